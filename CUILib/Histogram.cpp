@@ -85,24 +85,20 @@ void CHistogramViewer::Update()
 
 	C3DImage* im = m_img->GetImageSource()->Get3DImage();
 
+	// for out-of-core images this only samples part of the data
+	int pdf[256];
+	im->Histogram(pdf);
+
 	vector<double> h(256, 0.0);
-	for (int k = 0; k < im->Depth(); ++k)
-	{
-		for (int j = 0; j < im->Height(); ++j)
-			for (int i = 0; i < im->Width(); ++i)
-			{
-				int n = im->value(i, j, k);
-				h[n]++;
-			}
-	}
+	double N = 0.0;
+	for (int i = 0; i < 256; ++i) { h[i] = pdf[i]; N += pdf[i]; }
+	if (N == 0.0) N = 1.0;
 
 	if (m_logMode)
 	{
 		for (int i = 0; i < 256; ++i) h[i] = log(h[i] + 1.0);
 	}
 
-	double N = im->Depth()*im->Width()*im->Height();
-
 	QLineSeries* series = new QLineSeries();
 	for (int i = 0; i<256; ++i)
 		series->append(i, h[i] / N);
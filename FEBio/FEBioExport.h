@@ -59,6 +59,9 @@ public:
 	void SetPlotfileCompressionFlag(bool b);
 	void SetExportSelectionsFlag(bool b);
 
+	// set a callback for monitoring the progress of writing the large mesh sections
+	void SetProgressCallback(XMLProgressCallback* pcb) { m_xml.SetProgressCallback(pcb); }
+
 protected:
 	void WriteParam(Param& p);
 	void WriteParamList(ParamContainer& c);
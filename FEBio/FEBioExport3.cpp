@@ -53,6 +53,108 @@ FENodeList* BuildNodeList(GEdge* pe);
 FEFaceList* BuildFaceList(GFace* face);
 const char* ElementTypeString(int ntype);
 
+//-----------------------------------------------------------------------------
+// Leaf lists for writing the large mesh sections with XMLWriter::add_leaves.
+
+// nodes of a mesh: <node id="n">x,y,z</node>
+class NodeLeafList : public XMLLeafList
+{
+public:
+	NodeLeafList(FECoreMesh* pm, const Transform* T, int n0) : XMLLeafList("node", "id"), m_pm(pm), m_T(T), m_n0(n0) {}
+
+	int Leaves() const { return m_pm->Nodes(); }
+	int LeafID(int i) const { return m_n0 + i; }
+	char* LeafValue(int i, char* sz) const
+	{
+		vec3d r = m_pm->Node(i).r;
+		if (m_T) r = m_T->LocalToGlobal(r);
+		return XMLElement::format_value(sz, r);
+	}
+
+private:
+	FECoreMesh*			m_pm;
+	const Transform*	m_T;	// transform to global coordinates (or null)
+	int					m_n0;	// ID of first node
+};
+
+// elements of a mesh: <elem id="n">n1,n2,...</elem>
+// The nodes must have their export IDs assigned.
+class ElementLeafList : public XMLLeafList
+{
+public:
+	ElementLeafList(FECoreMesh* pm, const vector<int>& elem, int n0) : XMLLeafList("elem", "id"), m_pm(pm), m_elem(elem), m_n0(n0) {}
+
+	int Leaves() const { return (int)m_elem.size(); }
+	int LeafID(int i) const { return m_n0 + i; }
+	char* LeafValue(int i, char* sz) const
+	{
+		const FEElement_& el = m_pm->ElementRef(m_elem[i]);
+		int nn[FEElement::MAX_NODES];
+		int ne = el.Nodes();
+		for (int k = 0; k<ne; ++k) nn[k] = m_pm->Node(el.m_node[k]).m_nid;
+		return XMLElement::format_value(sz, nn, ne);
+	}
+
+private:
+	FECoreMesh*			m_pm;
+	const vector<int>&	m_elem;	// indices of elements to write
+	int					m_n0;	// ID of first element
+};
+
+// shell thickness: <e lid="n">h1,h2,...</e>
+class ShellThicknessLeafList : public XMLLeafList
+{
+public:
+	ShellThicknessLeafList(FECoreMesh* pm, const vector<int>& elem) : XMLLeafList("e", "lid"), m_pm(pm), m_elem(elem) {}
+
+	int Leaves() const { return (int)m_elem.size(); }
+	int LeafID(int i) const { return i + 1; }
+	char* LeafValue(int i, char* sz) const
+	{
+		const FEElement_& el = m_pm->ElementRef(m_elem[i]);
+		return XMLElement::format_value(sz, el.m_h, el.Nodes());
+	}
+
+private:
+	FECoreMesh*			m_pm;
+	const vector<int>&	m_elem;	// indices of shell elements
+};
+
+// element fibers in global coordinates: <e lid="n">x,y,z</e>
+class FiberLeafList : public XMLLeafList
+{
+public:
+	FiberLeafList(FECoreMesh* pm, const Transform& T, const vector<int>& elem) : XMLLeafList("e", "lid"), m_pm(pm), m_T(T), m_elem(elem) {}
+
+	int Leaves() const { return (int)m_elem.size(); }
+	int LeafID(int i) const { return i + 1; }
+	char* LeafValue(int i, char* sz) const
+	{
+		const FEElement_& el = m_pm->ElementRef(m_elem[i]);
+		return XMLElement::format_value(sz, m_T.LocalToGlobalNormal(el.m_fiber));
+	}
+
+private:
+	FECoreMesh*			m_pm;
+	const Transform&	m_T;
+	const vector<int>&	m_elem;
+};
+
+// scalar element data (FEElementData or FEPartData): <e lid="n">v</e>
+template <class T> class ElementDataLeafList : public XMLLeafList
+{
+public:
+	ElementDataLeafList(T& data, int n) : XMLLeafList("e", "lid"), m_data(data), m_n(n) {}
+
+	int Leaves() const { return m_n; }
+	int LeafID(int i) const { return i + 1; }
+	char* LeafValue(int i, char* sz) const { return XMLElement::format_value(sz, m_data[i]); }
+
+private:
+	T&		m_data;
+	int		m_n;
+};
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -2087,16 +2189,9 @@ void FEBioExport3::WriteGeometryObject(FEBioExport3::Part* part)
 	// Write the nodes
 	m_xml.add_branch("Nodes");
 	{
-		XMLElement el("node");
-		int nid = el.add_attribute("id", 0);
-		for (int j = 0; j<pm->Nodes(); ++j)
-		{
-			FENode& node = pm->Node(j);
-			el.set_attribute(nid, ++m_ntotnodes);
-			vec3d r = node.r;
-			el.value(r);
-			m_xml.add_leaf(el, false);
-		}
+		NodeLeafList nodes(pm, nullptr, m_ntotnodes + 1);
+		m_xml.add_leaves(nodes);
+		m_ntotnodes += pm->Nodes();
 	}
 	m_xml.close_branch();
 
@@ -2526,17 +2621,9 @@ void FEBioExport3::WriteGeometryNodes()
 
 		m_xml.add_branch(tagNodes);
 		{
-			XMLElement el("node");
-			int nid = el.add_attribute("id", 0);
-			for (int j = 0; j<pm->Nodes(); ++j, ++n)
-			{
-				FENode& node = pm->Node(j);
-				node.m_nid = n;
-				el.set_attribute(nid, n);
-				vec3d r = po->GetTransform().LocalToGlobal(node.r);
-				el.value(r);
-				m_xml.add_leaf(el, false);
-			}
+			NodeLeafList nodes(pm, &po->GetTransform(), n);
+			for (int j = 0; j<pm->Nodes(); ++j, ++n) pm->Node(j).m_nid = n;
+			m_xml.add_leaves(nodes);
 		}
 		m_xml.close_branch();
 	}
@@ -2672,7 +2759,6 @@ void FEBioExport3::WriteGeometryPart(Part* part, GPart* pg, bool writeMats, bool
 	// loop over unprocessed elements
 	int nset = 0;
 	int ncount = 0;
-	int nn[FEElement::MAX_NODES];
 	char szname[128] = { 0 };
 	for (int i = 0; ncount<NEP; ++i)
 	{
@@ -2716,21 +2802,15 @@ void FEBioExport3::WriteGeometryPart(Part* part, GPart* pg, bool writeMats, bool
 			xe.add_attribute("name", szname);
 			m_xml.add_branch(xe);
 			{
-				XMLElement xej("elem");
-				int n1 = xej.add_attribute("id", (int)0);
-
+				// collect the elements of this set
+				int eid0 = m_ntotelem + ncount + 1;
 				for (int j = i; j<NE; ++j)
 				{
 					FEElement_& ej = pm->ElementRef(j);
 					if ((ej.m_ntag == 1) && (ej.Type() == ntype))
 					{
 						int eid = m_ntotelem + ncount + 1;
-						xej.set_attribute(n1, eid);
-						int ne = ej.Nodes();
-						assert(ne == el.Nodes());
-						for (int k = 0; k<ne; ++k) nn[k] = pm->Node(ej.m_node[k]).m_nid;
-						xej.value(nn, ne);
-						m_xml.add_leaf(xej, false);
+						assert(ej.Nodes() == el.Nodes());
 						ej.m_ntag = -1;	// mark as processed
 						ej.m_nid = eid;
 						ncount++;
@@ -2738,6 +2818,9 @@ void FEBioExport3::WriteGeometryPart(Part* part, GPart* pg, bool writeMats, bool
 						es.m_elem.push_back(j);
 					}
 				}
+
+				ElementLeafList elems(pm, es.m_elem, eid0);
+				m_xml.add_leaves(elems);
 			}
 			m_xml.close_branch();
 
@@ -3074,20 +3157,15 @@ void FEBioExport3::WriteMeshDataShellThickness()
 			tag.add_attribute("elem_set", elset.m_name.c_str());
 			m_xml.add_branch(tag);
 			{
-				XMLElement el("e");
-				int n1 = el.add_attribute("lid", 0);
-
-				int nid = 1;
+				vector<int> shells;
 				for (int k = 0; k<(int)elset.m_elem.size(); ++k)
 				{
 					FEElement_& e = pm->ElementRef(elset.m_elem[k]);
-					if (e.IsShell())
-					{
-						el.set_attribute(n1, nid++);
-						el.value(e.m_h, e.Nodes());
-						m_xml.add_leaf(el, false);
-					}
+					if (e.IsShell()) shells.push_back(elset.m_elem[k]);
 				}
+
+				ShellThicknessLeafList leaves(pm, shells);
+				m_xml.add_leaves(leaves);
 			}
 			m_xml.close_branch();
 		}
@@ -3114,22 +3192,13 @@ void FEBioExport3::WriteMeshDataMaterialFibers()
 
 		if (ptiso && (ptiso->GetFiberMaterial()->m_naopt == FE_FIBER_USER))
 		{
-			int NE = (int)elSet.m_elem.size();
 			XMLElement tag("ElementData");
 			tag.add_attribute("var", "fiber");
 			tag.add_attribute("elem_set", elSet.m_name.c_str());
 			m_xml.add_branch(tag);
 			{
-				XMLElement el("e");
-				int nid = el.add_attribute("lid", 0);
-				for (int j = 0; j<NE; ++j)
-				{
-					FEElement_& e = pm->ElementRef(elSet.m_elem[j]);
-					vec3d a = T.LocalToGlobalNormal(e.m_fiber);
-					el.set_attribute(nid, j + 1);
-					el.value(a);
-					m_xml.add_leaf(el, false);
-				}
+				FiberLeafList leaves(pm, T, elSet.m_elem);
+				m_xml.add_leaves(leaves);
 			}
 			m_xml.close_branch(); // elem_data
 		}
@@ -3221,17 +3290,8 @@ void FEBioExport3::WriteElementDataFields()
 				tag.add_attribute("elem_set", data.GetName());
 				m_xml.add_branch(tag);
 				{
-					XMLElement el("e");
-					int nid = el.add_attribute("lid", 0);
-					FEItemListBuilder::ConstIterator it = pg->begin();
-					for (int j = 0; j < pg->size(); ++j, ++it)
-					{
-						int eid = *it;
-						FEElement_& e = pm->ElementRef(eid);
-						el.set_attribute(nid, j + 1);
-						el.value(data[j]);
-						m_xml.add_leaf(el, false);
-					}
+					ElementDataLeafList<FEElementData> leaves(data, pg->size());
+					m_xml.add_leaves(leaves);
 				}
 				m_xml.close_branch();
 			}
@@ -3246,15 +3306,8 @@ void FEBioExport3::WriteElementDataFields()
 				tag.add_attribute("elem_set", data.GetName());
 				m_xml.add_branch(tag);
 				{
-					XMLElement el("e");
-					int nid = el.add_attribute("lid", 0);
-					int N = pg->Size();
-					for (int j = 0; j < N; ++j)
-					{
-						el.set_attribute(nid, j + 1);
-						el.value(data[j]);
-						m_xml.add_leaf(el, false);
-					}
+					ElementDataLeafList<FEPartData> leaves(data, pg->Size());
+					m_xml.add_leaves(leaves);
 				}
 				m_xml.close_branch();
 
@@ -372,23 +372,33 @@ void FEBioFormat3::ParseGeometryNodes(FEBioModel::Part* part, XMLTag& tag)
 {
 	if (part == 0) throw XMLReader::InvalidTag(tag);
 
-	// first we need to figure out how many nodes there are
-	int nn = tag.children();
+	// read nodal coordinates
+	// (this is done in a single pass, so we don't have to count the children first)
+	vector<FEBioModel::NODE> nodes; nodes.reserve(10000);
+	++tag;
+	while (!tag.isend())
+	{
+		FEBioModel::NODE node;
+		tag.value(node.r);
+		int nid = tag.AttributeValue<int>("id", -1); assert(nid != -1);
+		node.id = nid;
+
+		nodes.push_back(node);
+		++tag;
+	}
 
 	// create nodes
+	int nn = (int)nodes.size();
 	FEMesh& mesh = *part->GetFEMesh();
 	int N0 = mesh.Nodes();
 	mesh.Create(N0 + nn, 0);
 
-	// read nodal coordinates
-	++tag;
 	for (int i = 0; i<nn; ++i)
 	{
+		FEBioModel::NODE& nd = nodes[i];
 		FENode& node = mesh.Node(N0 + i);
-		tag.value(node.r);
-		int nid = tag.AttributeValue<int>("id", -1); assert(nid != -1);
-		node.m_ntag = nid;
-		++tag;
+		node.m_ntag = nd.id;
+		node.r = nd.r;
 	}
 }
 
@@ -397,9 +407,6 @@ void FEBioFormat3::ParseGeometryElements(FEBioModel::Part* part, XMLTag& tag)
 {
 	if (part == 0) throw XMLReader::InvalidTag(tag);
 
-	// first we need to figure out how many elements there are
-	int elems = tag.children();
-
 	// get the required type attribute
 	const char* sztype = tag.AttributeValue("type");
 	FEElementType ntype = FE_INVALID_ELEMENT_TYPE;
@@ -486,33 +493,48 @@ void FEBioFormat3::ParseGeometryElements(FEBioModel::Part* part, XMLTag& tag)
 	// add domain to list
 	FEBioModel::Domain* dom = part->AddDomain(name, matID);
 
+	// read the elements
+	// (this is done in a single pass, so we don't have to count the children first)
+	FEElement tmp; tmp.SetType(ntype);
+	int nodes = tmp.Nodes();
+	vector<FEBioModel::ELEM> elem; elem.reserve(25000);
+	++tag;
+	while (!tag.isend())
+	{
+		FEBioModel::ELEM el;
+		if ((tag == "e") || (tag == "elem"))
+		{
+			el.id = tag.AttributeValue<int>("id", -1);
+			tag.value(el.n, nodes);
+			elem.push_back(el);
+		}
+		else throw XMLReader::InvalidTag(tag);
+
+		++tag;
+	}
+
 	// create elements
 	FEMesh& mesh = *part->GetFEMesh();
 	int NTE = mesh.Elements();
+	int elems = (int)elem.size();
 	mesh.Create(0, elems + NTE);
 
 	// generate the part id
 	int pid = part->Domains() - 1;
 
-	// read element data
-	++tag;
+	// copy element data
 	vector<int> elemSet; elemSet.reserve(elems);
 	for (int i = NTE; i<elems + NTE; ++i)
 	{
 		FEElement& el = mesh.Element(i);
+		FEBioModel::ELEM& els = elem[i - NTE];
 		el.SetType(ntype);
 		el.m_gid = pid;
 		dom->AddElement(i);
-		if ((tag == "e") || (tag == "elem"))
-		{
-			int id = tag.AttributeValue<int>("id", -1);
-			el.m_nid = id;
-			tag.value(el.m_node, el.Nodes());
-		}
-		else throw XMLReader::InvalidTag(tag);
+		el.m_nid = els.id;
+		for (int j = 0; j < nodes; ++j) el.m_node[j] = els.n[j];
 
 		elemSet.push_back(i);
-		++tag;
 	}
 
 	// create new element set
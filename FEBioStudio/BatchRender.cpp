@@ -0,0 +1,831 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#ifdef WIN32
+#include <glew.h>
+#endif
+#include "stdafx.h"
+#include "BatchRender.h"
+#include "PostDocument.h"
+#include "PostObject.h"
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLBuffer>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QFileInfo>
+#include <QDir>
+#ifdef __APPLE__
+#include <OpenGL/GLU.h>
+#else
+#include <GL/glu.h>
+#endif
+#include <XML/XMLReader.h>
+#include <XPLTLib/xpltFileReader.h>
+#include <PostLib/FEBioImport.h>
+#include <PostLib/FEVTKImport.h>
+#include <PostLib/FEPostModel.h>
+#include <PostLib/ImgAnimation.h>
+#include <PostLib/GIFAnimation.h>
+#include <PostLib/MPEGAnimation.h>
+#include <PostLib/AsyncAnimation.h>
+#include <PostGL/GLModel.h>
+#include <PostGL/GLColorMap.h>
+#include <PostGL/GLDisplacementMap.h>
+#include <PostGL/GLPlaneCutPlot.h>
+#include <PostGL/GLMirrorPlane.h>
+#include <PostGL/GLVectorPlot.h>
+#include <PostGL/GLTensorPlot.h>
+#include <PostGL/GLStreamLinePlot.h>
+#include <PostGL/GLParticleFlowPlot.h>
+#include <PostGL/GLVolumeFlowPlot.h>
+#include <PostGL/GLIsoSurfacePlot.h>
+#include <PostGL/GLSlicePLot.h>
+#include <PostLib/constants.h>
+#include <GLLib/GView.h>
+#include <GLLib/GLContext.h>
+#include <stdarg.h>
+
+//-----------------------------------------------------------------------------
+CBatchRender::CBatchRender()
+{
+	m_width = 1280;
+	m_height = 720;
+	m_samples = 4;
+	m_first = 0;
+	m_last = -1;
+	m_step = 1;
+	m_fps = 10.f;
+
+	m_view.bgcol = GLColor(255, 255, 255);
+	m_view.fgcol = GLColor(0, 0, 0);
+	m_view.bmesh = false;
+	m_view.boutline = true;
+	m_view.bortho = false;
+	m_view.btitle = true;
+	m_view.blegend = true;
+	m_view.nrender = 0;
+	m_view.fov = 45.0;
+	m_view.zoom = 1.0;
+	m_view.hasDir = m_view.hasQuat = m_view.hasTarget = m_view.hasDist = false;
+	m_view.dist = 0.0;
+
+	m_hasColormap = false;
+	m_hasDisp = false;
+
+	m_doc = nullptr;
+	m_anim = nullptr;
+
+	m_surface = nullptr;
+	m_context = nullptr;
+	m_fbo = nullptr;
+	m_resolve = nullptr;
+	m_pbo[0] = m_pbo[1] = nullptr;
+	m_frame[0].pending = m_frame[1].pending = false;
+}
+
+CBatchRender::~CBatchRender()
+{
+	DestroyContext();
+}
+
+//-----------------------------------------------------------------------------
+void CBatchRender::Log(const char* szformat, ...)
+{
+	va_list args;
+	va_start(args, szformat);
+	vprintf(szformat, args);
+	va_end(args);
+	fflush(stdout);
+}
+
+//-----------------------------------------------------------------------------
+bool CBatchRender::Run(const std::string& sessionFile)
+{
+	if (ReadSession(sessionFile) == false) return false;
+
+	if (CreateContext() == false)
+	{
+		Log("ERROR: Failed creating an OpenGL context.\n");
+#ifdef LINUX
+		if (getenv("DISPLAY") == nullptr) Log("No display was found. Run under an X server, e.g. xvfb-run.\n");
+#endif
+		DestroyContext();
+		return false;
+	}
+
+	bool bret = (LoadModel() && ApplySession() && CreateOutput());
+	if (bret)
+	{
+		// build the list of states
+		int NS = m_doc->GetStates();
+		int first = (m_first < 0 ? 0 : m_first);
+		int last = ((m_last < 0) || (m_last >= NS) ? NS - 1 : m_last);
+		int step = (m_step < 1 ? 1 : m_step);
+		std::vector<int> states;
+		for (int n = first; n <= last; n += step) states.push_back(n);
+		int frames = (int)states.size();
+
+		Log("Rendering %d frames to %s ...\n", frames, m_outputFile.c_str());
+		QElapsedTimer timer;
+		timer.start();
+
+		// While the GPU renders a state and copies its pixels to a pixel buffer, we finish 
+		// the previous frame and evaluate the next state. Finished frames go to the 
+		// encoder thread.
+		for (int i = 0; i < frames; ++i)
+		{
+			RenderState(states[i]);
+			StartReadBack(i % 2);
+
+			if ((i > 0) && (FinishReadBack((i - 1) % 2) == false)) { bret = false; break; }
+		}
+		if (bret && (frames > 0)) bret = FinishReadBack((frames - 1) % 2);
+
+		// this waits for the encoder to finish
+		m_anim->Close();
+
+		double sec = timer.elapsed() / 1000.0;
+		Log("%s: %d frames in %.1f s (%.1f frames/s)\n", (bret ? "Done" : "FAILED"), frames, sec, (sec > 0 ? frames / sec : 0.0));
+	}
+
+	DestroyContext();
+
+	return bret;
+}
+
+//-----------------------------------------------------------------------------
+bool CBatchRender::ReadSession(const std::string& sessionFile)
+{
+	QFileInfo fi(QString::fromStdString(sessionFile));
+	m_sessionPath = fi.absolutePath().toStdString();
+
+	XMLReader xml;
+	if (xml.Open(sessionFile.c_str()) == false)
+	{
+		Log("ERROR: Failed opening session file %s\n", sessionFile.c_str());
+		return false;
+	}
+
+	try {
+		XMLTag tag;
+		if (xml.FindTag("febiostudio_batch", tag) == false)
+		{
+			Log("ERROR: %s is not a batch session file.\n", sessionFile.c_str());
+			return false;
+		}
+
+		++tag;
+		do
+		{
+			if (tag == "model")
+			{
+				tag.value(m_modelFile);
+				++tag;
+			}
+			else if (tag == "output")
+			{
+				m_width = tag.AttributeValue<int>("width", m_width);
+				m_height = tag.AttributeValue<int>("height", m_height);
+				m_samples = tag.AttributeValue<int>("samples", m_samples);
+				m_fps = (float) tag.AttributeValue<double>("fps", m_fps);
+				tag.value(m_outputFile);
+				++tag;
+			}
+			else if (tag == "states")
+			{
+				m_first = tag.AttributeValue<int>("first", m_first);
+				m_last = tag.AttributeValue<int>("last", m_last);
+				m_step = tag.AttributeValue<int>("step", m_step);
+				++tag;
+			}
+			else if (tag == "view") ReadView(xml, tag);
+			else if (tag == "colormap") { m_hasColormap = true; ReadParams(xml, tag, m_colormap); }
+			else if (tag == "displacement") { m_hasDisp = true; ReadParams(xml, tag, m_disp); }
+			else if (tag == "plot")
+			{
+				PARAMS p;
+				const char* sztype = tag.AttributeValue("type");
+				p.type = sztype;
+				ReadParams(xml, tag, p);
+				m_plots.push_back(p);
+			}
+			else xml.SkipTag(tag);
+		}
+		while (!tag.isend());
+	}
+	catch (...)
+	{
+		Log("ERROR: Failed reading session file %s\n", sessionFile.c_str());
+		return false;
+	}
+
+	if (m_modelFile.empty()) { Log("ERROR: No model file defined.\n"); return false; }
+	if (m_outputFile.empty()) { Log("ERROR: No output file defined.\n"); return false; }
+	if ((m_width <= 0) || (m_height <= 0)) { Log("ERROR: Invalid output size.\n"); return false; }
+
+	// relative paths are relative to the session file
+	QDir dir(QString::fromStdString(m_sessionPath));
+	m_modelFile = QDir::cleanPath(dir.absoluteFilePath(QString::fromStdString(m_modelFile))).toStdString();
+	m_outputFile = QDir::cleanPath(dir.absoluteFilePath(QString::fromStdString(m_outputFile))).toStdString();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void CBatchRender::ReadView(XMLReader& xml, XMLTag& tag)
+{
+	VIEW& v = m_view;
+	if (tag.isleaf() || tag.isempty()) { ++tag; return; }
+
+	++tag;
+	do
+	{
+		if      (tag == "background"    ) tag.value(v.bgcol);
+		else if (tag == "foreground"    ) tag.value(v.fgcol);
+		else if (tag == "mesh"          ) tag.value(v.bmesh);
+		else if (tag == "outline"       ) tag.value(v.boutline);
+		else if (tag == "orthographic"  ) tag.value(v.bortho);
+		else if (tag == "title"         ) tag.value(v.btitle);
+		else if (tag == "legend"        ) tag.value(v.blegend);
+		else if (tag == "render_mode"   ) tag.value(v.nrender);
+		else if (tag == "fov"           ) tag.value(v.fov);
+		else if (tag == "zoom"          ) tag.value(v.zoom);
+		else if (tag == "view_direction") { tag.value(v.dir, 3); v.hasDir = true; }
+		else if (tag == "orientation"   ) { tag.value(v.quat, 4); v.hasQuat = true; }
+		else if (tag == "target"        ) { tag.value(v.target, 3); v.hasTarget = true; }
+		else if (tag == "distance"      ) { tag.value(v.dist); v.hasDist = true; }
+		else { xml.SkipTag(tag); continue; }
+		++tag;
+	}
+	while (!tag.isend());
+	++tag;
+}
+
+//-----------------------------------------------------------------------------
+void CBatchRender::ReadParams(XMLReader& xml, XMLTag& tag, PARAMS& p)
+{
+	if (tag.isleaf() || tag.isempty()) { ++tag; return; }
+
+	++tag;
+	do
+	{
+		if (tag == "param")
+		{
+			const char* szname = tag.AttributeValue("name");
+			std::string val;
+			tag.value(val);
+			p.values.push_back(std::pair<std::string, std::string>(szname, val));
+			++tag;
+		}
+		else xml.SkipTag(tag);
+	}
+	while (!tag.isend());
+	++tag;
+}
+
+//-----------------------------------------------------------------------------
+bool CBatchRender::LoadModel()
+{
+	m_doc = new CPostDocument(nullptr);
+
+	Post::FEFileReader* reader = nullptr;
+	QString ext = QFileInfo(QString::fromStdString(m_modelFile)).suffix();
+	if      (ext.compare("xplt", Qt::CaseInsensitive) == 0) reader = new xpltFileReader(m_doc->GetFEModel());
+	else if (ext.compare("feb" , Qt::CaseInsensitive) == 0) reader = new Post::FEBioImport(m_doc->GetFEModel());
+	else if ((ext.compare("vtk", Qt::CaseInsensitive) == 0) ||
+			 (ext.compare("vtu", Qt::CaseInsensitive) == 0)) reader = new Post::FEVTKimport(m_doc->GetFEModel());
+	else
+	{
+		Log("ERROR: Don't know how to read %s\n", m_modelFile.c_str());
+		return false;
+	}
+
+	Log("Reading %s ...\n", m_modelFile.c_str());
+	m_doc->SetFileReader(reader);
+	if (reader->Load(m_modelFile.c_str()) == false)
+	{
+		Log("ERROR: %s\n", reader->GetErrorMessage().c_str());
+		return false;
+	}
+
+	m_doc->SetDocFilePath(m_modelFile);
+	if ((m_doc->Initialize() == false) || (m_doc->IsValid() == false))
+	{
+		Log("ERROR: Failed initializing the model.\n");
+		return false;
+	}
+
+	Log("%d states read.\n", m_doc->GetStates());
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool CBatchRender::ApplySession()
+{
+	Post::CGLModel* glm = m_doc->GetGLModel();
+
+	if (m_hasDisp)
+	{
+		if (glm->GetDisplacementMap() == nullptr) glm->AddDisplacementMap();
+		Post::CGLDisplacementMap* dmap = glm->GetDisplacementMap();
+		if (dmap == nullptr) Log("WARNING: This model does not support displacement maps.\n");
+		else
+		{
+			ApplyParams(dmap, m_disp);
+		}
+	}
+
+	if (m_hasColormap)
+	{
+		Post::CGLColorMap* pc = glm->GetColorMap();
+		ApplyParams(pc, m_colormap);
+		pc->Activate(true);
+	}
+
+	for (size_t i = 0; i < m_plots.size(); ++i)
+	{
+		PARAMS& p = m_plots[i];
+
+		Post::CGLPlot* plot = nullptr;
+		if      (p.type == "planecut"    ) plot = new Post::CGLPlaneCutPlot(glm);
+		else if (p.type == "mirrorplane" ) plot = new Post::CGLMirrorPlane(glm);
+		else if (p.type == "vector"      ) plot = new Post::CGLVectorPlot(glm);
+		else if (p.type == "tensor"      ) plot = new Post::GLTensorPlot(glm);
+		else if (p.type == "streamlines" ) plot = new Post::CGLStreamLinePlot(glm);
+		else if (p.type == "particleflow") plot = new Post::CGLParticleFlowPlot(glm);
+		else if (p.type == "volumeflow"  ) plot = new Post::GLVolumeFlowPlot(glm);
+		else if (p.type == "isosurface"  ) plot = new Post::CGLIsoSurfacePlot(glm);
+		else if (p.type == "slice"       ) plot = new Post::CGLSlicePlot(glm);
+		else
+		{
+			Log("WARNING: Unknown plot type \"%s\"\n", p.type.c_str());
+			continue;
+		}
+
+		ApplyParams(plot, p);
+		glm->AddPlot(plot);
+	}
+
+	SetupCamera();
+
+	// update everything
+	m_doc->UpdateFEModel(true);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Set the parameters of an object and let it update its data
+bool CBatchRender::ApplyParams(FSObject* po, const PARAMS& p)
+{
+	bool bret = true;
+	for (size_t i = 0; i < p.values.size(); ++i)
+	{
+		if (SetParam(po, p.values[i].first, p.values[i].second) == false)
+		{
+			Log("WARNING: Invalid parameter \"%s\"\n", p.values[i].first.c_str());
+			bret = false;
+		}
+	}
+	po->UpdateData(true);
+	return bret;
+}
+
+//-----------------------------------------------------------------------------
+static bool is_number(const std::string& s)
+{
+	if (s.empty()) return false;
+	char* end = nullptr;
+	strtod(s.c_str(), &end);
+	return (*end == 0);
+}
+
+//-----------------------------------------------------------------------------
+// Set a parameter from its string value. Data fields, color maps and other 
+// enumerated values can be given by name.
+bool CBatchRender::SetParam(FSObject* po, const std::string& name, const std::string& val)
+{
+	Param* p = po->GetParam(name.c_str());
+	if (p == nullptr) return false;
+
+	const char* sz = val.c_str();
+	switch (p->GetParamType())
+	{
+	case Param_BOOL: p->SetBoolValue((val == "true") || (atoi(sz) != 0)); break;
+	case Param_FLOAT: p->SetFloatValue(atof(sz)); break;
+	case Param_INT:
+	case Param_CHOICE:
+	{
+		int n = atoi(sz);
+		const char* szenum = p->GetEnumNames();
+		if (szenum && (is_number(val) == false))
+		{
+			n = -1;
+			if (strncmp(szenum, "@data", 5) == 0) n = FindDataField(val);
+			else if (strcmp(szenum, "@color_map") == 0)
+			{
+				for (int i = 0; i < Post::ColorMapManager::ColorMaps(); ++i)
+				{
+					QString mapName = QString::fromStdString(Post::ColorMapManager::GetColorMapName(i));
+					if (mapName.compare(QString::fromStdString(val), Qt::CaseInsensitive) == 0) { n = i; break; }
+				}
+			}
+			else
+			{
+				// enum values are stored as a list of zero-terminated strings
+				for (int i = 0; *szenum; ++i, szenum += strlen(szenum) + 1)
+				{
+					if (val == szenum) { n = i; break; }
+				}
+			}
+			if (n == -1) return false;
+		}
+		p->SetIntValue(n);
+	}
+	break;
+	case Param_VEC3D:
+	{
+		vec3d v;
+		if (sscanf(sz, "%lg,%lg,%lg", &v.x, &v.y, &v.z) != 3) return false;
+		p->SetVec3dValue(v);
+	}
+	break;
+	case Param_COLOR:
+	{
+		int c[3];
+		if (sscanf(sz, "%d,%d,%d", &c[0], &c[1], &c[2]) != 3) return false;
+		p->SetColorValue(GLColor(c[0], c[1], c[2]));
+	}
+	break;
+	case Param_STRING: p->SetStringValue(val); break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Find a data field by name. Components are given by the name that is shown in
+// the data field selectors, e.g. "XX - Lagrange strain".
+int CBatchRender::FindDataField(const std::string& name)
+{
+	Post::FEDataManager& dm = *m_doc->GetFEModel()->GetDataManager();
+	Post::FEDataFieldPtr pd = dm.FirstDataField();
+	for (int i = 0; i < dm.DataFields(); ++i, ++pd)
+	{
+		Post::FEDataField& d = *(*pd);
+		if (d.GetName() == name) return BUILD_FIELD(d.DataClass(), i, 0);
+
+		int nc = d.components(Post::DATA_SCALAR);
+		for (int n = 0; n < nc; ++n)
+		{
+			if (d.componentName(n, Post::DATA_SCALAR) == name) return BUILD_FIELD(d.DataClass(), i, n);
+		}
+	}
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+void CBatchRender::SetupCamera()
+{
+	CGView& view = *m_doc->GetView();
+	CGLCamera& cam = view.GetCamera();
+	VIEW& v = m_view;
+
+	view.m_bortho = v.bortho;
+	view.m_fov = v.fov;
+
+	if (v.hasQuat) cam.SetOrientation(quatd(v.quat[0], v.quat[1], v.quat[2], v.quat[3]));
+	else if (v.hasDir) cam.SetViewDirection(vec3d(v.dir[0], v.dir[1], v.dir[2]));
+
+	if (v.hasTarget) cam.SetTarget(vec3d(v.target[0], v.target[1], v.target[2]));
+	if (v.hasDist) cam.SetTargetDistance(v.dist);
+	if (v.zoom > 0.0) cam.SetTargetDistance(cam.GetFinalTargetDistance() / v.zoom);
+
+	// we don't want the camera to animate
+	cam.Update(true);
+}
+
+//-----------------------------------------------------------------------------
+bool CBatchRender::CreateContext()
+{
+	QSurfaceFormat fmt;
+	fmt.setDepthBufferSize(24);
+	fmt.setStencilBufferSize(8);
+	fmt.setProfile(QSurfaceFormat::CompatibilityProfile);
+
+	m_context = new QOpenGLContext;
+	m_context->setFormat(fmt);
+	if (m_context->create() == false) return false;
+
+	m_surface = new QOffscreenSurface;
+	m_surface->setFormat(m_context->format());
+	m_surface->create();
+	if (m_surface->isValid() == false) return false;
+
+	if (m_context->makeCurrent(m_surface) == false) return false;
+
+#ifdef WIN32
+	glewInit();
+#endif
+
+	// The render target. If we are multi-sampling, we need a second target to resolve the samples.
+	QOpenGLFramebufferObjectFormat fboFormat;
+	fboFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	if (m_samples > 1) fboFormat.setSamples(m_samples);
+	m_fbo = new QOpenGLFramebufferObject(m_width, m_height, fboFormat);
+	if (m_fbo->isValid() == false) return false;
+
+	if (m_fbo->format().samples() > 1)
+	{
+		m_resolve = new QOpenGLFramebufferObject(m_width, m_height);
+		if (m_resolve->isValid() == false) return false;
+	}
+
+	// The pixel buffers allow us to read back a frame without waiting for the GPU.
+	// If we can't create them, we read back the frames directly.
+	for (int i = 0; i < 2; ++i)
+	{
+		m_pbo[i] = new QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer);
+		m_pbo[i]->setUsagePattern(QOpenGLBuffer::StreamRead);
+		if (m_pbo[i]->create())
+		{
+			m_pbo[i]->bind();
+			m_pbo[i]->allocate(m_width * m_height * 4);
+			m_pbo[i]->release();
+		}
+		else
+		{
+			delete m_pbo[i];
+			m_pbo[i] = nullptr;
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void CBatchRender::DestroyContext()
+{
+	// the GL objects need a current context to be released
+	if (m_context && m_surface && m_surface->isValid()) m_context->makeCurrent(m_surface);
+
+	delete m_anim; m_anim = nullptr;
+	delete m_doc; m_doc = nullptr;
+	for (int i = 0; i < 2; ++i) { delete m_pbo[i]; m_pbo[i] = nullptr; }
+	delete m_resolve; m_resolve = nullptr;
+	delete m_fbo; m_fbo = nullptr;
+
+	if (m_context) m_context->doneCurrent();
+	delete m_context; m_context = nullptr;
+	delete m_surface; m_surface = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+bool CBatchRender::CreateOutput()
+{
+	QString ext = QFileInfo(QString::fromStdString(m_outputFile)).suffix().toLower();
+
+	CAnimation* anim = nullptr;
+	if      (ext == "png") anim = new CPNGAnimation;
+	else if ((ext == "jpg") || (ext == "jpeg")) anim = new CJpgAnimation;
+	else if (ext == "bmp") anim = new CBmpAnimation;
+	else if (ext == "gif") anim = new CGIFAnimation;
+#ifdef FFMPEG
+	else if (ext == "mpg") anim = new CMPEGAnimation;
+#endif
+	else
+	{
+		Log("ERROR: Unsupported output format: %s\n", m_outputFile.c_str());
+		return false;
+	}
+
+	// make sure the output folder exists
+	QDir().mkpath(QFileInfo(QString::fromStdString(m_outputFile)).absolutePath());
+
+	// the frames are encoded on a background thread
+	m_anim = new CAsyncAnimation(anim);
+	if (m_anim->Create(m_outputFile.c_str(), m_width, m_height, m_fps) == 0)
+	{
+		Log("ERROR: Failed creating %s\n", m_outputFile.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate a state and render it into the frame buffer object
+void CBatchRender::RenderState(int nstate)
+{
+	m_doc->SetActiveState(nstate);
+
+	Post::CGLModel* glm = m_doc->GetGLModel();
+	CGView& view = *m_doc->GetView();
+	CGLCamera& cam = view.GetCamera();
+
+	m_fbo->bind();
+	glViewport(0, 0, m_width, m_height);
+
+	GLColor bg = m_view.bgcol;
+	glClearColor(bg.r / 255.f, bg.g / 255.f, bg.b / 255.f, 1.f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_CULL_FACE);
+
+	// setup the projection (same as in CGLView)
+	BOX box = m_doc->GetPostObject()->GetBoundingBox();
+	double R = box.Radius();
+	double L = (box.Center() - cam.GlobalPosition()).Length();
+	view.m_ffar = (L + R) * 2;
+	view.m_fnear = 0.01f*view.m_ffar;
+	view.m_ar = (GLfloat)m_width / (GLfloat)m_height;
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	if (view.m_bortho)
+	{
+		GLdouble f = 0.35*cam.GetTargetDistance();
+		glOrtho(-f*view.m_ar, f*view.m_ar, -f, f, view.m_fnear, view.m_ffar);
+	}
+	else gluPerspective(view.m_fov, view.m_ar, view.m_fnear, view.m_ffar);
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	// setup the lighting, using the default view settings
+	GLfloat specular[] = { 1.f, 1.f, 1.f, 1.f };
+	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
+	glMateriali(GL_FRONT_AND_BACK, GL_SHININESS, 32);
+
+	glEnable(GL_LIGHTING);
+	GLfloat lp[4] = { 0.5f, 0.5f, 1.f, 0.f };
+	GLfloat dv[4] = { 0.8f, 0.8f, 0.8f, 1.f };
+	GLfloat av[4] = { 0.09f, 0.09f, 0.09f, 1.f };
+	glLightfv(GL_LIGHT0, GL_POSITION, lp);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, dv);
+	glLightfv(GL_LIGHT0, GL_AMBIENT, av);
+
+	cam.Transform();
+
+	CGLContext rc;
+	rc.m_cam = &cam;
+	rc.m_q = cam.GetOrientation();
+	rc.m_showMesh = m_view.bmesh;
+	rc.m_showOutline = m_view.boutline;
+
+	// the GL model's render modes are offset by one
+	glm->SetRenderMode(m_view.nrender + 1);
+	glm->Render(rc);
+
+	Post::CGLPlaneCutPlot::DisableClipPlanes();
+
+	m_fbo->release();
+}
+
+//-----------------------------------------------------------------------------
+// Start copying the frame to a pixel buffer. This returns without waiting for the GPU.
+void CBatchRender::StartReadBack(int nslot)
+{
+	FRAME& f = m_frame[nslot];
+	f.state = m_doc->GetActiveState();
+	f.time = m_doc->GetTimeValue();
+	f.pending = true;
+
+	// the legend's range may change with the next state, so we store it
+	Post::CGLColorMap* pc = m_doc->GetGLModel()->GetColorMap();
+	pc->GetLegendBar()->GetRange(f.rng[0], f.rng[1]);
+
+	QOpenGLFramebufferObject* src = m_fbo;
+	if (m_resolve)
+	{
+		QOpenGLFramebufferObject::blitFramebuffer(m_resolve, m_fbo);
+		src = m_resolve;
+	}
+
+	if (m_pbo[nslot])
+	{
+		src->bind();
+		m_pbo[nslot]->bind();
+		glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		m_pbo[nslot]->release();
+		src->release();
+		glFlush();
+	}
+	else f.im = src->toImage();
+}
+
+//-----------------------------------------------------------------------------
+// Copy the pixels of a frame, draw the overlay and pass it on to the encoder.
+bool CBatchRender::FinishReadBack(int nslot)
+{
+	FRAME& f = m_frame[nslot];
+	if (f.pending == false) return true;
+	f.pending = false;
+
+	if (m_pbo[nslot])
+	{
+		m_pbo[nslot]->bind();
+		const uchar* src = (const uchar*)m_pbo[nslot]->map(QOpenGLBuffer::ReadOnly);
+		if (src)
+		{
+			// OpenGL's rows are bottom to top
+			f.im = QImage(m_width, m_height, QImage::Format_RGBA8888);
+			int rowSize = 4 * m_width;
+			for (int j = 0; j < m_height; ++j)
+			{
+				memcpy(f.im.scanLine(m_height - j - 1), src + j*rowSize, rowSize);
+			}
+			m_pbo[nslot]->unmap();
+		}
+		m_pbo[nslot]->release();
+
+		if (src == nullptr)
+		{
+			Log("ERROR: Failed reading back frame of state %d\n", f.state + 1);
+			return false;
+		}
+	}
+
+	DrawOverlay(f.im, f);
+
+	if (m_anim->Write(f.im) == 0)
+	{
+		Log("ERROR: Failed writing frame of state %d\n", f.state + 1);
+		return false;
+	}
+
+	// the encoder has its own reference to the image
+	f.im = QImage();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Draw the title and legend on a frame
+void CBatchRender::DrawOverlay(QImage& im, const FRAME& frame)
+{
+	if ((m_view.btitle == false) && (m_view.blegend == false)) return;
+
+	QPainter painter(&im);
+	painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+
+	GLColor fg = m_view.fgcol;
+	painter.setPen(QPen(QColor::fromRgb(fg.r, fg.g, fg.b)));
+
+	if (m_view.btitle)
+	{
+		QString title = QString::fromStdString(m_doc->GetDocFileBase());
+		QString field = QString::fromStdString(m_doc->GetFieldString());
+		QString txt = QString("%1\n%2\nTime = %3").arg(title).arg(field).arg(frame.time, 0, 'g', 4);
+		painter.drawText(QRect(10, 10, m_width - 20, m_height - 20), Qt::AlignLeft | Qt::AlignTop, txt);
+	}
+
+	Post::CGLColorMap* pc = m_doc->GetGLModel()->GetColorMap();
+	if (m_view.blegend && pc->IsActive() && pc->ShowLegend())
+	{
+		GLLegendBar* bar = pc->GetLegendBar();
+
+		float rng[2];
+		bar->GetRange(rng[0], rng[1]);
+		bar->SetRange(frame.rng[0], frame.rng[1]);
+
+		int h = (m_height - 40 < 600 ? m_height - 40 : 600);
+		bar->resize(m_width - 130, (m_height - h) / 2, 120, h);
+		bar->draw(&painter);
+
+		bar->SetRange(rng[0], rng[1]);
+	}
+
+	painter.end();
+}
@@ -0,0 +1,177 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#pragma once
+#include <QImage>
+#include <FSCore/color.h>
+#include <string>
+#include <vector>
+
+class CPostDocument;
+class CAnimation;
+class XMLReader;
+class XMLTag;
+class FSObject;
+class QOpenGLContext;
+class QOffscreenSurface;
+class QOpenGLFramebufferObject;
+class QOpenGLBuffer;
+
+//-----------------------------------------------------------------------------
+// Renders the states of a plot file to an image sequence or animation file,
+// without opening a window. This is what runs when FEBio Studio is started 
+// with the -batch option. The model, the output and the post-processing 
+// settings are read from a batch session file, e.g.:
+//
+// <febiostudio_batch>
+//   <model>run.xplt</model>
+//   <output width="1280" height="720" samples="4">frames/run.png</output>
+//   <states first="0" last="-1" step="1"/>
+//   <view>
+//     <background>255,255,255</background>
+//     <view_direction>0,-1,0</view_direction>
+//     <zoom>1.2</zoom>
+//   </view>
+//   <displacement>
+//     <param name="Scale factor">1</param>
+//   </displacement>
+//   <colormap>
+//     <param name="Data field">ZZ - Lagrange strain</param>
+//     <param name="Color map">Jet</param>
+//   </colormap>
+//   <plot type="planecut">
+//     <param name="X-normal">1</param>
+//   </plot>
+// </febiostudio_batch>
+//
+// Relative paths are relative to the session file. The output's file extension
+// determines the format (png, jpg and bmp write numbered images, gif and mpg 
+// write a single animation file).
+//
+// No window is opened, but an OpenGL context is still needed. On Linux this
+// requires an X server. On a machine without a display, use a virtual one,
+// e.g. xvfb-run FEBioStudio -batch session.xml.
+//
+// The frames are rendered in a pipeline: while the GPU renders a state and reads
+// back its pixels, the next state is evaluated on the CPU, and the finished 
+// frames are encoded on a background thread.
+class CBatchRender
+{
+	// a frame whose pixels are being read back
+	struct FRAME
+	{
+		int		state;		// the state that was rendered
+		float	time;		// the time value of that state
+		float	rng[2];		// legend range
+		bool	pending;	// is the read back in progress
+		QImage	im;			// the frame's image
+	};
+
+	// view options
+	struct VIEW
+	{
+		GLColor	bgcol;		// background color
+		GLColor	fgcol;		// text color
+		bool	bmesh;		// render mesh lines
+		bool	boutline;	// render outline
+		bool	bortho;		// orthographic projection
+		bool	btitle;		// render the title and time
+		bool	blegend;	// render the color map legend
+		int		nrender;	// render mode (0 = solid, 1 = wireframe)
+		double	fov;		// field of view
+		double	zoom;		// zoom factor (divides the camera distance)
+		bool	hasDir, hasQuat, hasTarget, hasDist;
+		double	dir[3];		// view direction
+		double	quat[4];	// camera orientation
+		double	target[3];	// camera target
+		double	dist;		// camera distance
+	};
+
+	// parameter values for a post-processing object
+	struct PARAMS
+	{
+		std::string	type;
+		std::vector< std::pair<std::string, std::string> >	values;
+	};
+
+public:
+	CBatchRender();
+	~CBatchRender();
+
+	// run the session. Returns false if anything went wrong.
+	bool Run(const std::string& sessionFile);
+
+private:
+	bool ReadSession(const std::string& sessionFile);
+	void ReadView(XMLReader& xml, XMLTag& tag);
+	void ReadParams(XMLReader& xml, XMLTag& tag, PARAMS& p);
+
+	bool LoadModel();
+	bool ApplySession();
+	bool ApplyParams(FSObject* po, const PARAMS& p);
+	bool SetParam(FSObject* po, const std::string& name, const std::string& val);
+	int FindDataField(const std::string& name);
+	void SetupCamera();
+
+	bool CreateContext();
+	void DestroyContext();
+
+	bool CreateOutput();
+
+	void RenderState(int nstate);
+	void StartReadBack(int nslot);
+	bool FinishReadBack(int nslot);
+	void DrawOverlay(QImage& im, const FRAME& frame);
+
+	void Log(const char* szformat, ...);
+
+private:
+	std::string		m_sessionPath;	// folder of the session file
+	std::string		m_modelFile;
+	std::string		m_outputFile;
+	int				m_width, m_height;
+	int				m_samples;		// nr of multi-samples
+	int				m_first, m_last, m_step;
+	float			m_fps;
+	VIEW			m_view;
+
+	bool				m_hasColormap;
+	bool				m_hasDisp;
+	PARAMS				m_colormap;
+	PARAMS				m_disp;
+	std::vector<PARAMS>	m_plots;
+
+	CPostDocument*	m_doc;
+	CAnimation*		m_anim;
+
+	QOffscreenSurface*			m_surface;
+	QOpenGLContext*				m_context;
+	QOpenGLFramebufferObject*	m_fbo;		// render target
+	QOpenGLFramebufferObject*	m_resolve;	// resolves the multi-sampled render target
+	QOpenGLBuffer*				m_pbo[2];	// pixel buffers for reading back frames
+	FRAME						m_frame[2];
+};
@@ -323,28 +323,39 @@ int CDlgImportLines::ReadAng2Format(const char* szfile)
 
 		// read the segments
 		int nd = 6 + 2 * ndataFields;
-		vector<float> d(nd, 0.f);
+		vector<float> d((size_t)segs*nd, 0.f);
+		if ((segs > 0) && (fread(&d[0], sizeof(float), d.size(), fp) != d.size())) { nret = 2; break; }
+
+		// find the elements of all the end points in one go
+		vector<vec3f> x(2 * (size_t)segs);
 		for (int i = 0; i<segs; ++i)
 		{
-			if (fread(&d[0], sizeof(float), nd, fp) != nd) { fclose(fp); nret = 2; break; }
+			const float* c = &d[(size_t)i*nd];
+			x[2 * i    ] = vec3f(c[0], c[1], c[2]); c += 3 + ndataFields;
+			x[2 * i + 1] = vec3f(c[0], c[1], c[2]);
+		}
+		vector<int> iel;
+		vector<vec3d> q;
+		find.FindElements(x, iel, q);
 
-			// store the raw coordinates
-			float* c = &d[0];
-			vec3f a0 = vec3f(c[0], c[1], c[2]); c += 3 + ndataFields;
-			vec3f b0 = vec3f(c[0], c[1], c[2]);
+		for (int i = 0; i<segs; ++i)
+		{
+			const float* c = &d[(size_t)i*nd];
 
 			float va = 0.f, vb = 0.f;
 			if (ndataFields > 0)
 			{
-				va = d[3];
-				vb = d[6 + ndataFields];
+				va = c[3];
+				vb = c[6 + ndataFields];
 			}
 
 			FRAG a, b;
 			a.user_data = va;
 			b.user_data = vb;
-			if (find.FindElement(a0, a.iel, a.r) == false) a.iel = -1;
-			if (find.FindElement(b0, b.iel, b.r) == false) b.iel = -1;
+			a.iel = iel[2 * i];
+			a.r[0] = q[2 * i].x; a.r[1] = q[2 * i].y; a.r[2] = q[2 * i].z;
+			b.iel = iel[2 * i + 1];
+			b.r[0] = q[2 * i + 1].x; b.r[1] = q[2 * i + 1].y; b.r[2] = q[2 * i + 1].z;
 			raw.push_back(pair<FRAG, FRAG>(a, b));
 
 			// convert them to global coordinates
@@ -354,7 +365,6 @@ int CDlgImportLines::ReadAng2Format(const char* szfile)
 			// add the line data
 			s.AddLine(r0, r1, va, vb, a.iel, b.iel);
 		}
-		if (nret != 1) break;
 
 		// next state
 		nstate++;
@@ -31,6 +31,7 @@ SOFTWARE.*/
 #include <QDialogButtonBox>
 #include <QBoxLayout>
 #include <QLabel>
+#include <QComboBox>
 
 
 // converts a string to a list of numbers. 
@@ -102,6 +103,7 @@ public:
 	QRadioButton* pb2;
 	QRadioButton* pb3;
 	QLineEdit* pitems;
+	QComboBox* pstorage;
 
 public:
 	void setupUi(QDialog* parent)
@@ -119,6 +121,14 @@ public:
 		pv->addWidget(pitems = new QLineEdit);
 		pv->addWidget(new QLabel("(e.g.:1,2,3:6,10:100:5)"));
 
+		QHBoxLayout* ph = new QHBoxLayout;
+		ph->addWidget(new QLabel("State data storage:"));
+		ph->addWidget(pstorage = new QComboBox);
+		pstorage->addItem("Full precision (32-bit)");
+		pstorage->addItem("Half precision (16-bit)");
+		pstorage->addItem("Quantized (16-bit)");
+		pv->addLayout(ph);
+
 		QDialogButtonBox* bb = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
 
 		pv->addWidget(bb);
@@ -147,5 +157,7 @@ void CDlgImportXPLT::accept()
 	strcpy(buf, s.c_str());
 	string_to_int_list(buf, m_item);
 
+	m_storage = ui->pstorage->currentIndex();
+
 	QDialog::accept();
 }
@@ -42,6 +42,7 @@ public:
 public:
 	int					m_nop;
 	std::vector<int>	m_item;
+	int					m_storage;
 
 private:
 	Ui::CDlgImportXPLT* ui;
@@ -40,6 +40,7 @@ public:
 
 public:
 	int	m_nx, m_ny, m_nz;
+	int	m_type;		// voxel type (see C3DImage::VoxelType)
 	double	m_x0, m_y0, m_z0;
 	double	m_w, m_h, m_d;
 
@@ -26,6 +26,7 @@ SOFTWARE.*/
 
 #include "stdafx.h"
 #include "DlgVTKExport.h"
+#include <PostLib/FEVTKExport.h>
 #include <QBoxLayout>
 #include <QCheckBox>
 #include <QDialogButtonBox>
@@ -35,14 +36,30 @@ class Ui::CDlgVTKExport
 public:
 	QCheckBox* shellThick;
 	QCheckBox* scalarData;
+	QCheckBox* binary;
+	QCheckBox* allStates;
 
 public:
-	void setupUi(QWidget* parent)
+	void setupUi(QWidget* parent, int mode)
 	{
 		QVBoxLayout* lo = new QVBoxLayout;
 
-		lo->addWidget(shellThick = new QCheckBox("Shell thickness"));
-		lo->addWidget(scalarData = new QCheckBox("Scalar data"));
+		shellThick = scalarData = allStates = nullptr;
+		if (mode == ::CDlgVTKExport::MESH_EXPORT)
+		{
+			lo->addWidget(shellThick = new QCheckBox("Shell thickness"));
+			lo->addWidget(scalarData = new QCheckBox("Scalar data"));
+			lo->addWidget(binary = new QCheckBox("Binary"));
+		}
+		else
+		{
+			lo->addWidget(allStates = new QCheckBox("Export all states"));
+			if (mode == ::CDlgVTKExport::POST_XML_EXPORT)
+				lo->addWidget(binary = new QCheckBox("Data compression (zlib)"));
+			else
+				lo->addWidget(binary = new QCheckBox("Binary"));
+			binary->setChecked(true);
+		}
 
 		QDialogButtonBox* bb = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
 		lo->addWidget(bb);
@@ -54,15 +71,34 @@ public:
 	}
 };
 
-CDlgVTKExport::CDlgVTKExport(QWidget* parent) : QDialog(parent), ui(new Ui::CDlgVTKExport)
+CDlgVTKExport::CDlgVTKExport(QWidget* parent, int mode) : QDialog(parent), ui(new Ui::CDlgVTKExport)
 {
-	ui->setupUi(this);
+	m_bshell_thick = false;
+	m_bscalar_data = false;
+	m_bbinary = false;
+	m_ballStates = false;
+	m_format = Post::FEVTKExport::VTK_ASCII;
+	m_mode = mode;
+
+	ui->setupUi(this, mode);
 }
 
 void CDlgVTKExport::accept()
 {
-	m_bshell_thick = ui->shellThick->isChecked();
-	m_bscalar_data = ui->scalarData->isChecked();
+	m_bbinary = ui->binary->isChecked();
+	if (m_mode == MESH_EXPORT)
+	{
+		m_bshell_thick = ui->shellThick->isChecked();
+		m_bscalar_data = ui->scalarData->isChecked();
+	}
+	else
+	{
+		m_ballStates = ui->allStates->isChecked();
+		if (m_mode == POST_XML_EXPORT)
+			m_format = (m_bbinary ? Post::FEVTKExport::VTU_ZLIB : Post::FEVTKExport::VTU_RAW);
+		else
+			m_format = (m_bbinary ? Post::FEVTKExport::VTK_BINARY : Post::FEVTKExport::VTK_ASCII);
+	}
 
 	QDialog::accept();
 }
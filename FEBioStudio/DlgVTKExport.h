@@ -34,14 +34,28 @@ namespace Ui {
 class CDlgVTKExport : public QDialog
 {
 public:
-	CDlgVTKExport(QWidget* parent);
+	// which options the dialog shows
+	enum Mode {
+		MESH_EXPORT,		// export of the model's mesh
+		POST_LEGACY_EXPORT,	// export of post states to legacy VTK files
+		POST_XML_EXPORT		// export of post states to VTK XML (.vtu) files
+	};
+
+public:
+	CDlgVTKExport(QWidget* parent, int mode = MESH_EXPORT);
 
 	void accept();
 
 public:
 	bool	m_bshell_thick;
 	bool	m_bscalar_data;
+	bool	m_bbinary;		// binary (legacy) or compressed (XML) data
+
+	// post export only
+	bool	m_ballStates;	// export all states
+	int		m_format;		// one of Post::FEVTKExport::FileFormat
 
 private:
+	int		m_mode;
 	Ui::CDlgVTKExport*	ui;
 };
@@ -756,7 +756,7 @@ void CDocument::LoadResources(IArchive& ar)
 
 //-----------------------------------------------------------------------------
 // import image data
-Post::CImageModel* CDocument::ImportImage(const std::string& fileName, int nx, int ny, int nz, BOX box)
+Post::CImageModel* CDocument::ImportImage(const std::string& fileName, int nx, int ny, int nz, BOX box, int voxelType)
 {
 	static int n = 1;
 
@@ -764,7 +764,7 @@ Post::CImageModel* CDocument::ImportImage(const std::string& fileName, int nx, i
 	string relFile = FSDir::makeRelative(fileName, "$(ProjectDir)");
 
 	Post::CImageModel* po = new Post::CImageModel(nullptr);
-	if (po->LoadImageData(relFile, nx, ny, nz, box) == false)
+	if (po->LoadImageData(relFile, nx, ny, nz, box, voxelType) == false)
 	{
 		delete po;
 		return nullptr;
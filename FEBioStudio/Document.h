@@ -148,7 +148,7 @@ public:
 	bool loadPriorAutoSave();
 
 	// import image data
-	Post::CImageModel* ImportImage(const std::string& fileName, int nx, int ny, int nz, BOX box);
+	Post::CImageModel* ImportImage(const std::string& fileName, int nx, int ny, int nz, BOX box, int voxelType = 0);
 
 	// set the document's title
 	void SetDocTitle(const std::string& t);
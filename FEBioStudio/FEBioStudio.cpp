@@ -32,6 +32,7 @@ SOFTWARE.*/
 #include <QFileDialog>
 #include "MainWindow.h"
 #include "FEBioStudio.h"
+#include "BatchRender.h"
 #include <stdio.h>
 #include <PostLib/PostView.h>
 #include <FSCore/FSDir.h>
@@ -75,6 +76,17 @@ int main(int argc, char* argv[])
 	FEElementLibrary::InitLibrary();
 	Post::Initialize();
 
+	// In batch mode we render a session file without opening any windows
+	for (int i = 1; i < argc - 1; ++i)
+	{
+		if (strcmp(argv[i], "-batch") == 0)
+		{
+			QApplication app(argc, argv);
+			CBatchRender batch;
+			return (batch.Run(argv[i + 1]) ? 0 : 1);
+		}
+	}
+
 #ifndef __APPLE__
 
 	QGuiApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
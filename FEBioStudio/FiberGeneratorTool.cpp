@@ -189,7 +189,10 @@ void CFiberGeneratorTool::OnApply()
 
 	// solve Laplace equation
 	LaplaceSolver L;
-	L.Solve(pm, val, bn);
+	if (L.Solve(pm, val, bn) == false)
+	{
+		QMessageBox::warning(GetMainWindow(), "Tool", QString("The Laplace solver did not converge (relative residual = %1).").arg(L.RelativeResidual()));
+	}
 
 	// create node data
 	FENodeData data(m_po);
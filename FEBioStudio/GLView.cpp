@@ -59,6 +59,9 @@ SOFTWARE.*/
 #include <QMenu>
 #include <QMessageBox>
 #include <PostLib/ImageModel.h>
+#include <PostLib/ImagePyramid.h>
+#include <PostLib/AsyncAnimation.h>
+#include <QOpenGLBuffer>
 #include "PostDocument.h"
 #include <PostGL/GLPlaneCutPlot.h>
 #include <PostGL/GLModel.h>
@@ -450,6 +453,9 @@ CGLView::CGLView(CMainWindow* pwnd, QWidget* parent) : QOpenGLWidget(parent), m_
 	m_video       = nullptr;
 	m_videoMode   = VIDEO_STOPPED;
 	m_videoFormat = GL_RGB;
+
+	m_pbo[0] = m_pbo[1] = nullptr;
+	m_pendingFrame = -1;
 }
 
 CGLView::~CGLView()
@@ -1394,12 +1400,14 @@ QImage CGLView::CaptureScreen()
 
 bool CGLView::NewAnimation(const char* szfile, CAnimation* video, GLenum fmt)
 {
-	m_video = video;
+	// frames are encoded on a background thread so that rendering does not wait for the encoder
+	m_video = new CAsyncAnimation(video);
+	m_pendingFrame = -1;
 	SetVideoFormat(fmt);
 
-	// get the width/height of the animation
-	int cx = width();
-	int cy = height();
+	// get the width/height of the animation (in device pixels)
+	int cx = m_dpr*width();
+	int cy = m_dpr*height();
 	if (m_pframe && m_pframe->visible())
 	{
 		cx = m_dpr*m_pframe->w();
@@ -1411,6 +1419,8 @@ bool CGLView::NewAnimation(const char* szfile, CAnimation* video, GLenum fmt)
 	if (m_pWnd->GetPostDocument()) fps = m_pWnd->GetPostDocument()->GetTimeSettings().m_fps;
 	if (fps == 0.f) fps = 10.f;
 
+	m_captureSize = QSize(cx, cy);
+
 	// create the animation
 	if (m_video->Create(szfile, cx, cy, fps) == false)
 	{
@@ -1460,6 +1470,11 @@ void CGLView::StopAnimation()
 		// stop the animation
 		m_videoMode = VIDEO_STOPPED;
 
+		// write the last frame that is still in the readback buffers
+		makeCurrent();
+		FlushFrame();
+		ReleaseFrameBuffers();
+
 		if (m_video->Frames() == 0)
 		{
 			QMessageBox::warning(this, "FEBio Studio", "This animation contains no frames. Only an empty video file was saved.");
@@ -1485,11 +1500,107 @@ void CGLView::PauseAnimation()
 	{
 		// pause the recording
 		m_videoMode = VIDEO_PAUSED;
+
+		makeCurrent();
+		FlushFrame();
 		m_pframe->SetState(GLSafeFrame::FIXED_SIZE);
 		repaint();
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Starts an asynchronous readback of the recorded region into one pixel buffer
+// and writes the frame that was captured in the other buffer during the previous
+// call. This way the GPU transfer of a frame overlaps with rendering the next one.
+bool CGLView::QueueFrame()
+{
+	int W = m_captureSize.width();
+	int H = m_captureSize.height();
+
+	// create the pixel buffers when they are first needed
+	for (int i = 0; i < 2; ++i)
+	{
+		if (m_pbo[i]) continue;
+		m_pbo[i] = new QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer);
+		m_pbo[i]->setUsagePattern(QOpenGLBuffer::StreamRead);
+		if (m_pbo[i]->create())
+		{
+			m_pbo[i]->bind();
+			m_pbo[i]->allocate(W * H * 4);
+			m_pbo[i]->release();
+		}
+		else
+		{
+			ReleaseFrameBuffers();
+			break;
+		}
+	}
+
+	// without pixel buffers, we have to read the frame synchronously
+	if (m_pbo[0] == nullptr)
+	{
+		glFlush();
+		QImage im = CaptureScreen();
+		return (m_video->Write(im) != 0);
+	}
+
+	// OpenGL's origin is the lower-left corner
+	int x = 0;
+	int y = m_dpr*height() - H;
+	if (m_pframe && m_pframe->visible())
+	{
+		x = m_dpr*m_pframe->x();
+		y = m_dpr*(height() - m_pframe->y() - m_pframe->h());
+	}
+
+	int n = (m_pendingFrame == 0 ? 1 : 0);
+	m_pbo[n]->bind();
+	glReadPixels(x, y, W, H, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	m_pbo[n]->release();
+
+	// write the previous frame while this one is being transferred
+	bool bret = FlushFrame();
+	m_pendingFrame = n;
+
+	return bret;
+}
+
+//-----------------------------------------------------------------------------
+// write the frame that is waiting in the pixel buffers (if any)
+bool CGLView::FlushFrame()
+{
+	if ((m_pendingFrame < 0) || (m_video == nullptr)) return true;
+
+	QOpenGLBuffer* pbo = m_pbo[m_pendingFrame];
+	m_pendingFrame = -1;
+	if (pbo == nullptr) return false;
+
+	int W = m_captureSize.width();
+	int H = m_captureSize.height();
+
+	QImage im(W, H, QImage::Format_RGBA8888);
+	pbo->bind();
+	const uchar* src = (const uchar*) pbo->map(QOpenGLBuffer::ReadOnly);
+	if (src)
+	{
+		// OpenGL's rows are bottom to top
+		for (int j = 0; j < H; ++j)
+			memcpy(im.scanLine(H - 1 - j), src + j*W*4, W*4);
+		pbo->unmap();
+	}
+	pbo->release();
+	if (src == nullptr) return false;
+
+	return (m_video->Write(im) != 0);
+}
+
+//-----------------------------------------------------------------------------
+void CGLView::ReleaseFrameBuffers()
+{
+	for (int i = 0; i < 2; ++i) { delete m_pbo[i]; m_pbo[i] = nullptr; }
+	m_pendingFrame = -1;
+}
+
 //-----------------------------------------------------------------------------
 void CGLView::repaintEvent()
 {
@@ -1650,9 +1761,7 @@ void CGLView::paintGL()
 
 	if ((m_videoMode == VIDEO_RECORDING) && (m_video != 0))
 	{
-		glFlush();
-		QImage im = CaptureScreen();
-		if (m_video->Write(im) == false)
+		if (QueueFrame() == false)
 		{
 			StopAnimation();
 			QMessageBox::critical(this, "FEBio Studio", "An error occurred while recording.");
@@ -1679,6 +1788,11 @@ void CGLView::paintGL()
 		cam.Update();
 		QTimer::singleShot(50, this, SLOT(repaintEvent()));
 	}
+	else if (Post::CImagePyramid::IsRefining())
+	{
+		// image data is being refined in the background, so keep redrawing until it's done
+		QTimer::singleShot(100, this, SLOT(repaintEvent()));
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -47,6 +47,7 @@ class CPostDocument;
 class GMaterial;
 class GDecoration;
 class CGView;
+class QOpenGLBuffer;
 
 // coordinate system modes
 #define COORD_GLOBAL	0
@@ -394,6 +395,13 @@ public:
 	VIDEO_MODE RecordingMode() const;
 	bool HasRecording() const;
 
+protected:
+	// asynchronous frame capture during recording
+	bool QueueFrame();
+	bool FlushFrame();
+	void ReleaseFrameBuffers();
+
+public:
 	void UpdateWidgets(bool bposition = true);
 
 	bool isTitleVisible() const;
@@ -507,6 +515,11 @@ private:
 	VIDEO_MODE		m_videoMode;	// the current video mode
 	CAnimation*		m_video;		// video object
 
+	// double-buffered pixel readback for recording
+	QOpenGLBuffer*	m_pbo[2];		// pixel pack buffers
+	int				m_pendingFrame;	// buffer holding a frame that was not written yet (or -1)
+	QSize			m_captureSize;	// size of the recorded frames (in device pixels)
+
 	// tracking
 	bool	m_btrack;
 	int		m_ntrack[3];
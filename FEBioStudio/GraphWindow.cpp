@@ -1670,6 +1670,36 @@ void CModelGraphWindow::addObjectData(int n)
 	for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
 }
 
+//-----------------------------------------------------------------------------
+// x-data for time (m_xtype == 0) or step (m_xtype == 1) graphs
+void CModelGraphWindow::timeAxisData(vector<float>& xdata, int nsteps)
+{
+	CPostDocument* doc = GetPostDoc();
+	Post::FEPostModel& fem = *doc->GetFEModel();
+
+	xdata.resize(nsteps);
+	if (m_xtype == 0)
+	{
+		for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+	}
+	else
+	{
+		for (int j = 0; j < nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// The y-field is cached (item-major) when it is plotted again for a large selection, 
+// so that subsequent updates (e.g. selection changes) don't need to visit all states.
+void CModelGraphWindow::updateHistoryCache(int itemClass, int items, int selected)
+{
+	if ((m_dataY != m_dataYPrev) || (m_xtype == 3)) return;
+	if ((selected < 1000) && (10 * selected < items)) return;
+
+	CPostDocument* doc = GetPostDoc();
+	doc->GetFEModel()->BuildHistoryCache((Post::Data_Class)itemClass, m_dataY);
+}
+
 //-----------------------------------------------------------------------------
 void CModelGraphWindow::addSelectedNodes()
 {
@@ -1677,138 +1707,87 @@ void CModelGraphWindow::addSelectedNodes()
 	Post::FEPostModel& fem = *doc->GetFEModel();
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
-	int nsteps = m_lastState - m_firstState + 1;
-	vector<float> xdata(nsteps);
-	vector<float> ydata(nsteps);
-
 	// get the selected nodes
+	vector<int> sel;
 	int NN = mesh.Nodes();
-	switch (m_xtype)
-	{
-	case 0: // time values
+	for (int i = 0; i < NN; i++)
 	{
-		for (int i = 0; i<NN; i++)
-		{
-			FENode& node = mesh.Node(i);
-			if (node.IsSelected())
-			{
-				for (int j = 0; j<nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+		if (mesh.Node(i).IsSelected()) sel.push_back(i);
+	}
+	if (sel.empty()) return;
 
-				// evaluate y-field
-				TrackNodeHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+	updateHistoryCache(Post::CLASS_NODE, NN, (int)sel.size());
 
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("N%1").arg(i + 1));
-				for (int j = 0; j<nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-	}
-	break;
-	case 1: // step values
+	// the time histories are evaluated for all selected nodes at once
+	// and stored per node, i.e. ydata[i*nsteps + j]
+	vector<float> xdata, ydata;
+	if (m_xtype == 3) // time-scatter
 	{
-		for (int i = 0; i<NN; i++)
-		{
-			FENode& node = mesh.Node(i);
-			if (node.IsSelected())
-			{
-				for (int j = 0; j<nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
+		int states = fem.GetStates();
 
-				// evaluate y-field
-				TrackNodeHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+		int state0 = m_firstState;
+		int state1 = m_lastState;
 
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("N%1").arg(i + 1));
-				for (int j = 0; j<nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-	}
-	break;
-	case 2: // scatter
-	{
-		for (int i = 0; i<NN; i++)
-		{
-			FENode& node = mesh.Node(i);
-			if (node.IsSelected())
-			{
-				TrackNodeHistory(i, &xdata[0], m_dataX, m_firstState, m_lastState);
+		if (state0 < 0) state0 = 0;
+		if (state0 >= states) state0 = states - 1;
 
-				// evaluate y-field
-				TrackNodeHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+		if (state1 < 0) state1 = 0;
+		if (state1 >= states) state1 = states - 1;
 
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("N%1").arg(i + 1));
-				for (int j = 0; j<nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-	}
-	break;
-	case 3: // time-scatter
-	{
-		vector<int> sel;
-		for (int i = 0; i < NN; i++)
+		if (state1 < state0)
 		{
-			FENode& node = mesh.Node(i);
-			if (node.IsSelected()) sel.push_back(i);
+			int tmp = state0;
+			state0 = state1;
+			state1 = tmp;
 		}
 
-		if (sel.empty() == false)
+		int nsteps = state1 - state0 + 1;
+		if (nsteps > 32) nsteps = 32;
+		for (int i = state0; i < state0 + nsteps; ++i)
 		{
-			int states = fem.GetStates();
-
-			int state0 = m_firstState;
-			int state1 = m_lastState;
-
-			if (state0 < 0) state0 = 0;
-			if (state0 >= states) state0 = states - 1;
-
-			if (state1 < 0) state1 = 0;
-			if (state1 >= states) state1 = states - 1;
+			CPlotData* plot = nextData();
+			plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
+		}
 
-			if (state1 < state0)
-			{
-				int tmp = state0;
-				state0 = state1;
-				state1 = tmp;
-			}
+		fem.EvaluateNodeHistory(sel, m_dataX, state0, state0 + nsteps - 1, xdata);
+		fem.EvaluateNodeHistory(sel, m_dataY, state0, state0 + nsteps - 1, ydata);
 
-			int nsteps = state1 - state0 + 1;
-			if (nsteps > 32) nsteps = 32;
-			for (int i = state0; i < state0 + nsteps; ++i)
+		for (int i = 0; i < (int)sel.size(); i++)
+		{
+			for (int j = 0; j < nsteps; ++j)
 			{
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
+				CPlotData& p = GetPlotWidget()->getPlotData(j);
+				p.addPoint(xdata[i*nsteps + j], ydata[i*nsteps + j]);
 			}
+		}
 
-			for (int i = 0; i < (int)sel.size(); i++)
-			{
-				FENode& node = mesh.Node(sel[i]);
-				if (node.IsSelected())
-				{
-					// evaluate x-field
-					TrackNodeHistory(sel[i], &xdata[0], m_dataX, state0, state0 + nsteps - 1);
+		// sort the plots 
+		int nplots = GetPlotWidget()->plots();
+		for (int i = 0; i < nplots; ++i)
+		{
+			CPlotData& data = GetPlotWidget()->getPlotData(i);
+			data.sort();
+		}
+	}
+	else
+	{
+		// evaluate y-field
+		int nsteps = fem.EvaluateNodeHistory(sel, m_dataY, m_firstState, m_lastState, ydata);
 
-					// evaluate y-field
-					TrackNodeHistory(sel[i], &ydata[0], m_dataY, state0, state0 + nsteps - 1);
+		// evaluate x-field
+		if (m_xtype == 2) fem.EvaluateNodeHistory(sel, m_dataX, m_firstState, m_lastState, xdata);
+		else timeAxisData(xdata, nsteps);
 
-					for (int j = 0; j < nsteps; ++j)
-					{
-						CPlotData& p = GetPlotWidget()->getPlotData(j);
-						p.addPoint(xdata[j], ydata[j]);
-					}
-				}
-			}
+		for (int i = 0; i < (int)sel.size(); i++)
+		{
+			const float* x = (m_xtype == 2 ? &xdata[i*nsteps] : &xdata[0]);
+			const float* y = &ydata[i*nsteps];
 
-			// sort the plots 
-			int nplots = GetPlotWidget()->plots();
-			for (int i = 0; i < nplots; ++i)
-			{
-				CPlotData& data = GetPlotWidget()->getPlotData(i);
-				data.sort();
-			}
+			CPlotData* plot = nextData();
+			plot->setLabel(QString("N%1").arg(sel[i] + 1));
+			for (int j = 0; j < nsteps; ++j) plot->addPoint(x[j], y[j]);
 		}
 	}
-	break;
-	}
 }
 
 //-----------------------------------------------------------------------------
@@ -1818,37 +1797,32 @@ void CModelGraphWindow::addSelectedEdges()
 	Post::FEPostModel& fem = *doc->GetFEModel();
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
-	int nsteps = m_lastState - m_firstState + 1;
-	vector<float> xdata(nsteps);
-	vector<float> ydata(nsteps);
-
-	// get the selected nodes
+	// get the selected edges
+	vector<int> sel;
 	int NL = mesh.Edges();
-	for (int i = 0; i<NL; i++)
+	for (int i = 0; i < NL; i++)
 	{
-		FEEdge& edge = mesh.Edge(i);
-		if (edge.IsSelected())
-		{
-			// evaluate x-field
-			switch (m_xtype)
-			{
-			case 0:
-				for (int j = 0; j<nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
-				break;
-			case 1:
-				for (int j = 0; j<nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
-				break;
-			default:
-				TrackEdgeHistory(i, &xdata[0], m_dataX, m_firstState, m_lastState);
-			}
+		if (mesh.Edge(i).IsSelected()) sel.push_back(i);
+	}
+	if (sel.empty()) return;
 
-			// evaluate y-field
-			TrackEdgeHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+	// evaluate y-field
+	vector<float> xdata, ydata;
+	int nsteps = fem.EvaluateEdgeHistory(sel, m_dataY, m_firstState, m_lastState, ydata);
 
-			CPlotData* plot = nextData();
-			plot->setLabel(QString("L%1").arg(i + 1));
-			for (int j = 0; j<nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-		}
+	// evaluate x-field
+	bool bxfield = (m_xtype != 0) && (m_xtype != 1);
+	if (bxfield) fem.EvaluateEdgeHistory(sel, m_dataX, m_firstState, m_lastState, xdata);
+	else timeAxisData(xdata, nsteps);
+
+	for (int i = 0; i < (int)sel.size(); i++)
+	{
+		const float* x = (bxfield ? &xdata[i*nsteps] : &xdata[0]);
+		const float* y = &ydata[i*nsteps];
+
+		CPlotData* plot = nextData();
+		plot->setLabel(QString("L%1").arg(sel[i] + 1));
+		for (int j = 0; j < nsteps; ++j) plot->addPoint(x[j], y[j]);
 	}
 }
 
@@ -1859,118 +1833,71 @@ void CModelGraphWindow::addSelectedFaces()
 	Post::FEPostModel& fem = *doc->GetFEModel();
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
-	int nsteps = m_lastState - m_firstState + 1;
-	vector<float> xdata(nsteps);
-	vector<float> ydata(nsteps);
-
 	// get the selected faces
+	vector<int> sel;
 	int NF = mesh.Faces();
-	switch (m_xtype)
+	for (int i = 0; i < NF; ++i)
 	{
-	case 0:
-		for (int i = 0; i < NF; ++i)
-		{
-			FEFace& f = mesh.Face(i);
-			if (f.IsSelected())
-			{
-				// evaluate x-field
-				for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+		if (mesh.Face(i).IsSelected()) sel.push_back(i);
+	}
+	if (sel.empty()) return;
 
-				// evaluate y-field
-				TrackFaceHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+	updateHistoryCache(Post::CLASS_FACE, NF, (int)sel.size());
 
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("F%1").arg(i + 1));
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-		break;
-	case 1:
-		for (int i = 0; i < NF; ++i)
+	vector<float> xdata, ydata;
+	if (m_xtype == 3) // time-scatter
+	{
+		int nsteps = m_lastState - m_firstState + 1;
+		if (nsteps > 32) nsteps = 32;
+		for (int i = m_firstState; i < m_firstState + nsteps; ++i)
 		{
-			FEFace& f = mesh.Face(i);
-			if (f.IsSelected())
-			{
-				for (int j = 0; j < nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
+			CPlotData* plot = nextData();
+			plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
+		}
 
-				// evaluate y-field
-				TrackFaceHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+		fem.EvaluateFaceHistory(sel, m_dataX, m_firstState, m_firstState + nsteps - 1, xdata);
+		fem.EvaluateFaceHistory(sel, m_dataY, m_firstState, m_firstState + nsteps - 1, ydata);
 
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("F%1").arg(i + 1));
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-		break;
-	case 2:
-		for (int i = 0; i < NF; ++i)
+		for (int i = 0; i < (int)sel.size(); i++)
 		{
-			FEFace& f = mesh.Face(i);
-			if (f.IsSelected())
+			for (int j = 0; j < nsteps; ++j)
 			{
-				// evaluate x-field
-				TrackFaceHistory(i, &xdata[0], m_dataX, m_firstState, m_lastState);
-
-				// evaluate y-field
-				TrackFaceHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
-
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("F%1").arg(i + 1));
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
+				CPlotData& p = GetPlotWidget()->getPlotData(j);
+				p.addPoint(xdata[i*nsteps + j], ydata[i*nsteps + j]);
 			}
 		}
-		break;
-	case 3:	// time-scatter
-	{
-		vector<int> sel;
-		for (int i = 0; i < NF; i++)
-		{
-			FEFace& face = mesh.Face(i);
-			if (face.IsSelected()) sel.push_back(i);
-		}
 
-		if (sel.empty() == false)
+		// sort the plots 
+		CPlotWidget* w = GetPlotWidget();
+		int nplots = w->plots();
+		for (int i = 0; i < nplots; ++i)
 		{
-			int nsteps = m_lastState - m_firstState + 1;
-			if (nsteps > 32) nsteps = 32;
-			for (int i = m_firstState; i < m_firstState + nsteps; ++i)
-			{
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
-			}
-
-			for (int i = 0; i < (int)sel.size(); i++)
-			{
-				FEFace& face = mesh.Face(sel[i]);
-
-				// evaluate x-field
-				TrackFaceHistory(sel[i], &xdata[0], m_dataX, m_firstState, m_lastState);
+			CPlotData& data = GetPlotWidget()->getPlotData(i);
+			data.sort();
+		}
 
-				// evaluate y-field
-				TrackFaceHistory(sel[i], &ydata[0], m_dataY, m_firstState, m_lastState);
+		if (w->autoRangeUpdate())
+			w->fitToData(false);
+	}
+	else
+	{
+		// evaluate y-field
+		int nsteps = fem.EvaluateFaceHistory(sel, m_dataY, m_firstState, m_lastState, ydata);
 
-				for (int j = 0; j < nsteps; ++j)
-				{
-					CPlotData& p = GetPlotWidget()->getPlotData(j);
-					p.addPoint(xdata[j], ydata[j]);
-				}
-			}
+		// evaluate x-field
+		if (m_xtype == 2) fem.EvaluateFaceHistory(sel, m_dataX, m_firstState, m_lastState, xdata);
+		else timeAxisData(xdata, nsteps);
 
-			// sort the plots 
-			CPlotWidget* w = GetPlotWidget();
-			int nplots = w->plots();
-			for (int i = 0; i < nplots; ++i)
-			{
-				CPlotData& data = GetPlotWidget()->getPlotData(i);
-				data.sort();
-			}
+		for (int i = 0; i < (int)sel.size(); i++)
+		{
+			const float* x = (m_xtype == 2 ? &xdata[i*nsteps] : &xdata[0]);
+			const float* y = &ydata[i*nsteps];
 
-			if (w->autoRangeUpdate())
-				w->fitToData(false);
+			CPlotData* plot = nextData();
+			plot->setLabel(QString("F%1").arg(sel[i] + 1));
+			for (int j = 0; j < nsteps; ++j) plot->addPoint(x[j], y[j]);
 		}
 	}
-	break;
-	}
 }
 
 //-----------------------------------------------------------------------------
@@ -1980,207 +1907,69 @@ void CModelGraphWindow::addSelectedElems()
 	Post::FEPostModel& fem = *doc->GetFEModel();
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
-	int nsteps = m_lastState - m_firstState + 1;
-	vector<float> xdata(nsteps);
-	vector<float> ydata(nsteps);
-
 	// get the selected elements
+	vector<int> sel;
 	int NE = mesh.Elements();
-	switch (m_xtype)
+	for (int i = 0; i < NE; i++)
 	{
-	case 0:
-		for (int i = 0; i < NE; i++)
-		{
-			FEElement_& e = mesh.ElementRef(i);
-			if (e.IsSelected())
-			{
-				// evaluate x-field
-				for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+		if (mesh.ElementRef(i).IsSelected()) sel.push_back(i);
+	}
+	if (sel.empty()) return;
 
-				// evaluate y-field
-				TrackElementHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+	updateHistoryCache(Post::CLASS_ELEM, NE, (int)sel.size());
 
-				CPlotData* plot = nextData();
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-				plot->setLabel(QString("E%1").arg(e.GetID()));
-			}
-		}
-		break;
-	case 1:
-		for (int i = 0; i < NE; i++)
+	vector<float> xdata, ydata;
+	if (m_xtype == 3) // time-scatter
+	{
+		int nsteps = m_lastState - m_firstState + 1;
+		if (nsteps > 32) nsteps = 32;
+		for (int i = m_firstState; i < m_firstState + nsteps; ++i)
 		{
-			FEElement_& e = mesh.ElementRef(i);
-			if (e.IsSelected())
-			{
-				// evaluate x-field
-				for (int j = 0; j < nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
+			CPlotData* plot = nextData();
+			plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
+		}
 
-				// evaluate y-field
-				TrackElementHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+		fem.EvaluateElementHistory(sel, m_dataX, m_firstState, m_firstState + nsteps - 1, xdata);
+		fem.EvaluateElementHistory(sel, m_dataY, m_firstState, m_firstState + nsteps - 1, ydata);
 
-				CPlotData* plot = nextData();
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-				plot->setLabel(QString("E%1").arg(e.GetID()));
-			}
-		}
-		break;
-	case 2:
-		for (int i = 0; i < NE; i++)
+		for (int i = 0; i < (int)sel.size(); i++)
 		{
-			FEElement_& e = mesh.ElementRef(i);
-			if (e.IsSelected())
+			for (int j = 0; j < nsteps; ++j)
 			{
-				// evaluate x-field
-				TrackElementHistory(i, &xdata[0], m_dataX, m_firstState, m_lastState);
-
-				// evaluate y-field
-				TrackElementHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
-
-				CPlotData* plot = nextData();
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-				plot->setLabel(QString("E%1").arg(e.GetID()));
+				CPlotData& p = GetPlotWidget()->getPlotData(j);
+				p.addPoint(xdata[i*nsteps + j], ydata[i*nsteps + j]);
 			}
 		}
-		break;
-	case 3:	// time-scatter
-	{
-		vector<int> sel;
-		for (int i = 0; i < NE; i++)
-		{
-			FEElement_& e = mesh.ElementRef(i);
-			if (e.IsSelected()) sel.push_back(i);
-		}
 
-		if (sel.empty() == false)
+		// sort the plots 
+		CPlotWidget* w = GetPlotWidget();
+		int nplots = w->plots();
+		for (int i = 0; i < nplots; ++i)
 		{
-			int nsteps = m_lastState - m_firstState + 1;
-			if (nsteps > 32) nsteps = 32;
-			for (int i = m_firstState; i < m_firstState + nsteps; ++i)
-			{
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
-			}
-
-			for (int i = 0; i < (int)sel.size(); i++)
-			{
-				FEElement_& e = mesh.ElementRef(sel[i]);
-				if (e.IsSelected())
-				{
-					// evaluate x-field
-					TrackElementHistory(sel[i], &xdata[0], m_dataX, m_firstState, m_lastState);
-
-					// evaluate y-field
-					TrackElementHistory(sel[i], &ydata[0], m_dataY, m_firstState, m_lastState);
-
-					for (int j = 0; j < nsteps; ++j)
-					{
-						CPlotData& p = GetPlotWidget()->getPlotData(j);
-						p.addPoint(xdata[j], ydata[j]);
-					}
-				}
-			}
-
-			// sort the plots 
-			CPlotWidget* w = GetPlotWidget();
-			int nplots = w->plots();
-			for (int i = 0; i < nplots; ++i)
-			{
-				CPlotData& data = GetPlotWidget()->getPlotData(i);
-				data.sort();
-			}
-
-			if (w->autoRangeUpdate())
-				w->fitToData(false);
+			CPlotData& data = GetPlotWidget()->getPlotData(i);
+			data.sort();
 		}
-	}
-	break;
-	}
-}
-
-//-----------------------------------------------------------------------------
-// Calculate time history of a node
-void CModelGraphWindow::TrackNodeHistory(int node, float* pval, int nfield, int nmin, int nmax)
-{
-	CPostDocument* doc = GetPostDoc();
-	Post::FEPostModel& fem = *doc->GetFEModel();
-
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
 
-	Post::NODEDATA nd;
-	for (int n = 0; n<nn; n++)
-	{
-		fem.EvaluateNode(node, n + nmin, nfield, nd);
-		pval[n] = nd.m_val;
+		if (w->autoRangeUpdate())
+			w->fitToData(false);
 	}
-}
-
-//-----------------------------------------------------------------------------
-// Calculate time history of a edge
-void CModelGraphWindow::TrackEdgeHistory(int edge, float* pval, int nfield, int nmin, int nmax)
-{
-	CPostDocument* doc = GetPostDoc();
-	Post::FEPostModel& fem = *doc->GetFEModel();
-
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
-
-	Post::EDGEDATA nd;
-	for (int n = 0; n<nn; n++)
-	{
-		fem.EvaluateEdge(edge, n + nmin, nfield, nd);
-		pval[n] = nd.m_val;
-	}
-}
-
-//-----------------------------------------------------------------------------
-// Calculate time history of a face
-void CModelGraphWindow::TrackFaceHistory(int nface, float* pval, int nfield, int nmin, int nmax)
-{
-	CPostDocument* doc = GetPostDoc();
-	Post::FEPostModel& fem = *doc->GetFEModel();
-
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
-
-	float data[FEFace::MAX_NODES], val;
-	for (int n = 0; n<nn; n++)
+	else
 	{
-		fem.EvaluateFace(nface, n + nmin, nfield, data, val);
-		pval[n] = val;
-	}
-}
+		// evaluate y-field
+		int nsteps = fem.EvaluateElementHistory(sel, m_dataY, m_firstState, m_lastState, ydata);
 
-//-----------------------------------------------------------------------------
-// Calculate time history of an element
-void CModelGraphWindow::TrackElementHistory(int nelem, float* pval, int nfield, int nmin, int nmax)
-{
-	CPostDocument* doc = GetPostDoc();
-	Post::FEPostModel& fem = *doc->GetFEModel();
+		// evaluate x-field
+		if (m_xtype == 2) fem.EvaluateElementHistory(sel, m_dataX, m_firstState, m_lastState, xdata);
+		else timeAxisData(xdata, nsteps);
 
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
+		for (int i = 0; i < (int)sel.size(); i++)
+		{
+			const float* x = (m_xtype == 2 ? &xdata[i*nsteps] : &xdata[0]);
+			const float* y = &ydata[i*nsteps];
 
-	float data[FEElement::MAX_NODES] = { 0.f }, val;
-	for (int n = 0; n<nn; n++)
-	{
-		fem.EvaluateElement(nelem, n + nmin, nfield, data, val);
-		pval[n] = val;
+			CPlotData* plot = nextData();
+			for (int j = 0; j < nsteps; ++j) plot->addPoint(x[j], y[j]);
+			plot->setLabel(QString("E%1").arg(mesh.ElementRef(sel[i]).GetID()));
+		}
 	}
 }
@@ -398,11 +398,11 @@ public:
 	void Update(bool breset = true, bool bfit = false);
 
 private:
-	// track mesh data
-	void TrackElementHistory(int nelem, float* pval, int nfield, int nmin = 0, int nmax = -1);
-	void TrackFaceHistory(int nface, float* pval, int nfield, int nmin = 0, int nmax = -1);
-	void TrackEdgeHistory(int edge, float* pval, int nfield, int nmin = 0, int nmax = -1);
-	void TrackNodeHistory(int node, float* pval, int nfield, int nmin = 0, int nmax = -1);
+	// x-data for time and step graphs
+	void timeAxisData(vector<float>& xdata, int nsteps);
+
+	// build the model's history cache for repeated plots of large selections
+	void updateHistoryCache(int itemClass, int items, int selected);
 
 private:
 	void addSelectedNodes();
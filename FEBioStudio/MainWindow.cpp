@@ -67,6 +67,8 @@ SOFTWARE.*/
 #include "DlgImportXPLT.h"
 #include "Commands.h"
 #include <XPLTLib/xpltFileReader.h>
+#include <PostLib/FEVTKImport.h>
+#include <PostLib/FELSDYNAPlot.h>
 #include <MeshTools/GModel.h>
 #include "DocManager.h"
 #include "PostDocument.h"
@@ -371,7 +373,11 @@ void CMainWindow::OpenFile(const QString& filePath, bool showLoadOptions, bool o
 	{
 		OpenDocument(fileName);
 	}
-	else if (ext.compare("xplt", Qt::CaseInsensitive) == 0)
+	else if ((ext.compare("xplt", Qt::CaseInsensitive) == 0) ||
+		(ext.compare("vtk", Qt::CaseInsensitive) == 0) ||
+		(ext.compare("vtu", Qt::CaseInsensitive) == 0) ||
+		(ext.compare("d3plot", Qt::CaseInsensitive) == 0) ||
+		(QFileInfo(fileName).fileName().compare("d3plot", Qt::CaseInsensitive) == 0))
 	{
 		// load the plot file
 		OpenPlotFile(fileName, nullptr, showLoadOptions);
@@ -716,6 +722,42 @@ void CMainWindow::OpenPlotFile(const QString& fileName, CModelDocument* modelDoc
 	if (doc == nullptr)
 	{
 		doc = new CPostDocument(this, modelDoc);
+
+		// VTK files are read directly, without load options
+		QString ext = QFileInfo(fileName).suffix();
+		if ((ext.compare("vtk", Qt::CaseInsensitive) == 0) ||
+			(ext.compare("vtu", Qt::CaseInsensitive) == 0))
+		{
+			doc->SetFileReader(new Post::FEVTKimport(doc->GetFEModel()));
+			ReadFile(doc, fileName, doc->GetFileReader(), QueuedFile::NEW_DOCUMENT);
+			return;
+		}
+
+		// LSDYNA databases take the same load options as xplt files
+		if ((ext.compare("d3plot", Qt::CaseInsensitive) == 0) ||
+			(QFileInfo(fileName).fileName().compare("d3plot", Qt::CaseInsensitive) == 0))
+		{
+			Post::FELSDYNAPlotImport* d3plot = new Post::FELSDYNAPlotImport(doc->GetFEModel());
+			doc->SetFileReader(d3plot);
+			if (showLoadOptions)
+			{
+				CDlgImportXPLT dlg(this);
+				if (dlg.exec())
+				{
+					d3plot->SetReadStateFlag(dlg.m_nop);
+					d3plot->SetReadStatesList(dlg.m_item);
+					d3plot->SetDataStorage(dlg.m_storage);
+				}
+				else
+				{
+					delete doc;
+					return;
+				}
+			}
+			ReadFile(doc, fileName, doc->GetFileReader(), QueuedFile::NEW_DOCUMENT);
+			return;
+		}
+
 		xpltFileReader* xplt = new xpltFileReader(doc->GetFEModel());
 		doc->SetFileReader(xplt);
 		if (showLoadOptions)
@@ -725,6 +767,7 @@ void CMainWindow::OpenPlotFile(const QString& fileName, CModelDocument* modelDoc
 			{
 				xplt->SetReadStateFlag(dlg.m_nop);
 				xplt->SetReadStatesList(dlg.m_item);
+				xplt->SetDataStorage(dlg.m_storage);
 			}
 			else
 			{
@@ -849,6 +892,13 @@ void CMainWindow::finishedReadingFile(bool success, QueuedFile& file, const QStr
 			AddLogEntry("success!\n");
 		}
 
+		// informational messages of the reader
+		if (file.m_fileReader && (file.m_fileReader->GetLogMessage().empty() == false))
+		{
+			AddLogEntry(QString::fromStdString(file.m_fileReader->GetLogMessage()));
+			AddLogEntry("\n");
+		}
+
 		// if this was a new document, make it the active one 
 		if (file.m_flags & QueuedFile::NEW_DOCUMENT)
 		{
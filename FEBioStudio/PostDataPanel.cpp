@@ -1156,5 +1156,8 @@ void CPostDataPanel::on_props_dataChanged(bool b)
 	CPostDocument* doc = GetActiveDocument();
 	doc->GetGLModel()->ResetAllStates();
 	doc->UpdateFEModel(true);
-	GetMainWindow()->RedrawGL();
+
+	// the field's values changed, so cached histories are stale and the graphs need updating
+	doc->GetFEModel()->ClearHistoryCache();
+	GetMainWindow()->Update(this, false);
 }
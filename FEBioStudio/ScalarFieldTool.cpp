@@ -213,7 +213,10 @@ void CScalarFieldTool::OnApply()
 
 	// solve Laplace equation
 	LaplaceSolver L;
-	L.Solve(pm, val, bn);
+	if (L.Solve(pm, val, bn) == false)
+	{
+		QMessageBox::warning(GetMainWindow(), "Tool", QString("The Laplace solver did not converge (relative residual = %1).").arg(L.RelativeResidual()));
+	}
 
 	if (m_ntype == 0)
 	{
@@ -97,6 +97,7 @@ SOFTWARE.*/
 #include <QtCore/QTextStream>
 #include <PostLib/ImageModel.h>
 #include <PostLib/FELSDYNAExport.h>
+#include <PostLib/FEVTKExport.h>
 #include <MeshTools/GModel.h>
 #include "DlgExportXPLT.h"
 #include <XPLTLib/xpltFileExport.h>
@@ -180,10 +181,12 @@ void CMainWindow::on_actionNewProject_triggered()
 void CMainWindow::on_actionOpen_triggered()
 {
 	QStringList filters;
-	filters << "All supported files (*.fsm *.feb *.xplt *.n *.inp *.fsprj *.prv)";
+	filters << "All supported files (*.fsm *.feb *.xplt *.vtk *.vtu d3plot *.d3plot *.n *.inp *.fsprj *.prv)";
 	filters << "FEBioStudio Model (*.fsm *.fsprj)";
 	filters << "FEBio input files (*.feb)";
 	filters << "FEBio plot files (*.xplt)";
+	filters << "VTK files (*.vtk *.vtu)";
+	filters << "LSDYNA database (d3plot *.d3plot)";
 	filters << "PreView files (*.prv)";
 	filters << "Abaus files (*.inp)";
 	filters << "Nike3D files (*.n)";
@@ -504,10 +507,11 @@ void CMainWindow::ExportPostGeometry()
 		//		<< "FEBio files (*.feb)"
 		//		<< "ASCII files (*.*)"
 		//		<< "VRML files (*.wrl)"
-		<< "LSDYNA Keyword (*.k)";
+		<< "LSDYNA Keyword (*.k)"
 	//		<< "BYU files(*.byu)"
 	//		<< "NIKE3D files (*.n)"
-	//		<< "VTK files (*.vtk)"
+		<< "VTK files (*.vtk)"
+		<< "VTK XML files (*.vtu)";
 	//		<< "LSDYNA database (*.d3plot)";
 
 	QFileDialog dlg(this, "Save");
@@ -598,6 +602,20 @@ void CMainWindow::ExportPostGeometry()
 		}
 	}
 	break;
+	case 2:
+	case 3:
+	{
+		CDlgVTKExport dlg(this, (nfilter == 3 ? CDlgVTKExport::POST_XML_EXPORT : CDlgVTKExport::POST_LEGACY_EXPORT));
+		if (dlg.exec())
+		{
+			Post::FEVTKExport w;
+			w.ExportAllStates(dlg.m_ballStates);
+			w.SetFileFormat(dlg.m_format);
+			bret = w.Save(fem, szfilename);
+			error = "Failed writing VTK file";
+		}
+	}
+	break;
 	/*	case 5:
 	{
 	bret = doc->ExportBYU(szfilename);
@@ -799,6 +817,7 @@ void CMainWindow::ExportGeometry()
 				VTKEXPORT ops;
 				ops.bshellthick = dlg.m_bshell_thick;
 				ops.bscalar_data = dlg.m_bscalar_data;
+				ops.bbinary = dlg.m_bbinary;
 				FEVTKExport writer(fem);
 				writer.SetOptions(ops);
 				if (!writer.Write(szfile))
@@ -1174,7 +1193,7 @@ void CMainWindow::on_actionImportImage_triggered()
 		{
 			BOX box(dlg.m_x0, dlg.m_y0, dlg.m_z0, dlg.m_x0 + dlg.m_w, dlg.m_y0 + dlg.m_h, dlg.m_z0 + dlg.m_d);
 
-			Post::CImageModel* po = doc->ImportImage(sfile, dlg.m_nx, dlg.m_ny, dlg.m_nz, box);
+			Post::CImageModel* po = doc->ImportImage(sfile, dlg.m_nx, dlg.m_ny, dlg.m_nz, box, dlg.m_type);
 			if (po == nullptr)
 			{
 				QMessageBox::critical(this, "FEBio Studio", "Failed importing image data.");
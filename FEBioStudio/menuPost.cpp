@@ -488,6 +488,16 @@ void CMainWindow::onTimer()
 		if (doc->IsValid())
 		{
 			TIMESETTINGS& time = doc->GetTimeSettings();
+
+			// While recording, the encoder is still busy with the frame we just rendered,
+			// so use that time to evaluate the data of the next state.
+			if (ui->glview->RecordingMode() == VIDEO_RECORDING)
+			{
+				int ninc = (time.m_mode == MODE_REVERSE ? -1 : (time.m_mode == MODE_CYLCE ? time.m_inc : 1));
+				int nnext = doc->GetActiveState() + ninc;
+				if ((nnext >= N0) && (nnext <= N1)) doc->GetGLModel()->PrefetchState(nnext);
+			}
+
 			double fps = time.m_fps;
 			if (fps < 1.0) fps = 1.0;
 			double msec_per_frame = 1000.0 / fps;
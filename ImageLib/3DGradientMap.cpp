@@ -26,18 +26,193 @@ SOFTWARE.*/
 
 #include "stdafx.h"
 #include "3DGradientMap.h"
+#include <math.h>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <new>
 
 //=============================================================================
 // C3DGradientMap
 //=============================================================================
 
+// All gradient maps with their precomputed normals. The budget is shared by all maps.
+static std::mutex s_lock;
+static std::vector<C3DGradientMap*> s_maps;
+static size_t s_budget = (size_t)1024 * 1024 * 1024;
+static size_t s_used = 0;
+static unsigned int s_clock = 0;
+
+void C3DGradientMap::SetMemoryBudget(size_t nbytes)
+{
+	std::lock_guard<std::mutex> lock(s_lock);
+	s_budget = nbytes;
+}
+
+size_t C3DGradientMap::GetMemoryBudget()
+{
+	return s_budget;
+}
+
 C3DGradientMap::C3DGradientMap(C3DImage& im, BOX box) : m_im(im), m_box(box)
 {
+	m_norm = nullptr;
+	m_size = 0;
+	m_locks = 0;
+	m_stamp = 0;
 
+	std::lock_guard<std::mutex> lock(s_lock);
+	s_maps.push_back(this);
 }
 
 C3DGradientMap::~C3DGradientMap()
 {
+	std::lock_guard<std::mutex> lock(s_lock);
+	Free();
+	s_maps.erase(std::find(s_maps.begin(), s_maps.end(), this));
+}
+
+void C3DGradientMap::SetBox(const BOX& box)
+{
+	if ((box.x0 == m_box.x0) && (box.y0 == m_box.y0) && (box.z0 == m_box.z0) &&
+		(box.x1 == m_box.x1) && (box.y1 == m_box.y1) && (box.z1 == m_box.z1)) return;
+
+	Release();
+	m_box = box;
+}
+
+void C3DGradientMap::Release()
+{
+	std::lock_guard<std::mutex> lock(s_lock);
+	if (m_locks == 0) Free();
+}
+
+// must be called with s_lock held
+void C3DGradientMap::Free()
+{
+	delete[] m_norm;
+	m_norm = nullptr;
+	s_used -= m_size;
+	m_size = 0;
+}
+
+bool C3DGradientMap::Lock()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_lock);
+		m_locks++;
+		m_stamp = ++s_clock;
+		if (m_norm) return true;
+
+		size_t nsize = (size_t)3 * m_im.Width()*m_im.Height()*m_im.Depth();
+		if ((nsize == 0) || (nsize > s_budget)) return false;
+
+		// make room by releasing the least recently used maps that are not in use
+		while (s_used + nsize > s_budget)
+		{
+			C3DGradientMap* lru = nullptr;
+			for (size_t i = 0; i < s_maps.size(); ++i)
+			{
+				C3DGradientMap* m = s_maps[i];
+				if (m->m_norm && (m->m_locks == 0) && ((lru == nullptr) || (m->m_stamp < lru->m_stamp))) lru = m;
+			}
+			if (lru == nullptr) return false;
+			lru->Free();
+		}
+
+		m_norm = new (std::nothrow) signed char[nsize];
+		if (m_norm == nullptr) return false;
+		m_size = nsize;
+		s_used += nsize;
+	}
+
+	// the map is locked, so it is safe to build it outside the lock
+	Build();
+
+	return true;
+}
+
+void C3DGradientMap::Unlock()
+{
+	std::lock_guard<std::mutex> lock(s_lock);
+	m_locks--;
+}
+
+//-----------------------------------------------------------------------------
+// Calculate the normals one row at a time. The rows of the stencil are copied
+// to float buffers, so the inner loops are simple enough to be vectorized.
+void C3DGradientMap::Build()
+{
+	const int nx = m_im.Width();
+	const int ny = m_im.Height();
+	const int nz = m_im.Depth();
+
+	const float dxi = (nx - 1.f) / (float)m_box.Width();
+	const float dyi = (ny - 1.f) / (float)m_box.Height();
+	const float dzi = (nz - 1.f) / (float)m_box.Depth();
+
+	#pragma omp parallel
+	{
+		std::vector<float> buf(8 * (size_t)nx);
+		float* pc = &buf[0];		// row (j,k)
+		float* pym = pc + nx;		// row (j-1,k) or (j,k)
+		float* pyp = pym + nx;		// row (j+1,k) or (j,k)
+		float* pzm = pyp + nx;		// row (j,k-1) or (j,k)
+		float* pzp = pzm + nx;		// row (j,k+1) or (j,k)
+		float* gx = pzp + nx;
+		float* gy = gx + nx;
+		float* gz = gy + nx;
+
+		#pragma omp for schedule(dynamic)
+		for (int k = 0; k < nz; ++k)
+		{
+			// one-sided differences on the boundary
+			int km = (k > 0 ? k - 1 : k), kp = (k < nz - 1 ? k + 1 : k);
+			float fz = (((kp - km) == 2) ? 0.5f*dzi : dzi);
+
+			for (int j = 0; j < ny; ++j)
+			{
+				int jm = (j > 0 ? j - 1 : j), jp = (j < ny - 1 ? j + 1 : j);
+				float fy = (((jp - jm) == 2) ? 0.5f*dyi : dyi);
+
+				for (int i = 0; i < nx; ++i)
+				{
+					pc [i] = m_im.value(i, j , k );
+					pym[i] = m_im.value(i, jm, k );
+					pyp[i] = m_im.value(i, jp, k );
+					pzm[i] = m_im.value(i, j , km);
+					pzp[i] = m_im.value(i, j , kp);
+				}
+
+				// x-gradient
+				if (nx > 1)
+				{
+					gx[0] = (pc[1] - pc[0])*dxi;
+					for (int i = 1; i < nx - 1; ++i) gx[i] = (pc[i + 1] - pc[i - 1])*(0.5f*dxi);
+					gx[nx - 1] = (pc[nx - 1] - pc[nx - 2])*dxi;
+				}
+				else gx[0] = 0.f;
+
+				// y and z-gradients
+				for (int i = 0; i < nx; ++i)
+				{
+					gy[i] = (pyp[i] - pym[i])*fy;
+					gz[i] = (pzp[i] - pzm[i])*fz;
+				}
+
+				// normalize and pack
+				signed char* pd = m_norm + 3 * ((size_t)(k*ny + j)*nx);
+				for (int i = 0; i < nx; ++i)
+				{
+					float L2 = gx[i] * gx[i] + gy[i] * gy[i] + gz[i] * gz[i];
+					float s = (L2 > 0.f ? 127.f / sqrtf(L2) : 0.f);
+					pd[3 * i    ] = (signed char)lrintf(gx[i] * s);
+					pd[3 * i + 1] = (signed char)lrintf(gy[i] * s);
+					pd[3 * i + 2] = (signed char)lrintf(gz[i] * s);
+				}
+			}
+		}
+	}
 }
 
 vec3f C3DGradientMap::Value(int i, int j, int k)
@@ -29,18 +29,56 @@ SOFTWARE.*/
 #include <FSCore/box.h>
 
 //-----------------------------------------------------------------------------
-//! A class for calculating gradient data on a 3D image
+//! A class for calculating gradient data on a 3D image.
+//! The normalized gradients can be precomputed for all voxels (see Lock). They 
+//! are packed in 3 bytes per voxel and kept until the map is destroyed, the box
+//! changes, or the memory is needed for another gradient map. The total memory
+//! of all precomputed maps is limited by a global budget.
 class C3DGradientMap
 {
 public:
 	C3DGradientMap(C3DImage& im, BOX box);
 	~C3DGradientMap();
 
+	C3DImage& GetImage() { return m_im; }
+
+	// changing the box invalidates the precomputed normals
+	void SetBox(const BOX& box);
+
 	// get a vector value
 	vec3f Value(int i, int j, int k);
 
+	// get the normalized gradient
+	vec3f Normal(int i, int j, int k)
+	{
+		if (m_norm == nullptr) return Value(i, j, k).Normalize();
+		const signed char* p = m_norm + 3*((size_t)(k*m_im.Height() + j)*m_im.Width() + i);
+		const float s = 1.f / 127.f;
+		return vec3f(p[0]*s, p[1]*s, p[2]*s);
+	}
+
+	// Precomputes the normals if needed and keeps them while the map is locked.
+	// Returns false if they do not fit in the budget. Normal then calculates them
+	// on the fly. Each call must be matched by a call to Unlock.
+	bool Lock();
+	void Unlock();
+
+	// release the precomputed normals
+	void Release();
+
+	static void SetMemoryBudget(size_t nbytes);
+	static size_t GetMemoryBudget();
+
+private:
+	void Build();
+	void Free();
+
 private:
 	C3DImage&	m_im;
 	BOX	m_box;
-};
 
+	signed char*	m_norm;		// packed normals (null if not precomputed)
+	size_t			m_size;		// size of m_norm
+	int				m_locks;	// nr of Lock calls without matching Unlock
+	unsigned int	m_stamp;	// last time this map was locked
+};
@@ -28,11 +28,18 @@ SOFTWARE.*/
 #include "3DImage.h"
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
+#include <atomic>
+#include <map>
 
 #ifdef WIN32
 #include <memory>
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
 #else
 #include <memory.h>
+#define fseek64 fseeko
+#define ftell64 ftello
 #endif
 
 //-----------------------------------------------------------------------------
@@ -47,6 +54,37 @@ int closest_pow2(int n)
 	return p;
 }
 
+//-----------------------------------------------------------------------------
+// A brick of voxels that was loaded from file
+struct C3DImage::Brick
+{
+	byte*			data;	// voxel data (in file format)
+	int				pins;	// number of threads currently reading from this brick
+	unsigned int	stamp;	// last access (for LRU)
+};
+
+// Each thread keeps the last brick it read from pinned, so that consecutive
+// reads from the same brick don't need to lock the brick table.
+struct BRICK_PIN
+{
+	unsigned int		serial;	// serial of the data set
+	int					nbrick;	// brick index
+	C3DImage::Brick*	brick;
+};
+
+static thread_local BRICK_PIN tl_pin = { 0, -1, nullptr };
+
+// open data sets by serial, so that a thread can release a pin on a data set
+// other than the one it is currently reading from
+static std::mutex s_pinLock;
+static std::map<unsigned int, C3DImage*> s_images;
+
+// used to assign a unique serial number to each opened data set
+static std::atomic<unsigned int> s_serial(0);
+
+// default memory budget for the brick cache (1 GB)
+const size_t DEFAULT_CACHE_SIZE = ((size_t)1 << 30);
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -55,6 +93,21 @@ C3DImage::C3DImage()
 {
 	m_pb = 0;
 	m_cx = m_cy = m_cz = 0;
+
+	m_fp = nullptr;
+	m_voxelType = VOXEL_UINT8;
+	m_bpv = 1;
+	m_nbx = m_nby = m_nbz = 0;
+	m_cacheSize = DEFAULT_CACHE_SIZE;
+	m_cacheUsed = 0;
+	m_clock = 0;
+	m_serial = 0;
+	m_readError = false;
+	m_vmin = 0.0;
+	m_vmax = 255.0;
+	m_binvert = false;
+	m_bflipz = false;
+	m_rangeValid = false;
 }
 
 C3DImage::~C3DImage()
@@ -67,12 +120,43 @@ void C3DImage::CleanUp()
 	delete [] m_pb;
 	m_pb = 0;
 	m_cx = m_cy = m_cz = 0;
+
+	// after this, pins on this data set are no longer released through it
+	if (m_serial)
+	{
+		std::lock_guard<std::mutex> lock(s_pinLock);
+		s_images.erase(m_serial);
+	}
+
+	// release the out-of-core data
+	for (size_t i = 0; i < m_brick.size(); ++i)
+	{
+		Brick* b = m_brick[i];
+		if (b) { delete [] b->data; delete b; }
+	}
+	m_brick.clear();
+	m_loaded.clear();
+	m_cacheUsed = 0;
+	m_nbx = m_nby = m_nbz = 0;
+	if (m_fp) fclose(m_fp);
+	m_fp = nullptr;
+	m_serial = 0;
+	m_readError = false;
+	m_voxelType = VOXEL_UINT8;
+	m_bpv = 1;
+	m_vmin = 0.0;
+	m_vmax = 255.0;
+	m_binvert = false;
+	m_bflipz = false;
+	m_rangeMin.clear();
+	m_rangeMax.clear();
+	m_rangeValid = false;
 }
 
 bool C3DImage::Create(int nx, int ny, int nz)
 {
 	// reallocate data if necessary
-	if (nx*ny*nz != m_cx*m_cy*m_cz)
+	if ((m_pb == 0) || (nx*ny*nz != m_cx*m_cy*m_cz))
 	{
 		CleanUp();
 
@@ -114,12 +198,261 @@ bool C3DImage::LoadFromFile(const char* szfile, int nbits)
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// This only checks that the file is large enough. No image data is read until
+// the voxels are accessed.
+bool C3DImage::Open(const char* szfile, int nx, int ny, int nz, int voxelType)
+{
+	CleanUp();
+
+	int bpv = 0;
+	switch (voxelType)
+	{
+	case VOXEL_UINT8 : bpv = 1; break;
+	case VOXEL_UINT16: bpv = 2; break;
+	case VOXEL_FLOAT : bpv = 4; break;
+	default:
+		return false;
+	}
+	if ((nx <= 0) || (ny <= 0) || (nz <= 0)) return false;
+
+	FILE* fp = fopen(szfile, "rb");
+	if (fp == 0) return false;
+
+	// make sure the file is large enough
+	fseek64(fp, 0, SEEK_END);
+	long long fileSize = (long long)ftell64(fp);
+	if (fileSize < (long long)nx*(long long)ny*(long long)nz*bpv)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	m_fp = fp;
+	m_cx = nx;
+	m_cy = ny;
+	m_cz = nz;
+	m_voxelType = voxelType;
+	m_bpv = bpv;
+
+	m_nbx = (nx + BRICK_MASK) >> BRICK_BITS;
+	m_nby = (ny + BRICK_MASK) >> BRICK_BITS;
+	m_nbz = (nz + BRICK_MASK) >> BRICK_BITS;
+	m_brick.assign((size_t)m_nbx*m_nby*m_nbz, nullptr);
+
+	m_serial = ++s_serial;
+	if (m_serial == 0) m_serial = ++s_serial;
+	{
+		std::lock_guard<std::mutex> lock(s_pinLock);
+		s_images[m_serial] = this;
+	}
+
+	switch (voxelType)
+	{
+	case VOXEL_UINT8 : SetValueRange(0.0, 255.0); break;
+	case VOXEL_UINT16: SetValueRange(0.0, 65535.0); break;
+	case VOXEL_FLOAT : SetValueRange(0.0, 1.0); break;
+	}
+
+	return true;
+}
+
+void C3DImage::SetValueRange(double vmin, double vmax)
+{
+	if (vmax == vmin) vmax = vmin + 1.0;
+	m_vmin = vmin;
+	m_vmax = vmax;
+	m_rangeValid = false;
+}
+
+void C3DImage::SetCacheSize(size_t nbytes)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_cacheSize = nbytes;
+}
+
+//-----------------------------------------------------------------------------
+// Release a brick that a thread pinned in the data set with the given serial.
+// Nothing needs to be done if that data set was closed in the meantime.
+void C3DImage::Unpin(unsigned int serial, Brick* b)
+{
+	std::lock_guard<std::mutex> lock(s_pinLock);
+	std::map<unsigned int, C3DImage*>::iterator it = s_images.find(serial);
+	if (it == s_images.end()) return;
+
+	C3DImage* im = it->second;
+	std::lock_guard<std::mutex> imlock(im->m_lock);
+	b->pins--;
+}
+
+//-----------------------------------------------------------------------------
+// Returns a pointer to the voxel (i,j,k) in its brick, loading the brick if needed.
+// The brick remains pinned until the calling thread reads from another brick.
+// Returns null if the brick could not be read from the file.
+const byte* C3DImage::BrickData(int i, int j, int k)
+{
+	int nb = ((k >> BRICK_BITS)*m_nby + (j >> BRICK_BITS))*m_nbx + (i >> BRICK_BITS);
+	size_t offset = ((size_t)((k & BRICK_MASK)*BRICK_SIZE + (j & BRICK_MASK))*BRICK_SIZE + (i & BRICK_MASK))*m_bpv;
+
+	BRICK_PIN& pin = tl_pin;
+	if ((pin.serial == m_serial) && (pin.nbrick == nb)) return pin.brick->data + offset;
+
+	// release the previous brick of this thread if it belongs to another data set
+	// (this is done before locking this data set, to keep the lock order fixed)
+	if (pin.brick && (pin.serial != m_serial))
+	{
+		Unpin(pin.serial, pin.brick);
+		pin.serial = 0;
+		pin.nbrick = -1;
+		pin.brick = nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	// release the previous brick of this thread
+	if (pin.brick)
+	{
+		pin.brick->pins--;
+		pin.serial = 0;
+		pin.nbrick = -1;
+		pin.brick = nullptr;
+	}
+
+	Brick* b = m_brick[nb];
+	if (b == nullptr)
+	{
+		// don't keep trying to read from a file that failed
+		if (m_readError) return nullptr;
+		b = LoadBrick(nb);
+		if (b == nullptr) { m_readError = true; return nullptr; }
+	}
+	b->pins++;
+	b->stamp = ++m_clock;
+
+	pin.serial = m_serial;
+	pin.nbrick = nb;
+	pin.brick = b;
+
+	return b->data + offset;
+}
+
+//-----------------------------------------------------------------------------
+// Read a brick from the file. Least recently used bricks are evicted first
+// to stay within the memory budget. This must be called with the lock held.
+C3DImage::Brick* C3DImage::LoadBrick(int nb)
+{
+	const size_t nbytes = (size_t)BRICK_SIZE*BRICK_SIZE*BRICK_SIZE*m_bpv;
+
+	while ((m_cacheUsed + nbytes > m_cacheSize) && (m_loaded.empty() == false))
+	{
+		int nmin = -1;
+		for (int n = 0; n < (int)m_loaded.size(); ++n)
+		{
+			Brick* bn = m_brick[m_loaded[n]];
+			if ((bn->pins == 0) && ((nmin == -1) || (bn->stamp < m_brick[m_loaded[nmin]]->stamp))) nmin = n;
+		}
+		if (nmin == -1) break;
+
+		Brick* old = m_brick[m_loaded[nmin]];
+		delete [] old->data;
+		delete old;
+		m_brick[m_loaded[nmin]] = nullptr;
+		m_loaded[nmin] = m_loaded.back();
+		m_loaded.pop_back();
+		m_cacheUsed -= nbytes;
+	}
+
+	Brick* b = new Brick;
+	b->data = new byte[nbytes];
+	b->pins = 0;
+	b->stamp = 0;
+	memset(b->data, 0, nbytes);
+
+	// range of voxels in this brick
+	int bx = nb % m_nbx;
+	int by = (nb / m_nbx) % m_nby;
+	int bz = nb / (m_nbx*m_nby);
+	int i0 = bx*BRICK_SIZE, j0 = by*BRICK_SIZE, k0 = bz*BRICK_SIZE;
+	int ni = (m_cx - i0 < BRICK_SIZE ? m_cx - i0 : BRICK_SIZE);
+	int nj = (m_cy - j0 < BRICK_SIZE ? m_cy - j0 : BRICK_SIZE);
+	int nk = (m_cz - k0 < BRICK_SIZE ? m_cz - k0 : BRICK_SIZE);
+
+	// read the rows
+	for (int k = 0; k < nk; ++k)
+		for (int j = 0; j < nj; ++j)
+		{
+			long long off = (((long long)(k0 + k)*m_cy + (j0 + j))*m_cx + i0)*m_bpv;
+			byte* pd = b->data + ((size_t)k*BRICK_SIZE + j)*BRICK_SIZE*m_bpv;
+			if ((fseek64(m_fp, off, SEEK_SET) != 0) || (fread(pd, m_bpv, ni, m_fp) != (size_t)ni))
+			{
+				delete [] b->data;
+				delete b;
+				return nullptr;
+			}
+		}
+
+	m_brick[nb] = b;
+	m_loaded.push_back(nb);
+	m_cacheUsed += nbytes;
+
+	return b;
+}
+
+//-----------------------------------------------------------------------------
+// map a voxel in file format to [0,255]
+byte C3DImage::ToByte(const byte* p) const
+{
+	double v = 0.0;
+	switch (m_voxelType)
+	{
+	case VOXEL_UINT8 : v = *p; break;
+	case VOXEL_UINT16: { word w; memcpy(&w, p, sizeof(word)); v = w; } break;
+	case VOXEL_FLOAT : { float f; memcpy(&f, p, sizeof(float)); v = f; } break;
+	}
+
+	double t = 255.0*(v - m_vmin) / (m_vmax - m_vmin);
+	if (t < 0.0) t = 0.0; else if (t > 255.0) t = 255.0;
+	byte b = (byte)(t + 0.5);
+
+	return (m_binvert ? 255 - b : b);
+}
+
+byte C3DImage::BrickValue(int i, int j, int k)
+{
+	if (m_bflipz) k = m_cz - 1 - k;
+	const byte* p = BrickData(i, j, k);
+	return (p ? ToByte(p) : 0);
+}
+
+double C3DImage::Voxel(int i, int j, int k)
+{
+	if (m_pb) return m_pb[m_cx*(k*m_cy + j) + i];
+
+	if (m_bflipz) k = m_cz - 1 - k;
+	const byte* p = BrickData(i, j, k);
+	if (p == nullptr) return 0.0;
+	switch (m_voxelType)
+	{
+	case VOXEL_UINT16: { word w; memcpy(&w, p, sizeof(word)); return w; }
+	case VOXEL_FLOAT : { float f; memcpy(&f, p, sizeof(float)); return f; }
+	}
+	return *p;
+}
+
 // BitBlt assumes that the 3D and 2D images have the same resolution !
 void C3DImage::BitBlt(CImage& im, int nslice)
 {
+	byte* pd = im.GetBytes();
+
+	if (m_pb == 0)
+	{
+		for (int j = 0; j < m_cy; ++j)
+			for (int i = 0; i < m_cx; ++i) *pd++ = BrickValue(i, j, nslice);
+		return;
+	}
+
 	// go to the beginning of the slice
 	byte* ps = m_pb + nslice*m_cx*m_cy;
-	byte* pd = im.GetBytes();
 
 	// copy image data
 	int n = m_cx*m_cy;
@@ -133,6 +466,14 @@ void C3DImage::StretchBlt(CImage& im, int nslice)
 	int nx = im.Width();
 	int ny = im.Height();
 
+	if (m_pb == 0)
+	{
+		for (int y = 0; y < ny; ++y)
+			for (int x = 0; x < nx; ++x)
+				*pd++ = Value((nx > 1 ? x / (nx - 1.0) : 0.0), (ny > 1 ? y / (ny - 1.0) : 0.0), nslice);
+		return;
+	}
+
 	int i0 = 0;
 	int j0 = 0;
 
@@ -179,8 +520,10 @@ void C3DImage::StretchBlt(C3DImage& im)
 	int nx = im.Width();
 	int ny = im.Height();
 	int nz = im.Depth();
-	byte* pb = im.m_pb;
+	#pragma omp parallel for schedule(dynamic)
 	for (int k=0; k<nz; ++k)
+	{
+		byte* pb = im.m_pb + (size_t)k*nx*ny;
 		for (int j=0; j<ny; ++j)
 			for (int i=0; i<nx; ++i, ++pb)
 			{
@@ -189,6 +532,46 @@ void C3DImage::StretchBlt(C3DImage& im)
 				double t = (double) k / (double) (nz - 1);
 				*pb = Peek(r, s, t);
 			}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Creates im from every n-th voxel of this image. For bricked images the rows
+// are read directly from the file, since most bricks would only contribute a
+// few voxels.
+void C3DImage::Subsample(C3DImage& im, int n)
+{
+	if (n < 1) n = 1;
+	int nx = (m_cx + n - 1) / n;
+	int ny = (m_cy + n - 1) / n;
+	int nz = (m_cz + n - 1) / n;
+	im.Create(nx, ny, nz);
+	byte* pd = im.m_pb;
+
+	if (m_pb)
+	{
+		for (int k = 0; k < nz; ++k)
+			for (int j = 0; j < ny; ++j)
+			{
+				const byte* ps = m_pb + ((size_t)k*n*m_cy + (size_t)j*n)*m_cx;
+				for (int i = 0; i < nx; ++i) *pd++ = ps[i*n];
+			}
+		return;
+	}
+
+	std::vector<byte> row((size_t)m_cx*m_bpv);
+	std::lock_guard<std::mutex> lock(m_lock);
+	for (int k = 0; k < nz; ++k)
+	{
+		int kf = (m_bflipz ? m_cz - 1 - k*n : k*n);
+		for (int j = 0; j < ny; ++j)
+		{
+			long long off = ((long long)kf*m_cy + (long long)j*n)*m_cx*m_bpv;
+			fseek64(m_fp, off, SEEK_SET);
+			if (fread(&row[0], m_bpv, m_cx, m_fp) != (size_t)m_cx) memset(&row[0], 0, row.size());
+			for (int i = 0; i < nx; ++i) *pd++ = ToByte(&row[(size_t)i*n*m_bpv]);
+		}
+	}
 }
 
 
@@ -196,8 +579,6 @@ byte C3DImage::Value(double fx, double fy, int nz)
 {
 	double r, s;
 
-	byte* pb = m_pb + nz*m_cx*m_cy;
-
 	int ix = (int) ((m_cx-1)*fx);
 	int iy = (int) ((m_cy-1)*fy);
 
@@ -205,19 +586,16 @@ byte C3DImage::Value(double fx, double fy, int nz)
 	if (iy == (m_cy - 1)) { iy--; s = 1; } else s = 2*(((m_cy-1)*fy) - iy)-1;
 
 	double h;
-	h  = (1-r)*(1-s)*pb[ix   +  iy   *m_cx];
-	h += (1+r)*(1-s)*pb[ix+1 +  iy   *m_cx];
-	h += (1+r)*(1+s)*pb[ix+1 + (iy+1)*m_cx];
-	h += (1-r)*(1+s)*pb[ix   + (iy+1)*m_cx];
+	h  = (1-r)*(1-s)*value(ix    , iy    , nz);
+	h += (1+r)*(1-s)*value(ix + 1, iy    , nz);
+	h += (1+r)*(1+s)*value(ix + 1, iy + 1, nz);
+	h += (1-r)*(1+s)*value(ix    , iy + 1, nz);
 
 	return (byte)(0.25*h);
 }
 
 byte C3DImage::Peek(double r, double s, double t)
 {
-	static int n1,n2,n3,n4,n5,n6,n7,n8;
-	static double h1,h2,h3,h4,h5,h6,h7,h8;
-
 	if (r < 0) r = 0; if (r > 1) r = 1;
 	if (s < 0) s = 0; if (s > 1) s = 1;
 	if (t < 0) t = 0; if (t > 1) t = 1;
@@ -225,40 +603,58 @@ byte C3DImage::Peek(double r, double s, double t)
 	int i = (int)(r*(m_cx-1)); if (i == (m_cx - 1)) i = m_cx - 2;
 	int j = (int)(s*(m_cy-1)); if (j == (m_cy - 1)) j = m_cy - 2;
 	int k = (int)(t*(m_cz-1)); if (k == (m_cz - 1)) k = m_cz - 2;
+	if (k < 0) k = 0;
 
 	r = 2.0*(r*(m_cx-1) - i) - 1.0;
 	s = 2.0*(s*(m_cy-1) - j) - 1.0;
 	t = 2.0*(t*(m_cz-1) - k) - 1.0;
 
-	n1 = i + j*m_cx + k*m_cx*m_cy;
-	n2 = n1 + 1;
-	n3 = n2 + m_cx;
-	n4 = n3 - 1;
-	n5 = n1 + (m_cz > 1 ? m_cx*m_cy : 0);
-	n6 = n5 + 1;
-	n7 = n6 + m_cx;
-	n8 = n7 - 1;
-
-	h1 = (1-r)*(1-s)*(1-t);
-	h2 = (1+r)*(1-s)*(1-t);
-	h3 = (1+r)*(1+s)*(1-t);
-	h4 = (1-r)*(1+s)*(1-t);
-	h5 = (1-r)*(1-s)*(1+t);
-	h6 = (1+r)*(1-s)*(1+t);
-	h7 = (1+r)*(1+s)*(1+t);
-	h8 = (1-r)*(1+s)*(1+t);
-	
-	byte* pb = m_pb;
+	int k1 = (m_cz > 1 ? k + 1 : k);
 
-	return (byte)((h1*pb[n1]+h2*pb[n2]+h3*pb[n3]+h4*pb[n4]+h5*pb[n5]+h6*pb[n6]+h7*pb[n7]+h8*pb[n8])*0.125);
-}
+	double h1 = (1-r)*(1-s)*(1-t);
+	double h2 = (1+r)*(1-s)*(1-t);
+	double h3 = (1+r)*(1+s)*(1-t);
+	double h4 = (1-r)*(1+s)*(1-t);
+	double h5 = (1-r)*(1-s)*(1+t);
+	double h6 = (1+r)*(1-s)*(1+t);
+	double h7 = (1+r)*(1+s)*(1+t);
+	double h8 = (1-r)*(1+s)*(1+t);
+
+	double v = h1*value(i, j, k ) + h2*value(i + 1, j, k ) + h3*value(i + 1, j + 1, k ) + h4*value(i, j + 1, k )
+		     + h5*value(i, j, k1) + h6*value(i + 1, j, k1) + h7*value(i + 1, j + 1, k1) + h8*value(i, j + 1, k1);
 
+	return (byte)(v*0.125);
+}
 
+//-----------------------------------------------------------------------------
+// For out-of-core images the histogram is estimated from a regular subset of
+// the bricks, so that this does not read the entire file.
 void C3DImage::Histogram(int* pdf)
 {
 	int i;
 	for (i=0; i<256; i++) pdf[i] = 0;
 
+	if (m_pb == 0)
+	{
+		const int MAX_BRICKS = 64;
+		int ns = 1;
+		while (((m_nbx + ns - 1) / ns)*((m_nby + ns - 1) / ns)*((m_nbz + ns - 1) / ns) > MAX_BRICKS) ns++;
+
+		for (int bz = 0; bz < m_nbz; bz += ns)
+			for (int by = 0; by < m_nby; by += ns)
+				for (int bx = 0; bx < m_nbx; bx += ns)
+				{
+					int i0 = bx*BRICK_SIZE, j0 = by*BRICK_SIZE, k0 = bz*BRICK_SIZE;
+					int i1 = (i0 + BRICK_SIZE < m_cx ? i0 + BRICK_SIZE : m_cx);
+					int j1 = (j0 + BRICK_SIZE < m_cy ? j0 + BRICK_SIZE : m_cy);
+					int k1 = (k0 + BRICK_SIZE < m_cz ? k0 + BRICK_SIZE : m_cz);
+					for (int k = k0; k < k1; ++k)
+						for (int j = j0; j < j1; ++j)
+							for (int i = i0; i < i1; ++i) pdf[BrickValue(i, j, k)]++;
+				}
+		return;
+	}
+
 	byte* pb = m_pb;
 	int nsize = m_cx*m_cy*m_cz;
 
@@ -273,6 +669,13 @@ void C3DImage::GetSliceX(CImage& im, int n)
 	byte* ps;
 	byte* pd = im.GetBytes();
 
+	if (m_pb == 0)
+	{
+		for (int z = 0; z < m_cz; z++)
+			for (int y = 0; y < m_cy; y++) *pd++ = BrickValue(n, y, z);
+		return;
+	}
+
 	// copy image data
 	for (int z=0; z<m_cz; z++)
 	{
@@ -289,6 +692,13 @@ void C3DImage::GetSliceY(CImage& im, int n)
 	byte* ps;
 	byte* pd = im.GetBytes();
 
+	if (m_pb == 0)
+	{
+		for (int z = 0; z < m_cz; z++)
+			for (int x = 0; x < m_cx; x++) *pd++ = BrickValue(x, n, z);
+		return;
+	}
+
 	// copy image data
 	for (int z=0; z<m_cz; z++)
 	{
@@ -304,6 +714,13 @@ void C3DImage::GetSliceZ(CImage& im, int n)
 
 	// copy image data
 	byte* pd = im.GetBytes();
+
+	if (m_pb == 0)
+	{
+		BitBlt(im, n);
+		return;
+	}
+
 	byte* ps = m_pb + n*m_cx*m_cy;
 
 	for (int i=0; i<m_cx*m_cy; i++, ps++) *pd++ = *ps;
@@ -366,20 +783,77 @@ void C3DImage::GetSampledSliceZ(CImage& im, double f)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// In-memory images can be modified, so their ranges are always recalculated.
+void C3DImage::UpdateBrickRanges()
+{
+	std::lock_guard<std::mutex> lock(m_rangeLock);
+	if (IsBricked() && m_rangeValid) return;
+
+	const int nbx = (m_cx + BRICK_MASK) >> BRICK_BITS;
+	const int nby = (m_cy + BRICK_MASK) >> BRICK_BITS;
+	const int nbz = (m_cz + BRICK_MASK) >> BRICK_BITS;
+	const int nbricks = nbx*nby*nbz;
+	m_rangeMin.resize(nbricks);
+	m_rangeMax.resize(nbricks);
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int n = 0; n < nbricks; ++n)
+	{
+		int i0 = (n % nbx)*BRICK_SIZE;
+		int j0 = ((n / nbx) % nby)*BRICK_SIZE;
+		int k0 = (n / (nbx*nby))*BRICK_SIZE;
+		int i1 = (i0 + BRICK_SIZE < m_cx ? i0 + BRICK_SIZE : m_cx);
+		int j1 = (j0 + BRICK_SIZE < m_cy ? j0 + BRICK_SIZE : m_cy);
+		int k1 = (k0 + BRICK_SIZE < m_cz ? k0 + BRICK_SIZE : m_cz);
+
+		byte vmin = 255, vmax = 0;
+		for (int k = k0; k < k1; ++k)
+			for (int j = j0; j < j1; ++j)
+				for (int i = i0; i < i1; ++i)
+				{
+					byte v = value(i, j, k);
+					if (v < vmin) vmin = v;
+					if (v > vmax) vmax = v;
+				}
+
+		m_rangeMin[n] = vmin;
+		m_rangeMax[n] = vmax;
+	}
+
+	m_rangeValid = true;
+}
+
+void C3DImage::GetBrickRange(int bx, int by, int bz, byte& vmin, byte& vmax) const
+{
+	const int nbx = (m_cx + BRICK_MASK) >> BRICK_BITS;
+	const int nby = (m_cy + BRICK_MASK) >> BRICK_BITS;
+	int n = (bz*nby + by)*nbx + bx;
+	vmin = m_rangeMin[n];
+	vmax = m_rangeMax[n];
+}
+
 void C3DImage::Invert()
 {
+	if (m_pb == 0) { m_binvert = !m_binvert; m_rangeValid = false; return; }
+
 	int n = m_cx*m_cy*m_cz;
 	for (int i=0; i<n; i++) m_pb[i] = 255 - m_pb[i];
 }
 
 void C3DImage::Zero()
 {
+	// out-of-core images are read-only
+	if (m_pb == 0) return;
+
 	int n = m_cx*m_cy*m_cz;
 	for (int i=0; i<n; i++) m_pb[i] = 0;
 }
 
 void C3DImage::FlipZ()
 {
+	if (m_pb == 0) { m_bflipz = !m_bflipz; m_rangeValid = false; return; }
+
 	int nsize = m_cx*m_cy;
 	byte* buf = new byte[nsize];
 	for (int i = 0; i < m_cz / 2; ++i)
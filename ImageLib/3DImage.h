@@ -26,11 +26,33 @@ SOFTWARE.*/
 
 #pragma once
 #include "Image.h"
+#include <stdio.h>
+#include <vector>
+#include <mutex>
 
 //-----------------------------------------------------------------------------
-// A class for representing 3D image stacks
+// A class for representing 3D image stacks.
+// The image data is either kept in memory as 8-bit values (see Create), or it
+// is read on demand from a RAW file (see Open). In the latter case, the voxels
+// are stored as 8, 16 or 32-bit values in the file and they are loaded in bricks
+// of BRICK_SIZE^3 voxels through a cache with a fixed memory budget.
+// value() always returns the 8-bit (display) value of a voxel. For 16 and 32-bit
+// data the raw values are mapped to [0,255] using the value range.
 class C3DImage
 {
+public:
+	// voxel types of RAW files
+	enum VoxelType {
+		VOXEL_UINT8,
+		VOXEL_UINT16,
+		VOXEL_FLOAT
+	};
+
+	// bricks are 2^BRICK_BITS voxels wide
+	enum { BRICK_BITS = 6, BRICK_SIZE = (1 << BRICK_BITS), BRICK_MASK = BRICK_SIZE - 1 };
+
+	struct Brick;
+
 public:
 	C3DImage();
 	virtual ~C3DImage();
@@ -40,20 +62,48 @@ public:
 
 	bool LoadFromFile(const char* szfile, int nbits);
 
+	// open a RAW file for out-of-core access
+	bool Open(const char* szfile, int nx, int ny, int nz, int voxelType = VOXEL_UINT8);
+
+	// is the image data read from file on demand?
+	bool IsBricked() const { return (m_fp != nullptr); }
+
+	int GetVoxelType() const { return m_voxelType; }
+
+	// range of raw values that is mapped to [0,255]
+	void SetValueRange(double vmin, double vmax);
+	void GetValueRange(double& vmin, double& vmax) const { vmin = m_vmin; vmax = m_vmax; }
+
+	// memory budget (in bytes) of the brick cache
+	void SetCacheSize(size_t nbytes);
+	size_t GetCacheSize() const { return m_cacheSize; }
+
 	void BitBlt(CImage& im, int nslice);
 	void StretchBlt(CImage& im, int nslice);
 	void StretchBlt(C3DImage& im);
 
+	// create im from every n-th voxel in each direction
+	void Subsample(C3DImage& im, int n);
+
 	int Width () { return m_cx; }
 	int Height() { return m_cy; }
 	int Depth () { return m_cz; }
 
-	byte& value(int i, int j, int k) { return m_pb[m_cx*(k*m_cy + j) + i]; }
+	byte value(int i, int j, int k) { return (m_pb ? m_pb[m_cx*(k*m_cy + j) + i] : BrickValue(i, j, k)); }
+	void setValue(int i, int j, int k, byte v) { m_pb[m_cx*(k*m_cy + j) + i] = v; }
 	byte Value(double fx, double fy, int nz);
 	byte Peek(double fx, double fy, double fz);
 
+	// raw value of a voxel (not mapped to [0,255])
+	double Voxel(int i, int j, int k);
+
 	void Histogram(int* pdf);
 
+	// Calculates the range of values in each brick of BRICK_SIZE^3 voxels. 
+	// The ranges of out-of-core images are only calculated once.
+	void UpdateBrickRanges();
+	void GetBrickRange(int bx, int by, int bz, byte& vmin, byte& vmax) const;
+
 	void GetSliceX(CImage& im, int n);
 	void GetSliceY(CImage& im, int n);
 	void GetSliceZ(CImage& im, int n);
@@ -70,11 +120,40 @@ public:
 
 	void FlipZ();
 
+protected:
+	byte BrickValue(int i, int j, int k);
+	const byte* BrickData(int i, int j, int k);
+	Brick* LoadBrick(int nbrick);
+	static void Unpin(unsigned int serial, Brick* b);
+	byte ToByte(const byte* p) const;
+
 protected:
 	byte*	m_pb;	// image data
 	int		m_cx;
 	int		m_cy;
 	int		m_cz;
+
+	// out-of-core data
+	FILE*				m_fp;			// RAW file
+	int					m_voxelType;	// voxel type in file
+	int					m_bpv;			// bytes per voxel
+	int					m_nbx, m_nby, m_nbz;	// number of bricks in each direction
+	std::vector<Brick*>	m_brick;		// brick table (null if not loaded)
+	std::vector<int>	m_loaded;		// indices of loaded bricks
+	size_t				m_cacheSize;	// memory budget
+	size_t				m_cacheUsed;	// memory used by loaded bricks
+	unsigned int		m_clock;		// access counter for LRU
+	unsigned int		m_serial;		// identifies this data set for the thread's brick pins
+	bool				m_readError;	// a brick could not be read from the file
+	double				m_vmin, m_vmax;	// value range
+	bool				m_binvert;		// invert values
+	bool				m_bflipz;		// flip z
+	std::mutex			m_lock;			// protects the brick table
+
+	// value ranges of the bricks
+	std::vector<byte>	m_rangeMin, m_rangeMax;
+	bool				m_rangeValid;
+	std::mutex			m_rangeLock;
 };
 
 //-----------------------------------------------------------------------------
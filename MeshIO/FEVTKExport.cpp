@@ -28,9 +28,55 @@ SOFTWARE.*/
 #include <GeomLib/GObject.h>
 #include <MeshTools/GModel.h>
 #include <MeshTools/FEProject.h>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// The binary legacy format stores values as big-endian 4-byte words.
+template <typename T> static void write_be(FILE* fp, const std::vector<T>& v)
+{
+	static_assert(sizeof(T) == 4, "only 4-byte values are supported");
+	if (v.empty()) return;
+
+	int n = 1;
+	bool swap = (*((char*)&n) == 1);
+	if (swap == false)
+	{
+		fwrite(&v[0], 4, v.size(), fp);
+		return;
+	}
+
+	std::vector<unsigned char> buf(4 * v.size());
+	const unsigned char* src = (const unsigned char*)&v[0];
+	for (size_t i = 0; i < buf.size(); i += 4)
+	{
+		buf[i    ] = src[i + 3];
+		buf[i + 1] = src[i + 2];
+		buf[i + 2] = src[i + 1];
+		buf[i + 3] = src[i    ];
+	}
+	fwrite(&buf[0], 1, buf.size(), fp);
+}
+
+//-----------------------------------------------------------------------------
+// VTK cell type of an element (or -1 if the element type is not supported)
+static int vtk_cell_type(int ntype)
+{
+	switch (ntype)
+	{
+	case FE_TRI3 : return 5;
+	case FE_QUAD4: return 9;
+	case FE_TET4 : return 10;
+	case FE_HEX8 : return 12;
+	case FE_TET10: return 24;
+	}
+	return -1;
+}
 
 FEVTKExport::FEVTKExport(FEProject& prj) : FEFileExport(prj)
 {
+	m_ops.bshellthick = false;
+	m_ops.bscalar_data = false;
+	m_ops.bbinary = false;
 }
 
 FEVTKExport::~FEVTKExport(void)
@@ -39,7 +85,8 @@ FEVTKExport::~FEVTKExport(void)
 
 bool FEVTKExport::Write(const char* szfile)
 {
-	FILE* fp = fopen(szfile, "wt");
+	bool binary = m_ops.bbinary;
+	FILE* fp = fopen(szfile, (binary ? "wb" : "wt"));
 	if (fp == 0) return false;
 
 	bool isPOLYDATA = false;
@@ -130,7 +177,7 @@ bool FEVTKExport::Write(const char* szfile)
 	// --- H E A D E R ---
 	fprintf(fp, "%s\n" , "# vtk DataFile Version 3.0");
 	fprintf(fp, "%s\n" ,"vtk output");
-	fprintf(fp, "%s\n" ,"ASCII");
+	fprintf(fp, "%s\n" ,(binary ? "BINARY" : "ASCII"));
 	if(isPOLYDATA)
 		fprintf(fp, "%s\n" ,"DATASET POLYDATA");
 	if(isUnstructuredGrid)
@@ -140,7 +187,22 @@ bool FEVTKExport::Write(const char* szfile)
 	//fprintf(fp, "%d %d %d %d\n", parts, nodes, faces, edges);
 
 	// --- N O D E S ---
-	for (int i=0; i<model.Objects(); ++i)
+	if (binary)
+	{
+		std::vector<float> v; v.reserve(3 * nodes);
+		for (int i = 0; i<model.Objects(); ++i)
+		{
+			GObject* po = model.Object(i);
+			FEMesh& m = *po->GetFEMesh();
+			for (int j = 0; j<m.Nodes(); ++j)
+			{
+				vec3d r = m.LocalToGlobal(m.Node(j).r);
+				v.push_back((float)r.x); v.push_back((float)r.y); v.push_back((float)r.z);
+			}
+		}
+		write_be(fp, v);
+	}
+	else for (int i=0; i<model.Objects(); ++i)
 	{
 		GObject* po = model.Object(i);
 		FEMesh& m = *po->GetFEMesh();
@@ -168,6 +230,8 @@ bool FEVTKExport::Write(const char* szfile)
 		fprintf(fp, "%s %d %d\n", "CELLS", totElems, totElems * (nodesPerElem + 1));
 
 	int nn[FEElement::MAX_NODES];
+	std::vector<int> cells;
+	if (binary) cells.reserve(totElems * (nodesPerElem + 1));
 	for (int i=0; i<model.Objects(); ++i)
 	{
 		FEMesh& m = *model.Object(i)->GetFEMesh();
@@ -177,6 +241,18 @@ bool FEVTKExport::Write(const char* szfile)
 			for (int k=0; k<el.Nodes(); ++k) 
 				nn[k] = m.Node(el.m_node[k]).m_ntag;
 
+			if (binary)
+			{
+				if (vtk_cell_type(el.Type()) < 0)
+				{
+					fclose(fp);
+					return false;
+				}
+				cells.push_back(el.Nodes());
+				for (int k = 0; k<el.Nodes(); ++k) cells.push_back(nn[k]);
+				continue;
+			}
+
 			switch (el.Type())
 			{
 			case FE_TRI3:
@@ -199,6 +275,8 @@ bool FEVTKExport::Write(const char* szfile)
 			}
 		}
 	}
+	if (binary) { write_be(fp, cells); fprintf(fp, "\n"); }
+
 	//----Shell Thickness ----
 	if (m_ops.bshellthick)
 	{
@@ -232,7 +310,14 @@ bool FEVTKExport::Write(const char* szfile)
 
 			}
 
-			for (int j=0; j<m.Nodes();)
+			if (binary)
+			{
+				std::vector<float> v(m.Nodes());
+				for (int j = 0; j<m.Nodes(); ++j) v[j] = (float)nodeShellThickness[j];
+				write_be(fp, v);
+				fprintf(fp, "\n");
+			}
+			else for (int j=0; j<m.Nodes();)
 			{
 				for (int k =0; k<9 && j+k<m.Nodes();k++)
 					fprintf(fp, "%15.10lg ", nodeShellThickness[j+k]);	
@@ -271,16 +356,19 @@ bool FEVTKExport::Write(const char* szfile)
 	{
 		fprintf(fp, "%s\n" ,"");		
 		fprintf(fp, "%s %d\n", "CELL_TYPES", totElems);
+		std::vector<int> types;
+		if (binary) types.reserve(totElems);
 		for (int i=0; i<model.Objects(); ++i)
 		{
 			FEMesh& m = *model.Object(i)->GetFEMesh();
 			for (int j=0; j<m.Elements(); ++j)
 			{
-				if (isHex8) fprintf(fp, "%s\n", "12");
-				if (isTet4) fprintf(fp, "%s\n", "10");
-				if (isTet10) fprintf(fp, "%s\n", "24");
+				int ntype = vtk_cell_type(m.Element(j).Type());
+				if (binary) types.push_back(ntype);
+				else fprintf(fp, "%d\n", ntype);
 			}
-		}	
+		}
+		if (binary) { write_be(fp, types); fprintf(fp, "\n"); }
 	}
 
 	fclose(fp);
@@ -33,6 +33,7 @@ struct VTKEXPORT
 {
 	bool	bshellthick;	// shell thickness
 	bool	bscalar_data;   //user scalar data
+	bool	bbinary;		// write binary instead of ASCII
 };
 
 
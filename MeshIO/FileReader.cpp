@@ -70,6 +70,7 @@ bool FileReader::Open(const char* szfile, const char* szmode)
 	m_cancelled = false;
 
 	m_err.clear();
+	m_log.clear();
 	if (m_fp) Close();
 
 	if ((szfile == 0) || (szfile[0] == 0)) return false;
@@ -80,7 +81,7 @@ bool FileReader::Open(const char* szfile, const char* szmode)
 		m_fileName = szfile;
 
 		// get the filesize
-		fseek(m_fp, 0, SEEK_END);
+		fseek64(m_fp, 0, SEEK_END);
 		m_nfilesize = ftell64(m_fp);
 		fseek64(m_fp, 0, SEEK_SET);
 	}
@@ -114,6 +115,17 @@ int FileReader::Errors()
 	return m_nerrors;
 }
 
+const std::string& FileReader::GetLogMessage()
+{
+	return m_log;
+}
+
+void FileReader::logMessage(const std::string& msg)
+{
+	if (m_log.empty()) m_log = msg;
+	else m_log.append("\n").append(msg);
+}
+
 bool FileReader::errf(const char* szerr, ...)
 {
 	if (szerr == 0) return false;
@@ -152,6 +164,31 @@ bool FileReader::errf(const char* szerr, ...)
 	return false;
 }
 
+bool FileReader::ReadAll(std::vector<char>& buf)
+{
+	buf.clear();
+	if (m_fp == 0) return false;
+
+	off_type npos = ftell64(m_fp);
+	if ((npos < 0) || (npos > m_nfilesize)) return false;
+	size_t size = (size_t)(m_nfilesize - npos);
+	buf.resize(size + 1);
+
+	// read in blocks, so the file progress can be tracked
+	const size_t blockSize = 64 << 20;
+	size_t nread = 0;
+	while (nread < size)
+	{
+		size_t n = size - nread;
+		if (n > blockSize) n = blockSize;
+		if (fread(&buf[nread], 1, n, m_fp) != n) { buf.clear(); return false; }
+		nread += n;
+	}
+	buf[size] = 0;
+
+	return true;
+}
+
 float FileReader::GetFileProgress() const
 {
 	if (m_fp)
@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include <stdio.h>
 #include <string.h>
 #include <string>
+#include <vector>
 
 #ifdef WIN32
 typedef __int64 off_type;
@@ -68,6 +69,9 @@ public:
 	// get the number of errors
 	int Errors();
 
+	// get the log messages (information about the file read that is not an error)
+	const std::string& GetLogMessage();
+
 	// get the amount of the file read so far
 	// expressed in percentage of total file size
 	float GetFileProgress() const;
@@ -91,15 +95,23 @@ protected:
 	// helper function that sets the error string
 	bool errf(const char* szerr, ...);
 
+	// add a line to the log messages
+	void logMessage(const std::string& msg);
+
 	// get the file pointer
 	FILE* FilePtr();
 
+	// read the rest of the file into buf. A terminating zero is appended,
+	// so buf.size() is one more than the number of bytes read.
+	bool ReadAll(std::vector<char>& buf);
+
 protected:
 	FILE*			m_fp;
 
 private:
 	std::string		m_fileName;	//!< file name
 	std::string		m_err;		//!< error messages (separated by \n)
+	std::string		m_log;		//!< log messages (separated by \n)
 	int				m_nerrors;	//!< number of errors
 	off_type		m_nfilesize;	// size of file
 	bool			m_cancelled;	//!< file read was cancelled
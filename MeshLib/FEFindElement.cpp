@@ -24,342 +24,330 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 
+
 #include "FEFindElement.h"
 #include "FECoreMesh.h"
 #include "MeshTools.h"
+#include <algorithm>
+
+// max nr of elements in a leaf of the BVH
+const int BVH_LEAF_SIZE = 4;
 
-FEFindElement::OCTREE_BOX::OCTREE_BOX()
+FEFindElement::FEFindElement(FECoreMesh& mesh) : m_mesh(mesh)
 {
-	m_elem = -1;
-	m_level = -1;
+	m_nframe = -1;
 }
 
-FEFindElement::OCTREE_BOX::~OCTREE_BOX()
+void FEFindElement::Init(int nframe)
 {
-	for (size_t i = 0; i<m_child.size(); ++i) delete m_child[i];
-	m_child.clear();
+	vector<bool> dummy;
+	Init(dummy, nframe);
 }
 
-void FEFindElement::OCTREE_BOX::split(int levels)
+void FEFindElement::Init(vector<bool>& flags, int nframe)
 {
-	m_level = levels;
-	if (m_level == 0) return;
-
-	double x0 = m_box.x0, x1 = m_box.x1;
-	double y0 = m_box.y0, y1 = m_box.y1;
-	double z0 = m_box.z0, z1 = m_box.z1;
-
-	double dx = x1 - x0;
-	double dy = y1 - y0;
-	double dz = z1 - z0;
-
-	m_child.clear();
-	for (int i = 0; i<2; i++)
-		for (int j = 0; j<2; j++)
-			for (int k = 0; k <2; k++)
-			{
-				double xa = x0 + i*dx*0.5, xb = x0 + (i + 1)*dx*0.5;
-				double ya = y0 + j*dy*0.5, yb = y0 + (j + 1)*dy*0.5;
-				double za = z0 + k*dz*0.5, zb = z0 + (k + 1)*dz*0.5;
-
-				BOX b(xa, ya, za, xb, yb, zb);
-				double R = b.GetMaxExtent();
-				b.Inflate(R*0.0001);
+	m_nframe = nframe;
 
-				OCTREE_BOX* box = new OCTREE_BOX;
-				box->m_box = b;
+	m_node.clear();
+	m_elem.clear();
+	m_ebox.clear();
+	m_box = BOX();
 
-				m_child.push_back(box);
-			}
+	int NN = m_mesh.Nodes();
+	int NE = m_mesh.Elements();
+	if ((NN == 0) || (NE == 0)) return;
 
-	for (int i = 0; i<(int)m_child.size(); ++i)
+	// select the elements
+	int cflags = (int)flags.size();
+	m_active.assign(NE, 0);
+	for (int i = 0; i<NE; ++i)
 	{
-		m_child[i]->split(levels - 1);
-	}
-}
+		FEElement_& e = m_mesh.ElementRef(i);
 
-void FEFindElement::OCTREE_BOX::Add(BOX& b, int nelem)
-{
-	if (m_level == 0)
-	{
-		if (m_box.Intersects(b))
+		bool badd = true;
+		if (flags.empty() == false)
 		{
-			OCTREE_BOX* box = new OCTREE_BOX;
-			box->m_box = b;
-			box->m_elem = nelem;
-			box->m_level = -1;
-			m_child.push_back(box);
-			return;
+			int mid = e.m_MatID;
+			if ((mid >= 0) && (mid < cflags)) badd = flags[mid];
 		}
-	}
-	else
-	{
-		for (size_t i = 0; i<m_child.size(); ++i)
+
+		if (badd)
 		{
-			m_child[i]->Add(b, nelem);
+			m_active[i] = 1;
+			m_elem.push_back(i);
 		}
 	}
-}
-
-
-FEFindElement::OCTREE_BOX* FEFindElement::OCTREE_BOX::Find(const vec3f& r)
-{
-	if (m_level == 0)
-	{
-		bool inside = m_box.IsInside(r);
-		return (inside ? this : 0);
-	}
 
-	// try to find the child
-	for (size_t i = 0; i<m_child.size(); ++i)
-	{
-		OCTREE_BOX* c = m_child[i];
-		OCTREE_BOX* ret = c->Find(r);
-		if (ret) return ret;
-	}
-
-	return 0;
+	Build();
 }
 
-
-FEFindElement::OCTREE_BOX* FEFindElement::FindBox(const vec3f& r)
+void FEFindElement::ElementBox(int nelem, float bmin[3], float bmax[3])
 {
-	// make sure it's in the master box
-	if (m_bound.IsInside(r) == false) return 0;
-
-	// try to find the child
-	OCTREE_BOX* b = &m_bound;
-	do
+	FEElement_& e = m_mesh.ElementRef(nelem);
+	int ne = e.Nodes();
+	vec3f r = to_vec3f(m_mesh.Node(e.m_node[0]).r);
+	bmin[0] = bmax[0] = r.x;
+	bmin[1] = bmax[1] = r.y;
+	bmin[2] = bmax[2] = r.z;
+	for (int j = 1; j<ne; ++j)
 	{
-		if (b->m_level == 0)
-		{
-			bool inside = b->IsInside(r);
-			return (inside ? b : 0);
-		}
-
-		bool bfound = false;
-		for (size_t i = 0; i<b->m_child.size(); ++i)
-		{
-			OCTREE_BOX* c = b->m_child[i];
-			if (c->IsInside(r))
-			{
-				b = c;
-				bfound = true;
-				break;
-			}
-		}
-
-		assert(bfound);
-		if (bfound == false) break;
-	} while (1);
-
-	return 0;
-}
+		r = to_vec3f(m_mesh.Node(e.m_node[j]).r);
+		if (r.x < bmin[0]) { bmin[0] = r.x; }
+		if (r.x > bmax[0]) { bmax[0] = r.x; }
+		if (r.y < bmin[1]) { bmin[1] = r.y; }
+		if (r.y > bmax[1]) { bmax[1] = r.y; }
+		if (r.z < bmin[2]) { bmin[2] = r.z; }
+		if (r.z > bmax[2]) { bmax[2] = r.z; }
+	}
 
-FEFindElement::FEFindElement(FECoreMesh& mesh) : m_mesh(mesh)
-{
-	m_nframe = -1;
+	// inflate the box a little
+	float R = bmax[0] - bmin[0];
+	if (bmax[1] - bmin[1] > R) R = bmax[1] - bmin[1];
+	if (bmax[2] - bmin[2] > R) R = bmax[2] - bmin[2];
+	R *= 0.001f;
+	for (int j = 0; j < 3; ++j) { bmin[j] -= R; bmax[j] += R; }
 }
 
-void FEFindElement::InitReferenceFrame(vector<bool>& flags)
+void FEFindElement::Build()
 {
-	assert(m_nframe == 0);
-
-	// calculate bounding box for the entire mesh
-	int NN = m_mesh.Nodes();
-	int NE = m_mesh.Elements();
-	if ((NN == 0) || (NE == 0)) return;
-
-	vec3f r = to_vec3f(m_mesh.Node(0).r);
-	BOX box(r, r);
-	for (int i = 1; i<m_mesh.Nodes(); ++i)
+	int NE = (int)m_elem.size();
+	if (NE == 0) return;
+
+	// calculate the element boxes and centers
+	vector<float> box(6*NE);
+	vector<vec3f> c(NE);
+#pragma omp parallel for
+	for (int i = 0; i < NE; ++i)
 	{
-		r = to_vec3f(m_mesh.Node(i).r);
-		box += r;
+		float* b = &box[6 * i];
+		ElementBox(m_elem[i], b, b + 3);
+		c[i] = vec3f(b[0] + b[3], b[1] + b[4], b[2] + b[5])*0.5f;
 	}
-	double R = box.GetMaxExtent();
-	box.Inflate(R*0.001);
 
-	// split this box recursively
-	m_bound.m_box = box;
+	// the elements are sorted along with their boxes via this index list
+	vector<int> index(NE);
+	for (int i = 0; i < NE; ++i) index[i] = i;
 
-	int l = (int)(log(NE) / log(8.0));
-	if (l < 0) l = 0;
-	if (l > 3) l = 3;
-	m_bound.split(l);
+	// build the tree top-down by splitting at the median of the longest axis
+	m_node.reserve(2 * (NE / BVH_LEAF_SIZE + 1));
+	BVH_NODE root;
+	root.left = -1; root.first = 0; root.count = NE;
+	m_node.push_back(root);
 
-	// calculate bounding boxes for all elements
-	int cflags = (int)flags.size();
-	for (int i = 0; i<NE; ++i)
+	vector<int> stack;
+	stack.push_back(0);
+	while (stack.empty() == false)
 	{
-		FEElement_& e = m_mesh.ElementRef(i);
+		int n = stack.back(); stack.pop_back();
+		int n0 = m_node[n].first;
+		int nc = m_node[n].count;
 
-		bool badd = true;
-		if (flags.empty() == false)
+		// bounding box of the node
+		float bmin[3], bmax[3], cmin[3], cmax[3];
+		for (int j = 0; j < 3; ++j)
 		{
-			int mid = e.m_MatID;
-			if ((mid >= 0) && (mid < cflags)) badd = flags[mid];
+			bmin[j] = cmin[j] = 1e37f;
+			bmax[j] = cmax[j] = -1e37f;
 		}
-
-		if (badd)
+		for (int i = n0; i < n0 + nc; ++i)
 		{
-			int ne = e.Nodes();
-
-			// do a quick bounding box test
-			vec3f r0 = to_vec3f(m_mesh.Node(e.m_node[0]).r);
-			vec3f r1 = r0;
-			BOX box(r0, r1);
-			for (int j = 1; j<ne; ++j)
+			const float* b = &box[6 * index[i]];
+			const vec3f& ci = c[index[i]];
+			float cc[3] = { ci.x, ci.y, ci.z };
+			for (int j = 0; j < 3; ++j)
 			{
-				vec3f rj = to_vec3f(m_mesh.Node(e.m_node[j]).r);
-				box += rj;
+				if (b[j] < bmin[j]) bmin[j] = b[j];
+				if (b[j + 3] > bmax[j]) bmax[j] = b[j + 3];
+				if (cc[j] < cmin[j]) cmin[j] = cc[j];
+				if (cc[j] > cmax[j]) cmax[j] = cc[j];
 			}
-			double R = box.GetMaxExtent();
-			box.Inflate(R*0.001);
-
-			// add it to the octree
-			m_bound.Add(box, i);
 		}
+		for (int j = 0; j < 3; ++j) { m_node[n].bmin[j] = bmin[j]; m_node[n].bmax[j] = bmax[j]; }
+
+		if (nc <= BVH_LEAF_SIZE) continue;
+
+		// split along the longest axis of the centers
+		int axis = 0;
+		if (cmax[1] - cmin[1] > cmax[axis] - cmin[axis]) axis = 1;
+		if (cmax[2] - cmin[2] > cmax[axis] - cmin[axis]) axis = 2;
+
+		int m = nc / 2;
+		std::nth_element(index.begin() + n0, index.begin() + n0 + m, index.begin() + n0 + nc, [&](int a, int b) {
+			const float* ca = &c[a].x;
+			const float* cb = &c[b].x;
+			return ca[axis] < cb[axis];
+		});
+
+		BVH_NODE l, r;
+		l.left = -1; l.first = n0; l.count = m;
+		r.left = -1; r.first = n0 + m; r.count = nc - m;
+		int nl = (int)m_node.size();
+		m_node[n].left = nl;
+		m_node[n].first = -1;
+		m_node[n].count = 0;
+		m_node.push_back(l);
+		m_node.push_back(r);
+		stack.push_back(nl);
+		stack.push_back(nl + 1);
 	}
-}
 
-void FEFindElement::InitCurrentFrame(vector<bool>& flags)
-{
-	assert(m_nframe == 1);
-
-	// calculate bounding box for the entire mesh
-	int NN = m_mesh.Nodes();
-	int NE = m_mesh.Elements();
-	if ((NN == 0) || (NE == 0)) return;
-
-	vec3d r = m_mesh.Node(0).r;
-	BOX box(r, r);
-	for (int i = 1; i<m_mesh.Nodes(); ++i)
+	// reorder the element list and boxes
+	vector<int> elem(NE);
+	m_ebox.resize(6 * NE);
+	for (int i = 0; i < NE; ++i)
 	{
-		r = m_mesh.Node(i).r;
-		box += r;
+		elem[i] = m_elem[index[i]];
+		for (int j = 0; j < 6; ++j) m_ebox[6 * i + j] = box[6 * index[i] + j];
 	}
-	double R = box.GetMaxExtent();
-	box.Inflate(R*0.001);
-
-	// split this box recursively
-	m_bound.m_box = box;
+	m_elem.swap(elem);
 
-	int l = (int)(log(NE) / log(8.0));
-	if (l < 0) l = 0;
-	if (l > 3) l = 3;
-	m_bound.split(l);
+	const BVH_NODE& rn = m_node[0];
+	m_box = BOX(rn.bmin[0], rn.bmin[1], rn.bmin[2], rn.bmax[0], rn.bmax[1], rn.bmax[2]);
+}
 
-	// calculate bounding boxes for all elements
-	int cflags = (int)flags.size();
-	for (int i = 0; i<NE; ++i)
+void FEFindElement::Update()
+{
+	// build the BVH if this was not initialized yet
+	if (m_nframe == -1) { Init(1); return; }
+	if (m_node.empty()) return;
+
+	// refit the leaves
+	int NN = (int)m_node.size();
+#pragma omp parallel for
+	for (int n = 0; n < NN; ++n)
 	{
-		FEElement_& e = m_mesh.ElementRef(i);
-
-		bool badd = true;
-		if (flags.empty() == false)
-		{
-			int mid = e.m_MatID;
-			if ((mid >= 0) && (mid < cflags)) badd = flags[mid];
-		}
+		BVH_NODE& node = m_node[n];
+		if (node.left != -1) continue;
 
-		if (badd)
+		for (int i = 0; i < node.count; ++i)
 		{
-			int ne = e.Nodes();
-
-			// do a quick bounding box test
-			vec3d r0 = m_mesh.Node(e.m_node[0]).r;
-			vec3d r1 = r0;
-			BOX box(r0, r1);
-			for (int j = 1; j<ne; ++j)
+			float* bmin = &m_ebox[6 * (node.first + i)];
+			float* bmax = bmin + 3;
+			ElementBox(m_elem[node.first + i], bmin, bmax);
+			for (int j = 0; j < 3; ++j)
 			{
-				vec3d rj = m_mesh.Node(e.m_node[j]).r;
-				box += rj;
+				if ((i == 0) || (bmin[j] < node.bmin[j])) node.bmin[j] = bmin[j];
+				if ((i == 0) || (bmax[j] > node.bmax[j])) node.bmax[j] = bmax[j];
 			}
-			double R = box.GetMaxExtent();
-			box.Inflate(R*0.001);
+		}
+	}
+
+	// children are always stored after their parent, so the internal nodes
+	// can be updated in reverse order
+	for (int n = NN - 1; n >= 0; --n)
+	{
+		BVH_NODE& node = m_node[n];
+		if (node.left == -1) continue;
 
-			// add it to the octree
-			m_bound.Add(box, i);
+		const BVH_NODE& a = m_node[node.left];
+		const BVH_NODE& b = m_node[node.left + 1];
+		for (int j = 0; j < 3; ++j)
+		{
+			node.bmin[j] = (a.bmin[j] < b.bmin[j] ? a.bmin[j] : b.bmin[j]);
+			node.bmax[j] = (a.bmax[j] > b.bmax[j] ? a.bmax[j] : b.bmax[j]);
 		}
 	}
-}
 
-void FEFindElement::Init(int nframe)
-{
-	vector<bool> dummy;
-	m_nframe = nframe;
-	if (m_nframe == 0) InitReferenceFrame(dummy);
-	else InitCurrentFrame(dummy);
+	const BVH_NODE& rn = m_node[0];
+	m_box = BOX(rn.bmin[0], rn.bmin[1], rn.bmin[2], rn.bmax[0], rn.bmax[1], rn.bmax[2]);
 }
 
-void FEFindElement::Init(vector<bool>& flags, int nframe)
+bool FEFindElement::TestElement(int nelem, const vec3f& x, double r[3])
 {
-	m_nframe = nframe;
-	if (m_nframe == 0) InitReferenceFrame(flags);
-	else InitCurrentFrame(flags);
+	FEElement_& e = m_mesh.ElementRef(nelem);
+	return ProjectInsideElement(m_mesh, e, x, r);
 }
 
-bool FEFindElement::FindInReferenceFrame(const vec3f& x, int& nelem, double r[3])
+bool FEFindElement::FindElement(const vec3f& x, int& nelem, double r[3])
 {
-	assert(m_nframe == 0);
-
-	vec3f y[FEElement::MAX_NODES];
-	OCTREE_BOX* b = FindBox(x);
-	if (b == 0) return false;
-	assert(b->m_level == 0);
+	nelem = -1;
+	if (m_node.empty()) return false;
 
-	int NE = (int)b->m_child.size();
-	for (int i = 0; i<NE; ++i)
+	int stack[64];
+	int ns = 0;
+	stack[ns++] = 0;
+	while (ns > 0)
 	{
-		OCTREE_BOX* c = b->m_child[i];
-		assert(c->m_level == -1);
-
-		int nid = c->m_elem; assert(nid >= 0);
+		const BVH_NODE& node = m_node[stack[--ns]];
+		if ((x.x < node.bmin[0]) || (x.x > node.bmax[0]) ||
+			(x.y < node.bmin[1]) || (x.y > node.bmax[1]) ||
+			(x.z < node.bmin[2]) || (x.z > node.bmax[2])) continue;
 
-		FEElement_& e = m_mesh.ElementRef(nid);
-		nelem = nid;
-
-		// do a quick bounding box test
-		if (c->m_box.IsInside(x))
+		if (node.left == -1)
+		{
+			for (int i = 0; i < node.count; ++i)
+			{
+				int nid = m_elem[node.first + i];
+
+				// do a quick bounding box test
+				const float* bmin = &m_ebox[6 * (node.first + i)];
+				const float* bmax = bmin + 3;
+				if ((x.x < bmin[0]) || (x.x > bmax[0]) ||
+					(x.y < bmin[1]) || (x.y > bmax[1]) ||
+					(x.z < bmin[2]) || (x.z > bmax[2])) continue;
+
+				// do a more complete search
+				if (TestElement(nid, x, r))
+				{
+					nelem = nid;
+					return true;
+				}
+			}
+		}
+		else if (ns < 62)
 		{
-			// do a more complete search
-			if (ProjectInsideReferenceElement(m_mesh, e, x, r)) return true;
+			stack[ns++] = node.left + 1;
+			stack[ns++] = node.left;
 		}
 	}
 
-	nelem = -1;
 	return false;
 }
 
-bool FEFindElement::FindInCurrentFrame(const vec3f& x, int& nelem, double r[3])
+bool FEFindElement::FindElement(const vec3f& x, int& nelem, double r[3], int hint)
 {
-	assert(m_nframe == 1);
-
-	vec3f y[FEElement::MAX_NODES];
-	OCTREE_BOX* b = FindBox(x);
-	if (b == 0) return false;
-	assert(b->m_level == 0);
-
-	int NE = (int)b->m_child.size();
-	for (int i = 0; i<NE; ++i)
+	int NE = (int)m_active.size();
+	if ((hint >= 0) && (hint < NE) && m_active[hint])
 	{
-		OCTREE_BOX* c = b->m_child[i];
-		assert(c->m_level == -1);
+		if (TestElement(hint, x, r)) { nelem = hint; return true; }
+
+		// try the neighbors
+		FEElement_& e = m_mesh.ElementRef(hint);
+		int nf = e.Faces();
+		for (int i = 0; i < nf; ++i)
+		{
+			int nbr = e.m_nbr[i];
+			if ((nbr >= 0) && m_active[nbr] && TestElement(nbr, x, r)) { nelem = nbr; return true; }
+		}
+	}
 
-		int nid = c->m_elem; assert(nid >= 0);
+	return FindElement(x, nelem, r);
+}
 
-		FEElement_& e = m_mesh.ElementRef(nid);
-		nelem = nid;
+int FEFindElement::FindElements(const vector<vec3f>& x, vector<int>& nelem, vector<vec3d>& r)
+{
+	int N = (int)x.size();
+	if (nelem.size() != x.size()) nelem.assign(N, -1);
+	r.resize(N);
 
-		// do a quick bounding box test
-		if (c->m_box.IsInside(x))
+	int nfound = 0;
+#pragma omp parallel for schedule(dynamic, 256) reduction(+:nfound)
+	for (int i = 0; i < N; ++i)
+	{
+		double q[3];
+		int nel = -1;
+		if (FindElement(x[i], nel, q, nelem[i]))
 		{
-			// do a more complete search
-			if (ProjectInsideElement(m_mesh, e, x, r)) return true;
+			r[i] = vec3d(q[0], q[1], q[2]);
+			nelem[i] = nel;
+			nfound++;
+		}
+		else
+		{
+			r[i] = vec3d(0, 0, 0);
+			nelem[i] = -1;
 		}
 	}
 
-	nelem = -1;
-	return false;
+	return nfound;
 }
@@ -26,31 +26,23 @@ SOFTWARE.*/
 
 #pragma once
 #include <FSCore/box.h>
+#include <vector>
 
 class FECoreMesh;
 
+//-----------------------------------------------------------------------------
+// Finds the element that contains a point. The element bounding boxes are
+// stored in a bounding volume hierarchy (BVH). When the nodes move, the BVH
+// can be refit to the new positions with Update() instead of being rebuilt.
 class FEFindElement
 {
-public:
-	class OCTREE_BOX
+	// a node of the BVH. Leaves reference a range of the element list.
+	struct BVH_NODE
 	{
-	public:
-		BOX					m_box;
-		vector<OCTREE_BOX*>	m_child;
-		int					m_elem;
-		int					m_level;
-
-	public:
-		OCTREE_BOX();
-		~OCTREE_BOX();
-
-		void split(int levels);
-
-		OCTREE_BOX* Find(const vec3f& r);
-
-		bool IsInside(const vec3f& r) const { return m_box.IsInside(r); }
-
-		void Add(BOX& b, int nelem);
+		float	bmin[3], bmax[3];
+		int		left;	// index of first child (the second child is left + 1), or -1 for leaves
+		int		first;	// first element (leaves only)
+		int		count;	// nr of elements (leaves only)
 	};
 
 public:
@@ -59,27 +51,33 @@ public:
 	void Init(int nframe = 0);
 	void Init(vector<bool>& flags, int nframe = 0);
 
+	// refit the BVH to the current node positions
+	void Update();
+
 	bool FindElement(const vec3f& x, int& nelem, double r[3]);
 
-	BOX BoundingBox() const { return m_bound.m_box; }
+	// same as above, but the hint element and its neighbors are tried first
+	bool FindElement(const vec3f& x, int& nelem, double r[3], int hint);
 
-private:
-	void InitReferenceFrame(vector<bool>& flags);
-	void InitCurrentFrame(vector<bool>& flags);
+	// find the elements of a list of points in parallel. On input, nelem 
+	// can contain hint elements (or -1). On output, it is -1 for points that
+	// were not found. Returns the nr of points found.
+	int FindElements(const vector<vec3f>& x, vector<int>& nelem, vector<vec3d>& r);
 
-	bool FindInReferenceFrame(const vec3f& x, int& nelem, double r[3]);
-	bool FindInCurrentFrame(const vec3f& x, int& nelem, double r[3]);
+	BOX BoundingBox() const { return m_box; }
 
 private:
-	OCTREE_BOX* FindBox(const vec3f& r);
+	void Build();
+	void ElementBox(int nelem, float bmin[3], float bmax[3]);
+	bool TestElement(int nelem, const vec3f& x, double r[3]);
 
 private:
-	OCTREE_BOX	m_bound;
 	FECoreMesh&	m_mesh;
 	int			m_nframe;	// = 0 reference, 1 = current
-};
 
-inline bool FEFindElement::FindElement(const vec3f& x, int& nelem, double r[3])
-{
-	return (m_nframe == 0 ? FindInReferenceFrame(x, nelem, r) : FindInCurrentFrame(x, nelem, r));
-}
+	BOX						m_box;		// bounding box of the mesh
+	std::vector<BVH_NODE>	m_node;		// BVH nodes (the root is the first)
+	std::vector<int>		m_elem;		// element list, ordered by leaf
+	std::vector<float>		m_ebox;		// element boxes (min, max), in the same order
+	std::vector<char>		m_active;	// elements that are included in the search
+};
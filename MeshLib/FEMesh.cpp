@@ -215,6 +215,7 @@ void FEMesh::Clear()
 	m_Face.clear();
 	m_Elem.clear();
 	m_Node.clear();
+	m_nrev++;
 
 	ClearMeshData();
 }
@@ -237,6 +238,7 @@ void FEMesh::Create(int nodes, int elems, int faces, int edges)
 	if (elems > 0) { if (elems) m_Elem.resize(elems); else m_Elem.clear(); }
 	if (faces > 0) { if (faces) m_Face.resize(faces); else m_Face.clear(); }
 	if (edges > 0) { if (edges) m_Edge.resize(edges); else m_Edge.clear(); }
+	m_nrev++;
 
 	// clear mesh data
 	ClearMeshData();
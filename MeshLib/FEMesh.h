@@ -93,6 +93,29 @@ public:
 	double	m_min, m_max;				//!< value range of element data
 };
 
+//-----------------------------------------------------------------------------
+// Stores the values of a mesh metric for all elements, so that the metric does not
+// need to be re-evaluated as long as the mesh (revision) and the object's scale do not change.
+class Mesh_MetricCache
+{
+public:
+	Mesh_MetricCache() { Clear(); }
+
+	void Clear() { m_metric = -1; m_nrev = 0; m_scale = vec3d(1, 1, 1); m_val.clear(); m_tag.clear(); }
+
+	bool IsValid(int metric, unsigned int nrev, const vec3d& scale) const
+	{
+		return ((m_metric == metric) && (m_nrev == nrev) && (m_scale == scale) && (m_val.empty() == false));
+	}
+
+public:
+	int				m_metric;	//!< metric that was evaluated
+	unsigned int	m_nrev;		//!< mesh revision at time of evaluation
+	vec3d			m_scale;	//!< object scale at time of evaluation
+	std::vector<double>	m_val;	//!< metric value for each element
+	std::vector<int>	m_tag;	//!< 1 if the metric could be evaluated, 0 otherwise
+};
+
 //-----------------------------------------------------------------------------
 class FEMeshBuilder;
 
@@ -196,6 +219,8 @@ public:
 
 	Mesh_Data& GetMeshData();
 
+	Mesh_MetricCache& GetMetricCache() { return m_metricCache; }
+
 public: // --- M E S H   Q U E R I E S ---
 	void BuildSurfaceNodeNodeTable(vector< set<int> >& NNT);
 
@@ -212,6 +237,9 @@ protected:
 	// mesh data (used for data evaluation)
 	Mesh_Data	m_data;
 
+	// cached mesh metrics (used by FEMeshValuator)
+	Mesh_MetricCache	m_metricCache;
+
 	// data fields
 	vector<FEMeshData*>		m_meshData;
 
@@ -30,6 +30,7 @@ SOFTWARE.*/
 //-----------------------------------------------------------------------------
 FEMeshBase::FEMeshBase()
 {
+	m_nrev = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -330,6 +331,7 @@ void FEMeshBase::UpdateMesh()
 {
 	UpdateNormals();
 	UpdateBoundingBox();
+	m_nrev++;
 }
 
 //-----------------------------------------------------------------------------
@@ -47,6 +47,10 @@ public:
 	// from FELineMesh
 	void UpdateMesh() override;
 
+	// The mesh revision is incremented each time UpdateMesh is called. 
+	// It can be used to check if data that was derived from the mesh is still valid.
+	unsigned int Revision() const { return m_nrev; }
+
 public:
 	// get the local positions of a face
 	void FaceNodeLocalPositions(const FEFace& f, vec3d* r) const;
@@ -109,6 +113,8 @@ protected:
 
 protected:
 	std::vector<FEFace>		m_Face;	//!< FE faces
+
+	unsigned int	m_nrev;	//!< mesh revision
 };
 
 //-------------------------------------------------------------------
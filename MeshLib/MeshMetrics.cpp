@@ -1077,6 +1077,57 @@ vec3d ShapeGradient(const FEMesh& mesh, const FEElement_& el, int na, int nb)
 	return grad;
 }
 
+//-----------------------------------------------------------------------------
+// evaluate the gradients of all shape functions at element node nb
+// This is equivalent to calling ShapeGradient for all na, but only inverts the Jacobian once.
+void ShapeGradients(const FEMesh& mesh, const FEElement_& el, int nb, vec3d* G)
+{
+	const int MN = FEElement::MAX_NODES;
+	vec3d r[MN];
+	mesh.ElementNodeLocalPositions(el, r);
+	ShapeGradients(el, r, nb, G);
+}
+
+//-----------------------------------------------------------------------------
+void ShapeGradients(const FEElement_& el, const vec3d* r, int nb, vec3d* G)
+{
+	const int ne = el.Nodes();
+
+	// shape function derivatives at node
+	const double(*H)[3] = 0;
+	switch (el.Type())
+	{
+	case FE_HEX8: H = GHEX8[nb]; break;
+	case FE_PENTA6: H = GWEDGE[nb]; break;
+	case FE_TET4: H = GTET[nb]; break;
+	case FE_TET10: H = GTET10[nb]; break;
+	case FE_TET15: H = GTET15[nb]; break;
+	case FE_TET20: H = GTET20[nb]; break;
+	default:
+		for (int i = 0; i < ne; ++i) G[i] = vec3d(0, 0, 0);
+		return;
+	}
+
+	// Jacobian at node b
+	mat3d J; J.zero();
+	for (int i = 0; i<ne; ++i)
+	{
+		J[0][0] += H[i][0] * r[i].x; J[0][1] += H[i][1] * r[i].x; J[0][2] += H[i][2] * r[i].x;
+		J[1][0] += H[i][0] * r[i].y; J[1][1] += H[i][1] * r[i].y; J[1][2] += H[i][2] * r[i].y;
+		J[2][0] += H[i][0] * r[i].z; J[2][1] += H[i][1] * r[i].z; J[2][2] += H[i][2] * r[i].z;
+	}
+	J = J.inverse();
+	J = J.transpose();
+
+	// shape function gradients
+	for (int a = 0; a < ne; ++a)
+	{
+		G[a].x = J[0][0] * H[a][0] + J[0][1] * H[a][1] + J[0][2] * H[a][2];
+		G[a].y = J[1][0] * H[a][0] + J[1][1] * H[a][1] + J[1][2] * H[a][2];
+		G[a].z = J[2][0] * H[a][0] + J[2][1] * H[a][1] + J[2][2] * H[a][2];
+	}
+}
+
 // get the min edge length of an element
 double MinEdgeLength(const FEMesh& mesh, const FEElement& e)
 {
@@ -1145,4 +1196,291 @@ double MaxEdgeLength(const FEMesh& mesh, const FEElement& e)
 	return Lmax;
 }
 
+//-----------------------------------------------------------------------------
+// evaluate a metric for one element
+double ElementMetric(const FEMesh& mesh, const FEElement& el, int metric)
+{
+	double val = 0;
+	switch (metric)
+	{
+	case ELEMENT_VOLUME:
+		val = ElementVolume(mesh, el);
+		break;
+	case JACOBIAN:
+		if (el.IsShell()) val = ShellJacobian(mesh, el, 1);
+		else val = SolidJacobian(mesh, el);
+		break;
+	case SHELL_THICKNESS:
+		if (el.IsShell())
+		{
+			int n = el.Nodes();
+			val = el.m_h[0];
+			for (int i = 1; i<n; ++i) if (el.m_h[i] < val) val = el.m_h[i];
+		}
+		break;
+	case SHELL_AREA:
+		if (el.IsShell()) val = ShellArea(mesh, el);
+		break;
+	case TET_QUALITY:
+		val = TetQuality(mesh, el);
+		break;
+	case TET_MIN_DIHEDRAL:
+		val = TetMinDihedralAngle(mesh, el);
+		break;
+	case TET_MAX_DIHEDRAL:
+		val = TetMaxDihedralAngle(mesh, el);
+		break;
+	case TRI_QUALITY:
+		val = TriQuality(mesh, el);
+		break;
+	case TET10_MIDSIDE_OFFSET:
+		val = Tet10MidsideNodeOffset(mesh, el, true);
+		break;
+	case MIN_EDGE_LENGTH:
+		val = MinEdgeLength(mesh, el);
+		break;
+	case MAX_EDGE_LENGTH:
+		val = MaxEdgeLength(mesh, el);
+		break;
+	default:
+		val = 0.0;
+	}
+	return val;
+}
+
+//-----------------------------------------------------------------------------
+// Number of tet elements that are processed together by the tet kernels.
+// The nodal coordinates of a block are stored as structure-of-arrays so that
+// the kernel loops can be vectorized by the compiler.
+const int TET_BLOCK = 64;
+
+struct TetBlock
+{
+	double	x[4][TET_BLOCK];
+	double	y[4][TET_BLOCK];
+	double	z[4][TET_BLOCK];
+};
+
+//-----------------------------------------------------------------------------
+// Evaluates one of the tet4 metrics for the n elements of the block. 
+// These kernels produce the same values as the corresponding per-element functions.
+static void TetBlockMetric(const TetBlock& b, int n, int metric, double* v)
+{
+	switch (metric)
+	{
+	case ELEMENT_VOLUME:
+	{
+		for (int k = 0; k < n; ++k)
+		{
+			double ax = b.x[1][k] - b.x[0][k], ay = b.y[1][k] - b.y[0][k], az = b.z[1][k] - b.z[0][k];
+			double bx = b.x[2][k] - b.x[0][k], by = b.y[2][k] - b.y[0][k], bz = b.z[2][k] - b.z[0][k];
+			double cx = b.x[3][k] - b.x[0][k], cy = b.y[3][k] - b.y[0][k], cz = b.z[3][k] - b.z[0][k];
+			v[k] = ((ay*bz - az*by)*cx + (az*bx - ax*bz)*cy + (ax*by - ay*bx)*cz) / 6.0;
+		}
+	}
+	break;
+	case TET_QUALITY:
+	{
+		// radius-edge ratio. The circumcenter (relative to node 0) is given by
+		// c = (|a|^2 (b x c) + |b|^2 (c x a) + |c|^2 (a x b)) / (2 a.(b x c))
+		for (int k = 0; k < n; ++k)
+		{
+			double ax = b.x[1][k] - b.x[0][k], ay = b.y[1][k] - b.y[0][k], az = b.z[1][k] - b.z[0][k];
+			double bx = b.x[2][k] - b.x[0][k], by = b.y[2][k] - b.y[0][k], bz = b.z[2][k] - b.z[0][k];
+			double cx = b.x[3][k] - b.x[0][k], cy = b.y[3][k] - b.y[0][k], cz = b.z[3][k] - b.z[0][k];
+
+			double bcx = by*cz - bz*cy, bcy = bz*cx - bx*cz, bcz = bx*cy - by*cx;
+			double cax = cy*az - cz*ay, cay = cz*ax - cx*az, caz = cx*ay - cy*ax;
+			double abx = ay*bz - az*by, aby = az*bx - ax*bz, abz = ax*by - ay*bx;
+
+			double a2 = ax*ax + ay*ay + az*az;
+			double b2 = bx*bx + by*by + bz*bz;
+			double c2 = cx*cx + cy*cy + cz*cz;
+			double D = 2.0*(ax*bcx + ay*bcy + az*bcz);
+
+			double rx = (a2*bcx + b2*cax + c2*abx) / D;
+			double ry = (a2*bcy + b2*cay + c2*aby) / D;
+			double rz = (a2*bcz + b2*caz + c2*abz) / D;
+			double R = sqrt(rx*rx + ry*ry + rz*rz);
+
+			// find the shortest edge
+			double dx, dy, dz;
+			dx = b.x[2][k] - b.x[1][k]; dy = b.y[2][k] - b.y[1][k]; dz = b.z[2][k] - b.z[1][k];
+			double d2 = dx*dx + dy*dy + dz*dz;
+			dx = b.x[3][k] - b.x[1][k]; dy = b.y[3][k] - b.y[1][k]; dz = b.z[3][k] - b.z[1][k];
+			double e2 = dx*dx + dy*dy + dz*dz;
+			dx = b.x[3][k] - b.x[2][k]; dy = b.y[3][k] - b.y[2][k]; dz = b.z[3][k] - b.z[2][k];
+			double f2 = dx*dx + dy*dy + dz*dz;
+
+			double L2 = a2;
+			if (b2 < L2) L2 = b2;
+			if (c2 < L2) L2 = c2;
+			if (d2 < L2) L2 = d2;
+			if (e2 < L2) L2 = e2;
+			if (f2 < L2) L2 = f2;
+
+			v[k] = R / sqrt(L2);
+		}
+	}
+	break;
+	case TET_MIN_DIHEDRAL:
+	case TET_MAX_DIHEDRAL:
+	{
+		const int LT[6][2] = { { 0, 1 }, { 1, 2 }, { 0, 2 }, { 0, 3 }, { 1, 3 }, { 2, 3 } };
+		bool bmin = (metric == TET_MIN_DIHEDRAL);
+		for (int k = 0; k < n; ++k)
+		{
+			// find the normals of all four faces
+			double nx[4], ny[4], nz[4];
+			for (int i = 0; i < 4; ++i)
+			{
+				const int* m = FTTET[i];
+				double ax = b.x[m[1]][k] - b.x[m[0]][k], ay = b.y[m[1]][k] - b.y[m[0]][k], az = b.z[m[1]][k] - b.z[m[0]][k];
+				double bx = b.x[m[2]][k] - b.x[m[0]][k], by = b.y[m[2]][k] - b.y[m[0]][k], bz = b.z[m[2]][k] - b.z[m[0]][k];
+				double fx = ay*bz - az*by, fy = az*bx - ax*bz, fz = ax*by - ay*bx;
+				double L = sqrt(fx*fx + fy*fy + fz*fz);
+				if (L != 0.0) { fx /= L; fy /= L; fz /= L; }
+				nx[i] = fx; ny[i] = fy; nz[i] = fz;
+			}
+
+			double cw0 = (bmin ? -1.0 : 1.0);
+			for (int i = 0; i < 6; ++i)
+			{
+				int i0 = LT[i][0], i1 = LT[i][1];
+				double cw = -(nx[i0]*nx[i1] + ny[i0]*ny[i1] + nz[i0]*nz[i1]);
+				if (bmin) { if (cw > cw0) cw0 = cw; }
+				else { if (cw < cw0) cw0 = cw; }
+			}
+			v[k] = 180.0*acos(cw0) / PI;
+		}
+	}
+	break;
+	case MIN_EDGE_LENGTH:
+	case MAX_EDGE_LENGTH:
+	{
+		bool bmin = (metric == MIN_EDGE_LENGTH);
+		for (int k = 0; k < n; ++k)
+		{
+			double L0 = (bmin ? 1e99 : 0.0);
+			for (int i = 0; i < 6; ++i)
+			{
+				int n0 = ET_TET[i][0], n1 = ET_TET[i][1];
+				double dx = b.x[n1][k] - b.x[n0][k];
+				double dy = b.y[n1][k] - b.y[n0][k];
+				double dz = b.z[n1][k] - b.z[n0][k];
+				double L = sqrt(dx*dx + dy*dy + dz*dz);
+				if (bmin) { if (L < L0) L0 = L; }
+				else { if (L > L0) L0 = L; }
+			}
+			v[k] = L0;
+		}
+	}
+	break;
+	default:
+		assert(false);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// see if a tet kernel exists for this metric
+static bool HasTetKernel(int metric)
+{
+	switch (metric)
+	{
+	case ELEMENT_VOLUME:
+	case TET_QUALITY:
+	case TET_MIN_DIHEDRAL:
+	case TET_MAX_DIHEDRAL:
+	case MIN_EDGE_LENGTH:
+	case MAX_EDGE_LENGTH:
+		return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate a metric for all the elements of the mesh.
+// Linear tets are gathered in blocks and processed by the tet kernels. All other
+// elements are evaluated with ElementMetric. Both loops run in parallel.
+void EvaluateMetric(const FEMesh& mesh, int metric, std::vector<double>& val, std::vector<int>& tag)
+{
+	int NE = mesh.Elements();
+	val.assign(NE, 0.0);
+	tag.assign(NE, 0);
+
+	// split the elements in linear tets and all others
+	vector<int> tets, other;
+	bool useTetKernel = HasTetKernel(metric);
+	for (int i = 0; i < NE; ++i)
+	{
+		const FEElement& el = mesh.Element(i);
+		if (useTetKernel && (el.Type() == FE_TET4)) tets.push_back(i);
+		else other.push_back(i);
+	}
+
+	// process the tets
+	if (tets.empty() == false)
+	{
+		// copy the (local) nodal coordinates to structure-of-arrays
+		int NN = mesh.Nodes();
+		vector<double> x(NN), y(NN), z(NN);
+#pragma omp parallel for
+		for (int i = 0; i < NN; ++i)
+		{
+			const vec3d& r = mesh.Node(i).r;
+			x[i] = r.x; y[i] = r.y; z[i] = r.z;
+		}
+
+		int NT = (int)tets.size();
+		int blocks = (NT + TET_BLOCK - 1) / TET_BLOCK;
+#pragma omp parallel for schedule(dynamic, 16)
+		for (int nb = 0; nb < blocks; ++nb)
+		{
+			int n0 = nb*TET_BLOCK;
+			int n = (n0 + TET_BLOCK <= NT ? TET_BLOCK : NT - n0);
+
+			// gather the block
+			TetBlock b;
+			for (int k = 0; k < n; ++k)
+			{
+				const FEElement& el = mesh.Element(tets[n0 + k]);
+				for (int j = 0; j < 4; ++j)
+				{
+					int nj = el.m_node[j];
+					b.x[j][k] = x[nj];
+					b.y[j][k] = y[nj];
+					b.z[j][k] = z[nj];
+				}
+			}
+
+			// evaluate the metric
+			double v[TET_BLOCK];
+			TetBlockMetric(b, n, metric, v);
+
+			// scatter the results
+			for (int k = 0; k < n; ++k)
+			{
+				val[tets[n0 + k]] = v[k];
+				tag[tets[n0 + k]] = 1;
+			}
+		}
+	}
+
+	// process all other elements
+	int NO = (int)other.size();
+#pragma omp parallel for schedule(dynamic, 1024)
+	for (int i = 0; i < NO; ++i)
+	{
+		int n = other[i];
+		try {
+			val[n] = ElementMetric(mesh, mesh.Element(n), metric);
+			tag[n] = 1;
+		}
+		catch (...)
+		{
+			tag[n] = 0;
+		}
+	}
+}
+
 }
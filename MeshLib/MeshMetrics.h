@@ -29,6 +29,22 @@ SOFTWARE.*/
 
 namespace FEMeshMetrics {
 
+// metrics that can be evaluated with ElementMetric and EvaluateMetric
+enum MetricType {
+	ELEMENT_VOLUME,
+	JACOBIAN,
+	SHELL_THICKNESS,
+	SHELL_AREA,
+	TET_QUALITY,
+	TET_MIN_DIHEDRAL,
+	TET_MAX_DIHEDRAL,
+	TRI_QUALITY,
+	TET10_MIDSIDE_OFFSET,
+	MIN_EDGE_LENGTH,
+	MAX_EDGE_LENGTH,
+	MAX_METRIC_TYPES
+};
+
 // shortest edge on the mesh
 double ShortestEdge(const FEMesh& mesh);
 
@@ -74,12 +90,27 @@ vec3d Gradient(const FEMesh& mesh, const FEElement& el, int node, double* v);
 // evaluate gradient at element nodes (i.e. Grad{Na(x_b)})
 vec3d ShapeGradient(const FEMesh& mesh, const FEElement_& el, int na, int nb);
 
+// evaluate the gradients of all shape functions at element node nb (i.e. G[a] = Grad{Na(x_b)})
+void ShapeGradients(const FEMesh& mesh, const FEElement_& el, int nb, vec3d* G);
+
+// same as above, but with the element's nodal coordinates passed in.
+void ShapeGradients(const FEElement_& el, const vec3d* r, int nb, vec3d* G);
+
 // get the min edge length of an element
 double MinEdgeLength(const FEMesh& mesh, const FEElement& e);
 
 // get the max edge length of an element
 double MaxEdgeLength(const FEMesh& mesh, const FEElement& e);
 
+// evaluate a metric (see MetricType) for one element. 
+// Throws an exception if the metric cannot be evaluated for this element.
+double ElementMetric(const FEMesh& mesh, const FEElement& el, int metric);
+
+// Evaluate a metric for all the elements of the mesh. This is much faster than calling 
+// ElementMetric for each element. On return, val[i] contains the value for element i and 
+// tag[i] is 1 if the value could be evaluated and 0 otherwise.
+void EvaluateMetric(const FEMesh& mesh, int metric, std::vector<double>& val, std::vector<int>& tag);
+
 }
 
 extern int FTHEX8[6][4];
@@ -0,0 +1,415 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#include "STLTools.h"
+#include "FESurfaceMesh.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <utility>
+
+//-----------------------------------------------------------------------------
+namespace {
+
+inline bool is_space(char c)
+{
+	return ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\f') || (c == '\v'));
+}
+
+inline bool is_digit(char c) { return ((c >= '0') && (c <= '9')); }
+
+inline const char* skip_space(const char* p, const char* e)
+{
+	while ((p < e) && is_space(*p)) ++p;
+	return p;
+}
+
+inline const char* skip_line(const char* p, const char* e)
+{
+	while ((p < e) && (*p != '\n')) ++p;
+	return p;
+}
+
+// see if the next token is the keyword sz, and if so, skip it
+bool match(const char*& p, const char* e, const char* sz)
+{
+	p = skip_space(p, e);
+	const char* q = p;
+	while (*sz)
+	{
+		if ((q == e) || (*q != *sz)) return false;
+		++q; ++sz;
+	}
+	if ((q < e) && !is_space(*q)) return false;
+	p = q;
+	return true;
+}
+
+// exactly representable powers of ten
+const double pow10tab[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// Parse a floating point number. The common case (up to 19 significant digits and
+// a small exponent) is handled here, anything else is passed on to strtod.
+bool parse_float(const char*& p, const char* e, float& v)
+{
+	p = skip_space(p, e);
+	const char* s = p;
+
+	bool neg = false;
+	if ((p < e) && ((*p == '-') || (*p == '+'))) { neg = (*p == '-'); ++p; }
+
+	uint64_t m = 0;
+	int nd = 0, ex = 0;
+	bool digits = false;
+	while ((p < e) && is_digit(*p))
+	{
+		if (nd < 19) { m = m * 10 + (*p - '0'); if (m) nd++; }
+		else ex++;
+		digits = true; ++p;
+	}
+	if ((p < e) && (*p == '.'))
+	{
+		++p;
+		while ((p < e) && is_digit(*p))
+		{
+			if (nd < 19) { m = m * 10 + (*p - '0'); if (m) nd++; ex--; }
+			digits = true; ++p;
+		}
+	}
+	if (digits && (p < e) && ((*p == 'e') || (*p == 'E')))
+	{
+		const char* q = p + 1;
+		bool eneg = false;
+		if ((q < e) && ((*q == '-') || (*q == '+'))) { eneg = (*q == '-'); ++q; }
+		if ((q < e) && is_digit(*q))
+		{
+			int n = 0;
+			while ((q < e) && is_digit(*q)) { if (n < 10000) n = n * 10 + (*q - '0'); ++q; }
+			ex += (eneg ? -n : n);
+			p = q;
+		}
+	}
+
+	if (digits && ((p == e) || is_space(*p)) && (ex >= -22) && (ex <= 22) && (m < (1ull << 53)))
+	{
+		double d = (double)m;
+		d = (ex < 0 ? d / pow10tab[-ex] : d * pow10tab[ex]);
+		v = (float)(neg ? -d : d);
+		return true;
+	}
+
+	// let strtod deal with everything else
+	char* end = nullptr;
+	double d = strtod(s, &end);
+	if ((end == s) || (end > e)) return false;
+	p = end;
+	v = (float)d;
+	return true;
+}
+
+inline uint64_t hash64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+inline uint64_t grid_index(float x, float x0, double h)
+{
+	double v = (x - x0) / h;
+	if (!(v > 0.0)) return 0;
+	if (v > 2097151.0) return 2097151;
+	return (uint64_t)v;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+bool STLParseASCII(const char* sz, size_t len, std::vector<vec3f>& vert, int& nline)
+{
+	const char* p = sz;
+	const char* e = sz + len;
+
+	// an ASCII facet takes roughly 250 bytes
+	vert.clear();
+	vert.reserve(3 * (len / 250 + 1));
+
+	nline = 0;
+	if (match(p, e, "solid"))
+	{
+		p = skip_line(p, e);
+		while (true)
+		{
+			if (match(p, e, "facet"))
+			{
+				// we don't need the normal
+				p = skip_line(p, e);
+				if ((match(p, e, "outer") == false) || (match(p, e, "loop") == false)) break;
+
+				int i;
+				for (i = 0; i < 3; ++i)
+				{
+					float x, y, z;
+					if ((match(p, e, "vertex") == false) ||
+						(parse_float(p, e, x) == false) ||
+						(parse_float(p, e, y) == false) ||
+						(parse_float(p, e, z) == false)) break;
+
+					vert.push_back(vec3f(x, y, z));
+				}
+				if ((i < 3) || (match(p, e, "endloop") == false) || (match(p, e, "endfacet") == false)) break;
+			}
+			else if (match(p, e, "endsolid"))
+			{
+				// a file can contain several solids
+				p = skip_line(p, e);
+				if (match(p, e, "solid")) p = skip_line(p, e);
+			}
+			else if (skip_space(p, e) == e) return true;
+			else break;
+		}
+	}
+
+	// figure out on which line the error occurred
+	nline = 1;
+	for (const char* q = sz; q < p; ++q) if (*q == '\n') nline++;
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+bool STLParseBinary(const char* buf, size_t len, std::vector<vec3f>& vert)
+{
+	// the header is followed by the number of triangles
+	if (len < 84) return false;
+	uint32_t ntri = 0;
+	memcpy(&ntri, buf + 80, sizeof(ntri));
+	if ((ntri == 0) || (84 + 50 * (size_t)ntri > len)) return false;
+
+	// Each triangle is stored as the normal, the three vertices and a 2-byte attribute.
+	// The records are not 4-byte aligned, so we need to copy them out.
+	vert.resize(3 * (size_t)ntri);
+	const int NT = (int)ntri;
+#pragma omp parallel for
+	for (int i = 0; i < NT; ++i)
+	{
+		float v[9];
+		memcpy(v, buf + 84 + 50 * (size_t)i + 12, sizeof(v));
+
+		vec3f* r = &vert[3 * (size_t)i];
+		r[0] = vec3f(v[0], v[1], v[2]);
+		r[1] = vec3f(v[3], v[4], v[5]);
+		r[2] = vec3f(v[6], v[7], v[8]);
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+int WeldVertices(const std::vector<vec3f>& vert, std::vector<vec3f>& node, std::vector<int>& index, double tol)
+{
+	node.clear();
+	const int N = (int)vert.size();
+	index.assign(N, -1);
+	if (N == 0) return 0;
+
+	// The vertices are processed in a fixed number of chunks and hash partitions,
+	// independent of the number of threads, which keeps the result deterministic.
+	const int NC = 64;
+	const int NP = 256;
+	std::vector<int> chunk(NC + 1);
+	for (int c = 0; c <= NC; ++c) chunk[c] = (int)(((int64_t)N * c) / NC);
+
+	// find the bounding box
+	std::vector<vec3f> bmin(NC, vert[0]), bmax(NC, vert[0]);
+#pragma omp parallel for
+	for (int c = 0; c < NC; ++c)
+	{
+		vec3f& r0 = bmin[c];
+		vec3f& r1 = bmax[c];
+		for (int i = chunk[c]; i < chunk[c + 1]; ++i)
+		{
+			const vec3f& r = vert[i];
+			if (r.x < r0.x) r0.x = r.x;
+			if (r.x > r1.x) r1.x = r.x;
+			if (r.y < r0.y) r0.y = r.y;
+			if (r.y > r1.y) r1.y = r.y;
+			if (r.z < r0.z) r0.z = r.z;
+			if (r.z > r1.z) r1.z = r.z;
+		}
+	}
+	vec3f r0 = bmin[0], r1 = bmax[0];
+	for (int c = 1; c < NC; ++c)
+	{
+		if (bmin[c].x < r0.x) r0.x = bmin[c].x;
+		if (bmax[c].x > r1.x) r1.x = bmax[c].x;
+		if (bmin[c].y < r0.y) r0.y = bmin[c].y;
+		if (bmax[c].y > r1.y) r1.y = bmax[c].y;
+		if (bmin[c].z < r0.z) r0.z = bmin[c].z;
+		if (bmax[c].z > r1.z) r1.z = bmax[c].z;
+	}
+
+	// grid spacing (at most 2^21 cells in each direction, so a cell index fits in 64 bits)
+	double ext = r1.x - r0.x;
+	if (r1.y - r0.y > ext) ext = r1.y - r0.y;
+	if (r1.z - r0.z > ext) ext = r1.z - r0.z;
+	double h = tol * ext;
+	if (h < ext / 2097151.0) h = ext / 2097151.0;
+	if (h <= 0.0) h = 1.0;
+
+	// calculate the grid cell of each vertex and count the vertices in each partition
+	std::vector<uint64_t> key(N);
+	std::vector<int> cnt(NC * NP, 0);
+#pragma omp parallel for
+	for (int c = 0; c < NC; ++c)
+	{
+		int* nc = &cnt[c * NP];
+		for (int i = chunk[c]; i < chunk[c + 1]; ++i)
+		{
+			const vec3f& r = vert[i];
+			uint64_t k = (grid_index(r.x, r0.x, h) << 42) | (grid_index(r.y, r0.y, h) << 21) | grid_index(r.z, r0.z, h);
+			key[i] = k;
+			nc[hash64(k) >> 56]++;
+		}
+	}
+
+	// sort the vertices by partition, keeping them in order within each partition
+	std::vector<int> part(NP + 1, 0);
+	int m = 0;
+	for (int p = 0; p < NP; ++p)
+	{
+		part[p] = m;
+		for (int c = 0; c < NC; ++c)
+		{
+			int n = cnt[c * NP + p];
+			cnt[c * NP + p] = m;
+			m += n;
+		}
+	}
+	part[NP] = m;
+
+	std::vector<int> perm(N);
+#pragma omp parallel for
+	for (int c = 0; c < NC; ++c)
+	{
+		int* off = &cnt[c * NP];
+		for (int i = chunk[c]; i < chunk[c + 1]; ++i) perm[off[hash64(key[i]) >> 56]++] = i;
+	}
+
+	// Find the first vertex in each grid cell with a hash table per partition.
+	// Since the vertices are visited in order, this is always the one with the lowest index.
+#pragma omp parallel for schedule(dynamic)
+	for (int p = 0; p < NP; ++p)
+	{
+		int n = part[p + 1] - part[p];
+		if (n == 0) continue;
+
+		// the keys are stored in the table as well, to avoid cache misses while probing
+		size_t size = 16;
+		while (size <= (size_t)n) size <<= 1;
+		const size_t mask = size - 1;
+		std::vector<std::pair<uint64_t, int> > table(size, std::pair<uint64_t, int>(0, -1));
+
+		for (int j = part[p]; j < part[p + 1]; ++j)
+		{
+			int i = perm[j];
+			uint64_t k = key[i];
+			size_t l = hash64(k) & mask;
+			while ((table[l].second != -1) && (table[l].first != k)) l = (l + 1) & mask;
+			if (table[l].second == -1) table[l] = std::pair<uint64_t, int>(k, i);
+			index[i] = table[l].second;
+		}
+	}
+
+	// number the nodes in the order they are first referenced
+	int nn = 0;
+	for (int i = 0; i < N; ++i)
+	{
+		if (index[i] == i)
+		{
+			index[i] = nn++;
+			node.push_back(vert[i]);
+		}
+		else index[i] = index[index[i]];
+	}
+
+	return nn;
+}
+
+//-----------------------------------------------------------------------------
+FESurfaceMesh* STLBuildMesh(const std::vector<vec3f>& vert)
+{
+	// merge the coincident vertices
+	std::vector<vec3f> node;
+	std::vector<int> index;
+	int NN = WeldVertices(vert, node, index);
+
+	// skip facets that collapsed
+	int NF = (int)vert.size() / 3;
+	std::vector<int> faceId(NF, -1);
+	int NE = 0;
+	for (int i=0; i<NF; ++i)
+	{
+		const int* n = &index[3*i];
+		if ((n[0] != n[1]) && (n[0] != n[2]) && (n[1] != n[2])) faceId[i] = NE++;
+	}
+
+	// create the mesh
+	FESurfaceMesh* pm = new FESurfaceMesh;
+	pm->Create(NN, 0, NE);
+
+	// create nodes
+	for (int i=0; i<NN; ++i)
+	{
+		const vec3f& ri = node[i];
+		pm->Node(i).pos(vec3d(ri.x, ri.y, ri.z));
+	}
+
+	// create elements
+	for (int i=0; i<NF; ++i)
+	{
+		int n = faceId[i];
+		if (n >= 0)
+		{
+			FEFace& face = pm->Face(n);
+			face.SetType(FE_FACE_TRI3);
+			face.m_gid = 0;
+			face.n[0] = index[3*i    ];
+			face.n[1] = index[3*i + 1];
+			face.n[2] = index[3*i + 2];
+		}
+	}
+
+	// update the mesh
+	pm->RebuildMesh();
+
+	return pm;
+}
@@ -0,0 +1,56 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#pragma once
+#include <MathLib/math3d.h>
+#include <vector>
+
+class FESurfaceMesh;
+
+//-----------------------------------------------------------------------------
+// Helper functions for importing STL files. The file content is expected to
+// be in memory. The facet vertices are returned as a flat array, three per facet.
+
+// Parse an ASCII STL file. The buffer must be zero-terminated (i.e. sz[len] == 0).
+// On failure, nline is set to the line where the error was encountered.
+bool STLParseASCII(const char* sz, size_t len, std::vector<vec3f>& vert, int& nline);
+
+// Parse a binary STL file (including the 80-byte header and triangle count).
+bool STLParseBinary(const char* buf, size_t len, std::vector<vec3f>& vert);
+
+//-----------------------------------------------------------------------------
+// Merge coincident vertices. Vertices are snapped to a grid with spacing tol
+// (relative to the bounding box) and vertices in the same grid cell are merged.
+// The merged nodes are stored in the order in which they are first referenced,
+// so the result does not depend on the number of threads.
+// On return, index[i] is the node index of vert[i]. Returns the number of nodes.
+int WeldVertices(const std::vector<vec3f>& vert, std::vector<vec3f>& node, std::vector<int>& index, double tol = 1e-6);
+
+//-----------------------------------------------------------------------------
+// Build a triangle surface mesh from the facet vertices. Coincident vertices
+// are welded and facets that collapse are skipped.
+FESurfaceMesh* STLBuildMesh(const std::vector<vec3f>& vert);
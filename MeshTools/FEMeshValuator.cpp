@@ -31,6 +31,7 @@ SOFTWARE.*/
 #include <MeshTools/GGroup.h>
 #include <MeshTools/FENodeData.h>
 #include <MeshTools/FEElementData.h>
+#include <GeomLib/GObject.h>
 
 //-----------------------------------------------------------------------------
 // constructor
@@ -47,29 +48,36 @@ void FEMeshValuator::Evaluate(int nfield)
 	int NE = m_mesh.Elements();
 	Mesh_Data& data = m_mesh.GetMeshData();
 	data.Init(&m_mesh, 0.0, 0);
-	if (nfield < 11)
+	if (nfield < FEMeshMetrics::MAX_METRIC_TYPES)
 	{
+		// The metric values are cached on the mesh, so we only need to
+		// re-evaluate when the mesh or the object's scale has changed.
+		GObject* po = m_mesh.GetGObject();
+		vec3d scale = (po ? po->GetTransform().GetScale() : vec3d(1, 1, 1));
+		Mesh_MetricCache& cache = m_mesh.GetMetricCache();
+		if (cache.IsValid(nfield, m_mesh.Revision(), scale) == false)
+		{
+			FEMeshMetrics::EvaluateMetric(m_mesh, nfield, cache.m_val, cache.m_tag);
+			cache.m_metric = nfield;
+			cache.m_nrev = m_mesh.Revision();
+			cache.m_scale = scale;
+		}
+
+#pragma omp parallel for
 		for (int i = 0; i < NE; ++i)
 		{
 			FEElement& el = m_mesh.Element(i);
-			if (el.IsVisible())
+			if (el.IsVisible() && cache.m_tag[i])
 			{
-				try {
-					double val = EvaluateElement(i, nfield);
-					data.SetElementValue(i, val);
-					data.SetElementDataTag(i, 1);
-				}
-				catch (...)
-				{
-					data.SetElementDataTag(i, 0);
-				}
+				data.SetElementValue(i, cache.m_val[i]);
+				data.SetElementDataTag(i, 1);
 			}
 			else data.SetElementDataTag(i, 0);
 		}
 	}
 	else
 	{
-		nfield -= 11;
+		nfield -= FEMeshMetrics::MAX_METRIC_TYPES;
 		if ((nfield >= 0) && (nfield < m_mesh.MeshDataFields()))
 		{
 			FEMeshData* meshData = m_mesh.GetMeshDataField(nfield);
@@ -139,52 +147,6 @@ void FEMeshValuator::Evaluate(int nfield)
 double FEMeshValuator::EvaluateElement(int n, int nfield, int* err)
 {
 	if (err) *err = 0;
-	double val = 0, sum = 0;
 	const FEElement& el = m_mesh.Element(n);
-	switch (nfield)
-	{
-	case 0: // element volume
-		val = FEMeshMetrics::ElementVolume(m_mesh, el);
-		break;
-	case 1: // jacobian
-		if (el.IsShell()) val = FEMeshMetrics::ShellJacobian(m_mesh, el, 1);
-		else val = FEMeshMetrics::SolidJacobian(m_mesh, el);
-		break;
-	case 2: // shell thickness
-		if (el.IsShell())
-		{
-			int n = el.Nodes();
-			val = el.m_h[0];
-			for (int i = 1; i<n; ++i) if (el.m_h[i] < val) val = el.m_h[i];
-		}
-		break;
-	case 3: // shell area
-		if (el.IsShell()) val = FEMeshMetrics::ShellArea(m_mesh, el);
-		break;
-	case 4: // element quality
-		val = FEMeshMetrics::TetQuality(m_mesh, el);
-		break;
-	case 5: // min dihedral angle
-		val = FEMeshMetrics::TetMinDihedralAngle(m_mesh, el);
-		break;
-	case 6: // max dihedral angle
-		val = FEMeshMetrics::TetMaxDihedralAngle(m_mesh, el);
-		break;
-	case 7:
-		val = FEMeshMetrics::TriQuality(m_mesh, el);
-		break;
-	case 8:
-		val = FEMeshMetrics::Tet10MidsideNodeOffset(m_mesh, el, true);
-		break;
-	case 9:
-		val = FEMeshMetrics::MinEdgeLength(m_mesh, el);
-		break;
-	case 10:
-		val = FEMeshMetrics::MaxEdgeLength(m_mesh, el);
-		break;
-	default:
-		val = 0.0;
-	}
-
-	return val;
+	return FEMeshMetrics::ElementMetric(m_mesh, el, nfield);
 }
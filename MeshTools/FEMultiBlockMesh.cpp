@@ -71,6 +71,34 @@ FEMesh* FEMultiBlockMesh::BuildMesh()
 	// create a new mesh
 	FEMesh* pm = new FEMesh();
 
+	// figure out the node ranges of all MB items and count the mesh items,
+	// so that the mesh only needs to be allocated once
+	int nodes = SetNodeRanges();
+
+	int elems = 0;
+	for (int i=0; i<(int) m_MBlock.size(); ++i)
+	{
+		MBBlock& b = m_MBlock[i];
+		elems += b.m_nx*b.m_ny*b.m_nz;
+	}
+
+	int faces = 0;
+	for (int i=0; i<(int) m_MBFace.size(); ++i)
+	{
+		MBFace& f = m_MBFace[i];
+		if (f.m_gid >= 0) faces += f.m_nx*f.m_ny;
+	}
+
+	int edges = 0;
+	for (int i=0; i<(int) m_MBEdge.size(); ++i)
+	{
+		MBEdge& e = m_MBEdge[i];
+		if (e.m_gid >= 0) edges += e.m_nx;
+	}
+
+	// allocate storage
+	pm->Create(nodes, elems, faces, edges);
+
 	// build the mesh
 	BuildNodes(pm);
 	BuildElements(pm);
@@ -84,304 +112,232 @@ FEMesh* FEMultiBlockMesh::BuildMesh()
 }
 
 //-----------------------------------------------------------------------------
-// build the FE nodes
+// Assigns the range of FE nodes that each MB item owns. The MB nodes come first,
+// followed by the interior nodes of the edges, faces and blocks. The start of each
+// range is stored in the item's tag. Returns the total number of nodes.
 //
-void FEMultiBlockMesh::BuildNodes(FEMesh *pm)
+int FEMultiBlockMesh::SetNodeRanges()
 {
-	int i, j, k, l;
+	int nodes = 0;
+	for (int i=0; i<(int) m_MBNode.size(); ++i) m_MBNode[i].m_ntag = nodes++;
 
-	int NB = m_MBlock.size();
-	int NF = m_MBFace.size();
-	int NE = m_MBEdge.size();
-	int NN = m_MBNode.size();
+	for (int i=0; i<(int) m_MBEdge.size(); ++i)
+	{
+		MBEdge& e = m_MBEdge[i];
+		e.m_ntag = nodes;
+		nodes += e.m_nx - 1;
+	}
 
-	// now, let's count the nodes
-	// I think the correct formula is:
-	// (NX+1)*(NY+1)*(NZ+1)*blocks - (NX+1)*(NY+1)*internal faces + (NX+1)*internal edges - internal nodes
-	int nodes = 0;
-	for (i=0; i<NB; ++i)
+	for (int i=0; i<(int) m_MBFace.size(); ++i)
 	{
-		MBBlock& B = m_MBlock[i];
-		nodes += (B.m_nx+1)*(B.m_ny+1)*(B.m_nz+1);
+		MBFace& f = m_MBFace[i];
+		f.m_ntag = nodes;
+		nodes += (f.m_nx - 1)*(f.m_ny - 1);
 	}
-	for (i=0; i<NF; ++i)
+
+	for (int i=0; i<(int) m_MBlock.size(); ++i)
 	{
-		MBFace& F = m_MBFace[i];
-		if (!F.m_bext) nodes -= (F.m_nx+1)*(F.m_ny+1);
+		MBBlock& b = m_MBlock[i];
+		b.m_ntag = nodes;
+		nodes += (b.m_nx - 1)*(b.m_ny - 1)*(b.m_nz - 1);
 	}
-	for (i=0; i<NE; ++i)
+
+	return nodes;
+}
+
+//-----------------------------------------------------------------------------
+// Calculates the (normalized) size of the first division of an item that is
+// divided in n segments using the zoning factor g.
+//
+static double ZoningStep(int n, double g, bool bdouble)
+{
+	double gr = 1;
+	if (bdouble)
 	{
-		MBEdge& E = m_MBEdge[i];
-		if (!E.m_bext) nodes += (E.m_nx + 1);
+		gr = 2; if (n%2) gr += g;
+		for (int j=0; j<n/2-1; ++j) gr = g*gr+2;
 	}
-	for (i=0; i<NN; ++i)
+	else 
 	{
-		MBNode& N = m_MBNode[i];
-		if (!N.m_bext) nodes -= 1;
+		for (int j=0; j<n-1; ++j) gr = g*gr+1; 
 	}
+	return 1 / gr;
+}
 
-	// create storage
-	pm->Create(nodes, 0);
+//-----------------------------------------------------------------------------
+// Evaluates the normalized coordinates of the n divisions of an item. The zoning
+// factor f is updated as it would be when stepping along the item.
+//
+static void ZoningCoordinates(int n, double gr, double& f, bool bdouble, double* x)
+{
+	double r = 0, dr = gr;
+	for (int j=0; j<n; ++j)
+	{
+		x[j] = r;
+		r += dr;
+		dr *= f;
+		if (bdouble && (j==n/2-1))
+		{
+			if (n%2 == 0) dr /= f;
+			f = 1.0/f;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// build the FE nodes
+// The node ranges must be assigned and the mesh allocated before this is called.
+//
+void FEMultiBlockMesh::BuildNodes(FEMesh *pm)
+{
+	int NB = m_MBlock.size();
+	int NF = m_MBFace.size();
+	int NE = m_MBEdge.size();
+	int NN = m_MBNode.size();
 
 	// A. create the nodes
 	// A.1. add all MB nodes
-	nodes = 0;
-	FENode* pn = pm->NodePtr();
-	for (i=0; i<NN; ++i, ++pn)
+	for (int i=0; i<NN; ++i)
 	{
-		pn->r = m_MBNode[i].m_r;
-		m_MBNode[i].m_ntag = nodes++;
-		pn->m_gid = m_MBNode[i].m_gid;
+		FENode& node = pm->Node(m_MBNode[i].m_ntag);
+		node.r = m_MBNode[i].m_r;
+		node.m_gid = m_MBNode[i].m_gid;
 	}
 
 	// A.2. add all edge nodes
-	vec3d r1, r2, r3, r4, r5, r6, r7, r8;
-	double r, s, t, gr, gs, gt, fr, fs, ft, dr, ds, dt;
-	double N1, N2, N3, N4, N5, N6, N7, N8;
-	for (i=0; i<NE; ++i)
+#pragma omp parallel for schedule(dynamic)
+	for (int i=0; i<NE; ++i)
 	{
 		MBEdge& e = m_MBEdge[i];
-		r1 = m_MBNode[e.m_node[0]].m_r;
-		r2 = m_MBNode[e.m_node[1]].m_r;
-		e.m_ntag = nodes;
+		vec3d r1 = m_MBNode[e.m_node[0]].m_r;
+		vec3d r2 = m_MBNode[e.m_node[1]].m_r;
 
-		fr = e.m_gx;
-		gr = 1;
-		if (e.m_bx)
-		{
-			gr = 2; if (e.m_nx%2) gr += fr;
-			for (j=0; j<e.m_nx/2-1; ++j) gr = fr*gr+2;
-			gr = 1 / gr;
-		}
-		else 
-		{
-			for (j=0; j<e.m_nx-1; ++j) gr = fr*gr+1; 
-			gr = 1 / gr;
-		}
+		double fr = e.m_gx;
+		vector<double> R(e.m_nx + 1);
+		ZoningCoordinates(e.m_nx, ZoningStep(e.m_nx, fr, e.m_bx), fr, e.m_bx, &R[0]);
 
-		dr = gr;
-		r = 0;
-		for (j=0; j<e.m_nx; ++j)
+		for (int j=1; j<e.m_nx; ++j)
 		{
-			if (j>0)
-			{
-				N1 = 1-r;
-				N2 = r;
-				pn->r = r1*N1 + r2*N2;
-				++pn;
-				++nodes;
-			}
-
-			r += dr;
-			dr *= fr;
-			if (e.m_bx && (j==e.m_nx/2-1))
-			{
-				if (e.m_nx%2 == 0) dr /= fr;
-				fr = 1.0/fr;
-			}
+			double r = R[j];
+			double N1 = 1-r;
+			double N2 = r;
+			pm->Node(e.m_ntag + j - 1).r = r1*N1 + r2*N2;
 		}
 	}
 
 	// A.3. add all face nodes
-	for (i=0; i<NF; ++i)
+#pragma omp parallel for schedule(dynamic)
+	for (int i=0; i<NF; ++i)
 	{
 		MBFace& f = m_MBFace[i];
-		r1 = m_MBNode[f.m_node[0]].m_r;
-		r2 = m_MBNode[f.m_node[1]].m_r;
-		r3 = m_MBNode[f.m_node[2]].m_r;
-		r4 = m_MBNode[f.m_node[3]].m_r;
-		f.m_ntag = nodes;
+		vec3d r1 = m_MBNode[f.m_node[0]].m_r;
+		vec3d r2 = m_MBNode[f.m_node[1]].m_r;
+		vec3d r3 = m_MBNode[f.m_node[2]].m_r;
+		vec3d r4 = m_MBNode[f.m_node[3]].m_r;
 
-		fr = f.m_gx;
-		gr = 1;
-		if (f.m_bx)
-		{
-			gr = 2; if (f.m_nx%2) gr += fr;
-			for (j=0; j<f.m_nx/2-1; ++j) gr = fr*gr+2;
-			gr = 1 / gr;
-		}
-		else 
-		{
-			for (j=0; j<f.m_nx-1; ++j) gr = fr*gr+1; 
-			gr = 1 / gr;
-		}
+		double fs = f.m_gy;
+		vector<double> S(f.m_ny + 1);
+		ZoningCoordinates(f.m_ny, ZoningStep(f.m_ny, fs, f.m_by), fs, f.m_by, &S[0]);
 
-		fs = f.m_gy;
-		gs = 1;
-		if (f.m_by)
-		{
-			gs = 2; if (f.m_ny%2) gs += fs;
-			for (j=0; j<f.m_ny/2-1; ++j) gs = fs*gs+2;
-			gs = 1 / gs;
-		}
-		else 
-		{
-			for (j=0; j<f.m_ny-1; ++j) gs = fs*gs+1; 
-			gs = 1 / gs;
-		}
+		double fr = f.m_gx;
+		double gr = ZoningStep(f.m_nx, fr, f.m_bx);
+		vector<double> R(f.m_nx + 1);
 
-		ds = gs;
-		s = 0;
-		for (j=0; j<f.m_ny; ++j)
+		for (int j=1; j<f.m_ny; ++j)
 		{
-			if (j>0)
-			{
-				dr = gr;
-				r = 0;
-				for (k=0; k<f.m_nx; ++k)
-				{
-					if (k>0)
-					{
-						N1 = (1-r)*(1-s);
-						N2 = r*(1-s);
-						N3 = r*s;
-						N4 = (1-r)*s;
-						pn->r = r1*N1 + r2*N2 + r3*N3 + r4*N4;
-						++pn;
-						++nodes;
-					}
-					r += dr;
-					dr *= fr;
-					if (f.m_bx && (k==f.m_nx/2-1))
-					{
-						if (f.m_nx%2 == 0) dr /= fr;
-						fr = 1.0/fr;
-					}
-				}
-				if (f.m_bx) fr = 1.0/fr;
-			}
+			ZoningCoordinates(f.m_nx, gr, fr, f.m_bx, &R[0]);
+			if (f.m_bx) fr = 1.0/fr;
 
-			s += ds;
-			ds *= fs;
-			if (f.m_by && (j==f.m_ny/2-1))
+			double s = S[j];
+			FENode* pn = pm->NodePtr(f.m_ntag + (j-1)*(f.m_nx-1));
+			for (int k=1; k<f.m_nx; ++k, ++pn)
 			{
-				if (f.m_ny%2 == 0) ds /= fs;
-				fs = 1.0/fs;
+				double r = R[k];
+				double N1 = (1-r)*(1-s);
+				double N2 = r*(1-s);
+				double N3 = r*s;
+				double N4 = (1-r)*s;
+				pn->r = r1*N1 + r2*N2 + r3*N3 + r4*N4;
 			}
 		}
 	}
 
 	// A.4. add all block nodes
-	for (i=0; i<NB; ++i)
+	for (int i=0; i<NB; ++i)
 	{
 		MBBlock& b = m_MBlock[i];
-		r1 = m_MBNode[b.m_node[0]].m_r;
-		r2 = m_MBNode[b.m_node[1]].m_r;
-		r3 = m_MBNode[b.m_node[2]].m_r;
-		r4 = m_MBNode[b.m_node[3]].m_r;
-		r5 = m_MBNode[b.m_node[4]].m_r;
-		r6 = m_MBNode[b.m_node[5]].m_r;
-		r7 = m_MBNode[b.m_node[6]].m_r;
-		r8 = m_MBNode[b.m_node[7]].m_r;
-		b.m_ntag = nodes;
-
-		fr = b.m_gx;
-		gr = 1;
-		if (b.m_bx)
+		int nx = b.m_nx, ny = b.m_ny, nz = b.m_nz;
+		if ((nx < 2) || (ny < 2) || (nz < 2)) continue;
+
+		vec3d r1 = m_MBNode[b.m_node[0]].m_r;
+		vec3d r2 = m_MBNode[b.m_node[1]].m_r;
+		vec3d r3 = m_MBNode[b.m_node[2]].m_r;
+		vec3d r4 = m_MBNode[b.m_node[3]].m_r;
+		vec3d r5 = m_MBNode[b.m_node[4]].m_r;
+		vec3d r6 = m_MBNode[b.m_node[5]].m_r;
+		vec3d r7 = m_MBNode[b.m_node[6]].m_r;
+		vec3d r8 = m_MBNode[b.m_node[7]].m_r;
+
+		// The zoning factors flip at the middle of a double zoned item, so we
+		// evaluate the t-coordinates, the s-coordinates of each layer, and the 
+		// r-zoning factor of each row up front. The rows can then be filled
+		// independently.
+		double ft = b.m_gz;
+		vector<double> T(nz + 1);
+		ZoningCoordinates(nz, ZoningStep(nz, ft, b.m_bz), ft, b.m_bz, &T[0]);
+
+		double fs = b.m_gy;
+		double gs = ZoningStep(ny, fs, b.m_by);
+		vector<double> S((nz - 1)*ny);
+		for (int j=1; j<nz; ++j)
 		{
-			gr = 2; if (b.m_nx%2) gr += fr;
-			for (j=0; j<b.m_nx/2-1; ++j) gr = fr*gr+2;
-			gr = 1 / gr;
-		}
-		else 
-		{
-			for (j=0; j<b.m_nx-1; ++j) gr = fr*gr+1; 
-			gr = 1 / gr;
+			ZoningCoordinates(ny, gs, fs, b.m_by, &S[(j-1)*ny]);
+			if (b.m_by) fs = 1.0/fs;
 		}
 
-		fs = b.m_gy;
-		gs = 1;
-		if (b.m_by)
+		int rows = (nz - 1)*(ny - 1);
+		double fr = b.m_gx;
+		double gr = ZoningStep(nx, fr, b.m_bx);
+		vector<double> FR(rows);
+		for (int n=0; n<rows; ++n)
 		{
-			gs = 2; if (b.m_ny%2) gs += fs;
-			for (j=0; j<b.m_ny/2-1; ++j) gs = fs*gs+2;
-			gs = 1 / gs;
-		}
-		else 
-		{
-			for (j=0; j<b.m_ny-1; ++j) gs = fs*gs+1; 
-			gs = 1 / gs;
+			// the factor flips at the middle of a row and back at its end
+			FR[n] = fr;
+			if (b.m_bx) { fr = 1.0/fr; fr = 1.0/fr; }
 		}
 
-		ft = b.m_gz;
-		gt = 1;
-		if (b.m_bz)
-		{
-			gt = 2; if (b.m_nz%2) gt += ft;
-			for (j=0; j<b.m_nz/2-1; ++j) gt = ft*gt+2;
-			gt = 1 / gt;
-		}
-		else 
+#pragma omp parallel
 		{
-			for (j=0; j<b.m_nz-1; ++j) gt = ft*gt+1; 
-			gt = 1 / gt;
-		}
+			vector<double> R(nx + 1);
 
-		dt = gt;
-		t = 0;
-		for (j=0; j<b.m_nz; ++j)
-		{
-			if (j>0)
+#pragma omp for schedule(static)
+			for (int n=0; n<rows; ++n)
 			{
-				ds = gs;
-				s = 0;
-				for (k=0; k<b.m_ny; ++k)
-				{
-					if (k>0)
-					{
-						dr = gr;
-						r = 0;
-						for (l=0; l<b.m_nx; ++l)
-						{
-							if (r>0)
-							{
-								N1 = (1-r)*(1-s)*(1-t);
-								N2 = r*(1-s)*(1-t);
-								N3 = r*s*(1-t);
-								N4 = (1-r)*s*(1-t);
-								N5 = (1-r)*(1-s)*t;
-								N6 = r*(1-s)*t;
-								N7 = r*s*t;
-								N8 = (1-r)*s*t;
-								pn->r = r1*N1 + r2*N2 + r3*N3 + r4*N4 + r5*N5 + r6*N6 + r7*N7 + r8*N8;
-								++pn;
-								++nodes;
-							}
+				int j = n / (ny - 1) + 1;
+				int k = n % (ny - 1) + 1;
+				double t = T[j];
+				double s = S[(j-1)*ny + k];
 
-							r += dr;
-							dr *= fr;
-							if (b.m_bx && (l==b.m_nx/2-1))
-							{
-								if (b.m_nx%2 == 0) dr /= fr;
-								fr = 1.0/fr;
-							}
-						}
-						if (b.m_bx) fr = 1.0/fr;
-					}
+				double f = FR[n];
+				ZoningCoordinates(nx, gr, f, b.m_bx, &R[0]);
 
-					s += ds;
-					ds *= fs;
-					if (b.m_by && (k==b.m_ny/2-1))
-					{
-						if (b.m_ny%2 == 0) ds /= fs;
-						fs = 1.0/fs;
-					}
+				FENode* pn = pm->NodePtr(b.m_ntag + n*(nx - 1));
+				for (int l=1; l<nx; ++l, ++pn)
+				{
+					double r = R[l];
+					double N1 = (1-r)*(1-s)*(1-t);
+					double N2 = r*(1-s)*(1-t);
+					double N3 = r*s*(1-t);
+					double N4 = (1-r)*s*(1-t);
+					double N5 = (1-r)*(1-s)*t;
+					double N6 = r*(1-s)*t;
+					double N7 = r*s*t;
+					double N8 = (1-r)*s*t;
+					pn->r = r1*N1 + r2*N2 + r3*N3 + r4*N4 + r5*N5 + r6*N6 + r7*N7 + r8*N8;
 				}
-				if (b.m_by) fs = 1.0/fs;
-			}
-
-			t += dt;
-			dt *= ft;
-			if (b.m_bz && (j==b.m_nz/2-1))
-			{
-				if (b.m_nz%2 == 0) dt /= ft;
-				ft = 1.0/ft;
 			}
 		}
 	}
-
-	// make sure we have the right number of nodes
-	assert(nodes == pm->Nodes());
 }
 
 //-----------------------------------------------------------------------------
@@ -389,34 +345,45 @@ void FEMultiBlockMesh::BuildNodes(FEMesh *pm)
 //
 void FEMultiBlockMesh::BuildElements(FEMesh* pm)
 {
-	int i, j, k, l;
-
 	int NB = m_MBlock.size();
 
-	// figure out how many elements we have
-	int elems = 0;
-	for (i=0; i<NB; ++i)
-	{
-		MBBlock& B = m_MBlock[i];
-		elems += B.m_nx*B.m_ny*B.m_nz;
-	}
-
-	// allocate elements
-	pm->Create(0, elems);
-
 	// create the elements
 	int eid = 0;
-	for (i=0; i<NB; ++i)
+	for (int i=0; i<NB; ++i)
 	{
 		MBBlock& b = m_MBlock[i];
-		for (j=0; j<b.m_nz; ++j)
+		int nx = b.m_nx, ny = b.m_ny, nz = b.m_nz;
+
+		// offsets between interior nodes
+		int sy = nx - 1;
+		int sz = (nx - 1)*(ny - 1);
+
+		int rows = ny*nz;
+#pragma omp parallel for schedule(static)
+		for (int n=0; n<rows; ++n)
 		{
-			for (k=0; k<b.m_ny; ++k)
+			int j = n / ny;
+			int k = n % ny;
+			bool binner = (j > 0) && (j < nz - 1) && (k > 0) && (k < ny - 1);
+
+			for (int l=0; l<nx; ++l)
 			{
-				for (l=0; l<b.m_nx; ++l)
+				FEElement_* pe = pm->ElementPtr(eid + n*nx + l);
+				if (binner && (l > 0) && (l < nx - 1))
+				{
+					// all nodes are interior to the block
+					int n0 = b.m_ntag + (l-1) + (k-1)*sy + (j-1)*sz;
+					pe->m_node[0] = n0;
+					pe->m_node[1] = n0 + 1;
+					pe->m_node[2] = n0 + 1 + sy;
+					pe->m_node[3] = n0 + sy;
+					pe->m_node[4] = n0 + sz;
+					pe->m_node[5] = n0 + 1 + sz;
+					pe->m_node[6] = n0 + 1 + sy + sz;
+					pe->m_node[7] = n0 + sy + sz;
+				}
+				else
 				{
-					FEElement_* pe = pm->ElementPtr(eid++);
-
 					pe->m_node[0] = GetBlockNodeIndex(b, l  , k  , j);
 					pe->m_node[1] = GetBlockNodeIndex(b, l+1, k  , j);
 					pe->m_node[2] = GetBlockNodeIndex(b, l+1, k+1, j);
@@ -425,11 +392,13 @@ void FEMultiBlockMesh::BuildElements(FEMesh* pm)
 					pe->m_node[5] = GetBlockNodeIndex(b, l+1, k  , j+1);
 					pe->m_node[6] = GetBlockNodeIndex(b, l+1, k+1, j+1);
 					pe->m_node[7] = GetBlockNodeIndex(b, l  , k+1, j+1);
-					pe->SetType(FE_HEX8);
-					pe->m_gid = b.m_gid;
 				}
+				pe->SetType(FE_HEX8);
+				pe->m_gid = b.m_gid;
 			}
 		}
+
+		eid += rows*nx;
 	}
 }
 
@@ -438,34 +407,29 @@ void FEMultiBlockMesh::BuildElements(FEMesh* pm)
 //
 void FEMultiBlockMesh::BuildFaces(FEMesh* pm)
 {
-	int i, j, k;
+	int NF = m_MBFace.size();
 
-	// count faces
+	// find the first face of each MB face
+	vector<int> F0(NF, 0);
 	int faces = 0;
-	int n1, n2;
-	for (i=0; i<(int) m_MBFace.size(); ++i)
+	for (int k=0; k<NF; ++k)
 	{
-		MBFace& f = m_MBFace[i];
+		MBFace& f = m_MBFace[k];
+		F0[k] = faces;
 		if (f.m_gid >= 0) faces += f.m_nx*f.m_ny;
 	}
 
-	// allocate faces
-	pm->Create(0,0, faces);
-
 	// build the faces
-	FEFace* pf = pm->FacePtr();
-	int m = 0;
-	for (k=0; k<(int) m_MBFace.size(); ++k)
+#pragma omp parallel for schedule(dynamic)
+	for (int k=0; k<NF; ++k)
 	{
 		MBFace& f = m_MBFace[k];
 		if (f.m_gid >= 0)
 		{
-			n1 = f.m_block[0];
-			n2 = f.m_block[1];
-
-			for (i=0; i<f.m_nx; ++i)
+			FEFace* pf = pm->FacePtr(F0[k]);
+			for (int i=0; i<f.m_nx; ++i)
 			{
-				for (j=0; j<f.m_ny; ++j, ++pf)
+				for (int j=0; j<f.m_ny; ++j, ++pf)
 				{
 					pf->SetType(FE_FACE_QUAD4);
 					pf->m_gid = pf->m_sid = f.m_gid;
@@ -475,7 +439,6 @@ void FEMultiBlockMesh::BuildFaces(FEMesh* pm)
 					pf->n[3] = GetFaceNodeIndex(f, i  , j+1);
 				}
 			}
-			++m;
 		}
 	}
 }
@@ -485,27 +448,14 @@ void FEMultiBlockMesh::BuildFaces(FEMesh* pm)
 //
 void FEMultiBlockMesh::BuildEdges(FEMesh* pm)
 {
-	int i, k;
-
-	// count edges
-	int edges = 0;
-	for (i=0; i<(int) m_MBEdge.size(); ++i)
-	{
-		MBEdge& e = m_MBEdge[i];
-		if (e.m_gid >= 0) edges += e.m_nx;
-	}
-
-	// allocate faces
-	pm->Create(0,0,0,edges);
-
 	// build the edges
 	FEEdge* pe = pm->EdgePtr();
-	for (k=0; k<(int) m_MBEdge.size(); ++k)
+	for (int k=0; k<(int) m_MBEdge.size(); ++k)
 	{
 		MBEdge& e = m_MBEdge[k];
 		if (e.m_gid >= 0)
 		{
-			for (i=0; i<e.m_nx; ++i, ++pe)
+			for (int i=0; i<e.m_nx; ++i, ++pe)
 			{
 				pe->m_gid = e.m_gid;
 				pe->SetType(FE_EDGE2);
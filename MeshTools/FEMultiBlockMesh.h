@@ -158,7 +158,10 @@ protected:
 	void BuildMBFaces();
 	void BuildMBEdges();
 
-	// build the mesh items
+	// assign the FE node ranges of the MB items
+	int SetNodeRanges();
+
+	// build the mesh items (the mesh must be allocated)
 	void BuildNodes   (FEMesh* pm);
 	void BuildElements(FEMesh* pm);
 	void BuildFaces   (FEMesh* pm);
@@ -28,11 +28,57 @@ SOFTWARE.*/
 #include "LaplaceSolver.h"
 #include <MeshLib/FEMesh.h>
 #include <MeshLib/FENodeNodeList.h>
-#include <MeshLib/FENodeElementList.h>
 #include <MeshLib/MeshMetrics.h>
 
+//-----------------------------------------------------------------------------
+// Sparse matrix in compressed row storage format
+struct CSRMatrix
+{
+	vector<int>		rowPtr;
+	vector<int>		colInd;
+	vector<double>	val;
+
+	int Rows() const { return (int)rowPtr.size() - 1; }
+
+	// find the index of column j in row i (or -1 if the entry does not exist)
+	int Find(int i, int j) const
+	{
+		for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) if (colInd[k] == j) return k;
+		return -1;
+	}
+
+	// calculate y = A*x
+	void Multiply(const vector<double>& x, vector<double>& y) const
+	{
+		int N = Rows();
+#pragma omp parallel for
+		for (int i = 0; i < N; ++i)
+		{
+			double s = 0.0;
+			for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) s += val[k] * x[colInd[k]];
+			y[i] = s;
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------
+static double dot(const vector<double>& a, const vector<double>& b)
+{
+	int N = (int)a.size();
+	double s = 0.0;
+#pragma omp parallel for reduction(+:s)
+	for (int i = 0; i < N; ++i) s += a[i] * b[i];
+	return s;
+}
+
+//-----------------------------------------------------------------------------
 LaplaceSolver::LaplaceSolver()
 {
+	m_maxIter = 10000;
+	m_tol = 1e-8;
+
+	m_iters = 0;
+	m_relres = 0.0;
 }
 
 // Solves the Laplace equation on the mesh.
@@ -41,9 +87,8 @@ LaplaceSolver::LaplaceSolver()
 // Output: val = solution
 bool LaplaceSolver::Solve(FEMesh* pm, vector<double>& val, vector<int>& bn)
 {
-	// convergence criteria
-	const int MAX_ITER = 1000;	// max number of iterations
-	const double eps = 0.0001;	// max change between iterations
+	m_iters = 0;
+	m_relres = 0.0;
 
 	// make sure the value and flag arrays are of the correct size
 	int NN = pm->Nodes();
@@ -83,122 +128,163 @@ bool LaplaceSolver::Solve(FEMesh* pm, vector<double>& val, vector<int>& bn)
 	for (int i=0; i<NN; ++i)
 		if (bn[i] == 0) val[i] = vavg;
 
+	// number the free nodes
+	vector<int> eq(NN, -1);
+	int NF = 0;
+	for (int i = 0; i < NN; ++i) if (bn[i] == 0) eq[i] = NF++;
+	if (NF == 0) return true;
+
 	// calculate the element volumes
 	int NE = pm->Elements();
 	vector<double> Ve(NE);
+#pragma omp parallel for
 	for (int i=0; i<NE; ++i) Ve[i] = FEMeshMetrics::ElementVolume(*pm, pm->Element(i));
 
 	// create Node-Node list
 	FENodeNodeList NNL(pm);
 
-	// create node-element list
-	FENodeElementList NEL;
-	NEL.Build(pm);
-
-	// we'll assign values to the edges and the nodes
-	NNL.InitValues(0.0);
-	vector<double> D(NN, 0.0);
-
-	// build the diagonal terms
-	for (int i=0; i<NN; ++i)
+	// build the sparsity pattern of the free-free block.
+	// The diagonal is stored as the first entry of each row.
+	CSRMatrix K;
+	K.rowPtr.assign(NF + 1, 0);
+	for (int i = 0; i < NN; ++i)
+	{
+		if (bn[i] == 0)
+		{
+			int n = 1;
+			int nval = NNL.Valence(i);
+			for (int j = 0; j < nval; ++j) if (bn[NNL.Node(i, j)] == 0) n++;
+			K.rowPtr[eq[i] + 1] = n;
+		}
+	}
+	for (int i = 0; i < NF; ++i) K.rowPtr[i + 1] += K.rowPtr[i];
+	K.colInd.resize(K.rowPtr[NF]);
+	K.val.assign(K.rowPtr[NF], 0.0);
+	for (int i = 0; i < NN; ++i)
 	{
 		if (bn[i] == 0)
 		{
-			int eval = NEL.Valence(i);
-			for (int j=0; j<eval; ++j)
+			int k = K.rowPtr[eq[i]];
+			K.colInd[k++] = eq[i];
+			int nval = NNL.Valence(i);
+			for (int j = 0; j < nval; ++j)
 			{
-				int iel = NEL.ElementIndex(i, j);
-				FEElement_& ej = *NEL.Element(i, j);
-
-				int na = ej.FindNodeIndex(i);
-				assert (na != -1);
-
-				double Vj = Ve[iel];
-				int nj = ej.Nodes();
-				double dot = 0.0;
-				for (int k=0; k<nj; ++k)
-				{
-					vec3d Ga = FEMeshMetrics::ShapeGradient(*pm, ej, na, k);
-					dot += Ga*Ga;
-				}
-				dot *= Vj / nj;
-			
-				D[i] += dot;
+				int nj = NNL.Node(i, j);
+				if (bn[nj] == 0) K.colInd[k++] = eq[nj];
 			}
 		}
 	}
 
-	// build the edge weights
-	for (int i=0; i<NN; ++i)
+	// Assemble the matrix and the right-hand side (i.e. the contributions of the fixed nodes).
+	// The element matrices use the same nodal-quadrature FE integrals that were used
+	// by the original fixed-point iteration. 
+	vector<double> R(NF, 0.0);
+#pragma omp parallel
 	{
-		int nval = NNL.Valence(i);
-		for (int j=0; j<nval; ++j)
-		{
-			int ni = i;
-			int nj = NNL.Node(i, j);
+		// shape function gradient buffer (G[k*MN + a] = Grad{Na(x_k)})
+		const int MN = FEElement::MAX_NODES;
+		vector<vec3d> G(MN*MN);
+		vec3d r[MN];
 
-			// we must loop over the union of Sa and Sb
-			int nei = NEL.Valence(ni);
+#pragma omp for schedule(dynamic, 1024)
+		for (int n = 0; n < NE; ++n)
+		{
+			const FEElement& el = pm->Element(n);
+			int ne = el.Nodes();
 
-			double Kij = 0.0;
+			// shape function gradients at all element nodes
+			pm->ElementNodeLocalPositions(el, r);
+			for (int k = 0; k < ne; ++k) FEMeshMetrics::ShapeGradients(el, r, k, &G[k*MN]);
 
-			for (int k=0; k<nei; ++k)
+			double w = Ve[n] / ne;
+			for (int a = 0; a < ne; ++a)
 			{
-				int kel = NEL.ElementIndex(ni, k);
-				if (NEL.HasElement(nj, kel))
-				{
-					FEElement_& ek = *NEL.Element(ni, k);
-					int na = ek.FindNodeIndex(ni); assert(na != -1);
-					int nb = ek.FindNodeIndex(nj); assert(nb != -1);
+				int na = el.m_node[a];
+				if (bn[na] != 0) continue;
+				int row = eq[na];
 
-					double Vk = Ve[kel];
-					int nk = ek.Nodes();
+				for (int b = 0; b < ne; ++b)
+				{
+					double Kab = 0.0;
+					for (int k = 0; k < ne; ++k) Kab += G[k*MN + a] * G[k*MN + b];
+					Kab *= w;
 
-					double dot = 0.0;
-					for (int k=0; k<nk; ++k)
+					int nb = el.m_node[b];
+					if (bn[nb] == 0)
 					{
-						vec3d Ga = FEMeshMetrics::ShapeGradient(*pm, ek, na, k);
-						vec3d Gb = FEMeshMetrics::ShapeGradient(*pm, ek, nb, k);
-						dot += Ga*Gb;
+						int l = K.Find(row, eq[nb]); assert(l >= 0);
+#pragma omp atomic
+						K.val[l] += Kab;
+					}
+					else
+					{
+						double f = Kab*val[nb];
+#pragma omp atomic
+						R[row] -= f;
 					}
-					dot *= Vk / nk;
-			
-					Kij += dot;
 				}
 			}
-
-			NNL.Value(i, j) = Kij;
 		}
 	}
 
-	// inverted diagonal values
-	vector<double> Dinv(NN);
-	for (int i=0; i<NN; ++i) Dinv[i] = 1.0 / D[i];
+	// inverted diagonal values (Jacobi preconditioner)
+	vector<double> Dinv(NF);
+	for (int i = 0; i < NF; ++i)
+	{
+		double d = K.val[K.rowPtr[i]];
+		Dinv[i] = (d != 0.0 ? 1.0 / d : 1.0);
+	}
+
+	// initial guess
+	vector<double> x(NF);
+	for (int i = 0; i < NN; ++i) if (bn[i] == 0) x[eq[i]] = val[i];
 
-	// start the iterations
-	int niter = 0;
-	double maxd;
-	do
+	// initial residual r = R - K*x
+	vector<double> r(NF), z(NF), p(NF), q(NF);
+	K.Multiply(x, q);
+	for (int i = 0; i < NF; ++i) r[i] = R[i] - q[i];
+
+	double bnorm = sqrt(dot(R, R));
+	if (bnorm == 0.0) bnorm = 1.0;
+
+	m_relres = sqrt(dot(r, r)) / bnorm;
+	bool bconv = (m_relres <= m_tol);
+	if (bconv == false)
 	{
-		maxd = 0.0;
-		for (int i=0; i<NN; ++i)
+		for (int i = 0; i < NF; ++i) { z[i] = Dinv[i] * r[i]; p[i] = z[i]; }
+		double rz = dot(r, z);
+
+		while (m_iters < m_maxIter)
 		{
-			if (bn[i] == 0)
+			K.Multiply(p, q);
+			double pq = dot(p, q);
+			if (pq == 0.0) break;
+			double alpha = rz / pq;
+
+#pragma omp parallel for
+			for (int i = 0; i < NF; ++i)
 			{
-				double sum = 0;
-				int nval = NNL.Valence(i);
-				for (int k=0; k<nval; ++k) sum -= val[NNL.Node(i, k)]*NNL.Value(i,k);
-				sum *= Dinv[i];
+				x[i] += alpha*p[i];
+				r[i] -= alpha*q[i];
+			}
+			m_iters++;
 
-				double dv = fabs(val[i] - sum);
-				val[i] = sum;
+			m_relres = sqrt(dot(r, r)) / bnorm;
+			if (m_relres <= m_tol) { bconv = true; break; }
 
-				if (dv > maxd) maxd = dv;
-			}
+#pragma omp parallel for
+			for (int i = 0; i < NF; ++i) z[i] = Dinv[i] * r[i];
+			double rz_new = dot(r, z);
+			double beta = rz_new / rz;
+			rz = rz_new;
+
+#pragma omp parallel for
+			for (int i = 0; i < NF; ++i) p[i] = z[i] + beta*p[i];
 		}
-		niter++;
 	}
-	while ((niter < MAX_ITER)&&(maxd > eps));
 
-	return true;
+	// copy the solution
+	for (int i = 0; i < NN; ++i) if (bn[i] == 0) val[i] = x[eq[i]];
+
+	return bconv;
 }
@@ -31,7 +31,8 @@ using namespace std;
 class FEMesh;
 
 //-----------------------------------------------------------------------------
-//! This class solves the Laplace equation using an iterative method
+//! This class solves the Laplace equation using a Jacobi-preconditioned
+//! conjugate gradient method
 class LaplaceSolver
 {
 public:
@@ -41,5 +42,21 @@ public:
 	// Input: val = initial values for all nodes
 	//        bn  = boundary flags: 0 = free, 1 = fixed
 	// Output: val = solution
+	// Returns false if the input is invalid or if the solver did not converge.
 	bool Solve(FEMesh* pm, vector<double>& val, vector<int>& bn);
+
+	// set the convergence parameters
+	void SetMaxIterations(int n) { m_maxIter = n; }
+	void SetTolerance(double tol) { m_tol = tol; }
+
+	// convergence info of the last solve
+	int Iterations() const { return m_iters; }
+	double RelativeResidual() const { return m_relres; }
+
+private:
+	int		m_maxIter;	// max number of CG iterations
+	double	m_tol;		// tolerance on the relative residual norm
+
+	int		m_iters;	// number of iterations of last solve
+	double	m_relres;	// relative residual norm of last solve
 };
@@ -65,6 +65,8 @@ public:
 	bool ShowLegend() { return m_pbar->visible(); }
 	void ShowLegend(bool b) { if (b) m_pbar->show(); else m_pbar->hide(); }
 
+	GLLegendBar* GetLegendBar() { return m_pbar; }
+
 	bool GetColorSmooth();
 	void SetColorSmooth(bool b);
 
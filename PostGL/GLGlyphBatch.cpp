@@ -0,0 +1,250 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "GLGlyphBatch.h"
+using namespace Post;
+
+//-----------------------------------------------------------------------------
+void GLGlyphShape::AddCylinder(float r0, float r1, float z0, float h, int slices)
+{
+	// normals of a cone have a z-component of (r0 - r1)/h
+	float nz = (h != 0.f ? (r0 - r1) / h : 0.f);
+	int n0 = Vertices();
+	for (int j = 0; j < 2; ++j)
+	{
+		float r = (j == 0 ? r0 : r1);
+		float z = (j == 0 ? z0 : z0 + h);
+		for (int i = 0; i <= slices; ++i)
+		{
+			double w = 2.0*PI*i / slices;
+			float cw = (float)cos(w), sw = (float)sin(w);
+			m_pos.push_back(vec3f(r*cw, r*sw, z));
+			vec3f n(cw, sw, nz); n.Normalize();
+			m_norm.push_back(n);
+		}
+	}
+
+	for (int i = 0; i < slices; ++i)
+	{
+		int a = n0 + i, b = a + 1;
+		int c = a + slices + 1, d = c + 1;
+		m_idx.push_back(a); m_idx.push_back(b); m_idx.push_back(d);
+		m_idx.push_back(a); m_idx.push_back(d); m_idx.push_back(c);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphShape::AddSphere(float r, int slices, int stacks)
+{
+	int n0 = Vertices();
+	for (int j = 0; j <= stacks; ++j)
+	{
+		double t = PI*j / stacks;
+		float z = (float)cos(t), s = (float)sin(t);
+		for (int i = 0; i <= slices; ++i)
+		{
+			double w = 2.0*PI*i / slices;
+			vec3f n(s*(float)cos(w), s*(float)sin(w), z);
+			m_pos.push_back(n*r);
+			m_norm.push_back(n);
+		}
+	}
+
+	for (int j = 0; j < stacks; ++j)
+		for (int i = 0; i < slices; ++i)
+		{
+			int a = n0 + j*(slices + 1) + i, b = a + 1;
+			int c = a + slices + 1, d = c + 1;
+			m_idx.push_back(a); m_idx.push_back(c); m_idx.push_back(d);
+			m_idx.push_back(a); m_idx.push_back(d); m_idx.push_back(b);
+		}
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphShape::AddBox(float h)
+{
+	const float N[6][3] = { {1,0,0},{-1,0,0},{0,1,0},{0,-1,0},{0,0,1},{0,0,-1} };
+	const float R[6][4][3] = {
+		{ { h,-h,-h },{ h, h,-h },{ h, h, h },{ h,-h, h } },
+		{ {-h, h,-h },{-h,-h,-h },{-h,-h, h },{-h, h, h } },
+		{ { h, h,-h },{-h, h,-h },{-h, h, h },{ h, h, h } },
+		{ {-h,-h,-h },{ h,-h,-h },{ h,-h, h },{-h,-h, h } },
+		{ {-h, h, h },{ h, h, h },{ h,-h, h },{-h,-h, h } },
+		{ { h, h,-h },{-h, h,-h },{-h,-h,-h },{ h,-h,-h } }
+	};
+
+	for (int i = 0; i < 6; ++i)
+	{
+		int n0 = Vertices();
+		for (int j = 0; j < 4; ++j)
+		{
+			m_pos.push_back(vec3f(R[i][j][0], R[i][j][1], R[i][j][2]));
+			m_norm.push_back(vec3f(N[i][0], N[i][1], N[i][2]));
+		}
+		m_idx.push_back(n0); m_idx.push_back(n0 + 1); m_idx.push_back(n0 + 2);
+		m_idx.push_back(n0); m_idx.push_back(n0 + 2); m_idx.push_back(n0 + 3);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphShape::AddLine(float L)
+{
+	int n0 = Vertices();
+	m_pos.push_back(vec3f(0.f, 0.f, 0.f));
+	m_pos.push_back(vec3f(0.f, 0.f, L));
+	m_norm.push_back(vec3f(0.f, 0.f, 1.f));
+	m_norm.push_back(vec3f(0.f, 0.f, 1.f));
+	m_idx.push_back(n0);
+	m_idx.push_back(n0 + 1);
+}
+
+//=============================================================================
+GLGlyphBatch::GLGlyphBatch()
+{
+	m_prim = GLGlyphShape::TRIANGLES;
+	m_instances = 0;
+	m_vertsPerInstance = 0;
+	m_chunk = 0;
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBatch::Clear()
+{
+	m_instances = 0;
+	m_vertsPerInstance = 0;
+	m_chunk = 0;
+	std::vector<VERTEX>().swap(m_vert);
+	m_idx.clear();
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBatch::AlignedFrame(const vec3f& v, float L, vec3f a[3])
+{
+	// this is the same rotation as applied by the immediate mode glyphs
+	vec3d t(v); t.Normalize();
+	vec3d ex(1, 0, 0), ey(0, 1, 0), ez(0, 0, 1);
+	quatd q(ez, t);
+	double w = q.GetAngle();
+	if (fabs(w) > 1e-6)
+	{
+		vec3d p = q.GetVector();
+		if (p.Length() <= 1e-6) q = quatd(w, vec3d(1, 0, 0));
+		ex = q*ex; ey = q*ey; ez = q*ez;
+	}
+	a[0] = to_vec3f(ex)*L;
+	a[1] = to_vec3f(ey)*L;
+	a[2] = to_vec3f(ez)*L;
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBatch::Build(const GLGlyphShape& shape, const std::vector<GLGlyphInstance>& inst)
+{
+	Clear();
+
+	int NV = shape.Vertices();
+	int NI = shape.Indices();
+	int NG = (int)inst.size();
+	if ((NV == 0) || (NI == 0) || (NG == 0)) return;
+
+	m_prim = shape.Primitive();
+	m_instances = NG;
+	m_vertsPerInstance = NV;
+
+	// all instances of a chunk must be addressable with 16-bit indices
+	// (glyph shapes are expected to have far fewer vertices than that)
+	assert(NV <= 65536);
+	m_chunk = 65536 / NV;
+	if (m_chunk < 1) m_chunk = 1;
+	if (m_chunk > NG) m_chunk = NG;
+	m_idx.resize((size_t)m_chunk*NI);
+	for (int k = 0; k < m_chunk; ++k)
+	{
+		for (int i = 0; i < NI; ++i) m_idx[(size_t)k*NI + i] = (unsigned short)(k*NV + shape.m_idx[i]);
+	}
+
+	m_vert.resize((size_t)NG*NV);
+
+#pragma omp parallel for schedule(static)
+	for (int k = 0; k < NG; ++k)
+	{
+		const GLGlyphInstance& g = inst[k];
+		const vec3f* a = g.a;
+
+		// normals are transformed by the cofactor matrix (i.e. the
+		// inverse transpose up to a scale factor)
+		vec3f c0 = a[1] ^ a[2];
+		vec3f c1 = a[2] ^ a[0];
+		vec3f c2 = a[0] ^ a[1];
+		if (a[0] * c0 < 0.f) { c0 = -c0; c1 = -c1; c2 = -c2; }
+
+		VERTEX* pv = &m_vert[(size_t)k*NV];
+		for (int i = 0; i < NV; ++i, ++pv)
+		{
+			const vec3f& p = shape.m_pos[i];
+			const vec3f& q = shape.m_norm[i];
+			vec3f r = g.r + a[0] * p.x + a[1] * p.y + a[2] * p.z;
+			vec3f n = c0*q.x + c1*q.y + c2*q.z;
+			float L = n.Length();
+			if (L > 0.f) n /= L;
+
+			pv->r[0] = r.x; pv->r[1] = r.y; pv->r[2] = r.z;
+			pv->n[0] = (signed char)(127.f*n.x);
+			pv->n[1] = (signed char)(127.f*n.y);
+			pv->n[2] = (signed char)(127.f*n.z);
+			pv->n[3] = 0;
+			pv->c[0] = g.c.r; pv->c[1] = g.c.g; pv->c[2] = g.c.b; pv->c[3] = g.c.a;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBatch::Render()
+{
+	if (m_instances == 0) return;
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	if (m_prim == GLGlyphShape::TRIANGLES) glEnableClientState(GL_NORMAL_ARRAY);
+
+	GLenum mode = (m_prim == GLGlyphShape::TRIANGLES ? GL_TRIANGLES : GL_LINES);
+	int NI = (int)m_idx.size() / m_chunk;
+	for (int k0 = 0; k0 < m_instances; k0 += m_chunk)
+	{
+		int nk = m_instances - k0;
+		if (nk > m_chunk) nk = m_chunk;
+
+		const VERTEX* pv = &m_vert[(size_t)k0*m_vertsPerInstance];
+		glVertexPointer(3, GL_FLOAT, sizeof(VERTEX), pv->r);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VERTEX), pv->c);
+		if (m_prim == GLGlyphShape::TRIANGLES) glNormalPointer(GL_BYTE, sizeof(VERTEX), pv->n);
+
+		glDrawElements(mode, nk*NI, GL_UNSIGNED_SHORT, &m_idx[0]);
+	}
+
+	glPopClientAttrib();
+}
@@ -0,0 +1,120 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <MathLib/math3d.h>
+#include <FSCore/color.h>
+#include <vector>
+
+namespace Post {
+
+//-----------------------------------------------------------------------------
+// The shape of a glyph. The shape is tessellated once in its local frame and 
+// is then copied for each glyph instance.
+class GLGlyphShape
+{
+public:
+	enum Primitive {
+		TRIANGLES,
+		LINES
+	};
+
+public:
+	GLGlyphShape(int primitive = TRIANGLES) : m_prim(primitive) {}
+
+	void Clear() { m_pos.clear(); m_norm.clear(); m_idx.clear(); }
+
+	int Primitive() const { return m_prim; }
+	int Vertices() const { return (int)m_pos.size(); }
+	int Indices() const { return (int)m_idx.size(); }
+
+	// add a (truncated) cone along the z-axis, starting at z0
+	void AddCylinder(float r0, float r1, float z0, float h, int slices);
+
+	// add a sphere centered at the origin
+	void AddSphere(float r, int slices, int stacks);
+
+	// add an axis-aligned box with half-width h
+	void AddBox(float h);
+
+	// add a line from the origin to (0,0,L)
+	void AddLine(float L);
+
+public:
+	int						m_prim;
+	std::vector<vec3f>		m_pos;	// vertex positions
+	std::vector<vec3f>		m_norm;	// vertex normals
+	std::vector<unsigned short>	m_idx;	// primitive indices
+};
+
+//-----------------------------------------------------------------------------
+// A glyph instance: the shape is transformed by the matrix whose columns
+// are a[0], a[1], a[2] and then translated to r.
+struct GLGlyphInstance
+{
+	vec3f	r;
+	vec3f	a[3];
+	GLColor	c;
+};
+
+//-----------------------------------------------------------------------------
+// Renders many copies of a glyph shape. The instances are expanded into one
+// interleaved vertex array when they change, which is then drawn in chunks
+// that share a single index array.
+class GLGlyphBatch
+{
+	struct VERTEX
+	{
+		float			r[3];
+		signed char		n[4];
+		unsigned char	c[4];
+	};
+
+public:
+	GLGlyphBatch();
+
+	// expand the instances into the vertex array
+	void Build(const GLGlyphShape& shape, const std::vector<GLGlyphInstance>& inst);
+
+	void Clear();
+
+	void Render();
+
+	int Instances() const { return m_instances; }
+
+	// returns a frame whose z-axis is aligned with v and scaled by L
+	static void AlignedFrame(const vec3f& v, float L, vec3f a[3]);
+
+private:
+	int						m_prim;
+	int						m_instances;
+	int						m_vertsPerInstance;
+	int						m_chunk;	// instances per draw call
+	std::vector<VERTEX>		m_vert;
+	std::vector<unsigned short>	m_idx;
+};
+
+}
@@ -238,6 +238,24 @@ void CGLModel::UpdateDisplacements(int nstate, bool breset)
 	if (m_pdis && m_pdis->IsActive()) m_pdis->Update(nstate, 0.f, breset);
 }
 
+//-----------------------------------------------------------------------------
+// This evaluates the displacement and color map fields of the given state without
+// touching the current mesh state, so that it can run while a frame is still being
+// processed (e.g. while the previous frame of an animation is being encoded).
+void CGLModel::PrefetchState(int nstate)
+{
+	if (m_ps == nullptr) return;
+	if ((nstate < 0) || (nstate >= m_ps->GetStates())) return;
+
+	if (m_pdis && m_pdis->IsActive()) m_pdis->UpdateState(nstate);
+
+	if (m_pcol && m_pcol->IsActive())
+	{
+		int nfield = m_pcol->GetEvalField();
+		if (m_ps->IsValidFieldCode(nfield, nstate)) m_ps->Evaluate(nfield, nstate);
+	}
+}
+
 //-----------------------------------------------------------------------------
 void CGLModel::SetMaterialParams(FEMaterial* pm)
 {
@@ -116,6 +116,9 @@ public:
 	bool Update(bool breset) override;
 	void UpdateDisplacements(int nstate, bool breset = false);
 
+	// evaluate the data of a state ahead of time so that the next Update is cheap
+	void PrefetchState(int nstate);
+
 	bool AddDisplacementMap(const char* szvectorField = 0);
 
 	void RemoveDisplacementMap();
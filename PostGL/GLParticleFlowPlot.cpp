@@ -27,6 +27,7 @@ SOFTWARE.*/
 #include "stdafx.h"
 #include "GLParticleFlowPlot.h"
 #include "GLModel.h"
+#include <thread>
 using namespace Post;
 
 CGLParticleFlowPlot::CGLParticleFlowPlot(CGLModel* mdl) : CGLPlot(mdl), m_find(*mdl->GetActiveMesh())
@@ -54,6 +55,9 @@ CGLParticleFlowPlot::CGLParticleFlowPlot(CGLModel* mdl) : CGLPlot(mdl), m_find(*
 	m_seedTime = 1;
 	m_dt = 0.01f;
 
+	m_np = 0;
+	m_ntime = -1;
+
 	UpdateData(false);
 }
 
@@ -118,43 +122,39 @@ void CGLParticleFlowPlot::SetDensity(float v)
 
 void CGLParticleFlowPlot::Render(CGLContext& rc)
 {
-	int NP = (int) m_particles.size();
+	int NP = (int) m_livePos.size();
 	if (NP == 0) return;
 
 	glPushAttrib(GL_ENABLE_BIT);
 	glDisable(GL_LIGHTING);
 	glDisable(GL_TEXTURE_1D);
 
-	glBegin(GL_POINTS);
-	for (int i=0; i<NP; ++i)
-	{
-		FlowParticle& p = m_particles[i];
-		if (p.m_balive)
-		{
-			glColor3ub(p.m_col.r, p.m_col.g, p.m_col.b);
-			glVertex3f(p.m_r.x, p.m_r.y, p.m_r.z);
-		}
-	}
-	glEnd();
+	// the live particles are stored contiguously, so we can draw them in one call
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(vec3f), &m_livePos[0]);
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, &m_liveCol[0]);
+	glDrawArrays(GL_POINTS, 0, NP);
+	glPopClientAttrib();
 
 	if (m_showPath)
 	{
-		int ntime = GetModel()->CurrentTimeIndex();
+		int ntime = m_ntime;
 		if (ntime >= m_seedTime + 1)
 		{
 			glColor3ub(0,0,255);
-			for (int i = 0; i<NP; ++i)
+			for (int i = 0; i<m_np; ++i)
 			{
-				FlowParticle& p = m_particles[i];
-
 				int tend = ntime;
-				if (tend > p.m_ndeath) tend = p.m_ndeath;
+				if (tend > m_death[i]) tend = m_death[i];
+				if (tend > m_maxtime) tend = m_maxtime;
 
 				glBegin(GL_LINE_STRIP);
 				{
 					for (int n=m_seedTime; n<=tend; ++n)
 					{
-						vec3f& r = p.m_pos[n];
+						vec3f& r = m_pos[n][i];
 						glVertex3f(r.x, r.y, r.z);
 					}					
 				}
@@ -168,19 +168,21 @@ void CGLParticleFlowPlot::Render(CGLContext& rc)
 
 void CGLParticleFlowPlot::Update(int ntime, float dt, bool breset)
 {
-	if (breset) { m_map.Clear(); m_rng.clear(); m_maxtime = -1; m_particles.clear(); }
+	if (breset) { m_map.Clear(); m_rng.clear(); m_maxtime = -1; ClearParticles(); }
 	if (m_nvec == -1) return;
 
 	CGLModel* mdl = GetModel();
 
 	// see if we need to revaluate the FEFindElement object
-	// We evaluate it when the plot needs to be reset, or when the model has a displacement map
+	// We build it when the plot needs to be reset, and refit it to the new
+	// nodal positions when the model has a displacement map
 	bool bdisp = mdl->HasDisplacementMap();
-	if (breset || bdisp)
+	if (breset)
 	{
 		// choose reference frame or current frame, depending on whether we have a displacement map
 		m_find.Init(bdisp ? 1 : 0);
 	}
+	else if (bdisp) m_find.Update();
 
 	FEMeshBase* pm = mdl->GetActiveMesh();
 	FEPostModel* pfem = mdl->GetFEModel();
@@ -194,59 +196,86 @@ void CGLParticleFlowPlot::Update(int ntime, float dt, bool breset)
 		m_rng.resize(NS);
 	}
 
-	// check the tag
-	int ntag = m_map.GetTag(ntime);
+	// the current state is needed for the color range. The states that the
+	// particles are advected through are evaluated when they are needed.
+	UpdateNodalField(ntime);
 
-	// see if we need to update
-	if (ntag != m_nvec)
-	{
-		// check all states up until this time
-		for (int n=0; n<=ntime; ++n)
-		{
-			ntag = m_map.GetTag(n);
-			if (ntag != m_nvec)
-			{
-				m_map.SetTag(n, m_nvec);
+	// copy nodal values
+	m_crng = m_rng[ntime];
 
-				// get the state we are interested in
-				vector<vec3f>& val = m_map.State(n);
+	// update particles
+	UpdateParticles(ntime);
+}
 
-				vec2f& rng = m_rng[n];
-				rng.x = rng.y = 0;
+// evaluate the vector field of a state, if it wasn't evaluated already. 
+// This only writes to the data of this state, so different states can be
+// evaluated on different threads.
+void CGLParticleFlowPlot::UpdateNodalField(int n)
+{
+	if (m_map.GetTag(n) == m_nvec) return;
 
-				float L;
+	FEMeshBase* pm = GetModel()->GetActiveMesh();
+	FEPostModel* pfem = GetModel()->GetFEModel();
 
-				for (int i = 0; i<pm->Nodes(); ++i)
-				{
-					val[i] = pfem->EvaluateNodeVector(i, n, m_nvec);
-					L = val[i].Length();
-					if (L > rng.y) rng.y = L;
-				}
+	// get the state we are interested in
+	vector<vec3f>& val = m_map.State(n);
 
-				if (rng.y == rng.x) ++rng.y;
-			}
-		}
+	vec2f& rng = m_rng[n];
+	rng.x = rng.y = 0;
+
+	float L;
+
+	for (int i = 0; i<pm->Nodes(); ++i)
+	{
+		val[i] = pfem->EvaluateNodeVector(i, n, m_nvec);
+		L = val[i].Length();
+		if (L > rng.y) rng.y = L;
 	}
 
-	// copy nodal values
-	m_crng = m_rng[ntime];
+	if (rng.y == rng.x) ++rng.y;
 
-	// update particles
-	UpdateParticles(ntime);
+	m_map.SetTag(n, m_nvec);
+}
+
+void CGLParticleFlowPlot::ClearParticles()
+{
+	m_np = 0;
+	m_death.clear();
+	m_elem.clear();
+	m_step.clear();
+	m_pos.clear();
+	m_vel.clear();
+	m_live.clear();
+	m_livePos.clear();
+	m_liveCol.clear();
 }
 
 void CGLParticleFlowPlot::UpdateParticles(int ntime)
 {
+	m_ntime = ntime;
 	if (ntime < m_seedTime)
 	{
 		// deactivate all particles
-		for (int i=0; i<m_particles.size(); ++i) m_particles[i].m_balive = false;
+		m_live.clear();
+		m_livePos.clear();
+		m_liveCol.clear();
 		return;
 	}
 
 	if (ntime > m_maxtime)
 	{
-		// perform particle integration
+		// Advance the particles from maxtime to this time. Only the new time steps 
+		// are integrated. Each particle continues with the step size and element 
+		// it had at the end of the last time step.
+		// This is pipelined: the vector field of the next state is evaluated on
+		// a separate thread while the particles are seeded or advected through
+		// the current interval.
+		int n0 = (m_maxtime < m_seedTime ? m_seedTime : m_maxtime);
+		UpdateNodalField(n0);
+
+		std::thread next;
+		if (n0 < ntime) next = std::thread(&CGLParticleFlowPlot::UpdateNodalField, this, n0 + 1);
+
 		if (m_maxtime < m_seedTime)
 		{
 			// seed the particles
@@ -254,8 +283,16 @@ void CGLParticleFlowPlot::UpdateParticles(int ntime)
 			m_maxtime = m_seedTime;
 		}
 
-		// advance the particles from maxtime to this time
-		AdvanceParticles(m_maxtime, ntime);
+		for (int n = n0; n < ntime; ++n)
+		{
+			// wait for the field at the end of this interval
+			next.join();
+			if (n + 1 < ntime) next = std::thread(&CGLParticleFlowPlot::UpdateNodalField, this, n + 2);
+
+			AdvanceParticles(n, n + 1);
+		}
+		if (next.joinable()) next.join();
+
 		m_maxtime = ntime;
 	}
 
@@ -265,50 +302,57 @@ void CGLParticleFlowPlot::UpdateParticles(int ntime)
 
 void CGLParticleFlowPlot::UpdateParticleState(int ntime)
 {
-	int NP = (int) m_particles.size();
-	for (int i=0; i<NP; ++i)
+	// collect the particles that are alive at this time
+	m_live.clear();
+	if ((ntime < 0) || (ntime >= (int)m_pos.size()) || (m_pos[ntime].empty()))
 	{
-		FlowParticle& p = m_particles[i];
+		m_livePos.clear();
+		m_liveCol.clear();
+		return;
+	}
 
-		if (ntime >= p.m_ndeath)
-		{
-			p.m_balive = false;
-		}
-		else
-		{
-			p.m_balive = true;
-			p.m_r = p.m_pos[ntime];
-			p.m_v = p.m_vel[ntime];
-		}
+	for (int i=0; i<m_np; ++i)
+	{
+		if (ntime < m_death[i]) m_live.push_back(i);
 	}
 
+	int NL = (int)m_live.size();
+	m_livePos.resize(NL);
+	const vector<vec3f>& pos = m_pos[ntime];
+#pragma omp parallel for
+	for (int i = 0; i<NL; ++i) m_livePos[i] = pos[m_live[i]];
+
 	UpdateParticleColors();
 }
 
 void CGLParticleFlowPlot::UpdateParticleColors()
 {
+	int NL = (int)m_live.size();
+	m_liveCol.resize(4*NL);
+	if (NL == 0) return;
+
 	float vmin = m_crng.x;
 	float vmax = m_crng.y;
 	if (vmax == vmin) vmax++;
 
 	int ncol = m_Col.GetColorMap();
-	CColorMap& col = ColorMapManager::GetColorMap(ncol);
+	const CColorMap& col = ColorMapManager::GetColorMap(ncol);
 
-	int NP = (int)m_particles.size();
-	for (int i = 0; i<NP; ++i)
+	const vector<vec3f>& vel = m_vel[m_ntime];
+#pragma omp parallel for
+	for (int i = 0; i<NL; ++i)
 	{
-		FlowParticle& p = m_particles[i];
-		if (p.m_balive)
-		{
-			vec3f& v = p.m_v;
-			float V = v.Length();
-			float w = (V - vmin) / (vmax - vmin);
-			p.m_col = col.map(w);
-		}
+		float V = vel[m_live[i]].Length();
+		float w = (V - vmin) / (vmax - vmin);
+		GLColor c = col.map(w);
+		byte* pc = &m_liveCol[4 * i];
+		pc[0] = c.r; pc[1] = c.g; pc[2] = c.b; pc[3] = 255;
 	}
 }
 
-vec3f CGLParticleFlowPlot::Velocity(const vec3f& r, int ntime, float w, bool& ok)
+// Evaluate the velocity at point r, at a fraction w of the interval [ntime, ntime+1].
+// On input, nelem is the element to search first. On output, it is the element that contains r.
+vec3f CGLParticleFlowPlot::Velocity(const vec3f& r, int ntime, float w, int& nelem, bool& ok)
 {
 	vec3f v(0.f, 0.f, 0.f);
 	vec3f ve0[FEElement::MAX_NODES];
@@ -318,15 +362,16 @@ vec3f CGLParticleFlowPlot::Velocity(const vec3f& r, int ntime, float w, bool& ok
 	vector<vec3f>& val0 = m_map.State(ntime    );
 	vector<vec3f>& val1 = m_map.State(ntime + 1);
 
-	int nelem;
+	int ne = -1;
 	double q[3];
-	if (m_find.FindElement(r, nelem, q))
+	if (m_find.FindElement(r, ne, q, nelem))
 	{
 		ok = true;
-		FEElement_& el = mesh.ElementRef(nelem);
+		nelem = ne;
+		FEElement_& el = mesh.ElementRef(ne);
 
-		int ne = el.Nodes();
-		for (int i = 0; i<ne; ++i)
+		int nn = el.Nodes();
+		for (int i = 0; i<nn; ++i)
 		{
 			ve0[i] = val0[el.m_node[i]];
 			ve1[i] = val1[el.m_node[i]];
@@ -349,75 +394,150 @@ void CGLParticleFlowPlot::AdvanceParticles(int n0, int n1)
 	if (mdl == 0) return;
 	FEPostModel& fem = *mdl->GetFEModel();
 
-	// get the mesh
-	FEMeshBase& mesh = *mdl->GetActiveMesh();
+	if ((m_np == 0) || (m_dt <= 0.f)) return;
 
+	// the error tolerance is relative to the size of the model
 	BOX box = m_find.BoundingBox();
-	float R = box.GetMaxExtent();
-	float dt = m_dt;
-	if (dt <= 0.f) return;
+	float tol = 1e-4f*box.GetMaxExtent();
+	if (tol <= 0.f) tol = 1e-6f;
 
-	for (int ntime=n0; ntime<n1; ++ntime)
+	// allocate storage for the new time steps
+	vector<float> t(n1 + 1, 0.f);
+	for (int n = n0; n <= n1; ++n)
 	{
-		float t0 = fem.GetState(ntime    )->m_time;
-		float t1 = fem.GetState(ntime + 1)->m_time;
-		if (t1 < t0) t1 = t0;
-
-		int NP = (int)m_particles.size();
-#pragma omp parallel for shared (NP)
-		for (int i = 0; i<NP; ++i)
+		t[n] = fem.GetState(n)->m_time;
+		if ((n > n0) && (t[n] < t[n - 1])) t[n] = t[n - 1];
+		if (n > n0)
 		{
-			FlowParticle& p = m_particles[i];
-			p.m_pos[ntime+1] = p.m_pos[ntime];
-			p.m_vel[ntime+1] = p.m_vel[ntime];
+			m_pos[n].resize(m_np);
+			m_vel[n].resize(m_np);
 		}
+	}
 
-		float t = t0;
-		while (t < t1)
+	// Each particle is integrated over all the new time steps independently, 
+	// so we don't need to synchronize between steps.
+	int NP = m_np;
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i<NP; ++i)
+	{
+		for (int ntime = n0; ntime < n1; ++ntime)
 		{
-			t += dt;
-			if (t > t1) t = t1;
-			float w = (t - t0) / (t1 - t0);
-
-			int NP = (int) m_particles.size();
-#pragma omp parallel for shared (NP)
-			for (int i=0; i<NP; ++i)
+			if (m_death[i] > ntime)
 			{
-				FlowParticle& p = m_particles[i];
+				if (AdvanceParticle(i, ntime, t[ntime], t[ntime + 1], tol) == false)
+					m_death[i] = ntime + 1;
+			}
+			else
+			{
+				m_pos[ntime + 1][i] = m_pos[ntime][i];
+				m_vel[ntime + 1][i] = m_vel[ntime][i];
+			}
+		}
+	}
+}
 
-				if (p.m_ndeath > ntime)
-				{
-					vec3f r0 = p.m_pos[ntime + 1];
-					vec3f v0 = p.m_vel[ntime + 1];
+// Advance a particle from time step ntime to ntime+1 using the Bogacki-Shampine 
+// RK3(2) pair. The step size is adjusted so that the estimated position error 
+// of each step stays below tol.
+bool CGLParticleFlowPlot::AdvanceParticle(int i, int ntime, float t0, float t1, float tol)
+{
+	const int MAX_STEPS = 10000;
 
-					vec3f r1 = r0 + v0*dt;
+	vec3f r = m_pos[ntime][i];
+	int ne = m_elem[i];
+	float h = m_step[i];
 
-					bool ok = true;
-					vec3f v1 = Velocity(r1, ntime, w, ok);
-					if (ok == false)
-					{
-						p.m_ndeath = ntime + 1;
-					}
-					else
-					{
-						p.m_pos[ntime + 1] = r1;
-						p.m_vel[ntime + 1] = v1;
-					}
-				}
+	vec3f& r1 = m_pos[ntime + 1][i];
+	vec3f& v1 = m_vel[ntime + 1][i];
+	r1 = r;
+	v1 = m_vel[ntime][i];
+
+	float T = t1 - t0;
+	if (T <= 0.f) return true;
+	if ((h <= 0.f) || (h > T)) h = T;
+	float hmin = 1e-6f*T;
+
+	bool ok = true;
+	vec3f k1 = Velocity(r, ntime, 0.f, ne, ok);
+	if (ok == false) return false;
+
+	float t = t0;
+	for (int nstep = 0; (t < t1) && (nstep < MAX_STEPS); ++nstep)
+	{
+		bool last = (h >= t1 - t);
+		float hs = (last ? t1 - t : h);
+
+		bool ok2, ok3, ok4 = false;
+		vec3f k2 = Velocity(r + k1*(0.5f*hs), ntime, (t + 0.5f*hs - t0) / T, ne, ok2);
+		vec3f k3 = Velocity(r + k2*(0.75f*hs), ntime, (t + 0.75f*hs - t0) / T, ne, ok3);
+		vec3f rn = r + (k1*(2.f/9.f) + k2*(1.f/3.f) + k3*(4.f/9.f))*hs;
+		vec3f k4;
+		if (ok2 && ok3) k4 = Velocity(rn, ntime, (last ? 1.f : (t + hs - t0) / T), ne, ok4);
+
+		if ((ok2 && ok3 && ok4) == false)
+		{
+			// we left the mesh. Try a smaller step, unless we can't get any closer.
+			if (hs <= hmin)
+			{
+				r1 = r;
+				v1 = k1;
+				m_elem[i] = ne;
+				return false;
 			}
+			h = 0.5f*hs;
+			continue;
+		}
+
+		// error estimate
+		vec3f e = (k1*(-5.f/72.f) + k2*(1.f/12.f) + k3*(1.f/9.f) + k4*(-1.f/8.f))*hs;
+		float err = e.Length();
+
+		float fac = (err > 0.f ? 0.9f*pow(tol / err, 1.f/3.f) : 4.f);
+		if (fac > 4.f) fac = 4.f;
+		if (fac < 0.2f) fac = 0.2f;
+
+		if ((err <= tol) || (hs <= hmin))
+		{
+			// accept the step (the last stage is the first stage of the next step)
+			r = rn;
+			k1 = k4;
+			t = (last ? t1 : t + hs);
+
+			// don't let the end of the interval shrink the step size
+			if (last == false) h = hs*fac;
+			else if (fac < 1.f) h = hs*fac;
 		}
+		else h = hs*fac;
+
+		if (h > T) h = T;
+		if (h < hmin) h = hmin;
 	}
+
+	r1 = r;
+	v1 = k1;
+	m_elem[i] = ne;
+	m_step[i] = h;
+
+	// if we ran out of steps, the particle stalled before reaching t1
+	return (t >= t1);
 }
 
-static float frand()
+// A hash based random number in [0,1]. Unlike rand() this is thread safe and
+// gives the same seeds each time.
+static float hrand(unsigned int n)
 {
-	return rand() / (float) RAND_MAX;
+	n = (n ^ 61) ^ (n >> 16);
+	n *= 9;
+	n = n ^ (n >> 4);
+	n *= 0x27d4eb2d;
+	n = n ^ (n >> 15);
+	return (n & 0xFFFFFF) / (float) 0xFFFFFF;
 }
 
 void CGLParticleFlowPlot::SeedParticles()
 {
 	// clear current particles, if any
-	m_particles.clear();
+	ClearParticles();
 
 	// get the model
 	CGLModel* mdl = GetModel();
@@ -438,8 +558,9 @@ void CGLParticleFlowPlot::SeedParticles()
 	// make sure vtol is positive
 	float vtol = fabs(m_vtol);
 
-	// loop over all the surface facts
+	// find the surface faces that will get a seed
 	int NF = mesh.Faces();
+	vector<char> seed(NF, 0);
 #pragma omp parallel for shared (NF)
 	for (int i = 0; i<NF; ++i)
 	{
@@ -451,35 +572,48 @@ void CGLParticleFlowPlot::SeedParticles()
 		for (int j = 0; j<nf; ++j) vf += val[f.n[j]];
 		vf /= nf;
 
-		// generate random number
-		float w = frand();
-
 		// see if this is a valid candidate for a seed
 		vec3f fn = f.m_fn;
-		if ((fn*vf < -vtol) && (w <= m_density))
+		if ((fn*vf < -vtol) && (hrand(i) <= m_density)) seed[i] = 1;
+	}
+
+	vector<int> face;
+	for (int i = 0; i < NF; ++i) if (seed[i]) face.push_back(i);
+	int NP = (int)face.size();
+	if (NP == 0) return;
+
+	// allocate the particles
+	m_np = NP;
+	m_death.assign(NP, NS);	// assume the particles will live the entire time
+	m_elem.assign(NP, -1);
+	m_step.assign(NP, m_dt);
+	m_pos.resize(NS);
+	m_vel.resize(NS);
+	m_pos[m_seedTime].resize(NP);
+	m_vel[m_seedTime].resize(NP);
+
+#pragma omp parallel for shared (NP)
+	for (int i = 0; i<NP; ++i)
+	{
+		FEFace& f = mesh.Face(face[i]);
+
+		// calculate the face center and velocity, this will be the seed
+		// NOTE: We are using reference coordinates, therefore we assume that the mesh is not deforming!!
+		int nf = f.Nodes();
+		vec3d cf(0.f, 0.f, 0.f);
+		vec3f vf(0.f, 0.f, 0.f);
+		for (int j = 0; j<nf; ++j)
 		{
-			// calculate the face center, this will be the seed
-			// NOTE: We are using reference coordinates, therefore we assume that the mesh is not deforming!!
-			vec3d cf(0.f, 0.f, 0.f);
-			for (int j = 0; j<nf; ++j) cf += mesh.Node(f.n[j]).r;
-			cf /= nf;
-
-			// create a particle here
-			FlowParticle p;
-			p.m_pos.resize(NS);
-			p.m_vel.resize(NS);
-			p.m_balive = true;
-			p.m_ndeath = NS;	// assume the particle will live the entire time
-
-			// set initial position and velocity
-			p.m_pos[m_seedTime] = to_vec3f(cf);
-			p.m_vel[m_seedTime] = vf;
-
-			// add it to the pile
-#pragma omp critical
-            {
-                m_particles.push_back(p);
-            }
+			cf += mesh.Node(f.n[j]).r;
+			vf += val[f.n[j]];
 		}
+		cf /= nf;
+		vf /= nf;
+
+		m_pos[m_seedTime][i] = to_vec3f(cf);
+		m_vel[m_seedTime][i] = vf;
+
+		// the element that owns the face is a good place to start searching
+		m_elem[i] = f.m_elem[0].eid;
 	}
 }
@@ -35,41 +35,6 @@ class CGLParticleFlowPlot : public CGLPlot
 {
 	enum { DATA_FIELD, COLOR_MAP, CLIP, SEED_STEP, THRESHOLD, DENSITY, STEP_SIZE, PATH_LINES };
 
-	class FlowParticle
-	{
-	public:
-		FlowParticle(){}
-		FlowParticle(const FlowParticle& p)
-		{
-			m_r = p.m_r;
-			m_v = p.m_v;
-			m_col = p.m_col;
-			m_balive = p.m_balive;
-			m_ndeath = p.m_ndeath;
-			m_pos = p.m_pos;
-			m_vel = p.m_vel;
-		}
-		void operator =(const FlowParticle& p)
-		{
-			m_r = p.m_r;
-			m_v = p.m_v;
-			m_col = p.m_col;
-			m_balive = p.m_balive;
-			m_ndeath = p.m_ndeath;
-			m_pos = p.m_pos;
-			m_vel = p.m_vel;
-		}
-
-	public:
-		vec3f			m_r;		// current particle position
-		vec3f			m_v;		// current particle velocity
-		GLColor			m_col;		// particles color
-		bool			m_balive;	// is particle alive at current position?
-		int				m_ndeath;	// time of death
-		vector<vec3f>	m_pos;		// particle position at various times
-		vector<vec3f>	m_vel;		// particle velocity at various times
-	};
-
 public:
 	CGLParticleFlowPlot(CGLModel* mdl);
 
@@ -105,12 +70,20 @@ protected:
 
 	void SeedParticles();
 
+	void ClearParticles();
+
 	void AdvanceParticles(int t0, int t1);
 
-	vec3f Velocity(const vec3f& r, int ntime, float dt, bool& ok);
+	// advance one particle over the interval [ntime, ntime+1]. Returns false if the particle 
+	// left the mesh or stalled (i.e. did not reach the end of the interval).
+	bool AdvanceParticle(int i, int ntime, float t0, float t1, float tol);
+
+	vec3f Velocity(const vec3f& r, int ntime, float w, int& nelem, bool& ok);
 
 	void UpdateParticleState(int ntime);
 
+	void UpdateNodalField(int n);
+
 public:
 	void UpdateParticleColors();
 
@@ -132,6 +105,18 @@ private:
 
 	FEFindElement	m_find;
 
-	vector<FlowParticle>	m_particles;
+	// particle data, stored as arrays (one entry per particle)
+	int				m_np;		// nr of particles
+	vector<int>		m_death;	// time of death
+	vector<int>		m_elem;		// last element that contained the particle (search hint)
+	vector<float>	m_step;		// current (adaptive) integration step size
+	vector< vector<vec3f> >	m_pos;	// particle positions, per time step
+	vector< vector<vec3f> >	m_vel;	// particle velocities, per time step
+
+	// the live particles at the current time step (used for rendering)
+	vector<vec3f>	m_livePos;
+	vector<byte>	m_liveCol;	// RGBA colors (4 per particle)
+	vector<int>		m_live;		// indices of the live particles
+	int				m_ntime;	// the time step of the live particles
 };
 }
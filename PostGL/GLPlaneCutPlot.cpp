@@ -44,6 +44,50 @@ const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
 const int QUAD_NT[4] = { 0, 1, 2, 3 };
 const int TRI_NT[4]  = { 0, 1, 2, 2 };
 
+//-----------------------------------------------------------------------------
+// Returns the equivalent hex (degenerate) node numbering of an element or
+// null if the element cannot be sliced.
+static const int* ElementCorners(const FEElement_& el)
+{
+	switch (el.Type())
+	{
+	case FE_HEX8   : return HEX_NT;
+	case FE_HEX20  : return HEX_NT;
+	case FE_HEX27  : return HEX_NT;
+	case FE_PENTA6 : return PEN_NT;
+	case FE_PENTA15: return PEN_NT;
+	case FE_TET4   : return TET_NT;
+	case FE_TET5   : return TET_NT;
+	case FE_TET10  : return TET_NT;
+	case FE_TET15  : return TET_NT;
+	case FE_TET20  : return TET_NT;
+	case FE_PYRA5  : return PYR_NT;
+	}
+	return nullptr;
+}
+
+// Same, but for a face (returns the equivalent quad numbering)
+static const int* FaceCorners(const FEFace& face)
+{
+	switch (face.Type())
+	{
+	case FE_FACE_TRI3 : return TRI_NT;
+	case FE_FACE_TRI6 : return TRI_NT;
+	case FE_FACE_TRI7 : return TRI_NT;
+	case FE_FACE_TRI10: return TRI_NT;
+	case FE_FACE_QUAD4: return QUAD_NT;
+	case FE_FACE_QUAD8: return QUAD_NT;
+	case FE_FACE_QUAD9: return QUAD_NT;
+	}
+	return nullptr;
+}
+
+// max number of slices that are kept in the cache
+const int MAX_CACHED_SLICES = 32;
+
+// max number of faces, summed over all cached slices
+const int MAX_CACHED_FACES = 1000000;
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -80,6 +124,8 @@ CGLPlaneCutPlot::CGLPlaneCutPlot(CGLModel* po) : CGLPlot(po)
 	m_bshowplane = true;
 	m_bshow_mesh = false;
 
+	m_key.mesh = nullptr;
+
 	m_nclip = GetFreePlane();
 	if (m_nclip >= 0) m_pcp[m_nclip] = this;
 
@@ -177,6 +223,13 @@ void CGLPlaneCutPlot::InitClipPlanes()
 
 void CGLPlaneCutPlot::Update(int ntime, float dt, bool breset)
 {
+	// the nodal values may have changed, so we can't reuse anything
+	if (breset)
+	{
+		m_key.mesh = nullptr;
+		m_cache.clear();
+	}
+
 	UpdateSlice();
 }
 
@@ -420,30 +473,18 @@ void CGLPlaneCutPlot::RenderMesh()
 
 	Post::FEState& state = *ps->CurrentState();
 
-	// repeat over all elements
-	for (i=0; i<pm->Elements(); ++i)
+	// repeat over all elements that are cut by the plane
+	for (i=0; i<m_slice.Elements(); ++i)
 	{
-		// render only when visible
-		FEElement_& el = pm->ElementRef(i);
+		GLSlice::ELEM& ce = m_slice.Element(i);
+		FEElement_& el = pm->ElementRef(ce.elem);
 		FEMaterial* pmat = ps->GetMaterial(el.m_MatID);
-		if ((el.m_ntag > 0) && (pmat->bmesh) && (pmat->bvisible || m_bcut_hidden) && (pmat->bclip))
+		if ((pmat->bmesh) && (pmat->bvisible || m_bcut_hidden) && (pmat->bclip))
 		{
-			switch (el.Type())
-			{
-			case FE_HEX8   : nt = HEX_NT; break;
-			case FE_HEX20  : nt = HEX_NT; break;
-			case FE_HEX27  : nt = HEX_NT; break;
-			case FE_PENTA6 : nt = PEN_NT; break;
-            case FE_PENTA15: nt = PEN_NT; break;
-            case FE_TET4   : nt = TET_NT; break;
-            case FE_TET5   : nt = TET_NT; break;
-			case FE_TET10  : nt = TET_NT; break;
-			case FE_TET15  : nt = TET_NT; break;
-			case FE_TET20  : nt = TET_NT; break;
-			}
+			nt = ElementCorners(el);
 
 			// calculate the case of the element
-			ncase = el.m_ntag;
+			ncase = ce.ncase;
 
 			// get the nodal values
 			for (k=0; k<8; ++k)
@@ -583,6 +624,177 @@ void CGLPlaneCutPlot::RenderOutline()
 	glPopAttrib();
 }
 
+//-----------------------------------------------------------------------------
+bool CGLPlaneCutPlot::INDEX_KEY::operator == (const INDEX_KEY& k) const
+{
+	return ((mesh == k.mesh) && (nrev == k.nrev) && (ntime == k.ntime) && (dt == k.dt) &&
+		    (ndisp == k.ndisp) && (disp == k.disp) && (norm == k.norm));
+}
+
+//-----------------------------------------------------------------------------
+void CGLPlaneCutPlot::SlabIndex::Clear()
+{
+	m_item.clear();
+	m_min.clear();
+	m_max.clear();
+	m_off.clear();
+	m_bin.clear();
+	m_d0 = m_scale = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// The number of buckets is chosen so that for a reasonably uniform mesh each item
+// spans only a few buckets, while a bucket holds not much more than the items in
+// a single layer of elements.
+void CGLPlaneCutPlot::SlabIndex::Build(std::vector<int>& item, std::vector<float>& dmin, std::vector<float>& dmax)
+{
+	Clear();
+	m_item.swap(item);
+	m_min.swap(dmin);
+	m_max.swap(dmax);
+
+	int N = (int)m_item.size();
+	if (N == 0) return;
+
+	// get the total range
+	double d0 = m_min[0], d1 = m_max[0];
+	for (int i = 1; i < N; ++i)
+	{
+		if (m_min[i] < d0) d0 = m_min[i];
+		if (m_max[i] > d1) d1 = m_max[i];
+	}
+
+	// pad the extents a little, so that float round-off does not drop any items
+	double tol = 1e-5*(d1 - d0);
+	if (tol == 0.0) tol = 1e-5*(fabs(d0) > 1.0 ? fabs(d0) : 1.0);
+	for (int i = 0; i < N; ++i)
+	{
+		m_min[i] -= (float)tol;
+		m_max[i] += (float)tol;
+	}
+	d0 -= 2.0*tol;
+	d1 += 2.0*tol;
+
+	int K = (int)(2.0*pow((double)N, 1.0 / 3.0));
+	if (K < 1) K = 1;
+	if (K > 4096) K = 4096;
+
+	m_d0 = d0;
+	m_scale = K / (d1 - d0);
+
+	auto bucket = [=](double d) {
+		int b = (int)((d - d0)*m_scale);
+		return (b < 0 ? 0 : (b >= K ? K - 1 : b));
+	};
+
+	// count the items in each bucket
+	m_off.assign(K + 1, 0);
+	for (int i = 0; i < N; ++i)
+	{
+		int b0 = bucket(m_min[i]);
+		int b1 = bucket(m_max[i]);
+		for (int b = b0; b <= b1; ++b) m_off[b + 1]++;
+	}
+	for (int b = 0; b < K; ++b) m_off[b + 1] += m_off[b];
+
+	// fill the buckets
+	m_bin.resize(m_off[K]);
+	std::vector<int> pos(m_off.begin(), m_off.end() - 1);
+	for (int i = 0; i < N; ++i)
+	{
+		int b0 = bucket(m_min[i]);
+		int b1 = bucket(m_max[i]);
+		for (int b = b0; b <= b1; ++b) m_bin[pos[b]++] = i;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void CGLPlaneCutPlot::SlabIndex::Find(double ref, std::vector<int>& items) const
+{
+	items.clear();
+	int K = (int)m_off.size() - 1;
+	if (K < 1) return;
+
+	double t = (ref - m_d0)*m_scale;
+	if ((t < 0.0) || (t > K)) return;
+	int b = (int)t;
+	if (b >= K) b = K - 1;
+
+	for (int j = m_off[b]; j < m_off[b + 1]; ++j)
+	{
+		int i = m_bin[j];
+		if ((m_min[i] <= ref) && (m_max[i] >= ref)) items.push_back(m_item[i]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// (Re)build the slab indices when the geometry or the plane orientation changed.
+// Moving the plane along its normal does not require a rebuild.
+void CGLPlaneCutPlot::UpdateIndex(FEPostMesh* pm, const INDEX_KEY& key)
+{
+	if (key == m_key) return;
+	m_key = key;
+
+	const vec3d& norm = key.norm;
+
+	// solid elements
+	std::vector<int> item;
+	item.reserve(pm->Elements());
+	for (int i = 0; i < pm->Elements(); ++i)
+	{
+		FEElement_& el = pm->ElementRef(i);
+		if (el.IsSolid() && ElementCorners(el)) item.push_back(i);
+	}
+
+	int NE = (int)item.size();
+	std::vector<float> dmin(NE), dmax(NE);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < NE; ++i)
+	{
+		FEElement_& el = pm->ElementRef(item[i]);
+		const int* nt = ElementCorners(el);
+		double d0 = 0.0, d1 = 0.0;
+		for (int k = 0; k < 8; ++k)
+		{
+			vec3d r = to_vec3f(pm->Node(el.m_node[nt[k]]).r);
+			double d = norm*r;
+			if ((k == 0) || (d < d0)) d0 = d;
+			if ((k == 0) || (d > d1)) d1 = d;
+		}
+		dmin[i] = (float)d0;
+		dmax[i] = (float)d1;
+	}
+	m_elemIndex.Build(item, dmin, dmax);
+
+	// surface faces
+	item.clear();
+	for (int i = 0; i < pm->Faces(); ++i)
+	{
+		if (FaceCorners(pm->Face(i))) item.push_back(i);
+	}
+
+	int NF = (int)item.size();
+	dmin.resize(NF);
+	dmax.resize(NF);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < NF; ++i)
+	{
+		FEFace& face = pm->Face(item[i]);
+		const int* nt = FaceCorners(face);
+		double d0 = 0.0, d1 = 0.0;
+		for (int k = 0; k < 4; ++k)
+		{
+			vec3d r = to_vec3f(pm->Node(face.n[nt[k]]).r);
+			double d = norm*r;
+			if ((k == 0) || (d < d0)) d0 = d;
+			if ((k == 0) || (d > d1)) d1 = d;
+		}
+		dmin[i] = (float)d0;
+		dmax[i] = (float)d1;
+	}
+	m_faceIndex.Build(item, dmin, dmax);
+}
+
 //-----------------------------------------------------------------------------
 void CGLPlaneCutPlot::UpdateSlice()
 {
@@ -604,341 +816,394 @@ void CGLPlaneCutPlot::UpdateSlice()
 	FEPostModel* ps = mdl->GetFEModel();
 	FEPostMesh* pm = mdl->GetActiveMesh();
 
-	m_slice.Clear();
-
 	Post::FEState& state = *ps->CurrentState();
 
-	// loop over all domains
-	for (int n = 0; n < pm->Domains(); ++n)
+	// make sure the slab indices are up to date
+	CGLDisplacementMap* dispMap = mdl->GetDisplacementMap();
+	INDEX_KEY key;
+	key.mesh  = pm;
+	key.nrev  = pm->Revision();
+	key.ntime = ps->CurrentTimeIndex();
+	key.dt    = ps->CurrentTime() - ps->GetTimeValue(key.ntime);
+	key.ndisp = ps->GetDisplacementField();
+	key.disp  = ((dispMap && dispMap->IsActive()) ? dispMap->GetScale() : 0.f);
+	key.norm  = norm;
+	UpdateIndex(pm, key);
+
+	// find the elements and faces that may straddle the plane
+	std::vector<int> elems, faces;
+	m_elemIndex.Find(ref, elems);
+	m_faceIndex.Find(ref, faces);
+
+	// only keep the ones that are cut by this plane
+	unsigned int nhash = 2166136261u;
+	int ne = 0;
+	for (int i = 0; i < (int)elems.size(); ++i)
 	{
-		FEDomain& dom = pm->Domain(n);
-		int matId = dom.GetMatID();
+		FEElement_& el = pm->ElementRef(elems[i]);
+		int matId = el.m_MatID;
+		if ((matId >= 0) && (matId < ps->Materials()) && (el.IsVisible() || m_bcut_hidden))
+		{
+			FEMaterial* pmat = ps->GetMaterial(matId);
+			if ((pmat->bvisible || m_bcut_hidden) && pmat->bclip)
+			{
+				elems[ne++] = elems[i];
+				nhash = (nhash ^ (unsigned int)(2*elems[i] + (el.IsActive() ? 1 : 0))) * 16777619u;
+			}
+		}
+	}
+	elems.resize(ne);
+
+	int nf = 0;
+	for (int i = 0; i < (int)faces.size(); ++i)
+	{
+		FEFace& face = pm->Face(faces[i]);
+		FEElement& el = pm->Element(face.m_elem[0].eid);
+		int matId = el.m_MatID;
 		if ((matId >= 0) && (matId < ps->Materials()))
 		{
 			FEMaterial* pmat = ps->GetMaterial(matId);
 			if ((pmat->bvisible || m_bcut_hidden) && pmat->bclip)
 			{
-				AddDomain(pm, n);
+				faces[nf++] = faces[i];
+				nhash = (nhash ^ (unsigned int)faces[i]) * 16777619u;
 			}
 		}
 	}
+	faces.resize(nf);
 
-	AddFaces(pm);
-}
+	// see if we computed this slice before
+	int ndivs = mdl->GetSubDivisions();
+	for (int i = (int)m_cache.size() - 1; i >= 0; --i)
+	{
+		SLICE_CACHE& c = m_cache[i];
+		if ((c.key == key) && (c.ref == ref) && (c.nfield == state.m_nField) &&
+			(c.ndivs == ndivs) && (c.bcut == m_bcut_hidden) && (c.nhash == nhash))
+		{
+			m_slice = c.slice;
 
-void CGLPlaneCutPlot::AddDomain(FEPostMesh* pm, int n)
-{
-	float ev[8];
-	vec3d ex[8];
-	int	nf[8];
-	EDGE edge[15];
-	int en[8];
-	int	rf[3];
+			// move it to the back so it's evicted last
+			if (i != (int)m_cache.size() - 1)
+			{
+				SLICE_CACHE tmp = c;
+				m_cache.erase(m_cache.begin() + i);
+				m_cache.push_back(tmp);
+			}
+			return;
+		}
+	}
 
-	FEDomain& dom = pm->Domain(n);
+	m_slice.Clear();
+	AddElements(pm, elems, norm, ref);
+	AddFaces(pm, faces, norm, ref);
 
-	// get the plane equations
-	GLdouble a[4];
-	GetNormalizedEquations(a);
+	// store it in the cache
+	if (m_slice.Faces() <= MAX_CACHED_FACES)
+	{
+		int nfaces = m_slice.Faces();
+		for (int i = 0; i < (int)m_cache.size(); ++i) nfaces += m_cache[i].slice.Faces();
+		while (!m_cache.empty() && ((m_cache.size() >= MAX_CACHED_SLICES) || (nfaces > MAX_CACHED_FACES)))
+		{
+			nfaces -= m_cache[0].slice.Faces();
+			m_cache.erase(m_cache.begin());
+		}
 
-	// set the plane normal
-	vec3d norm((float)a[0], (float)a[1], (float)a[2]);
+		SLICE_CACHE c;
+		c.key = key;
+		c.ref = ref;
+		c.nfield = state.m_nField;
+		c.ndivs = ndivs;
+		c.bcut = m_bcut_hidden;
+		c.nhash = nhash;
+		c.slice = m_slice;
+		m_cache.push_back(c);
+	}
+}
 
-	double ref = -a[3];
+//-----------------------------------------------------------------------------
+// Slice the elements in parallel. Each block of elements writes to its own list
+// so that the final order of the faces does not depend on the thread scheduling.
+void CGLPlaneCutPlot::AddElements(FEPostMesh* pm, const std::vector<int>& elems, const vec3d& norm, double ref)
+{
+	int N = (int)elems.size();
+	if (N == 0) return;
 
-	CGLModel* mdl = GetModel();
-	int ndivs = mdl->GetSubDivisions();
+	int ndivs = GetModel()->GetSubDivisions();
 
-	FEPostModel* ps = mdl->GetFEModel();
-	Post::FEState& state = *ps->CurrentState();
+	int NB = (N < 256 ? N : 256);
+	std::vector< std::vector<GLSlice::FACE> > faceList(NB);
+	std::vector< std::vector<GLSlice::ELEM> > elemList(NB);
 
-	// repeat over all elements
-	for (int i = 0; i < dom.Elements(); ++i)
+#pragma omp parallel for schedule(dynamic)
+	for (int b = 0; b < NB; ++b)
 	{
-		// render only when visible
-		FEElement_& el = dom.Element(i);
-		if ((el.IsVisible() || m_bcut_hidden) && el.IsSolid())
+		int n0 = (int)(((long long)N*b) / NB);
+		int n1 = (int)(((long long)N*(b + 1)) / NB);
+		for (int i = n0; i < n1; ++i)
 		{
-			const int *nt;
-			switch (el.Type())
+			FEElement_& el = pm->ElementRef(elems[i]);
+			int ncase = SliceElement(pm, el, norm, ref, ndivs, faceList[b]);
+			if ((ncase != 0) && (ncase != 255))
 			{
-			case FE_HEX8: nt = HEX_NT; break;
-			case FE_HEX20: nt = HEX_NT; break;
-			case FE_HEX27: nt = HEX_NT; break;
-			case FE_PENTA6: nt = PEN_NT; break;
-			case FE_PENTA15: nt = PEN_NT; break;
-			case FE_TET4: nt = TET_NT; break;
-			case FE_TET5: nt = TET_NT; break;
-			case FE_TET10: nt = TET_NT; break;
-			case FE_TET15: nt = TET_NT; break;
-			case FE_TET20: nt = TET_NT; break;
-			case FE_PYRA5: nt = PYR_NT; break;
+				GLSlice::ELEM e = { elems[i], ncase };
+				elemList[b].push_back(e);
 			}
+		}
+	}
 
-			// get the nodal values
-			for (int k = 0; k < 8; ++k)
-			{
-				FENode& node = pm->Node(el.m_node[nt[k]]);
-				nf[k] = (node.IsExterior() ? 1 : 0);
-				ex[k] = to_vec3f(node.r);
-				en[k] = el.m_node[nt[k]];
-				ev[k] = state.m_NODE[el.m_node[nt[k]]].m_val;
-			}
+	for (int b = 0; b < NB; ++b)
+	{
+		for (GLSlice::FACE& f : faceList[b]) m_slice.AddFace(f);
+		for (GLSlice::ELEM& e : elemList[b]) m_slice.AddElement(e);
+	}
+}
 
-			// calculate the case of the element
-			int ncase = 0;
-			for (int k = 0; k < 8; ++k)
-				if (norm*ex[k] >= ref) ncase |= (1 << k);
+//-----------------------------------------------------------------------------
+// Calculate the slice faces of an element and returns the element's case
+int CGLPlaneCutPlot::SliceElement(FEPostMesh* pm, FEElement_& el, const vec3d& norm, double ref, int ndivs, std::vector<GLSlice::FACE>& faceList)
+{
+	float ev[8];
+	vec3d ex[8];
 
-			el.m_ntag = ncase;
+	Post::FEState& state = *GetModel()->GetFEModel()->CurrentState();
 
-			if ((ndivs <= 1) || (el.Shape() != ELEM_HEX))
-			{
-				// loop over faces
-				int* pf = LUT[ncase];
-				int ne = 0;
-				for (int l = 0; l < 5; l++)
-				{
-					if (*pf == -1) break;
+	const int *nt = ElementCorners(el);
+	if (nt == nullptr) return 0;
 
-					// calculate nodal positions
-					vec3d r[3];
-					float tex[3], w1, w2, w;
-					for (int k = 0; k < 3; k++)
-					{
-						int n1 = ET_HEX[pf[k]][0];
-						int n2 = ET_HEX[pf[k]][1];
+	// get the nodal values
+	for (int k = 0; k < 8; ++k)
+	{
+		FENode& node = pm->Node(el.m_node[nt[k]]);
+		ex[k] = to_vec3f(node.r);
+		ev[k] = state.m_NODE[el.m_node[nt[k]]].m_val;
+	}
 
-						w1 = norm * ex[n1];
-						w2 = norm * ex[n2];
+	// calculate the case of the element
+	int ncase = 0;
+	for (int k = 0; k < 8; ++k)
+		if (norm*ex[k] >= ref) ncase |= (1 << k);
 
-						if (w2 != w1)
-							w = (ref - w1) / (w2 - w1);
-						else
-							w = 0.f;
+	if ((ndivs <= 1) || (el.Shape() != ELEM_HEX))
+	{
+		// loop over faces
+		int* pf = LUT[ncase];
+		for (int l = 0; l < 5; l++)
+		{
+			if (*pf == -1) break;
 
-						float v = ev[n1] * (1 - w) + ev[n2] * w;
+			// calculate nodal positions
+			vec3d r[3];
+			float tex[3], w1, w2, w;
+			for (int k = 0; k < 3; k++)
+			{
+				int n1 = ET_HEX[pf[k]][0];
+				int n2 = ET_HEX[pf[k]][1];
 
-						r[k] = ex[n1] * (1 - w) + ex[n2] * w;
-						tex[k] = v;
-						rf[k] = ((nf[n1] == 1) && (nf[n2] == 1) ? 1 : 0);
-					}
+				w1 = norm * ex[n1];
+				w2 = norm * ex[n2];
 
-					GLSlice::FACE face;
-					face.mat = n;
-					face.norm = norm;
-					face.r[0] = r[0];
-					face.r[1] = r[1];
-					face.r[2] = r[2];
-					face.tex[0] = tex[0];
-					face.tex[1] = tex[1];
-					face.tex[2] = tex[2];
-					face.bactive = el.IsActive();
+				if (w2 != w1)
+					w = (ref - w1) / (w2 - w1);
+				else
+					w = 0.f;
 
-					m_slice.AddFace(face);
+				float v = ev[n1] * (1 - w) + ev[n2] * w;
 
-					pf += 3;
-				}
+				r[k] = ex[n1] * (1 - w) + ex[n2] * w;
+				tex[k] = v;
 			}
-			else
-			{
-				for (int ix = 0; ix < ndivs; ++ix)
-				{
-					double wr0 = -1.0 + 2.0*ix / ndivs;
-					double wr1 = -1.0 + 2.0*(ix + 1) / ndivs;
-					for (int iy = 0; iy < ndivs; ++iy)
-					{
-						double ws0 = -1.0 + 2.0*iy / ndivs;
-						double ws1 = -1.0 + 2.0*(iy + 1) / ndivs;
-						for (int iz = 0; iz < ndivs; ++iz)
-						{
-							double wt0 = -1.0 + 2.0*iz / ndivs;
-							double wt1 = -1.0 + 2.0*(iz + 1) / ndivs;
-
-							double H[8][8];
-							HEX8::shape(H[0], wr0, ws0, wt0);
-							HEX8::shape(H[1], wr1, ws0, wt0);
-							HEX8::shape(H[2], wr1, ws1, wt0);
-							HEX8::shape(H[3], wr0, ws1, wt0);
-							HEX8::shape(H[4], wr0, ws0, wt1);
-							HEX8::shape(H[5], wr1, ws0, wt1);
-							HEX8::shape(H[6], wr1, ws1, wt1);
-							HEX8::shape(H[7], wr0, ws1, wt1);
-
-							vec3d x[8];
-							float v[8];
-							for (int kk = 0; kk < 8; ++kk)
-							{
-								double* h = H[kk];
-								x[kk] = vec3d(0, 0, 0);
-								v[kk] = 0.0;
-								for (int jj = 0; jj < 8; ++jj)
-								{
-									x[kk] += ex[jj] * h[jj];
-									v[kk] += ev[jj] * h[jj];
-								}
-							}																					
-
-							// calculate the case of the element
-							int ncase = 0;
-							for (int k = 0; k < 8; ++k)
-								if (norm*x[k] >= ref) ncase |= (1 << k);
-
-							// loop over faces
-							int* pf = LUT[ncase];
-							int ne = 0;
-							for (int l = 0; l < 5; l++)
-							{
-								if (*pf == -1) break;
-
-								// calculate nodal positions
-								vec3d r[3];
-								float tex[3], w1, w2, w;
-								for (int k = 0; k < 3; k++)
-								{
-									int n1 = ET_HEX[pf[k]][0];
-									int n2 = ET_HEX[pf[k]][1];
-
-									w1 = norm * x[n1];
-									w2 = norm * x[n2];
-
-									if (w2 != w1)
-										w = (ref - w1) / (w2 - w1);
-									else
-										w = 0.f;
-
-									float f = v[n1] * (1 - w) + v[n2] * w;
-
-									r[k] = x[n1] * (1 - w) + x[n2] * w;
-									tex[k] = f;
-								}
-
-								GLSlice::FACE face;
-								face.mat = n;
-								face.norm = norm;
-								face.r[0] = r[0];
-								face.r[1] = r[1];
-								face.r[2] = r[2];
-								face.tex[0] = tex[0];
-								face.tex[1] = tex[1];
-								face.tex[2] = tex[2];
-								face.bactive = el.IsActive();
-
-								m_slice.AddFace(face);
-
-								pf += 3;
-							}
-						}
-					}
-				}
-			}
-		}
-	}
-}
-
-void CGLPlaneCutPlot::AddFaces(FEPostMesh* pm)
-{
-	float ev[8];
-	vec3d ex[8];
-	int	nf[8];
-	EDGE edge[15];
-	int en[8];
-	int	rf[3];
-	CGLModel* mdl = GetModel();
-	FEPostModel* ps = mdl->GetFEModel();
-	Post::FEState& state = *ps->CurrentState();
 
-	// get the plane equations
-	GLdouble a[4];
-	GetNormalizedEquations(a);
+			GLSlice::FACE face;
+			face.mat = el.m_MatID;
+			face.norm = norm;
+			face.r[0] = r[0];
+			face.r[1] = r[1];
+			face.r[2] = r[2];
+			face.tex[0] = tex[0];
+			face.tex[1] = tex[1];
+			face.tex[2] = tex[2];
+			face.bactive = el.IsActive();
 
-	// set the plane normal
-	vec3d norm((float)a[0], (float)a[1], (float)a[2]);
+			faceList.push_back(face);
 
-	double ref = -a[3];
-	// loop over faces to determine edges
-	for (int i = 0; i < pm->Faces(); ++i)
+			pf += 3;
+		}
+	}
+	else
 	{
-		FEFace& face = pm->Face(i);
-
-		int elemId = face.m_elem[0].eid;
-		FEElement& el = pm->Element(elemId);
-		int pid = el.m_MatID;
-		if (pid >= 0)
+		for (int ix = 0; ix < ndivs; ++ix)
 		{
-			FEDomain& dom = pm->Domain(pid);
-			int matId = dom.GetMatID();
-			if ((matId >= 0) && (matId < ps->Materials()))
+			double wr0 = -1.0 + 2.0*ix / ndivs;
+			double wr1 = -1.0 + 2.0*(ix + 1) / ndivs;
+			for (int iy = 0; iy < ndivs; ++iy)
 			{
-				FEMaterial* pmat = ps->GetMaterial(matId);
-				if ((pmat->bvisible || m_bcut_hidden) && pmat->bclip)
+				double ws0 = -1.0 + 2.0*iy / ndivs;
+				double ws1 = -1.0 + 2.0*(iy + 1) / ndivs;
+				for (int iz = 0; iz < ndivs; ++iz)
 				{
-					const int *nt = nullptr;
-					switch (face.Type())
-					{
-					case FE_FACE_TRI3 : nt = TRI_NT; break;
-					case FE_FACE_TRI6 : nt = TRI_NT; break;
-					case FE_FACE_TRI7 : nt = TRI_NT; break;
-					case FE_FACE_TRI10: nt = TRI_NT; break;
-					case FE_FACE_QUAD4: nt = QUAD_NT; break;
-					case FE_FACE_QUAD8: nt = QUAD_NT; break;
-					case FE_FACE_QUAD9: nt = QUAD_NT; break;
-					}
-
-					// get the nodal values
-					for (int k = 0; k<4; ++k)
+					double wt0 = -1.0 + 2.0*iz / ndivs;
+					double wt1 = -1.0 + 2.0*(iz + 1) / ndivs;
+
+					double H[8][8];
+					HEX8::shape(H[0], wr0, ws0, wt0);
+					HEX8::shape(H[1], wr1, ws0, wt0);
+					HEX8::shape(H[2], wr1, ws1, wt0);
+					HEX8::shape(H[3], wr0, ws1, wt0);
+					HEX8::shape(H[4], wr0, ws0, wt1);
+					HEX8::shape(H[5], wr1, ws0, wt1);
+					HEX8::shape(H[6], wr1, ws1, wt1);
+					HEX8::shape(H[7], wr0, ws1, wt1);
+
+					vec3d x[8];
+					float v[8];
+					for (int kk = 0; kk < 8; ++kk)
 					{
-						FENode& node = pm->Node(face.n[nt[k]]);
-						ex[k] = to_vec3f(node.r);
-						en[k] = el.m_node[nt[k]];
-						ev[k] = state.m_NODE[el.m_node[nt[k]]].m_val;
+						double* h = H[kk];
+						x[kk] = vec3d(0, 0, 0);
+						v[kk] = 0.0;
+						for (int jj = 0; jj < 8; ++jj)
+						{
+							x[kk] += ex[jj] * h[jj];
+							v[kk] += ev[jj] * h[jj];
+						}
 					}
 
-					// calculate the case of the face
-					int ncase = 0;
-					for (int k = 0; k<4; ++k)
-						if (norm*ex[k] >= ref) ncase |= (1 << k);
+					// calculate the case of the sub-element
+					int nsub = 0;
+					for (int k = 0; k < 8; ++k)
+						if (norm*x[k] >= ref) nsub |= (1 << k);
 
 					// loop over faces
-					int* pf = LUT2D[ncase];
-					int ne = 0;
-					for (int l = 0; l < 2; l++)
+					int* pf = LUT[nsub];
+					for (int l = 0; l < 5; l++)
 					{
 						if (*pf == -1) break;
 
 						// calculate nodal positions
-						vec3d r[2];
-						float w1, w2, w;
-						for (int k = 0; k<2; k++)
+						vec3d r[3];
+						float tex[3], w1, w2, w;
+						for (int k = 0; k < 3; k++)
 						{
-							int n1 = ET2D[pf[k]][0];
-							int n2 = ET2D[pf[k]][1];
+							int n1 = ET_HEX[pf[k]][0];
+							int n2 = ET_HEX[pf[k]][1];
 
-							w1 = norm*ex[n1];
-							w2 = norm*ex[n2];
+							w1 = norm * x[n1];
+							w2 = norm * x[n2];
 
 							if (w2 != w1)
 								w = (ref - w1) / (w2 - w1);
 							else
 								w = 0.f;
 
-							float v = ev[n1] * (1 - w) + ev[n2] * w;
+							float f = v[n1] * (1 - w) + v[n2] * w;
 
-							r[k] = ex[n1] * (1 - w) + ex[n2] * w;
+							r[k] = x[n1] * (1 - w) + x[n2] * w;
+							tex[k] = f;
 						}
 
-						// add the edge
-						GLSlice::EDGE e;
-						e.r[0] = r[0];
-						e.r[1] = r[1];
-						m_slice.AddEdge(e);
+						GLSlice::FACE face;
+						face.mat = el.m_MatID;
+						face.norm = norm;
+						face.r[0] = r[0];
+						face.r[1] = r[1];
+						face.r[2] = r[2];
+						face.tex[0] = tex[0];
+						face.tex[1] = tex[1];
+						face.tex[2] = tex[2];
+						face.bactive = el.IsActive();
 
-						pf += 2;
+						faceList.push_back(face);
+
+						pf += 3;
 					}
 				}
 			}
 		}
 	}
+
+	return ncase;
+}
+
+//-----------------------------------------------------------------------------
+// Calculate the outline edges of the slice from the surface faces
+void CGLPlaneCutPlot::AddFaces(FEPostMesh* pm, const std::vector<int>& faces, const vec3d& norm, double ref)
+{
+	int N = (int)faces.size();
+	if (N == 0) return;
+
+	int NB = (N < 256 ? N : 256);
+	std::vector< std::vector<GLSlice::EDGE> > edgeList(NB);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int b = 0; b < NB; ++b)
+	{
+		int n0 = (int)(((long long)N*b) / NB);
+		int n1 = (int)(((long long)N*(b + 1)) / NB);
+		for (int i = n0; i < n1; ++i)
+		{
+			SliceFace(pm, pm->Face(faces[i]), norm, ref, edgeList[b]);
+		}
+	}
+
+	for (int b = 0; b < NB; ++b)
+	{
+		for (GLSlice::EDGE& e : edgeList[b]) m_slice.AddEdge(e);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void CGLPlaneCutPlot::SliceFace(FEPostMesh* pm, FEFace& face, const vec3d& norm, double ref, std::vector<GLSlice::EDGE>& edgeList)
+{
+	vec3d ex[4];
+
+	const int *nt = FaceCorners(face);
+	if (nt == nullptr) return;
+
+	// get the nodal values
+	for (int k = 0; k<4; ++k)
+	{
+		FENode& node = pm->Node(face.n[nt[k]]);
+		ex[k] = to_vec3f(node.r);
+	}
+
+	// calculate the case of the face
+	int ncase = 0;
+	for (int k = 0; k<4; ++k)
+		if (norm*ex[k] >= ref) ncase |= (1 << k);
+
+	// loop over faces
+	int* pf = LUT2D[ncase];
+	for (int l = 0; l < 2; l++)
+	{
+		if (*pf == -1) break;
+
+		// calculate nodal positions
+		vec3d r[2];
+		float w1, w2, w;
+		for (int k = 0; k<2; k++)
+		{
+			int n1 = ET2D[pf[k]][0];
+			int n2 = ET2D[pf[k]][1];
+
+			w1 = norm*ex[n1];
+			w2 = norm*ex[n2];
+
+			if (w2 != w1)
+				w = (ref - w1) / (w2 - w1);
+			else
+				w = 0.f;
+
+			r[k] = ex[n1] * (1 - w) + ex[n2] * w;
+		}
+
+		// add the edge
+		GLSlice::EDGE e;
+		e.r[0] = r[0];
+		e.r[1] = r[1];
+		edgeList.push_back(e);
+
+		pf += 2;
+	}
 }
 
 //-----------------------------------------------------------------------------
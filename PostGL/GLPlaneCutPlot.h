@@ -29,9 +29,13 @@ SOFTWARE.*/
 #include <MathLib/Transform.h>
 #include <vector>
 
+class FEElement_;
+class FEFace;
+
 namespace Post {
 
 	class FEState;
+	class FEPostMesh;
 
 class CGLPlaneCutPlot : public CGLPlot  
 {
@@ -54,6 +58,13 @@ class CGLPlaneCutPlot : public CGLPlot
 			vec3d r[2];
 		};
 
+		// element that is cut by the plane
+		struct ELEM
+		{
+			int		elem;	// index into the mesh' element list
+			int		ncase;	// marching cubes case
+		};
+
 	public:
 		GLSlice(){}
 
@@ -66,11 +77,67 @@ class CGLPlaneCutPlot : public CGLPlot
 		EDGE& Edge(int i) { return m_Edge[i]; }
 		void AddEdge(EDGE& e) { m_Edge.push_back(e); }
 
-		void Clear() { m_Face.clear(); m_Edge.clear(); }
+		int Elements() const { return (int) m_Elem.size(); }
+		ELEM& Element(int i) { return m_Elem[i]; }
+		void AddElement(ELEM& e) { m_Elem.push_back(e); }
+
+		void Clear() { m_Face.clear(); m_Edge.clear(); m_Elem.clear(); }
 
 	private:
 		std::vector<FACE>	m_Face;
 		std::vector<EDGE>	m_Edge;
+		std::vector<ELEM>	m_Elem;
+	};
+
+	// Stores the extents of a list of items (elements or faces) along the plane normal
+	// in a uniform grid of buckets, so that finding the items that straddle the
+	// plane only requires visiting a single bucket.
+	class SlabIndex
+	{
+	public:
+		SlabIndex() { m_d0 = m_scale = 0.0; }
+
+		void Clear();
+
+		// build the buckets from the item extents
+		void Build(std::vector<int>& item, std::vector<float>& dmin, std::vector<float>& dmax);
+
+		// find all items whose extent contains ref
+		void Find(double ref, std::vector<int>& items) const;
+
+	private:
+		std::vector<int>	m_item;	// item IDs
+		std::vector<float>	m_min;	// min extent of item
+		std::vector<float>	m_max;	// max extent of item
+		std::vector<int>	m_off;	// offset into m_bin for each bucket
+		std::vector<int>	m_bin;	// indices into m_item, sorted by bucket
+		double	m_d0, m_scale;		// maps distance to bucket
+	};
+
+	// identifies the geometry the slab indices were built for
+	struct INDEX_KEY
+	{
+		const FEPostMesh*	mesh;
+		unsigned int		nrev;	// mesh revision
+		int					ntime;	// current state
+		float				dt;		// time offset from that state (when interpolating)
+		int					ndisp;	// displacement field
+		float				disp;	// displacement scale factor (0 when off)
+		vec3d				norm;	// plane normal
+
+		bool operator == (const INDEX_KEY& k) const;
+	};
+
+	// a previously computed slice
+	struct SLICE_CACHE
+	{
+		INDEX_KEY		key;
+		double			ref;		// plane offset
+		int				nfield;		// field that was evaluated
+		int				ndivs;		// element subdivisions
+		bool			bcut;		// cut hidden flag
+		unsigned int	nhash;		// visibility hash of the candidate items
+		GLSlice			slice;
 	};
 
 public:
@@ -111,8 +178,11 @@ protected:
 	static int GetFreePlane();
 	void UpdateSlice();
 
-	void AddDomain(FEPostMesh* pm, int n);
-	void AddFaces(FEPostMesh* pm);
+	void UpdateIndex(FEPostMesh* pm, const INDEX_KEY& key);
+	void AddElements(FEPostMesh* pm, const std::vector<int>& elems, const vec3d& norm, double ref);
+	void AddFaces(FEPostMesh* pm, const std::vector<int>& faces, const vec3d& norm, double ref);
+	int SliceElement(FEPostMesh* pm, FEElement_& el, const vec3d& norm, double ref, int ndivs, std::vector<GLSlice::FACE>& faceList);
+	void SliceFace(FEPostMesh* pm, FEFace& face, const vec3d& norm, double ref, std::vector<GLSlice::EDGE>& edgeList);
 
 public:
 	static int ClipPlanes();
@@ -143,6 +213,12 @@ protected:
 
 	GLSlice	m_slice;
 
+	INDEX_KEY	m_key;			// key of the current slab indices
+	SlabIndex	m_elemIndex;	// solid elements
+	SlabIndex	m_faceIndex;	// surface faces
+
+	std::vector<SLICE_CACHE>	m_cache;	// recently computed slices (most recent last)
+
 	int		m_nclip;								// clip plane number
 	static	std::vector<int>				m_clip;	// avaialabe clip planes
 	static	std::vector<CGLPlaneCutPlot*>	m_pcp;
@@ -66,6 +66,8 @@ CGLStreamLinePlot::CGLStreamLinePlot(CGLModel* fem) : CGLLegendPlot(fem), m_find
 	m_lastTime = 0;
 	m_lastdt = 1.f;
 
+	m_cacheKey = 0;
+
 	m_Col.SetDivisions(10);
 
 	GLLegendBar* bar = new GLLegendBar(&m_Col, 0, 0, 600, 100, GLLegendBar::HORIZONTAL);
@@ -171,13 +173,15 @@ void CGLStreamLinePlot::Update(int ntime, float dt, bool breset)
 	if (breset) { m_map.Clear(); m_rng.clear(); m_val.clear(); m_prob.clear(); }
 
 	// see if we need to revaluate the FEFindElement object
-	// We evaluate it when the plot needs to be reset, or when the model has a displacement map
+	// We build it when the plot needs to be reset, and refit it to the new
+	// nodal positions when the model has a displacement map
 	bool bdisp = mdl->HasDisplacementMap();
-	if (breset || bdisp)
+	if (breset)
 	{
 		// choose reference frame or current frame, depending on whether we have a displacement map
 		m_find.Init(bdisp ? 1 : 0);
 	}
+	else if (bdisp) m_find.Update();
 
 	if (m_map.States() == 0)
 	{
@@ -255,17 +259,22 @@ void CGLStreamLinePlot::Update(int ntime, float dt, bool breset)
 	UpdateStreamLines();
 }
 
-vec3f CGLStreamLinePlot::Velocity(const vec3f& r, bool& ok)
+vec3f CGLStreamLinePlot::Velocity(const vec3f& r, bool& ok, int& nelem)
 {
 	vec3f v(0.f, 0.f, 0.f);
 	vec3f ve[FEElement::MAX_NODES];
 	FEPostMesh& mesh = *GetModel()->GetActiveMesh();
-	int nelem;
 	double q[3];
-	if (m_find.FindElement(r, nelem, q))
+
+	// find the element, starting with the element of the previous point
+	int nfound = -1;
+	if (m_find.FindElement(r, nfound, q, nelem) == false) nfound = -1;
+
+	nelem = nfound;
+	if (nfound >= 0)
 	{
 		ok = true;
-		FEElement_& el = mesh.ElementRef(nelem);
+		FEElement_& el = mesh.ElementRef(nfound);
 
 		int ne = el.Nodes();
 		for (int i=0; i<ne; ++i) ve[i] = m_val[el.m_node[i]];
@@ -277,6 +286,14 @@ vec3f CGLStreamLinePlot::Velocity(const vec3f& r, bool& ok)
 	return v;
 }
 
+// hash of a float array, used to see if cached stream lines are still valid
+static unsigned int hash_floats(const float* d, size_t n, unsigned int h)
+{
+	const unsigned int* u = (const unsigned int*)d;
+	for (size_t i = 0; i < n; ++i) { h ^= u[i]; h *= 16777619u; }
+	return h;
+}
+
 void CGLStreamLinePlot::UpdateStreamLines()
 {
 	// clear current stream lines
@@ -304,107 +321,133 @@ void CGLStreamLinePlot::UpdateStreamLines()
 	float R = box.GetMaxExtent();
 	float maxStep = m_inc*R;
 
+	// The stream lines only depend on the velocity field, the nodal positions and 
+	// the step size, so the stream lines of seeds that were already integrated
+	// can be reused if none of these changed.
+	unsigned int key = 2166136261u;
+	if (m_val.empty() == false) key = hash_floats(&m_val[0].x, 3 * m_val.size(), key);
+	for (int i = 0; i < mesh.Nodes(); ++i)
+	{
+		vec3f r = to_vec3f(mesh.Node(i).r);
+		key = hash_floats(&r.x, 3, key);
+	}
+	key = hash_floats(&m_inc, 1, key);
+
+	int NF = mesh.Faces();
+	if ((key != m_cacheKey) || ((int)m_cache.size() != NF))
+	{
+		m_cache.assign(NF, StreamLine());
+		m_cached.assign(NF, 0);
+		m_cacheKey = key;
+	}
+
 	// tag all elements
 	mesh.TagAllElements(0);
 
-	// use the same seed
-	srand(0);
-
-	// loop over all the surface facts
-	double q[3];
-	int NF = mesh.Faces();
-#pragma omp parallel for shared (NF)
-	for (int i=0; i<NF; ++i)
+	// find the seeds
+	vector<int> seeds;
+	for (int i = 0; i < NF; ++i)
 	{
 		FEFace& f = mesh.Face(i);
 
 		// evaluate the average velocity at this face
 		int nf = f.Nodes();
 		vec3f vf(0.f, 0.f, 0.f);
-		for (int j=0; j<nf; ++j) vf += m_val[f.n[j]];
+		for (int j = 0; j<nf; ++j) vf += m_val[f.n[j]];
 		vf /= nf;
 
 		// see if this is a valid candidate for a seed
 		vec3f fn = f.m_fn;
-		if ((fn*vf < -vtol) && (m_prob[i] <= m_density))
+		if ((fn*vf < -vtol) && (m_prob[i] <= m_density)) seeds.push_back(i);
+	}
+
+	// integrate the stream lines that are not cached yet
+	int NS = (int)seeds.size();
+#pragma omp parallel for schedule(dynamic, 16)
+	for (int n = 0; n < NS; ++n)
+	{
+		int i = seeds[n];
+		if (m_cached[i]) continue;
+
+		FEFace& f = mesh.Face(i);
+
+		// evaluate the average velocity at this face
+		int nf = f.Nodes();
+		vec3f vf(0.f, 0.f, 0.f);
+		for (int j=0; j<nf; ++j) vf += m_val[f.n[j]];
+		vf /= nf;
+
+		// calculate the face center, this will be the seed
+		// NOTE: We are using reference coordinates, therefore we assume that te mesh is not deforming!!
+		vec3f cf(0.f, 0.f, 0.f);
+		for (int j = 0; j<nf; ++j) cf += to_vec3f(mesh.Node(f.n[j]).r);
+		cf /= nf;
+
+		// project the seed into the adjacent solid element
+		double q[3];
+		int nelem = f.m_elem[0].eid;
+		FEElement_* el = &mesh.ElementRef(nelem);
+		el->m_ntag = 1;
+		ProjectInsideReferenceElement(mesh, *el, cf, q);
+
+		double V = vf.Length();
+
+		// now, propagate the seed and form the stream line
+		StreamLine& l = m_cache[i];
+		l.m_pt.clear();
+		l.Add(cf, V);
+
+		vec3f vc = vf;
+
+		bool ok;
+		do
 		{
-			// calculate the face center, this will be the seed
-			// NOTE: We are using reference coordinates, therefore we assume that te mesh is not deforming!!
-			vec3f cf(0.f, 0.f, 0.f);
-			for (int j = 0; j<nf; ++j) cf += to_vec3f(mesh.Node(f.n[j]).r);
-			cf /= nf;
-
-			// project the seed into the adjacent solid element
-			int nelem = f.m_elem[0].eid;
-			FEElement_* el = &mesh.ElementRef(nelem);
-			el->m_ntag = 1;
-			ProjectInsideReferenceElement(mesh, *el, cf, q);
-
-			double V = vf.Length();
-
-			// now, propagate the seed and form the stream line
-			StreamLine l;
-			l.Add(cf, V);
+			// make sure the velocity is not zero, otherwise we'll be stuck
+			double V = vc.Length();
+			if (V < 1e-5f) break;
 
-			vec3f vc = vf;
+			// "time" increment
+			float dt =  maxStep / V;
 
-			vec3f v[FEElement::MAX_NODES];
-			bool ok;
+			// propagate the seed
+			// RK4
+			vec3f dr(0.f, 0.f, 0.f);
 			do
 			{
-				// make sure the velocity is not zero, otherwise we'll be stuck
-				double V = vc.Length();
-				if (V < 1e-5f) break;
-
-				// "time" increment
-				float dt =  maxStep / V;
-
-				// propagate the seed
-				// Euler's method
-//				cf += vc*dt;
-
-				// RK2 method
-/*				vec3f p = cf + vc*dt;
-				vec3f vp = Velocity(p, ok);
-				if (ok == false) break;
-				cf += (vc + vp)*(dt*0.5f);
-*/
-				// RK4
-				vec3f dr(0.f, 0.f, 0.f);
-				do
-				{
-					vec3f a = vc*dt;
-					vec3f b = Velocity(cf + a*0.5f, ok)*dt; if (ok == false) break;
-					vec3f c = Velocity(cf + b*0.5f, ok)*dt; if (ok == false) break;
-					vec3f d = Velocity(cf + c     , ok)*dt; if (ok == false) break;
-
-					dr = (a + b*2.f + c*2.f + d) / 6.0;
-					float DR = dr.Length();
-					if (DR > 2.0f*maxStep) dt *= 0.5f; else break;
-				}
-				while (1);
-				if (ok == false) break;
-
-				cf += dr;
-
-				// add it to the stream line
-				l.Add(cf, V);
-
-				// if for some reason we're stuck, we'll set a max nr of points
-				if (l.Points() > MAX_POINTS) break;
-
-				// get velocity at new point
-				vc = Velocity(cf, ok);
-				if (ok == false) break;
+				vec3f a = vc*dt;
+				vec3f b = Velocity(cf + a*0.5f, ok, nelem)*dt; if (ok == false) break;
+				vec3f c = Velocity(cf + b*0.5f, ok, nelem)*dt; if (ok == false) break;
+				vec3f d = Velocity(cf + c     , ok, nelem)*dt; if (ok == false) break;
+
+				dr = (a + b*2.f + c*2.f + d) / 6.0;
+				float DR = dr.Length();
+				if (DR > 2.0f*maxStep) dt *= 0.5f; else break;
 			}
 			while (1);
+			if (ok == false) break;
 
-			if (l.Points() > 2)
-#pragma omp critical
-			{
-				m_streamLines.push_back(l);
-			}
+			cf += dr;
+
+			// add it to the stream line
+			l.Add(cf, V);
+
+			// if for some reason we're stuck, we'll set a max nr of points
+			if (l.Points() > MAX_POINTS) break;
+
+			// get velocity at new point
+			vc = Velocity(cf, ok, nelem);
+			if (ok == false) break;
 		}
+		while (1);
+
+		m_cached[i] = 1;
+	}
+
+	// collect the stream lines in seed order
+	for (int n = 0; n < NS; ++n)
+	{
+		StreamLine& l = m_cache[seeds[n]];
+		if (l.Points() > 2) m_streamLines.push_back(l);
 	}
 
 	// evaluate the color of stream lines
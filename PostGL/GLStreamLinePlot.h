@@ -111,7 +111,9 @@ public:
 
 protected:
 
-	vec3f Velocity(const vec3f& r, bool& ok);
+	// evaluate the velocity at r. On input, nelem is the element that is tried
+	// first (and its neighbors), on output it is the element that contains r.
+	vec3f Velocity(const vec3f& r, bool& ok, int& nelem);
 
 private:
 	int	m_nvec;	// vector field
@@ -135,6 +137,10 @@ private:
 	vector<StreamLine>	m_streamLines;
 	vector<float>		m_prob;
 
+	vector<StreamLine>	m_cache;	// stream line of each seed (face)
+	vector<char>		m_cached;	// stream line of seed is cached
+	unsigned int		m_cacheKey;	// hash of the data the cache depends on
+
 	FEFindElement	m_find;
 
 	int		m_rangeType;				//!< dynamic, static, or user-defined
@@ -85,6 +85,8 @@ GLTensorPlot::GLTensorPlot(CGLModel* po) : CGLLegendPlot(po)
 	m_range.ntype = RANGE_DYNAMIC;
 	m_range.valid = false;
 
+	m_glyphsValid = false;
+
 	GLLegendBar* bar = new GLLegendBar(&m_Col, 0, 0, 600, 100, GLLegendBar::HORIZONTAL);
 	bar->align(GLW_ALIGN_BOTTOM | GLW_ALIGN_HCENTER);
 	bar->copy_label(szname);
@@ -115,6 +117,7 @@ bool GLTensorPlot::UpdateData(bool bsave)
 		m_bnormalize = GetBoolValue(NORMALIZE);
 
 		m_range.ntype = GetIntValue(RANGE_TYPE);
+		m_glyphsValid = false;
 
 		if (noldcol != m_ncol)
 		{
@@ -185,6 +188,7 @@ void GLTensorPlot::Update(int ntime, float dt, bool breset)
 
 	m_lastTime = ntime;
 	m_lastDt = dt;
+	m_glyphsValid = false;
 
 	CGLModel* mdl = GetModel();
 	FEPostMesh* pm = mdl->GetActiveMesh();
@@ -413,10 +417,7 @@ void GLTensorPlot::Render(CGLContext& rc)
 	// store attributes
 	glPushAttrib(GL_LIGHTING_BIT);
 
-	// create the cylinder object
 	glEnable(GL_LIGHTING);
-	GLUquadricObj* pglyph = gluNewQuadric();
-	gluQuadricNormals(pglyph, GLU_SMOOTH);
 
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFEModel();
@@ -443,8 +444,12 @@ void GLTensorPlot::Render(CGLContext& rc)
 		glLightfv(GL_LIGHT0, GL_AMBIENT, amb);
 	}
 
+	// find the items that get a glyph
+	vector<int> items;
+	int NI = 0;
 	if (IS_ELEM_FIELD(m_ntensor))
 	{
+		NI = pm->Elements();
 		pm->TagAllElements(0);
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
@@ -466,58 +471,15 @@ void GLTensorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		float auto_scale = 1.f;
-		if (m_bautoscale)
-		{
-			float Lmax = 0.f;
-			for (int i = 0; i < pm->Elements(); ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					float L = fabs(m_val[i].l[j]);
-					if (L > Lmax) Lmax = L;
-				}
-			}
-			if (Lmax == 0.f) Lmax = 1.f;
-			auto_scale = 1.f / Lmax;
-		}
-
-		CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
-		float fmax = 1.f, fmin = 0.f;
-		if (m_ncol != Glyph_Col_Solid)
-		{
-			fmax = m_range.max;
-			fmin = m_range.min;
-		}
-
-		GetLegendBar()->SetRange(fmin, fmax);
-
-		if (fmax == fmin) fmax++;
-
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
 			FEElement_& elem = pm->ElementRef(i);
-			if ((frand() <= m_dens) && elem.m_ntag)
-			{
-				vec3d r = pm->ElementCenter(elem);
-
-				TENSOR& t = m_val[i];
-
-				if (m_ncol != Glyph_Col_Solid)
-				{
-					float w = (t.f - fmin) / (fmax - fmin);
-					GLColor c = map.map(w);
-					glColor3ub(c.r, c.g, c.b);
-				}
-
-				glTranslatef(r.x, r.y, r.z);
-				RenderGlyphs(t, scale*auto_scale, pglyph);
-				glTranslatef(-r.x, -r.y, -r.z);
-			}
+			if ((frand() <= m_dens) && elem.m_ntag) items.push_back(i);
 		}
 	}
 	else
 	{
+		NI = pm->Nodes();
 		pm->TagAllNodes(0);
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
@@ -540,61 +502,59 @@ void GLTensorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		float auto_scale = 1.f;
-		if (m_bautoscale)
-		{
-			float Lmax = 0.f;
-			for (int i = 0; i < pm->Nodes(); ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					float L = fabs(m_val[i].l[j]);
-					if (L > Lmax) Lmax = L;
-				}
-			}
-			if (Lmax == 0.f) Lmax = 1.f;
-			auto_scale = 1.f / Lmax;
-		}
-
-		CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
-		float fmax = 1.f, fmin = 0.f;
-		if (m_ncol != Glyph_Col_Solid)
+		for (int i = 0; i < pm->Nodes(); ++i)
 		{
-			fmax = m_range.max;
-			fmin = m_range.min;
+			FENode& node = pm->Node(i);
+			if ((frand() <= m_dens) && node.m_ntag) items.push_back(i);
 		}
-		GetLegendBar()->SetRange(fmin, fmax);
-
-		if (fmax == fmin) fmax++;
-
-		if (m_nglyph == Glyph_Line) glDisable(GL_LIGHTING);
-
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
+	}
 
-		for (int i = 0; i < pm->Nodes(); ++i)
+	float auto_scale = 1.f;
+	if (m_bautoscale)
+	{
+		float Lmax = 0.f;
+		for (int i = 0; i < NI; ++i)
 		{
-			FENode& node = pm->Node(i);
-			if ((frand() <= m_dens) && node.m_ntag)
+			for (int j = 0; j < 3; ++j)
 			{
-				vec3d r = node.r;
-
-				TENSOR& t = m_val[i];
-
-				if (m_ncol != Glyph_Col_Solid)
-				{
-					float w = (t.f  - fmin)/ (fmax - fmin);
-					GLColor c = map.map(w);
-					glColor3ub(c.r, c.g, c.b);
-				}
-
-				glTranslatef(r.x, r.y, r.z);
-				RenderGlyphs(t, scale*auto_scale, pglyph);
-				glTranslatef(-r.x, -r.y, -r.z);
+				float L = fabs(m_val[i].l[j]);
+				if (L > Lmax) Lmax = L;
 			}
 		}
+		if (Lmax == 0.f) Lmax = 1.f;
+		auto_scale = 1.f / Lmax;
 	}
 
-	gluDeleteQuadric(pglyph);
+	float fmax = 1.f, fmin = 0.f;
+	if (m_ncol != Glyph_Col_Solid)
+	{
+		fmax = m_range.max;
+		fmin = m_range.min;
+	}
+
+	GetLegendBar()->SetRange(fmin, fmax);
+
+	if (fmax == fmin) fmax++;
+
+	// the glyphs are only rebuilt when something changed
+	GLYPH_KEY key;
+	key.nglyph = m_nglyph;
+	key.ncol = m_ncol;
+	key.ncolmap = m_Col.GetColorMap();
+	key.gcl = m_gcl;
+	key.bnorm = m_bnormalize;
+	key.scale = scale*auto_scale;
+	key.fmin = fmin;
+	key.fmax = fmax;
+	if ((m_glyphsValid == false) || (key != m_glyphKey) || (items != m_glyphItems))
+	{
+		m_glyphKey = key;
+		m_glyphItems = items;
+		BuildGlyphs();
+		m_glyphsValid = true;
+	}
+
+	m_glyphs.Render();
 
 	// restore attributes
 	glPopAttrib();
@@ -602,178 +562,106 @@ void GLTensorPlot::Render(CGLContext& rc)
 	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 }
 
-void GLTensorPlot::RenderGlyphs(TENSOR& t, float scale, GLUquadricObj* glyph)
+void GLTensorPlot::BuildGlyphs()
 {
+	CGLModel* mdl = GetModel();
+	FEPostMesh* pm = mdl->GetActiveMesh();
+
+	float scale = m_glyphKey.scale;
+	float fmin = m_glyphKey.fmin;
+	float fmax = m_glyphKey.fmax;
+
+	// tessellate the glyph
+	GLGlyphShape shape(m_nglyph == Glyph_Line ? GLGlyphShape::LINES : GLGlyphShape::TRIANGLES);
 	switch (m_nglyph)
 	{
-	case Glyph_Arrow : RenderArrows(t, scale, glyph); break;
-	case Glyph_Line  : RenderLines (t, scale, glyph); break;
-	case Glyph_Sphere: RenderSphere(t, scale, glyph); break;
-	case Glyph_Box   : RenderBox   (t, scale, glyph); break;
+	case Glyph_Arrow:
+		shape.AddCylinder(0.05f, 0.05f, 0.f, 0.9f, 5);
+		shape.AddCylinder(0.15f, 0.f, 0.81f, 0.2f, 10);
+		break;
+	case Glyph_Line  : shape.AddLine(1.f); break;
+	case Glyph_Sphere: shape.AddSphere(1.f, 16, 16); break;
+	case Glyph_Box   : shape.AddBox(0.5f); break;
 	}
-}
 
-void GLTensorPlot::RenderArrows(GLTensorPlot::TENSOR& t, float scale, GLUquadricObj* pglyph)
-{
-	GLColor c[3];
-	c[0] = GLColor(255, 0, 0);
-	c[1] = GLColor(0, 255, 0);
-	c[2] = GLColor(0, 0, 255);
+	// arrows and lines have a glyph for each direction
+	int ng = ((m_nglyph == Glyph_Arrow) || (m_nglyph == Glyph_Line) ? 3 : 1);
 
-	for (int i = 0; i<3; ++i)
-	{
-		glPushMatrix();
-
-		float L = (m_bnormalize ? scale : scale*t.l[i]);
-		float l0 = L*.9;
-		float l1 = L*.2;
-		float r0 = L*0.05;
-		float r1 = L*0.15;
-
-		vec3f v = t.r[i];
-		quatd q = quatd(vec3f(0,0,1), v);
-		float w = q.GetAngle();
-		if (fabs(w) > 1e-6)
-		{
-			vec3d p = q.GetVector();
-			if (p.Length() > 1e-6) glRotated(w * 180 / PI, p.x, p.y, p.z);
-		}
+	const GLColor c[3] = { GLColor(255, 0, 0), GLColor(0, 255, 0), GLColor(0, 0, 255) };
 
-		glColor3ub(c[i].r, c[i].g, c[i].b);
-		gluCylinder(pglyph, r0, r0, l0, 5, 1);
-		glTranslatef(0.f, 0.f, (float)l0*0.9f);
-		gluCylinder(pglyph, r1, 0, l1, 10, 1);
+	CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
 
-		glPopMatrix();
-	}
-}
-
-void GLTensorPlot::RenderLines(GLTensorPlot::TENSOR& t, float scale, GLUquadricObj* pglyph)
-{
-	GLColor c[3];
-	c[0] = GLColor(255, 0, 0);
-	c[1] = GLColor(0, 255, 0);
-	c[2] = GLColor(0, 0, 255);
-
-	for (int i = 0; i<3; ++i)
+	bool belem = IS_ELEM_FIELD(m_ntensor);
+	int NG = (int)m_glyphItems.size();
+	vector<GLGlyphInstance> inst(NG*ng);
+	vector<char> skip(NG*ng, 1);
+#pragma omp parallel for schedule(static)
+	for (int k = 0; k < NG; ++k)
 	{
-		glPushMatrix();
+		int i = m_glyphItems[k];
+		vec3f r = (belem ? to_vec3f(pm->ElementCenter(pm->ElementRef(i))) : to_vec3f(pm->Node(i).r));
+		TENSOR t = m_val[i];
 
-		float L = (m_bnormalize ? scale : scale*t.l[i]);
+		GLColor col = m_gcl;
+		if (m_ncol != Glyph_Col_Solid)
+		{
+			float w = (t.f - fmin) / (fmax - fmin);
+			col = map.map(w);
+		}
+		col.a = 255;
 
-		vec3f v = t.r[i];
-		quatd q = quatd(vec3f(0, 0, 1), v);
-		float w = q.GetAngle();
-		if (fabs(w) > 1e-6)
+		if (ng == 3)
 		{
-			vec3d p = q.GetVector();
-			if (p.Length() > 1e-6) glRotatef(w * 180 / PI, p.x, p.y, p.z);
+			for (int j = 0; j < 3; ++j)
+			{
+				if (t.r[j].Length() == 0.f) continue;
+				float L = (m_bnormalize ? scale : scale*t.l[j]);
+
+				GLGlyphInstance& g = inst[3 * k + j];
+				g.r = r;
+				g.c = c[j];
+				GLGlyphBatch::AlignedFrame(t.r[j], L, g.a);
+				skip[3 * k + j] = 0;
+			}
 		}
+		else
+		{
+			if (scale <= 0.f) continue;
 
-		glBegin(GL_LINES);
-		glColor3ub(c[i].r, c[i].g, c[i].b);
-		glVertex3f(0.f, 0.f, 0.f);
-		glVertex3f(0.f, 0.f, L);
-		glEnd();
+			float smax = 0.f;
+			float sx = fabs(t.l[0]); if (sx > smax) smax = sx;
+			float sy = fabs(t.l[1]); if (sy > smax) smax = sy;
+			float sz = fabs(t.l[2]); if (sz > smax) smax = sz;
+			if (smax < 1e-7f) continue;
 
-		glPopMatrix();
-	}
-}
+			if (sx < 0.1*smax) sx = 0.1f*smax;
+			if (sy < 0.1*smax) sy = 0.1f*smax;
+			if (sz < 0.1*smax) sz = 0.1f*smax;
 
-void GLTensorPlot::RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph)
-{
-	if (scale <= 0.f) return;
-
-	float smax = 0.f;
-	float sx = fabs(t.l[0]); if (sx > smax) smax = sx;
-	float sy = fabs(t.l[1]); if (sy > smax) smax = sy;
-	float sz = fabs(t.l[2]); if (sz > smax) smax = sz;
-	if (smax < 1e-7f) return;
-
-	if (sx < 0.1*smax) sx = 0.1f*smax;
-	if (sy < 0.1*smax) sy = 0.1f*smax;
-	if (sz < 0.1*smax) sz = 0.1f*smax;
-
-	glPushMatrix();
-	vec3f* e = t.r;
-	vec3f n = e[0] ^ e[1];
-	if (n*e[2] < 0) e[2] = -e[2];
-	GLfloat m[4][4] = {0};
-	m[3][3] = 1.f;
-	m[0][0] = e[0].x; m[0][1] = e[0].y; m[0][2] = e[0].z;
-	m[1][0] = e[1].x; m[1][1] = e[1].y; m[1][2] = e[1].z;
-	m[2][0] = e[2].x; m[2][1] = e[2].y; m[2][2] = e[2].z;
-	glMultMatrixf(&m[0][0]);
-
-	glScalef(scale*sx, scale*sy, scale*sz);
-	gluSphere(glyph, 1.f, 16, 16);
-	glPopMatrix();
-}
+			vec3f* e = t.r;
+			if (m_nglyph == Glyph_Sphere)
+			{
+				vec3f n = e[0] ^ e[1];
+				if (n*e[2] < 0) e[2] = -e[2];
+			}
 
-void GLTensorPlot::RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph)
-{
-	if (scale <= 0.f) return;
-
-	float smax = 0.f;
-	float sx = fabs(t.l[0]); if (sx > smax) smax = sx;
-	float sy = fabs(t.l[1]); if (sy > smax) smax = sy;
-	float sz = fabs(t.l[2]); if (sz > smax) smax = sz;
-	if (smax < 1e-7f) return;
-
-	if (sx < 0.1*smax) sx = 0.1f*smax;
-	if (sy < 0.1*smax) sy = 0.1f*smax;
-	if (sz < 0.1*smax) sz = 0.1f*smax;
-
-	glPushMatrix();
-	vec3f* e = t.r;
-	GLfloat m[4][4] = { 0 };
-	m[3][3] = 1.f;
-	m[0][0] = e[0].x; m[0][1] = e[0].y; m[0][2] = e[0].z;
-	m[1][0] = e[1].x; m[1][1] = e[1].y; m[1][2] = e[1].z;
-	m[2][0] = e[2].x; m[2][1] = e[2].y; m[2][2] = e[2].z;
-	glMultMatrixf(&m[0][0]);
-
-	glScalef(scale*sx, scale*sy, scale*sz);
-	glBegin(GL_QUADS);
+			GLGlyphInstance& g = inst[k];
+			g.r = r;
+			g.c = col;
+			g.a[0] = e[0] * (scale*sx);
+			g.a[1] = e[1] * (scale*sy);
+			g.a[2] = e[2] * (scale*sz);
+			skip[k] = 0;
+		}
+	}
+
+	// remove the empty glyphs
+	int m = 0;
+	for (int k = 0; k < NG*ng; ++k)
 	{
-		float r0 = 0.5f;
-		glNormal3d(1, 0, 0);
-		glVertex3d(r0, -r0, -r0);
-		glVertex3d(r0, r0, -r0);
-		glVertex3d(r0, r0, r0);
-		glVertex3d(r0, -r0, r0);
-
-		glNormal3d(-1, 0, 0);
-		glVertex3d(-r0, r0, -r0);
-		glVertex3d(-r0, -r0, -r0);
-		glVertex3d(-r0, -r0, r0);
-		glVertex3d(-r0, r0, r0);
-
-		glNormal3d(0, 1, 0);
-		glVertex3d(r0, r0, -r0);
-		glVertex3d(-r0, r0, -r0);
-		glVertex3d(-r0, r0, r0);
-		glVertex3d(r0, r0, r0);
-
-		glNormal3d(0, -1, 0);
-		glVertex3d(-r0, -r0, -r0);
-		glVertex3d(r0, -r0, -r0);
-		glVertex3d(r0, -r0, r0);
-		glVertex3d(-r0, -r0, r0);
-
-		glNormal3d(0, 0, 1);
-		glVertex3d(-r0, r0, r0);
-		glVertex3d(r0, r0, r0);
-		glVertex3d(r0, -r0, r0);
-		glVertex3d(-r0, -r0, r0);
-
-		glNormal3d(0, 0, -1);
-		glVertex3d(r0, r0, -r0);
-		glVertex3d(-r0, r0, -r0);
-		glVertex3d(-r0, -r0, -r0);
-		glVertex3d(r0, -r0, -r0);
+		if (skip[k] == 0) inst[m++] = inst[k];
 	}
-	glEnd();
-	glPopMatrix();
+	inst.resize(m);
 
+	m_glyphs.Build(shape, inst);
 }
@@ -26,12 +26,8 @@ SOFTWARE.*/
 
 #pragma once
 #include "GLPlot.h"
+#include "GLGlyphBatch.h"
 #include <GLWLib/GLWidget.h>
-#ifdef __APPLE__
-    #include <OpenGL/GLU.h>
-#else
-    #include <GL/glu.h>
-#endif
 
 namespace Post {
 
@@ -77,6 +73,8 @@ public:
 
 	bool UpdateData(bool bsave = true) override;
 
+	void UpdateTexture() override { m_Col.UpdateTexture(); m_glyphsValid = false; }
+
 public:
 	int GetTensorField() { return m_ntensor; }
 	void SetTensorField(int nfield);
@@ -109,11 +107,8 @@ public:
 	void SetNormalize(bool b) { m_bnormalize = b; }
 
 protected:
-	void RenderGlyphs(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderArrows(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderLines(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph);
+	// build the glyphs of the selected items
+	void BuildGlyphs();
 
 	void Update() override;
 
@@ -143,5 +138,26 @@ protected:
 	int		m_lastTime;
 	float	m_lastDt;
 	int		m_lastCol;
+
+	// parameters that the glyph geometry depends on
+	struct GLYPH_KEY
+	{
+		int		nglyph, ncol, ncolmap;
+		GLColor	gcl;
+		bool	bnorm;
+		float	scale, fmin, fmax;
+
+		bool operator != (const GLYPH_KEY& k) const
+		{
+			return (nglyph != k.nglyph) || (ncol != k.ncol) || (ncolmap != k.ncolmap) ||
+				(gcl.r != k.gcl.r) || (gcl.g != k.gcl.g) || (gcl.b != k.gcl.b) || (bnorm != k.bnorm) ||
+				(scale != k.scale) || (fmin != k.fmin) || (fmax != k.fmax);
+		}
+	};
+
+	GLGlyphBatch	m_glyphs;		// glyph geometry
+	GLYPH_KEY		m_glyphKey;		// parameters of glyph geometry
+	vector<int>		m_glyphItems;	// items that have a glyph
+	bool			m_glyphsValid;	// glyph geometry is up to date
 };
 }
@@ -88,6 +88,8 @@ CGLVectorPlot::CGLVectorPlot(CGLModel* po) : CGLLegendPlot(po)
 	m_usr[0] = 0.0;
 	m_usr[1] = 1.0;
 
+	m_glyphsValid = false;
+
 	GLLegendBar* bar = new GLLegendBar(&m_Col, 0, 0, 120, 500);
 	bar->align(GLW_ALIGN_BOTTOM | GLW_ALIGN_HCENTER);
 	bar->SetOrientation(GLLegendBar::HORIZONTAL);
@@ -119,6 +121,7 @@ bool CGLVectorPlot::UpdateData(bool bsave)
 		m_rngType = GetIntValue(RANGE_TYPE);
 		m_usr[1] = GetFloatValue(USER_MAX);
 		m_usr[0] = GetFloatValue(USER_MIN);
+		m_glyphsValid = false;
 
 		GLLegendBar* bar = GetLegendBar();
 		if ((m_ncol == 0) || !IsActive()) bar->hide();
@@ -170,11 +173,6 @@ void CGLVectorPlot::Render(CGLContext& rc)
 	// store attributes
 	glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT);
 
-	// create the cylinder object
-	glEnable(GL_LIGHTING);
-	GLUquadricObj* pglyph = gluNewQuadric();
-	gluQuadricNormals(pglyph, GLU_SMOOTH);
-
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFEModel();
 
@@ -214,6 +212,8 @@ void CGLVectorPlot::Render(CGLContext& rc)
 		glLightfv(GL_LIGHT0, GL_AMBIENT, dif);
 	}
 
+	// find the items that get a glyph
+	vector<int> items;
 	if (IS_ELEM_FIELD(m_nvec))
 	{
 		pm->TagAllElements(0);
@@ -237,16 +237,10 @@ void CGLVectorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		// render the vectors at the elements' centers
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
 			FEElement_& elem = pm->ElementRef(i);
-			if ((frand() <= m_dens) && elem.m_ntag)
-			{
-				vec3f r = to_vec3f(pm->ElementCenter(elem));
-				vec3f v = m_val[i];
-				RenderVector(r, v, pglyph);
-			}
+			if ((frand() <= m_dens) && elem.m_ntag) items.push_back(i);
 		}
 	}
 	else
@@ -276,18 +270,29 @@ void CGLVectorPlot::Render(CGLContext& rc)
 		for (int i = 0; i < pm->Nodes(); ++i)
 		{
 			FENode& node = pm->Node(i);
-			if ((frand() <= m_dens) && node.m_ntag)
-			{
-				vec3f r = to_vec3f(node.r);
-
-				vec3f v = m_val[i];
-
-				RenderVector(r, v, pglyph);
-			}
+			if ((frand() <= m_dens) && node.m_ntag) items.push_back(i);
 		}
 	}
 
-	gluDeleteQuadric(pglyph);
+	// the glyphs are only rebuilt when something changed
+	GLYPH_KEY key;
+	key.nglyph = m_nglyph;
+	key.ncol = m_ncol;
+	key.ncolmap = m_Col.GetColorMap();
+	key.gcl = m_gcl;
+	key.bnorm = m_bnorm;
+	key.ar = m_ar;
+	key.fscale = m_fscale;
+	key.crng = m_crng;
+	if ((m_glyphsValid == false) || (key != m_glyphKey) || (items != m_glyphItems))
+	{
+		m_glyphKey = key;
+		m_glyphItems = items;
+		BuildGlyphs();
+		m_glyphsValid = true;
+	}
+
+	m_glyphs.Render();
 
 	// restore attributes
 	glPopAttrib();
@@ -295,125 +300,76 @@ void CGLVectorPlot::Render(CGLContext& rc)
 	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 }
 
-void CGLVectorPlot::RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph)
+void CGLVectorPlot::BuildGlyphs()
 {
-	float L = v.Length();
-	if (L == 0.f) return;
+	CGLModel* mdl = GetModel();
+	FEPostMesh* pm = mdl->GetActiveMesh();
+
+	// tessellate the glyph in units of the vector length
+	float r0 = 0.05f*m_ar;
+	float r1 = 0.15f*m_ar;
+	GLGlyphShape shape(m_nglyph == GLYPH_LINE ? GLGlyphShape::LINES : GLGlyphShape::TRIANGLES);
+	switch (m_nglyph)
+	{
+	case GLYPH_ARROW:
+		shape.AddCylinder(r0, r0, 0.f, 0.9f, 5);
+		shape.AddCylinder(r1, 0.f, 0.81f, 0.2f, 10);
+		break;
+	case GLYPH_CONE    : shape.AddCylinder(r1, 0.f, 0.f, 0.9f, 10); break;
+	case GLYPH_CYLINDER: shape.AddCylinder(r1, r1, 0.f, 0.9f, 10); break;
+	case GLYPH_SPHERE  : shape.AddSphere(r1, 10, 5); break;
+	case GLYPH_BOX     : shape.AddBox(r0); break;
+	case GLYPH_LINE    : shape.AddLine(1.f); break;
+	}
 
 	CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
 
 	float fmin = m_crng.x;
 	float fmax = m_crng.y;
 
-	float f = (L - fmin) / (fmax - fmin);
-	GLColor col = map.map(f);
-	v.Normalize();
-
-	switch (m_ncol)
-	{
-	case GLYPH_COL_LENGTH:
-		glColor3ub(col.r, col.g, col.b);
-		break;
-	case GLYPH_COL_ORIENT:
+	bool belem = IS_ELEM_FIELD(m_nvec);
+	int NG = (int)m_glyphItems.size();
+	vector<GLGlyphInstance> inst(NG);
+	vector<char> skip(NG, 0);
+#pragma omp parallel for schedule(static)
+	for (int k = 0; k < NG; ++k)
 	{
-		GLdouble r = fabs(v.x);
-		GLdouble g = fabs(v.y);
-		GLdouble b = fabs(v.z);
-		glColor3d(r, g, b);
-	}
-	break;
-	case GLYPH_COL_SOLID:
-	default:
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
-	}
+		int i = m_glyphItems[k];
+		vec3f v = m_val[i];
+		float L = v.Length();
+		if (L == 0.f) { skip[k] = 1; continue; }
 
-	if (m_bnorm) L = 1;
+		GLGlyphInstance& g = inst[k];
+		g.r = (belem ? to_vec3f(pm->ElementCenter(pm->ElementRef(i))) : to_vec3f(pm->Node(i).r));
 
-	L *= m_fscale;
-	float l0 = L*.9;
-	float l1 = L*.2;
-	float r0 = L*0.05*m_ar;
-	float r1 = L*0.15*m_ar;
+		float f = (L - fmin) / (fmax - fmin);
+		v.Normalize();
 
-	glPushMatrix();
+		switch (m_ncol)
+		{
+		case GLYPH_COL_LENGTH: g.c = map.map(f); break;
+		case GLYPH_COL_ORIENT:
+			g.c = GLColor((unsigned char)(255.f*fabs(v.x)), (unsigned char)(255.f*fabs(v.y)), (unsigned char)(255.f*fabs(v.z)));
+			break;
+		case GLYPH_COL_SOLID:
+		default:
+			g.c = m_gcl;
+		}
+		g.c.a = 255;
 
-	glTranslatef(r.x, r.y, r.z);
-	quatd q(vec3d(0,0,1), v);
-	float w = q.GetAngle();
-	if (fabs(w) > 1e-6)
-	{
-		vec3d p = q.GetVector();
-		if (p.Length() > 1e-6) glRotated(w * 180 / PI, p.x, p.y, p.z);
-		else glRotated(w * 180 / PI, 1, 0, 0);
+		if (m_bnorm) L = 1;
+		GLGlyphBatch::AlignedFrame(v, L*m_fscale, g.a);
 	}
 
-	switch (m_nglyph)
+	// remove zero-length vectors
+	int m = 0;
+	for (int k = 0; k < NG; ++k)
 	{
-	case GLYPH_ARROW:
-		gluCylinder(pglyph, r0, r0, l0, 5, 1);
-		glTranslatef(0.f, 0.f, (float)l0*0.9f);
-		gluCylinder(pglyph, r1, 0, l1, 10, 1);
-		break;
-	case GLYPH_CONE:
-		gluCylinder(pglyph, r1, 0, l0, 10, 1);
-		break;
-	case GLYPH_CYLINDER:
-		gluCylinder(pglyph, r1, r1, l0, 10, 1);
-		break;
-	case GLYPH_SPHERE:
-		gluSphere(pglyph, r1, 10, 5);
-		break;
-	case GLYPH_BOX:
-		glBegin(GL_QUADS);
-		{
-			glNormal3d(1, 0, 0);
-			glVertex3d(r0, -r0, -r0);
-			glVertex3d(r0, r0, -r0);
-			glVertex3d(r0, r0, r0);
-			glVertex3d(r0, -r0, r0);
-
-			glNormal3d(-1, 0, 0);
-			glVertex3d(-r0, r0, -r0);
-			glVertex3d(-r0, -r0, -r0);
-			glVertex3d(-r0, -r0, r0);
-			glVertex3d(-r0, r0, r0);
-
-			glNormal3d(0, 1, 0);
-			glVertex3d(r0, r0, -r0);
-			glVertex3d(-r0, r0, -r0);
-			glVertex3d(-r0, r0, r0);
-			glVertex3d(r0, r0, r0);
-
-			glNormal3d(0, -1, 0);
-			glVertex3d(-r0, -r0, -r0);
-			glVertex3d(r0, -r0, -r0);
-			glVertex3d(r0, -r0, r0);
-			glVertex3d(-r0, -r0, r0);
-
-			glNormal3d(0, 0, 1);
-			glVertex3d(-r0, r0, r0);
-			glVertex3d(r0, r0, r0);
-			glVertex3d(r0, -r0, r0);
-			glVertex3d(-r0, -r0, r0);
-
-			glNormal3d(0, 0, -1);
-			glVertex3d(r0, r0, -r0);
-			glVertex3d(-r0, r0, -r0);
-			glVertex3d(-r0, -r0, -r0);
-			glVertex3d(r0, -r0, -r0);
-		}
-		glEnd();
-		break;
-	case GLYPH_LINE:
-		glBegin(GL_LINES);
-		{
-			glVertex3d(0, 0, 0);
-			glVertex3d(0, 0, L);
-		}
-		glEnd();
+		if (skip[k] == 0) inst[m++] = inst[k];
 	}
+	inst.resize(m);
 
-	glPopMatrix();
+	m_glyphs.Build(shape, inst);
 }
 
 void CGLVectorPlot::SetVectorField(int ntype) 
@@ -445,6 +401,7 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 
 	m_lastTime = ntime;
 	m_lastDt = dt;
+	m_glyphsValid = false;
 
 	CGLModel* mdl = GetModel();
 	FEPostMesh* pm = mdl->GetActiveMesh();
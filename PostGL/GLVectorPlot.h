@@ -26,8 +26,7 @@ SOFTWARE.*/
 
 #pragma once
 #include "GLPlot.h"
-
-class GLUquadric;
+#include "GLGlyphBatch.h"
 
 namespace Post {
 
@@ -105,17 +104,17 @@ public:
 
 	void Update(int ntime, float dt, bool breset) override;
 
-	void UpdateTexture() override { m_Col.UpdateTexture(); }
-
 	bool UpdateData(bool bsave = true) override;
 
 	void Update() override;
 
 	void Activate(bool b) override;
 
+	void UpdateTexture() override { m_Col.UpdateTexture(); m_glyphsValid = false; }
+
 private:
-	// render a vector n at position r
-	void RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph);
+	// build the glyphs of the selected items
+	void BuildGlyphs();
 
 	void UpdateState(int nstate);
 
@@ -152,5 +151,27 @@ protected:
 	vec2f			m_staticRange;
 
 	float			m_fscale;	// total scale factor for rendering
+
+	// parameters that the glyph geometry depends on
+	struct GLYPH_KEY
+	{
+		int		nglyph, ncol, ncolmap;
+		GLColor	gcl;
+		bool	bnorm;
+		float	ar, fscale;
+		vec2f	crng;
+
+		bool operator != (const GLYPH_KEY& k) const
+		{
+			return (nglyph != k.nglyph) || (ncol != k.ncol) || (ncolmap != k.ncolmap) ||
+				(gcl.r != k.gcl.r) || (gcl.g != k.gcl.g) || (gcl.b != k.gcl.b) || (bnorm != k.bnorm) || 
+				(ar != k.ar) || (fscale != k.fscale) || (crng.x != k.crng.x) || (crng.y != k.crng.y);
+		}
+	};
+
+	GLGlyphBatch	m_glyphs;		// glyph geometry
+	GLYPH_KEY		m_glyphKey;		// parameters of glyph geometry
+	vector<int>		m_glyphItems;	// items that have a glyph
+	bool			m_glyphsValid;	// glyph geometry is up to date
 };
 }
@@ -0,0 +1,155 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#include "stdafx.h"
+#include "AsyncAnimation.h"
+#include <QThread>
+
+//-----------------------------------------------------------------------------
+class CEncoderThread : public QThread
+{
+public:
+	CEncoderThread(CAsyncAnimation* anim) : m_anim(anim) {}
+
+	void run() override { m_anim->Encode(); }
+
+private:
+	CAsyncAnimation*	m_anim;
+};
+
+//-----------------------------------------------------------------------------
+CAsyncAnimation::CAsyncAnimation(CAnimation* anim, int maxQueuedFrames) : m_anim(anim)
+{
+	m_thread = nullptr;
+	m_maxFrames = (maxQueuedFrames < 1 ? 1 : maxQueuedFrames);
+	m_busy = false;
+	m_stop = false;
+	m_error = false;
+	m_frames = 0;
+}
+
+CAsyncAnimation::~CAsyncAnimation()
+{
+	Close();
+	delete m_anim;
+}
+
+int CAsyncAnimation::Create(const char* szfile, int cx, int cy, float fps)
+{
+	Close();
+	if ((m_anim == nullptr) || (m_anim->Create(szfile, cx, cy, fps) == 0)) return 0;
+
+	m_stop = false;
+	m_error = false;
+	m_frames = 0;
+	m_thread = new CEncoderThread(this);
+	m_thread->start();
+	return 1;
+}
+
+int CAsyncAnimation::Write(QImage& im)
+{
+	if (m_thread == nullptr) return 0;
+
+	QMutexLocker lock(&m_mutex);
+	if (m_error) return 0;
+
+	// wait for room in the queue
+	while ((int)m_queue.size() >= m_maxFrames) m_frameDone.wait(&m_mutex);
+
+	// QImage is implicitly shared, so this does not copy the pixels
+	m_queue.push_back(im);
+	m_frames++;
+	m_frameAdded.wakeOne();
+
+	return 1;
+}
+
+void CAsyncAnimation::Encode()
+{
+	m_mutex.lock();
+	while (true)
+	{
+		while (m_queue.empty() && (m_stop == false)) m_frameAdded.wait(&m_mutex);
+		if (m_queue.empty()) break;
+
+		QImage im = m_queue.front();
+		m_queue.pop_front();
+		m_busy = true;
+		m_mutex.unlock();
+
+		// the encoding happens outside the lock
+		bool ok = (m_error == false) && (m_anim->Write(im) != 0);
+
+		m_mutex.lock();
+		if (ok == false) m_error = true;
+		m_busy = false;
+		m_frameDone.wakeAll();
+	}
+	m_mutex.unlock();
+}
+
+void CAsyncAnimation::Flush()
+{
+	QMutexLocker lock(&m_mutex);
+	while ((m_queue.empty() == false) || m_busy) m_frameDone.wait(&m_mutex);
+}
+
+int CAsyncAnimation::QueuedFrames()
+{
+	QMutexLocker lock(&m_mutex);
+	return (int)m_queue.size();
+}
+
+bool CAsyncAnimation::IsValid()
+{
+	QMutexLocker lock(&m_mutex);
+	return (m_thread != nullptr) && (m_error == false);
+}
+
+int CAsyncAnimation::Frames()
+{
+	return m_frames;
+}
+
+void CAsyncAnimation::Close()
+{
+	if (m_thread)
+	{
+		// let the encoder finish the remaining frames
+		m_mutex.lock();
+		m_stop = true;
+		m_frameAdded.wakeAll();
+		m_mutex.unlock();
+
+		m_thread->wait();
+		delete m_thread;
+		m_thread = nullptr;
+
+		m_anim->Close();
+	}
+}
@@ -0,0 +1,77 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#pragma once
+#include "Animation.h"
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+#include <deque>
+
+class QThread;
+
+//-----------------------------------------------------------------------------
+//! Animation that encodes its frames on a background thread. 
+//! Frames are queued and passed on, in order, to the animation object that
+//! does the actual encoding. Write only blocks when the queue is full.
+class CAsyncAnimation : public CAnimation
+{
+public:
+	//! The async animation takes ownership of the animation object
+	CAsyncAnimation(CAnimation* anim, int maxQueuedFrames = 8);
+	~CAsyncAnimation();
+
+public:
+	int Create(const char* szfile, int cx, int cy, float fps = 10.f) override;
+	int Write(QImage& im) override;
+	bool IsValid() override;
+	void Close() override;
+	int Frames() override;
+
+	//! wait until all queued frames are encoded
+	void Flush();
+
+	//! number of frames that are waiting to be encoded
+	int QueuedFrames();
+
+	//! the encoder thread's main loop
+	void Encode();
+
+private:
+	CAnimation*	m_anim;			//!< the animation that encodes the frames
+	QThread*	m_thread;		//!< the encoder thread
+	int			m_maxFrames;	//!< max nr of frames in the queue
+
+	std::deque<QImage>	m_queue;	//!< frames waiting to be encoded
+	QMutex			m_mutex;
+	QWaitCondition	m_frameAdded;
+	QWaitCondition	m_frameDone;
+	bool			m_busy;		//!< the encoder is writing a frame
+	bool			m_stop;		//!< tells the encoder thread to finish
+	bool			m_error;	//!< an error occurred while encoding
+	int				m_frames;	//!< nr of frames submitted
+};
@@ -0,0 +1,92 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "FEDataArray.h"
+
+namespace Post {
+
+//-----------------------------------------------------------------------------
+uint16_t float_to_half(float f)
+{
+	uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+
+	uint32_t sign = (x >> 16) & 0x8000;
+	int e = (int)((x >> 23) & 0xff);
+	uint32_t m = x & 0x7fffff;
+
+	// inf or nan
+	if (e == 255) return (uint16_t)(sign | 0x7c00 | (m ? 0x200 : 0));
+
+	int ne = e - 127 + 15;
+
+	// overflow
+	if (ne >= 31) return (uint16_t)(sign | 0x7c00);
+
+	// subnormal (or zero)
+	if (ne <= 0)
+	{
+		if (ne < -10) return (uint16_t)sign;
+		m |= 0x800000;
+		int shift = 14 - ne;
+		uint32_t h = m >> shift;
+		uint32_t rem = m & ((1u << shift) - 1);
+		uint32_t half = 1u << (shift - 1);
+		if ((rem > half) || ((rem == half) && (h & 1))) h++;
+		return (uint16_t)(sign | h);
+	}
+
+	// normal (a carry from rounding propagates into the exponent)
+	uint32_t h = ((uint32_t)ne << 10) | (m >> 13);
+	uint32_t rem = m & 0x1fff;
+	if ((rem > 0x1000) || ((rem == 0x1000) && (h & 1))) h++;
+	return (uint16_t)(sign | h);
+}
+
+//-----------------------------------------------------------------------------
+float half_to_float(uint16_t h)
+{
+	uint32_t sign = ((uint32_t)h & 0x8000) << 16;
+	uint32_t e = (h >> 10) & 0x1f;
+	uint32_t m = h & 0x3ff;
+
+	uint32_t x;
+	if (e == 0)
+	{
+		// zero or subnormal
+		float f = (float)m * (1.f / 16777216.f);
+		return (sign ? -f : f);
+	}
+	else if (e == 31) x = sign | 0x7f800000 | (m << 13);
+	else x = sign | ((e - 15 + 127) << 23) | (m << 13);
+
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+} // namespace Post
@@ -0,0 +1,211 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <vector>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <MathLib/math3d.h>
+
+namespace Post {
+
+//-----------------------------------------------------------------------------
+// Storage modes for state data
+// - STORAGE_FLOAT  : full single precision (default)
+// - STORAGE_HALF   : IEEE half precision (16 bits per component)
+// - STORAGE_QUANT16: 16-bit quantization against the min/max of each component
+enum Data_Storage {
+	STORAGE_FLOAT,
+	STORAGE_HALF,
+	STORAGE_QUANT16
+};
+
+//-----------------------------------------------------------------------------
+// half precision conversion (round to nearest even)
+uint16_t float_to_half(float f);
+float half_to_float(uint16_t h);
+
+//-----------------------------------------------------------------------------
+// number of float components of a data type. Types that are not made up
+// of floats (e.g. Mat3d) have zero components and are never compressed.
+template <class T> class FEDataArrayTraits { public: enum { components = 0 }; };
+
+template <> class FEDataArrayTraits<float  > { public: enum { components =  1 }; };
+template <> class FEDataArrayTraits<vec3f  > { public: enum { components =  3 }; };
+template <> class FEDataArrayTraits<mat3fd > { public: enum { components =  3 }; };
+template <> class FEDataArrayTraits<mat3fs > { public: enum { components =  6 }; };
+template <> class FEDataArrayTraits<mat3f  > { public: enum { components =  9 }; };
+template <> class FEDataArrayTraits<tens4fs> { public: enum { components = 21 }; };
+
+//-----------------------------------------------------------------------------
+// Array used by the mesh data classes to store the values of a state. 
+// The array can be compressed to one of the 16-bit storage modes, after which
+// values are decoded on the fly with get(). Any non-const access expands the
+// array back to full precision.
+template <typename T> class FEDataArray
+{
+	enum { NC = FEDataArrayTraits<T>::components };
+	static constexpr int NA = (NC > 0 ? NC : 1);	// array size for per component values
+
+public:
+	FEDataArray() : m_mode(STORAGE_FLOAT), m_size(0) {}
+
+	size_t size() const { return (m_mode == STORAGE_FLOAT ? m_data.size() : m_size); }
+	bool empty() const { return (size() == 0); }
+
+	int Storage() const { return m_mode; }
+
+	T get(size_t i) const
+	{
+		if (m_mode == STORAGE_FLOAT) return m_data[i];
+		return decode(i);
+	}
+
+	T& operator [] (size_t i) { expand(); return m_data[i]; }
+
+	void resize(size_t n) { expand(); m_data.resize(n); }
+	void push_back(const T& v) { expand(); m_data.push_back(v); }
+	void append(const std::vector<T>& d) { expand(); m_data.insert(m_data.end(), d.begin(), d.end()); }
+
+	// compress the data. Returns the max absolute error of the stored values.
+	float compress(int mode);
+
+	// restore full precision
+	void expand();
+
+private:
+	T decode(size_t i) const;
+
+private:
+	int					m_mode;		// storage mode
+	size_t				m_size;		// nr of values when compressed
+	std::vector<T>		m_data;		// full precision values
+	std::vector<uint16_t>	m_pack;	// compressed values (NC per value)
+	float				m_min[NA];	// per component minimum (QUANT16 only)
+	float				m_scl[NA];	// per component scale (QUANT16 only)
+};
+
+template <typename T> T FEDataArray<T>::decode(size_t i) const
+{
+	float f[NA];
+	const uint16_t* p = &m_pack[i*NC];
+	if (m_mode == STORAGE_HALF)
+	{
+		for (int k = 0; k < NC; ++k) f[k] = half_to_float(p[k]);
+	}
+	else
+	{
+		for (int k = 0; k < NC; ++k) f[k] = m_min[k] + m_scl[k] * (float)p[k];
+	}
+	T v;
+	memcpy(&v, f, sizeof(T));
+	return v;
+}
+
+template <typename T> void FEDataArray<T>::expand()
+{
+	if (m_mode == STORAGE_FLOAT) return;
+	std::vector<T> d(m_size);
+	for (size_t i = 0; i < m_size; ++i) d[i] = decode(i);
+	m_data.swap(d);
+	std::vector<uint16_t>().swap(m_pack);
+	m_mode = STORAGE_FLOAT;
+	m_size = 0;
+}
+
+template <typename T> float FEDataArray<T>::compress(int mode)
+{
+	if ((NC == 0) || (mode == m_mode)) return 0.f;
+	expand();
+	if ((mode == STORAGE_FLOAT) || m_data.empty()) return 0.f;
+	static_assert((NC == 0) || (sizeof(T) == NC*sizeof(float)), "FEDataArray: unexpected data layout");
+
+	const size_t N = m_data.size();
+	const float* pf = (const float*) &m_data[0];
+
+	// only finite values can be compressed. Half precision also needs 
+	// all values to be in range.
+	float fmin[NA], fmax[NA];
+	for (int k = 0; k < NC; ++k) { fmin[k] = fmax[k] = pf[k]; }
+	for (size_t i = 0; i < N*NC; ++i)
+	{
+		float f = pf[i];
+		if ((f - f) != 0.f) return 0.f;
+		int k = (int)(i % NC);
+		if (f < fmin[k]) fmin[k] = f;
+		if (f > fmax[k]) fmax[k] = f;
+	}
+	if (mode == STORAGE_HALF)
+	{
+		for (int k = 0; k < NC; ++k)
+			if ((fmin[k] < -65504.f) || (fmax[k] > 65504.f)) return 0.f;
+	}
+	else
+	{
+		for (int k = 0; k < NC; ++k)
+		{
+			m_min[k] = fmin[k];
+			m_scl[k] = (fmax[k] - fmin[k]) / 65535.f;
+		}
+	}
+
+	m_pack.resize(N*NC);
+	for (size_t i = 0; i < N*NC; ++i)
+	{
+		float f = pf[i];
+		if (mode == STORAGE_HALF) m_pack[i] = float_to_half(f);
+		else
+		{
+			int k = (int)(i % NC);
+			float q = (m_scl[k] > 0.f ? (f - m_min[k]) / m_scl[k] : 0.f);
+			if (q < 0.f) q = 0.f; else if (q > 65535.f) q = 65535.f;
+			m_pack[i] = (uint16_t)(q + 0.5f);
+		}
+	}
+
+	m_mode = mode;
+	m_size = N;
+
+	// measure the error
+	float maxErr = 0.f;
+	for (size_t i = 0; i < N; ++i)
+	{
+		T v = decode(i);
+		const float* pv = (const float*) &v;
+		for (int k = 0; k < NC; ++k)
+		{
+			float e = fabs(pv[k] - pf[i*NC + k]);
+			if (e > maxErr) maxErr = e;
+		}
+	}
+
+	std::vector<T>().swap(m_data);
+
+	return maxErr;
+}
+
+} // namespace Post
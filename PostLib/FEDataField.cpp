@@ -42,6 +42,8 @@ FEDataField::FEDataField(const std::string& name, Data_Type ntype, Data_Format n
 	m_flag = flag;
 	m_name = name;
 	m_arraySize = 0;
+	m_storage = 0;
+	m_storageError = 0.f;
 }
 
 
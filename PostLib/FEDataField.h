@@ -99,6 +99,14 @@ public:
 	void SetArrayNames(vector<string>& n);
 	vector<string> GetArrayNames() const;
 
+	// storage mode of the state data (see Data_Storage)
+	void SetStorage(int n) { m_storage = n; }
+	int GetStorage() const { return m_storage; }
+
+	// max error introduced by the storage mode over all states
+	float StorageError() const { return m_storageError; }
+	void UpdateStorageError(float e) { if (e > m_storageError) m_storageError = e; }
+
 protected:
 	int				m_nfield;	//!< field ID
 	Data_Type		m_ntype;	//!< data type
@@ -110,6 +118,9 @@ protected:
 	int				m_arraySize;	//!< data size for arrays
 	vector<string>	m_arrayNames;	//!< (optional) names of array components
 
+	int				m_storage;		//!< storage mode of state data
+	float			m_storageError;	//!< max error due to storage mode
+
 
 public:
 	// TODO: Add properties list for data fields (e.g. strains and curvature could use this)
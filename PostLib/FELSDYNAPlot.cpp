@@ -32,29 +32,30 @@ SOFTWARE.*/
 #include "FEPostModel.h"
 using namespace Post;
 
+#ifdef WIN32
+#define ftell64(a)     _ftelli64(a)
+#define fseek64(a,b,c) _fseeki64(a,b,c)
+#endif
+
+#ifdef LINUX // same for Linux and Mac OS X
+#define ftell64(a)     ftello(a)
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+#ifdef __APPLE__ // same for Linux and Mac OS X
+#define ftell64(a)     ftello(a)
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
 // this function performs a big-endian to little endian or vice versa byteswap
 // this is used by the plotfile import routine
 void byteswap(int* pi, int n)
 {
-	union
-	{
-		int m;
-		unsigned char byte[4];
-	};
-
+	unsigned int* pu = (unsigned int*)pi;
 	for (int i=0; i<n; i++)
 	{
-		m = pi[i];
-
-		byte[0] ^= byte[3];
-		byte[3] ^= byte[0];
-		byte[0] ^= byte[3];
-
-		byte[1] ^= byte[2];
-		byte[2] ^= byte[1];
-		byte[1] ^= byte[2];
-
-		pi[i] = m;
+		unsigned int m = pu[i];
+		pu[i] = (m >> 24) | ((m >> 8) & 0x0000FF00) | ((m << 8) & 0x00FF0000) | (m << 24);
 	}
 }
 
@@ -63,6 +64,9 @@ FELSDYNAPlotImport::FELSDYNAPlotImport(FEPostModel* fem) : FEFileReader(fem)
 {
 	m_brepeat = false;
 	m_naction = 0;
+	m_stateSize = 0;
+	m_read_state_flag = LSDYNA_READ_ALL_STATES;
+	m_storage = STORAGE_FLOAT;
 }
 
 FELSDYNAPlotImport::~FELSDYNAPlotImport()
@@ -74,6 +78,8 @@ bool FELSDYNAPlotImport::Load(const char *szfile)
 {
 	// reset family plot file counter
 	m_ifile = 0;
+	m_states.clear();
+	m_fileSize.clear();
 
 	// open the plot file
 	if (Open(szfile, "rb") == false) return errf("Failed opening file %s.", szfile);
@@ -87,9 +93,14 @@ bool FELSDYNAPlotImport::Load(const char *szfile)
 	// read the mesh
 	if (ReadMesh(*m_fem) == false) return false;
 
+	// find all the states
+	if (IndexStates() == false) return false;
+
 	// read the states
 	if (ReadStates(*m_fem) == false) return false;
 
+	Close();
+
 	return true;
 }
 
@@ -110,12 +121,8 @@ int FELSDYNAPlotImport::ReadData(void* pd, size_t nsize, size_t ncnt, bool bdump
 		Close();
 		m_ifile++;
 
-		char sznewfile[256] = {0};
-		string fileName = GetFileName();
-		sprintf(sznewfile, "%s%02d", fileName.c_str(), m_ifile);
-
 		// try to open it
-		m_fp = fopen(sznewfile, "rb");
+		m_fp = fopen(FamilyFileName(m_ifile).c_str(), "rb");
 		if (m_fp == 0) return -1;
 
 		// try to read the rest of the data
@@ -136,11 +143,81 @@ int FELSDYNAPlotImport::ReadData(void* pd, size_t nsize, size_t ncnt, bool bdump
 	return nread;
 }
 
+//-----------------------------------------------------------------------------
+// name of the n-th file of the plot file family
+std::string FELSDYNAPlotImport::FamilyFileName(int n)
+{
+	string fileName = GetFileName();
+	if (n == 0) return fileName;
+
+	char szext[16] = {0};
+	sprintf(szext, "%02d", n);
+	return fileName + szext;
+}
+
+//-----------------------------------------------------------------------------
+// size of the n-th file of the family, or -1 if the file does not exist
+off_type FELSDYNAPlotImport::FamilyFileSize(int n)
+{
+	while ((int)m_fileSize.size() <= n)
+	{
+		off_type nsize = -1;
+		if (m_fileSize.empty() || (m_fileSize.back() >= 0))
+		{
+			FILE* fp = fopen(FamilyFileName((int)m_fileSize.size()).c_str(), "rb");
+			if (fp)
+			{
+				fseek64(fp, 0, SEEK_END);
+				nsize = ftell64(fp);
+				fclose(fp);
+			}
+		}
+		m_fileSize.push_back(nsize);
+	}
+	return m_fileSize[n];
+}
+
+//-----------------------------------------------------------------------------
+bool FELSDYNAPlotImport::OpenFamilyFile(int n)
+{
+	if (m_fp && (m_ifile == n)) return true;
+
+	Close();
+	m_ifile = n;
+	m_fp = fopen(FamilyFileName(n).c_str(), "rb");
+	return (m_fp != 0);
+}
+
+//-----------------------------------------------------------------------------
+// Read a block of data that starts at the given offset in the given file of the
+// family. If the block continues past the end of the file, the rest is read from the next file.
+bool FELSDYNAPlotImport::ReadFamilyData(int nfile, off_type noffset, void* pd, size_t nbytes)
+{
+	char* pc = (char*)pd;
+	while (nbytes > 0)
+	{
+		off_type nsize = FamilyFileSize(nfile);
+		if ((nsize < 0) || (OpenFamilyFile(nfile) == false)) return false;
+
+		size_t nread = nbytes;
+		if ((off_type)nread > nsize - noffset) nread = (size_t)(nsize - noffset);
+
+		if (fseek64(m_fp, noffset, SEEK_SET) != 0) return false;
+		if (fread(pc, 1, nread, m_fp) != nread) return false;
+
+		pc += nread;
+		nbytes -= nread;
+		nfile++;
+		noffset = 0;
+	}
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 bool FELSDYNAPlotImport::ReadHeader(FEPostModel& fem)
 {
 	// read the plot header
-	if (fread(&m_hdr, 64*sizeof(int), 1, m_fp) == -1) return errf("Failed reading header. This is an invalid or corrupted file.");
+	if (fread(&m_hdr, 64*sizeof(int), 1, m_fp) != 1) return errf("Failed reading header. This is an invalid or corrupted file.");
 
 	// check to see if we need to byteswap
 	m_bswap = false;
@@ -192,6 +269,10 @@ bool FELSDYNAPlotImport::ReadHeader(FEPostModel& fem)
 		pdm->AddDataField(new FEStrainDataField("Lagrange strain", FEStrainDataField::LAGRANGE));
 	}
 	else fem.SetDisplacementField(-1);
+
+	// set the storage mode of the state data
+	FEDataFieldPtr pd = pdm->FirstDataField();
+	for (int i = 0; i < pdm->DataFields(); ++i, ++pd) (*pd)->SetStorage(m_storage);
  
 	return true;
 }
@@ -224,37 +305,43 @@ bool FELSDYNAPlotImport::ReadMesh(FEPostModel &fem)
 	// allocate storage
 	mesh.Create(m_hdr.nump, m_hdr.nel8 + m_hdr.nel4 + m_hdr.nel2);
 
-	// read the nodal coordinates
-	float xyz[3];
-	for (i=0; i<m_hdr.nump; i++)
+	// read the nodal coordinates (we keep a copy for calculating displacements)
+	int NN = m_hdr.nump;
+	m_r0.resize(NN);
+	if (NN > 0)
+	{
+		if (ReadData(&m_r0[0], sizeof(float), 3*NN) != 3*NN)
+		{
+			delete pm;
+			return errf("Error while reading nodal coordinates");
+		}
+	}
+	for (i=0; i<NN; i++)
 	{
 		FENode& n = mesh.Node(i);
-
-		ReadData(xyz, sizeof(float), 3);
-		
-		n.r.x = xyz[0];
-		n.r.y = xyz[1];
-		n.r.z = xyz[2];
+		n.r.x = m_r0[i].x;
+		n.r.y = m_r0[i].y;
+		n.r.z = m_r0[i].z;
 	}
 	fem.AddMesh(pm);
 
-	int nread;
-	int n[9];
 	// read the element connectivity
+	// (each section is read in one go)
+	vector<int> buf(9*m_hdr.nel8);
+	if ((m_hdr.nel8 > 0) && (ReadData(&buf[0], sizeof(int), buf.size()) != (int)buf.size()))
+	{
+		Close();
+		mesh.ClearAll();
+		return errf("Error while reading element connectivity");
+	}
+
 	int ne = 0;
 	int nmat = fem.Materials();
 	for (i=0; i<m_hdr.nel8; i++)
 	{
 		FEElement& el = static_cast<FEElement&>(mesh.ElementRef(ne++));
 
-		nread = ReadData(n, sizeof(int), 9);
-		if (nread != 9)
-		{
-			Close();
-			mesh.ClearAll();
-			return errf("Error while reading element connectivity");
-		}
-
+		const int* n = &buf[9*i];
 		if ((n[7]==n[4])&&(n[6]==n[4])&&(n[5]==n[4])) 
 		{
 			el.SetType(FE_TET4) ;
@@ -298,12 +385,18 @@ bool FELSDYNAPlotImport::ReadMesh(FEPostModel &fem)
 	}
 
 	// read beam elements
+	buf.resize(6*m_hdr.nel2);
+	if ((m_hdr.nel2 > 0) && (ReadData(&buf[0], sizeof(int), buf.size()) != (int)buf.size()))
+	{
+		Close();
+		mesh.ClearAll();
+		return errf("Error while reading beam connectivity");
+	}
 	for (i=0; i<m_hdr.nel2; ++i)
 	{
 		FEElement& el = static_cast<FEElement&>(mesh.ElementRef(ne++));
 
-		ReadData(n, sizeof(int), 6);
-
+		const int* n = &buf[6*i];
 		el.SetType(FE_BEAM2);
 		assert(n[5] > 0);
 
@@ -313,12 +406,18 @@ bool FELSDYNAPlotImport::ReadMesh(FEPostModel &fem)
 	}
 
 	// read shells
+	buf.resize(5*m_hdr.nel4);
+	if ((m_hdr.nel4 > 0) && (ReadData(&buf[0], sizeof(int), buf.size()) != (int)buf.size()))
+	{
+		Close();
+		mesh.ClearAll();
+		return errf("Error while reading shell connectivity");
+	}
 	for (i=0; i<m_hdr.nel4; ++i)
 	{
 		FEElement& el = static_cast<FEElement&>(mesh.ElementRef(ne++));
 
-		ReadData(n, sizeof(int), 5);
-
+		const int* n = &buf[5*i];
 		el.SetType(FE_QUAD4);
 
 		assert(n[4] > 0);
@@ -363,197 +462,265 @@ bool FELSDYNAPlotImport::ReadMesh(FEPostModel &fem)
 }
 
 //-----------------------------------------------------------------------------
-bool FELSDYNAPlotImport::ReadStates(FEPostModel& fem)
+// Find the location and time of all the states in the plot file family. The state
+// data itself is not read here, so states that are not needed are never read.
+bool FELSDYNAPlotImport::IndexStates()
 {
-	// read the timesteps
+	// number of words per state
 	int nnd = m_hdr.nump*(m_hdr.flagT + 3*(m_hdr.flagU + m_hdr.flagV + m_hdr.flagA));
 	int n8 = m_hdr.nel8*m_hdr.nv3d;
 	int n4 = m_hdr.nel4*m_hdr.nv2d;
 	int n2 = m_hdr.nel2*m_hdr.nv1d;
+	m_stateSize = 1 + m_hdr.nglbv + nnd + n8 + n4 + n2;
+	const off_type nbytes = (off_type)m_stateSize*sizeof(int);
 
-	int datasize = 1 + m_hdr.nglbv + nnd + n8 + n4 + n2;
-	int* pdata = new int [datasize];
-	bool bdone = false;
+	// the states start after the mesh
+	int nfile = m_ifile;
+	off_type noff = ftell64(m_fp);
 
-	float ftime, fprev;
-	int nstate = 0;
+	m_states.clear();
+	while (true)
+	{
+		STATE_INFO si;
+		si.nfile = nfile;
+		si.noffset = noff;
+
+		// find the end of the state, which could be in one of the following files
+		off_type nleft = nbytes;
+		bool bok = true;
+		while (FamilyFileSize(nfile) - noff < nleft)
+		{
+			nleft -= FamilyFileSize(nfile) - noff;
+			nfile++;
+			noff = 0;
+			if (FamilyFileSize(nfile) < 0) { bok = false; break; }
+		}
+		if (bok == false) break;
+		noff += nleft;
+
+		// read the time value
+		int ntime = 0;
+		if (ReadFamilyData(si.nfile, si.noffset, &ntime, sizeof(int)) == false) break;
+		if (m_bswap) byteswap(&ntime, 1);
+		memcpy(&si.time, &ntime, sizeof(float));
+
+		// we've reached the final timestep
+		if (fabs(si.time + 999999) < 1e-8) break;
+
+		m_states.push_back(si);
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FELSDYNAPlotImport::ReadStates(FEPostModel& fem)
+{
+	// figure out which states to read
+	int NS = (int)m_states.size();
+	vector<int> states;
+	switch (m_read_state_flag)
+	{
+	case LSDYNA_READ_LAST_STATE_ONLY:
+		if (NS > 0) states.push_back(NS - 1);
+		break;
+	case LSDYNA_READ_FIRST_AND_LAST:
+		if (NS > 0) states.push_back(0);
+		if (NS > 1) states.push_back(NS - 1);
+		break;
+	case LSDYNA_READ_STATES_FROM_LIST:
+		for (int i = 0; i < NS; ++i)
+		{
+			for (int j = 0; j < (int)m_state_list.size(); ++j)
+				if (m_state_list[j] == i) { states.push_back(i); break; }
+		}
+		break;
+	default:
+		for (int i = 0; i < NS; ++i) states.push_back(i);
+	}
+
+	// each state is read in one go
+	vector<float> buf(m_stateSize);
 
 	FEState* pprev = 0;	// previously read state
 	FEState* pstate = 0;
 
-	FEPostMesh& mesh = *fem.GetFEMesh(0);
-
 	bool bfirst = true;
 
-	do
+	for (int k = 0; k < (int)states.size(); ++k)
 	{
-		// read a data section
-		int nread = ReadData(pdata, sizeof(int), datasize, true);
-		if (nread != datasize) bdone = true;
-		else
+		const STATE_INFO& si = m_states[states[k]];
+		float ftime = si.time;
+
+		// see if we already read in this time value
+		// TODO: check the repeat and action logic
+		//       This used to be handled by a dialog class
+		bool bnew = false;
+		if (pprev && (pprev->m_time == ftime))
 		{
-			// byteswap if necessary
-			ftime = *((float*) pdata);
+			if (bfirst || !m_brepeat)
+			{
+				bfirst = false;
+				return errf("Duplicate time value in state %d", states[k] + 1);
+			}
 
-			if (fabs(ftime + 999999) < 1e-8)
+			switch (m_naction)
 			{
-				// we've reached the finale timestep
+			case 0: // add state
+				pstate = new FEState(ftime, &fem, fem.GetFEMesh(0));
+				bnew = true;
+				break;
+			case 1: // replace state
+				pstate = pprev;
 				break;
+			case 2: // ignore state
+				pstate = 0;
+				break;
+			default:
+				assert(false);
 			}
+		}
+		else
+		{
+			// create the next state
+			pstate = new FEState(ftime, &fem, fem.GetFEMesh(0));
+			bnew = true;
+		}
 
-			// increment state counter
-			++nstate;
-
-			// see if we already read in this time value
-			// TODO: check the repeat and action logic
-			//       This used to be handled by a dialog class
-			if (pprev && (pprev->m_time == ftime))
+		if (pstate)
+		{
+			if (ReadFamilyData(si.nfile, si.noffset, &buf[0], buf.size()*sizeof(float)) == false)
 			{
-				if (bfirst || !m_brepeat)
-				{
-					bfirst = false;
-					delete [] pdata;
-					return false;
-				}
-
-				switch (m_naction)
-				{
-				case 0: // add state
-					pstate = new FEState(ftime, &fem, fem.GetFEMesh(0));
-					fem.AddState(pstate);
-					pprev = pstate;
-					break;
-				case 1: // replace state
-					pstate = pprev;
-					break;
-				case 2: // ignore state
-					pstate = 0;
-					break;
-				default:
-					assert(false);
-				}
+				if (bnew) delete pstate;
+				return errf("Error while reading state data");
 			}
-			else
+			if (m_bswap) byteswap((int*)&buf[0], m_stateSize);
+
+			ReadStateData(*pstate, &buf[0]);
+
+			// the state is added after it is filled, so that the storage mode can be applied
+			if (bnew)
 			{
-				// create the next state and add to the FE mesh
-				pstate = new FEState(ftime, &fem, fem.GetFEMesh(0));
 				fem.AddState(pstate);
 				pprev = pstate;
 			}
+		}
+	}
 
-			if (pstate)
-			{
-				fprev = ftime;
-
-				float* pf = (float*) (pdata + 1 + m_hdr.nglbv);
+	return true;
+}
 
-				// read nodal displacements
-				if (m_hdr.flagU)
-				{
-					// Note that LSDYNA actually stores the current nodal positions, not the displacements
-					FENodeData<vec3f>& dsp = dynamic_cast<FENodeData<vec3f>&>(pstate->m_Data[m_nfield[LSDYNA_DISP]]);
-					for (int i=0; i<m_hdr.nump; ++i, pf += 3)
-					{
-						vec3f r0 = to_vec3f(mesh.Node(i).r);
-						dsp[i].x = pf[0] - r0.x;
-						dsp[i].y = pf[1] - r0.y;
-						dsp[i].z = pf[2] - r0.z;
-					}
-				}
+//-----------------------------------------------------------------------------
+// copy the data of a state from the state record
+void FELSDYNAPlotImport::ReadStateData(FEState& state, const float* pf)
+{
+	const int NN = m_hdr.nump;
 
-				// read nodal velocity
-				if (m_hdr.flagV)
-				{
-					FENodeData<vec3f>& vel = dynamic_cast<FENodeData<vec3f>&>(pstate->m_Data[m_nfield[LSDYNA_VEL]]);
-					for (int i=0; i<m_hdr.nump; i++, pf += 3)
-					{
-						vel[i].x = pf[0];
-						vel[i].y = pf[1];
-						vel[i].z = pf[2];
-					}
-				}
+	// skip the time and global variables
+	pf += 1 + m_hdr.nglbv;
 
-				// read nodal acceleration
-				if (m_hdr.flagA)
-				{
-					FENodeData<vec3f>& acc = dynamic_cast<FENodeData<vec3f>&>(pstate->m_Data[m_nfield[LSDYNA_ACC]]);
-					for (int i=0; i<m_hdr.nump; i++, pf += 3)
-					{
-						acc[i].x = pf[0];
-						acc[i].y = pf[1];
-						acc[i].z = pf[2];
-					}
-				}
+	// read nodal displacements
+	if (m_hdr.flagU)
+	{
+		// Note that LSDYNA actually stores the current nodal positions, not the displacements
+		FENodeData<vec3f>& dsp = dynamic_cast<FENodeData<vec3f>&>(state.m_Data[m_nfield[LSDYNA_DISP]]);
+		if (NN > 0)
+		{
+			float* pd = &(dsp.data()->x);
+			const float* r0 = &m_r0[0].x;
+			for (int i=0; i<3*NN; ++i) pd[i] = pf[i] - r0[i];
+		}
+		pf += 3*NN;
+	}
 
-				// read the nodal temperatures
-				if (m_hdr.flagT)
-				{
-					FENodeData<float>& T = dynamic_cast<FENodeData<float>&>(pstate->m_Data[m_nfield[LSDYNA_TEMP]]);
-					for (int i=0; i<m_hdr.nump; ++i, ++pf) T[i] = *pf;
-				}
+	// read nodal velocity
+	if (m_hdr.flagV)
+	{
+		FENodeData<vec3f>& vel = dynamic_cast<FENodeData<vec3f>&>(state.m_Data[m_nfield[LSDYNA_VEL]]);
+		if (NN > 0)
+		{
+			float* pd = &(vel.data()->x);
+			for (int i=0; i<3*NN; ++i) pd[i] = pf[i];
+		}
+		pf += 3*NN;
+	}
 
-				// load solid stress data
-				if (m_hdr.flagU)
-				{
-					FEElementData<mat3fs,DATA_ITEM>& s  = dynamic_cast<FEElementData<mat3fs,DATA_ITEM>&>(pstate->m_Data[m_nfield[LSDYNA_STRESS  ]]);
-					FEElementData<float ,DATA_ITEM>& p  = dynamic_cast<FEElementData<float ,DATA_ITEM>&>(pstate->m_Data[m_nfield[LSDYNA_PRESSURE]]);
-					FEElementData<float ,DATA_ITEM>& ps = dynamic_cast<FEElementData<float ,DATA_ITEM>&>(pstate->m_Data[m_nfield[LSDYNA_PLASTIC ]]);
-					for (int i=0; i<m_hdr.nel8; i++, pf += m_hdr.nv3d)
-					{
-						mat3fs m;
-						m.x = pf[0];
-						m.y = pf[1];
-						m.z = pf[2];
-						m.xy = pf[3];
-						m.yz = pf[4];
-						m.xz = pf[5];
-						s.add(i, m);
-						ps.add(i, pf[6]);
-						p.add(i, -m.tr()/3.f);
-					}
-
-					// load beam stress data
-					for (int i=0; i<m_hdr.nel2; ++i, pf += m_hdr.nv1d)
-					{
-						s.add(i + m_hdr.nel8, mat3fs(pf[0], 0, 0, 0, 0, 0));
-					}
-
-					// load shell stress data
-					ELEMDATA* pe = &pstate->m_ELEM[0] + (m_hdr.nel8 + m_hdr.nel2);
-					for (int i=0; i<m_hdr.nel4; i++, pf += m_hdr.nv2d)
-					{
-						int n = i + m_hdr.nel8 + m_hdr.nel2;
-						mat3fs m(pf[0], pf[1], pf[2], pf[3], pf[4], pf[5]);
-						s.add(n, m);
-						ps.add(n, pf[6]);
-						p.add(n, -m.tr()/3.f);
-						pe[i].m_h[0] = pf[29];
-						pe[i].m_h[1] = pf[29];
-						pe[i].m_h[2] = pf[29];
-						pe[i].m_h[3] = pf[29];
-
-						if (m_hdr.nv2d == 44)
-						{
-							FEElementData<mat3fs,DATA_ITEM>& E  = dynamic_cast<FEElementData<mat3fs,DATA_ITEM>&>(pstate->m_Data[m_nfield[LSDYNA_SHELL_STRAIN]]);
-							mat3fs m;
-							m.x = 0.5f*(pf[32] + pf[38]);
-							m.y = 0.5f*(pf[33] + pf[39]);
-							m.z = 0.5f*(pf[34] + pf[40]);
-							m.xy = 0.5f*(pf[35] + pf[41]);
-							m.yz = 0.5f*(pf[36] + pf[42]);
-							m.xz = 0.5f*(pf[37] + pf[43]);
-							E.add(n, m);
-						}
-					}
-				}
-			}
+	// read nodal acceleration
+	if (m_hdr.flagA)
+	{
+		FENodeData<vec3f>& acc = dynamic_cast<FENodeData<vec3f>&>(state.m_Data[m_nfield[LSDYNA_ACC]]);
+		if (NN > 0)
+		{
+			float* pd = &(acc.data()->x);
+			for (int i=0; i<3*NN; ++i) pd[i] = pf[i];
 		}
+		pf += 3*NN;
 	}
-	while(!bdone);
 
-	delete [] pdata;
+	// read the nodal temperatures
+	if (m_hdr.flagT)
+	{
+		FENodeData<float>& T = dynamic_cast<FENodeData<float>&>(state.m_Data[m_nfield[LSDYNA_TEMP]]);
+		if (NN > 0) memcpy(T.data(), pf, NN*sizeof(float));
+		pf += NN;
+	}
 
-	return true;
+	// load solid stress data
+	if (m_hdr.flagU)
+	{
+		FEElementData<mat3fs,DATA_ITEM>& s  = dynamic_cast<FEElementData<mat3fs,DATA_ITEM>&>(state.m_Data[m_nfield[LSDYNA_STRESS  ]]);
+		FEElementData<float ,DATA_ITEM>& p  = dynamic_cast<FEElementData<float ,DATA_ITEM>&>(state.m_Data[m_nfield[LSDYNA_PRESSURE]]);
+		FEElementData<float ,DATA_ITEM>& ps = dynamic_cast<FEElementData<float ,DATA_ITEM>&>(state.m_Data[m_nfield[LSDYNA_PLASTIC ]]);
+		for (int i=0; i<m_hdr.nel8; i++, pf += m_hdr.nv3d)
+		{
+			mat3fs m;
+			m.x = pf[0];
+			m.y = pf[1];
+			m.z = pf[2];
+			m.xy = pf[3];
+			m.yz = pf[4];
+			m.xz = pf[5];
+			s.add(i, m);
+			ps.add(i, pf[6]);
+			p.add(i, -m.tr()/3.f);
+		}
+
+		// load beam stress data
+		for (int i=0; i<m_hdr.nel2; ++i, pf += m_hdr.nv1d)
+		{
+			s.add(i + m_hdr.nel8, mat3fs(pf[0], 0, 0, 0, 0, 0));
+		}
+
+		// load shell stress data
+		FEElementData<mat3fs,DATA_ITEM>* E = 0;
+		if (m_hdr.nv2d == 44) E = dynamic_cast<FEElementData<mat3fs,DATA_ITEM>*>(&state.m_Data[m_nfield[LSDYNA_SHELL_STRAIN]]);
+
+		ELEMDATA* pe = (m_hdr.nel4 > 0 ? &state.m_ELEM[0] + (m_hdr.nel8 + m_hdr.nel2) : 0);
+		for (int i=0; i<m_hdr.nel4; i++, pf += m_hdr.nv2d)
+		{
+			int n = i + m_hdr.nel8 + m_hdr.nel2;
+			mat3fs m(pf[0], pf[1], pf[2], pf[3], pf[4], pf[5]);
+			s.add(n, m);
+			ps.add(n, pf[6]);
+			p.add(n, -m.tr()/3.f);
+			pe[i].m_h[0] = pf[29];
+			pe[i].m_h[1] = pf[29];
+			pe[i].m_h[2] = pf[29];
+			pe[i].m_h[3] = pf[29];
+
+			if (E)
+			{
+				mat3fs m;
+				m.x = 0.5f*(pf[32] + pf[38]);
+				m.y = 0.5f*(pf[33] + pf[39]);
+				m.z = 0.5f*(pf[34] + pf[40]);
+				m.xy = 0.5f*(pf[35] + pf[41]);
+				m.yz = 0.5f*(pf[36] + pf[42]);
+				m.xz = 0.5f*(pf[37] + pf[43]);
+				E->add(n, m);
+			}
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -26,9 +26,14 @@ SOFTWARE.*/
 
 #pragma once
 #include "FEFileReader.h"
+#include <MathLib/math3d.h>
+#include <vector>
+#include <string>
 
 namespace Post {
 
+class FEState;
+
 struct PLOTHEADER
 {
 	char	Title[40];		// title of the problem
@@ -62,6 +67,15 @@ struct PLOTHEADER
 	int		UnUsed4[16];	// blank (unused)
 };
 
+//-----------------------------------------------------------------------------
+// options for reading states (same values as the xplt reader)
+enum LSDYNA_READ_STATE_FLAG {
+	LSDYNA_READ_ALL_STATES,
+	LSDYNA_READ_LAST_STATE_ONLY,
+	LSDYNA_READ_STATES_FROM_LIST,
+	LSDYNA_READ_FIRST_AND_LAST
+};
+
 //-----------------------------------------------------------------------------
 class FELSDYNAPlotImport : public FEFileReader
 {
@@ -78,22 +92,44 @@ class FELSDYNAPlotImport : public FEFileReader
 		LSDYNA_PLASTIC
 	};
 
+	// location of a state in the plot file family
+	struct STATE_INFO
+	{
+		int			nfile;		// index of file in family
+		off_type	noffset;	// byte offset of state in that file
+		float		time;		// time value of state
+	};
+
 public:
 	FELSDYNAPlotImport(FEPostModel* fem);
 	~FELSDYNAPlotImport();
 
 	bool Load(const char* szfile) override;
 
+	void SetReadStateFlag(int n) { m_read_state_flag = n; }
+	void SetReadStatesList(const std::vector<int>& l) { m_state_list = l; }
+
+	// set the storage mode for state data (see Post::Data_Storage)
+	void SetDataStorage(int n) { m_storage = n; }
+
 protected:
 	bool ReadHeader   (FEPostModel& fem);
 	bool ReadMesh     (FEPostModel& fem);
+	bool IndexStates  ();
 	bool ReadStates   (FEPostModel& fem);
 
 	void CreateMaterials(FEPostModel& fem);
 
+	void ReadStateData(FEState& state, const float* pf);
+
 protected:
 	int ReadData(void* pd, size_t nsize, size_t ncnt, bool bdump = false);
 
+	std::string FamilyFileName(int n);
+	off_type FamilyFileSize(int n);
+	bool OpenFamilyFile(int n);
+	bool ReadFamilyData(int nfile, off_type noffset, void* pd, size_t nbytes);
+
 public:
 	bool	m_brepeat;
 	int		m_naction;
@@ -104,6 +140,16 @@ protected:
 
 	PLOTHEADER	m_hdr;							//!< plot file header
 	int			m_nfield[LSDYNA_MAXFIELDS];		//!< pre-defined data fields
+
+	int						m_stateSize;	//!< number of words per state
+	std::vector<STATE_INFO>	m_states;		//!< index of all states in the file family
+	std::vector<off_type>	m_fileSize;		//!< sizes of the files in the family (-1 if missing)
+	std::vector<vec3f>		m_r0;			//!< initial nodal positions
+
+	// Options
+	int					m_read_state_flag;	//!< flag setting option for reading states
+	std::vector<int>	m_state_list;		//!< list of states to read (only for LSDYNA_READ_STATES_FROM_LIST)
+	int					m_storage;			//!< storage mode of state data
 };
 
 //-----------------------------------------------------------------------------
@@ -105,6 +105,10 @@ public:
 
 	FEPostModel* GetFEModel();
 
+	// compress the data to the given storage mode (see Data_Storage).
+	// Returns the max absolute error introduced by the compression.
+	virtual float Compress(int mode) { return 0.f; }
+
 protected:
 	FEState*	m_state;
 	Data_Type	m_ntype;
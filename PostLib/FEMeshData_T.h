@@ -30,6 +30,7 @@ SOFTWARE.*/
 #include "FEState.h"
 #include "FEPostMesh.h"
 #include "FEDataField.h"
+#include "FEDataArray.h"
 #include <set>
 using namespace std;
 
@@ -70,14 +71,18 @@ template <typename T> class FENodeData : public FENodeData_T<T>
 {
 public:
 	FENodeData(FEState* state, FEDataField* pdf) : FENodeData_T<T>(state, pdf) { m_data.resize(state->GetFEMesh()->Nodes()); }
-	void eval(int n, T* pv) { (*pv) = m_data[n]; }
+	void eval(int n, T* pv) { (*pv) = m_data.get(n); }
 	void copy(FENodeData<T>& d) { m_data = d.m_data; }
 
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
+
+	// pointer to the (full precision) values, for filling the array in bulk
+	T* data() { return (m_data.empty() ? nullptr : &m_data[0]); }
 
 protected:
-	vector<T>	m_data;
+	FEDataArray<T>	m_data;
 };
 
 //-----------------------------------------------------------------------------
@@ -144,7 +149,7 @@ public:
 		if (m_face.empty())
 			m_face.assign(state->GetFEMesh()->Faces(), -1); 
 	}
-	void eval(int n, T* pv) { (*pv) = m_data[m_face[n]]; }
+	void eval(int n, T* pv) { (*pv) = m_data.get(m_face[n]); }
 	bool active(int n) { return (m_face[n] >= 0); }
 	void copy(FEFaceData<T,DATA_ITEM>& d) { m_data = d.m_data; }
 	bool add(int n, const T& d)
@@ -161,9 +166,10 @@ public:
 
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
 
 protected:
-	vector<T>		m_data;
+	FEDataArray<T>	m_data;
 	vector<int>		m_face;
 };
 
@@ -176,7 +182,7 @@ public:
 		if (m_face.empty())
 			m_face.assign(state->GetFEMesh()->Faces(), -1); 
 	}
-	void eval(int n, T* pv) { (*pv) = m_data[m_face[n]]; }
+	void eval(int n, T* pv) { (*pv) = m_data.get(m_face[n]); }
 	bool active(int n) { return (m_face[n] >= 0); }
 	void copy(FEFaceData<T,DATA_ITEM>& d) { m_data = d.m_data; }
 	bool add(vector<int>& item, const T& v) 
@@ -198,9 +204,10 @@ public:
 
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
 
 protected:
-	vector<T>		m_data;
+	FEDataArray<T>	m_data;
 	vector<int>		m_face;
 };
 
@@ -217,7 +224,7 @@ public:
 	void eval(int n, T* pv)
 	{ 
         int m = FEMeshData::GetFEState()->GetFEMesh()->Face(n).Nodes();
-		for (int i=0; i<m; ++i) pv[i] = m_data[m_face[n] + i];
+		for (int i=0; i<m; ++i) pv[i] = m_data.get(m_face[n] + i);
 	}
 	bool active(int n) { return (m_face[n] >= 0); }
 	void copy(FEFaceData<T,DATA_COMP>& d) { m_data = d.m_data; m_face = d.m_face; }
@@ -235,9 +242,10 @@ public:
 
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
 
 protected:
-	vector<T>		m_data;
+	FEDataArray<T>	m_data;
 	vector<int>		m_face;
 };
 
@@ -259,14 +267,14 @@ public:
 	{ 
 		int n = m_face[2*nface];
 		int m = m_face[2*nface+1];
-		for (int i=0; i<m; ++i) pv[i] = m_data[m_indx[n + i] ]; 
+		for (int i=0; i<m; ++i) pv[i] = m_data.get(m_indx[n + i]); 
 	}
 	bool active(int n) { return (m_face[2*n] >= 0); }
 	void copy(FEFaceData<T,DATA_NODE>& d) { m_data = d.m_data; m_indx = d.m_indx; }
 	void add(vector<T>& data, vector<int>& face, vector<int>& index, vector<int>& nf)
 	{
 		int n0 = (int)m_data.size();
-		m_data.insert(m_data.end(), data.begin(), data.end());
+		m_data.append(data);
 		int c = 0;
 		for (int i = 0; i<(int)face.size(); ++i)
 		{
@@ -278,9 +286,10 @@ public:
 
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
 
 protected:
-	vector<T>		m_data;
+	FEDataArray<T>	m_data;
 	vector<int>		m_face;
 	vector<int>		m_indx; 
 };
@@ -452,7 +461,7 @@ public:
 	{ 
 		m_elem.assign(state->GetFEMesh()->Elements(), -1); 
 	}
-	void eval(int n, T* pv) { assert(m_elem[n] >= 0); (*pv) = m_data[m_elem[n]]; }
+	void eval(int n, T* pv) { assert(m_elem[n] >= 0); (*pv) = m_data.get(m_elem[n]); }
 	void set(int n, const T& v) { assert(m_elem[n] >= 0); m_data[m_elem[n]] = v; }
 	void copy(FEElementData<T, DATA_ITEM>& d) { m_data = d.m_data; }
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[n] >= 0); }
@@ -468,9 +477,10 @@ public:
 	}
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
 
 protected:
-	vector<T>		m_data;
+	FEDataArray<T>	m_data;
 	vector<int>		m_elem;
 };
 
@@ -483,7 +493,7 @@ public:
 		if (m_elem.empty())
 			m_elem.assign(state->GetFEMesh()->Elements(), -1); 
 	}
-	void eval(int n, T* pv) { assert(m_elem[n] >= 0); (*pv) = m_data[m_elem[n]]; }
+	void eval(int n, T* pv) { assert(m_elem[n] >= 0); (*pv) = m_data.get(m_elem[n]); }
 	void copy(FEElementData<T, DATA_REGION>& d) { m_data = d.m_data; }
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[n] >= 0); }
 	void add(vector<int>& item, const T& v) 
@@ -513,9 +523,10 @@ public:
 
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
 
 protected:
-	vector<T>		m_data;
+	FEDataArray<T>	m_data;
 	vector<int>		m_elem;
 };
 
@@ -536,7 +547,7 @@ public:
 	{ 
 		int n = m_elem[2*i  ];
 		int m = m_elem[2*i+1];
-		for (int j=0; j<m; ++j) pv[j] = m_data[n + j];
+		for (int j=0; j<m; ++j) pv[j] = m_data.get(n + j);
 	}
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[2 * n + 1] > 0); }
 	void copy(FEElementData<T,DATA_COMP>& d) { m_data = d.m_data; }
@@ -551,9 +562,10 @@ public:
 	}
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
 
 protected:
-	vector<T>		m_data;
+	FEDataArray<T>	m_data;
 	vector<int>		m_elem;
 };
 
@@ -575,7 +587,7 @@ public:
 	{ 
 		int n = m_elem[2*i  ];	// start index in data array
 		int m = m_elem[2*i+1];	// size of elem data (should be nr. of nodes)
-		for (int j=0; j<m; ++j) pv[j] = m_data[ m_indx[n + j] ];
+		for (int j=0; j<m; ++j) pv[j] = m_data.get(m_indx[n + j]);
 	}
 	void set(int i, int j, T& v)
 	{
@@ -587,7 +599,7 @@ public:
 	void add(vector<T>& d, vector<int>& e, vector<int>& l, int ne) 
 	{ 
 		int n0 = (int) m_data.size();
-		m_data.insert(m_data.end(), d.begin(), d.end());
+		m_data.append(d);
 		for (int i=0; i<(int) e.size(); ++i) 
 		{
 			m_elem[2*e[i]  ] = (int) m_indx.size();
@@ -597,9 +609,10 @@ public:
 	}
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
+	float Compress(int mode) override { return m_data.compress(mode); }
 
 protected:
-	vector<T>		m_data;
+	FEDataArray<T>	m_data;
 	vector<int>		m_elem;
 	vector<int>		m_indx;
 };
@@ -69,6 +69,10 @@ FEPostModel::FEPostModel()
 	m_nTime = 0;
 	m_fTime = 0.f;
 
+	m_histClass = 0;
+	m_histField = -1;
+	m_histStates = 0;
+
 	m_pThis = this;
 }
 
@@ -239,6 +243,8 @@ void FEPostModel::ClearStates()
 	for (int i=0; i<(int) m_State.size(); i++) delete m_State[i];
 	m_State.clear();
 	m_nTime = 0;
+
+	ClearHistoryCache();
 }
 
 //-----------------------------------------------------------------------------
@@ -247,12 +253,28 @@ void FEPostModel::AddState(FEState* pFEState)
 	pFEState->SetID((int) m_State.size());
 	pFEState->m_ref = m_RefState[m_RefState.size() - 1];
 	m_State.push_back(pFEState); 
+	ClearHistoryCache();
+
+	// apply the storage mode of the data fields
+	FEDataFieldPtr pd = m_pDM->FirstDataField();
+	int N = pFEState->m_Data.size();
+	for (int i = 0; i < N; ++i, ++pd)
+	{
+		int storage = (*pd)->GetStorage();
+		if (storage != STORAGE_FLOAT)
+		{
+			float err = pFEState->m_Data[i].Compress(storage);
+			(*pd)->UpdateStorageError(err);
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
 // add a state
 void FEPostModel::AddState(float ftime)
 {
+	ClearHistoryCache();
+
 	vector<FEState*>::iterator it = m_State.begin();
 	for (it = m_State.begin(); it != m_State.end(); ++it)
 		if ((*it)->m_time > ftime)
@@ -271,6 +293,8 @@ void FEPostModel::AddState(float ftime)
 // delete a state
 void FEPostModel::DeleteState(int n)
 {
+	ClearHistoryCache();
+
 	vector<FEState*>::iterator it = m_State.begin();
 	int N = m_State.size();
 	assert((n>=0) && (n<N));
@@ -285,6 +309,8 @@ void FEPostModel::DeleteState(int n)
 // insert a state a time f
 void FEPostModel::InsertState(FEState *ps, float f)
 {
+	ClearHistoryCache();
+
 	vector<FEState*>::iterator it = m_State.begin();
 	for (it=m_State.begin(); it != m_State.end(); ++it)
 		if ((*it)->m_time > f) 
@@ -978,6 +1004,9 @@ void FEPostModel::AddDependant(FEModelDependant* pc)
 //-----------------------------------------------------------------------------
 void FEPostModel::UpdateDependants()
 {
+	// the data has changed so the cached histories are no longer valid
+	ClearHistoryCache();
+
 	int N = m_Dependants.size();
 	for (int i=0; i<N; ++i) m_Dependants[i]->Update(this);
 }
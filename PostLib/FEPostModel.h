@@ -214,6 +214,24 @@ public:
 	// evaluate based on point
 	void EvaluateNode(const vec3f& r, int ntime, int nfield, NODEDATA& d);
 
+	// evaluate the time history of a list of items between states nmin and nmax (-1 = last state).
+	// The values are stored per item, i.e. val[i*nstates + n] is the value of items[i] at 
+	// state nmin + n. Returns the number of states.
+	int EvaluateNodeHistory   (const vector<int>& items, int nfield, int nmin, int nmax, vector<float>& val);
+	int EvaluateEdgeHistory   (const vector<int>& items, int nfield, int nmin, int nmax, vector<float>& val);
+	int EvaluateFaceHistory   (const vector<int>& items, int nfield, int nmin, int nmax, vector<float>& val);
+	int EvaluateElementHistory(const vector<int>& items, int nfield, int nmin, int nmax, vector<float>& val);
+
+	// Item-major cache of the time history of one field for all nodes (CLASS_NODE), 
+	// faces (CLASS_FACE) or elements (CLASS_ELEM). The Evaluate*History functions use it
+	// when the field matches. The cache is cleared when states or data fields change.
+	bool BuildHistoryCache(Data_Class itemClass, int nfield);
+	void ClearHistoryCache();
+	bool HasHistoryCache(Data_Class itemClass, int nfield);
+
+	// returns the cached values of an item (one per state), or 0 if the field is not cached
+	const float* CachedHistory(Data_Class itemClass, int nfield, int item);
+
 	// evaluate vector functions
 	vec3f EvaluateNodeVector(int n, int ntime, int nvec);
 	bool EvaluateFaceVector(int n, int ntime, int nvec, vec3f& r);
@@ -225,7 +243,7 @@ public:
 	mat3f EvaluateElemTensor(int n, int ntime, int nten, int ntype = -1);
 
 	// displacement field
-	void SetDisplacementField(int ndisp) { m_ndisp = ndisp; }
+	void SetDisplacementField(int ndisp) { m_ndisp = ndisp; ClearHistoryCache(); }
 	int GetDisplacementField() { return m_ndisp; }
 	vec3f NodePosition(int n, int ntime);
 	vec3f FaceNormal(FEFace& f, int ntime);
@@ -301,6 +319,12 @@ protected:
 	FEDataManager*		m_pDM;		// the Data Manager
 	int					m_ndisp;	// vector field defining the displacement
 
+	// --- H I S T O R Y   C A C H E ---
+	int				m_histClass;	// item class of cached field (0 = none)
+	int				m_histField;	// field code of cached field
+	int				m_histStates;	// nr of states when cache was built
+	vector<float>	m_histVal;		// cached values, i.e. m_histVal[item*m_histStates + state]
+
 	// dependants
 	vector<FEModelDependant*>	m_Dependants;
 
@@ -24,10 +24,11 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 
+
 #include "stdafx.h"
 #include "FESTLimport.h"
 #include "FEPostModel.h"
-#include <ctype.h>
+#include <MeshLib/STLTools.h>
 #include <FSCore/color.h>
 
 using namespace Post;
@@ -41,134 +42,80 @@ FESTLimport::~FESTLimport(void)
 {
 }
 
-bool FESTLimport::read_line(char* szline, const char* sz)
-{
-	m_nline++;
-
-	int l = strlen(sz);
-	if (fgets(szline, 255, m_fp) == 0) return false;
-
-	// remove leading white space
-	int n = 0;
-	while (isspace(szline[n])) ++n;
-	if (n != 0)
-	{
-		char* ch = szline + n;
-		n = 0;
-		while (*ch) szline[n++] = *ch++;
-	}
-	
-	if (strncmp(szline, sz, l) != 0) return false;
-
-	return true;
-}
-
 bool FESTLimport::Load(const char* szfile)
 {
 	m_fem->Clear();
-	m_nline = 0;
 
 	// try to open the file
-	if (Open(szfile, "rt") == false) return errf("Failed opening file %s.", szfile);
+	if (Open(szfile, "rb") == false) return errf("Failed opening file %s.", szfile);
 
-	// read the first line
-	char szline[256] = {0};
-	if (read_line(szline, "solid ") == false) return errf("First line must be solid definition.");
+	// read the entire file
+	std::vector<char> buf;
+	if (ReadAll(buf) == false) return errf("Failed reading file %s.", szfile);
 
-	// clear the list
-	m_Face.clear();
+	// close the file
+	Close();
 
 	// read all the triangles
-	FACET face;
-	do
+	std::vector<vec3f> vert;
+	int nline = 0;
+	if (STLParseASCII(&buf[0], buf.size() - 1, vert, nline) == false)
 	{
-		// read the facet line
-		if (read_line(szline, "facet normal") == false)
-		{
-			// check for the endsolid tag
-			if (strncmp(szline, "endsolid", 8) == 0) break; 
-			else return errf("Error encountered at line %d", m_nline);
-		}
-
-		// read the outer loop line
-		if (read_line(szline, "outer loop") == false) return errf("Error encountered at line %d", m_nline);
-
-		// read the vertex data
-		float x, y, z;
-		for (int i=0; i<3; ++i)
-		{
-			if (read_line(szline, "vertex ") == false) return errf("Error encountered at line %d", m_nline);
-			sscanf(szline, "vertex %g%g%g", &x, &y, &z);
-
-			face.r[i].x = x;
-			face.r[i].y = y;
-			face.r[i].z = z;
-		}
-
-		// read the endloop tag
-		if (read_line(szline, "endloop") == false) return errf("Error encountered at line %d", m_nline);
-
-		// read the endfacet tag
-		if (read_line(szline, "endfacet") == false) return errf("Error encountered at line %d", m_nline);
-
-		// add the facet to the list
-		m_Face.push_back(face);
+		if (nline == 1) return errf("First line must be solid definition.");
+		else return errf("Error encountered at line %d", nline);
 	}
-	while (1);
-
-	// close the file
-	Close();
+	buf = std::vector<char>();
 
 	// build the nodes
-	build_mesh();
+	build_mesh(vert);
 
 	return true;
 }
 
-void FESTLimport::build_mesh()
+void FESTLimport::build_mesh(const std::vector<vec3f>& vert)
 {
-	int i;
-
 	// add one material to the scene
 	FEMaterial mat;
 	m_fem->AddMaterial(mat);
 
-	// reserve space for nodes
-	int NF = m_Face.size();
-	m_Node.reserve(NF*3);
+	// merge the coincident vertices
+	std::vector<vec3f> node;
+	std::vector<int> index;
+	int NN = WeldVertices(vert, node, index);
 
-	// create the nodes
-	list<FACET>::iterator pf = m_Face.begin();
-	for (int i=0; i<NF; ++i, ++pf)
+	// skip facets that collapsed
+	int NF = (int)vert.size() / 3;
+	std::vector<int> elemId(NF, -1);
+	int NE = 0;
+	for (int i = 0; i < NF; ++i)
 	{
-		FACET& f = *pf;
-		for (int j=0; j<3; ++j) f.n[j] = find_node(f.r[j]);
+		const int* n = &index[3 * i];
+		if ((n[0] != n[1]) && (n[0] != n[2]) && (n[1] != n[2])) elemId[i] = NE++;
 	}
-	int NN = m_Node.size();
 
 	// create the mesh
 	FEPostMesh* pm = new FEPostMesh();
-	pm->Create(NN, NF);
+	pm->Create(NN, NE);
 
 	// create nodes
-	for (i=0; i<NN; ++i)
+	for (int i = 0; i < NN; ++i)
 	{
 		FENode& n = pm->Node(i);
-		vec3f& ri = m_Node[i];
-		n.r = ri;
+		n.r = node[i];
 	}
 	m_fem->AddMesh(pm);
 
 	// create elements
-	list<FACET>::iterator is = m_Face.begin();
-	for (i=0; i<NF; ++i, ++is)
+	for (int i = 0; i < NF; ++i)
 	{
-		FACET& f = *is;
-		FEElement& e = pm->Element(i);
+		int ne = elemId[i];
+		if (ne < 0) continue;
+
+		FEElement& e = pm->Element(ne);
 		e.SetType(FE_TRI3);
-		e.m_node[0] = f.n[0];
-		e.m_node[1] = f.n[1];
-		e.m_node[2] = f.n[2];
+		e.m_node[0] = index[3 * i    ];
+		e.m_node[1] = index[3 * i + 1];
+		e.m_node[2] = index[3 * i + 2];
 		e.m_MatID = 0;
 	}
 
@@ -180,16 +127,3 @@ void FESTLimport::build_mesh()
 	FEState* ps = new FEState(0.f, m_fem, m_fem->GetFEMesh(0));
 	m_fem->AddState(ps);
 }
-
-int FESTLimport::find_node(vec3f& r, const double eps)
-{
-	int N = m_Node.size();
-	for (int i=0; i<N; ++i)
-	{
-		vec3f& ri = m_Node[i];
-		if ((ri - r)*(ri - r) < eps) return i;
-	}
-
-	m_Node.push_back(r);
-	return m_Node.size() - 1;
-}
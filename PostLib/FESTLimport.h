@@ -24,22 +24,16 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 
+
 #pragma once
 #include "FEFileReader.h"
 #include <MathLib/math3d.h>
 #include <vector>
-#include <list>
 
 namespace Post {
 
 class FESTLimport : public FEFileReader
 {
-	struct FACET
-	{
-		vec3f	r[3];
-		int		n[3];
-	};
-
 public:
 	FESTLimport(FEPostModel* fem);
 	virtual ~FESTLimport(void);
@@ -47,15 +41,7 @@ public:
 	bool Load(const char* szfile) override;
 
 protected:
-	bool read_line(char* szline, const char* sz);
-
-	void build_mesh();
-	int find_node(vec3f& r, const double eps = 1e-12);
-
-protected:
-	std::list<FACET>	m_Face;
-	std::vector<vec3f>	m_Node;
-	int					m_nline;	// line counter
+	void build_mesh(const std::vector<vec3f>& vert);
 };
 
 }
@@ -26,12 +26,16 @@ SOFTWARE.*/
 
 #include "FEVTKExport.h"
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <zlib.h>
 #include "FEPostModel.h"
 #include "FEMeshData_T.h"
 
 using namespace Post;
 
 enum VTK_CELLTYPE {
+	VTK_EMPTY_CELL =             0,
 	VTK_VERTEX =                 1,
 	VTK_POLY_VERTEX =            2,
 	VTK_LINE =                   3,
@@ -54,17 +58,188 @@ enum VTK_CELLTYPE {
 	VTK_QUADRATIC_WEDGE =        26
 };
 
-void Space2_(char* szname)
+// sources of the arrays in a VTU file
+enum VTU_SOURCE {
+	VTU_POINT_FIELD,
+	VTU_CELL_FIELD,
+	VTU_POINTS,
+	VTU_CONNECTIVITY,
+	VTU_OFFSETS,
+	VTU_TYPES
+};
+
+// an array in the appended data section of a VTU file
+struct VTU_ARRAY
 {
-	int n = (int)strlen(szname);
-	for (int i = 0; i<n; ++i)
-		if (szname[i] == ' ') szname[i] = '_';
+	int							nsrc;	// source of array (see VTU_SOURCE)
+	const FEVTKExport::FIELD*	f;		// data field (for field arrays)
+	const char*					sztype;	// VTK data type
+	int							ncomp;	// number of components
+	size_t						size;	// size of uncompressed data (in bytes)
+	unsigned long long			offset;	// offset in appended data
+	vector<unsigned char>		data;	// compressed data
+};
+
+// uncompressed block size of zlib compressed arrays
+const size_t VTU_BLOCK_SIZE = (1 << 18);
+
+//-----------------------------------------------------------------------------
+static int vtk_cell_type(int ntype)
+{
+	switch (ntype)
+	{
+	case FE_HEX8   : return VTK_HEXAHEDRON;
+	case FE_TET4   : return VTK_TETRA;
+	case FE_PENTA6 : return VTK_WEDGE;
+	case FE_QUAD4  : return VTK_QUAD;
+	case FE_TRI3   : return VTK_TRIANGLE;
+	case FE_BEAM2  : return VTK_LINE;
+	case FE_HEX20  : return VTK_QUADRATIC_HEXAHEDRON;
+	case FE_QUAD8  : return VTK_QUADRATIC_QUAD;
+	case FE_BEAM3  : return VTK_QUADRATIC_EDGE;
+	case FE_TET10  : return VTK_QUADRATIC_TETRA;
+	case FE_TET15  : return VTK_QUADRATIC_TETRA;
+	case FE_PENTA15: return VTK_QUADRATIC_WEDGE;
+	case FE_HEX27  : return VTK_QUADRATIC_HEXAHEDRON;
+	case FE_TRI6   : return VTK_QUADRATIC_TRIANGLE;
+	case FE_QUAD9  : return VTK_QUADRATIC_QUAD;
+	}
+	return VTK_EMPTY_CELL;
+}
+
+//-----------------------------------------------------------------------------
+// number of VTK components of a data type. Tensors are written as full 3x3 matrices.
+static int vtk_components(int ntype)
+{
+	switch (ntype)
+	{
+	case DATA_FLOAT : return 1;
+	case DATA_VEC3F : return 3;
+	case DATA_MAT3FS: return 9;
+	case DATA_MAT3FD: return 9;
+	}
+	return 0;
 }
 
+//-----------------------------------------------------------------------------
+// convert the packed tensor values (see write_data) to 3x3 matrices
+static void expand_tensors(vector<float>& val, int ntype)
+{
+	if (ntype == DATA_MAT3FS)
+	{
+		size_t N = val.size() / 6;
+		vector<float> t(9 * N);
+		for (size_t i = 0; i < N; ++i)
+		{
+			const float* v = &val[6 * i];
+			float* m = &t[9 * i];
+			m[0] = v[0]; m[1] = v[3]; m[2] = v[5];
+			m[3] = v[3]; m[4] = v[1]; m[5] = v[4];
+			m[6] = v[5]; m[7] = v[4]; m[8] = v[2];
+		}
+		val.swap(t);
+	}
+	else if (ntype == DATA_MAT3FD)
+	{
+		size_t N = val.size() / 3;
+		vector<float> t(9 * N, 0.f);
+		for (size_t i = 0; i < N; ++i)
+		{
+			t[9 * i    ] = val[3 * i    ];
+			t[9 * i + 4] = val[3 * i + 1];
+			t[9 * i + 8] = val[3 * i + 2];
+		}
+		val.swap(t);
+	}
+}
+
+//-----------------------------------------------------------------------------
+static bool is_little_endian()
+{
+	int n = 1;
+	return (*((char*)&n) == 1);
+}
 
+//-----------------------------------------------------------------------------
+// The legacy binary format stores all values as big-endian.
+template <typename T> static void write_binary(FILE* fp, const T* v, size_t n)
+{
+	static_assert(sizeof(T) == 4, "only 4-byte values are supported");
+	const unsigned char* src = (const unsigned char*)v;
+	size_t nbytes = 4 * n;
+	if (is_little_endian() == false)
+	{
+		fwrite(src, 1, nbytes, fp);
+		return;
+	}
+
+	unsigned char buf[1 << 16];
+	while (nbytes > 0)
+	{
+		size_t m = (nbytes < sizeof(buf) ? nbytes : sizeof(buf));
+		for (size_t i = 0; i < m; i += 4)
+		{
+			buf[i    ] = src[i + 3];
+			buf[i + 1] = src[i + 2];
+			buf[i + 2] = src[i + 1];
+			buf[i + 3] = src[i    ];
+		}
+		fwrite(buf, 1, m, fp);
+		src += m;
+		nbytes -= m;
+	}
+}
+
+//-----------------------------------------------------------------------------
+static void write_array(FILE* fp, bool binary, const vector<float>& val, int ncols)
+{
+	if (binary)
+	{
+		if (val.empty() == false) write_binary(fp, &val[0], val.size());
+		fprintf(fp, "\n");
+	}
+	else
+	{
+		size_t N = val.size();
+		for (size_t i = 0; i < N; i += ncols)
+		{
+			for (int k = 0; (k < ncols) && (i + k < N); ++k) fprintf(fp, "%g ", val[i + k]);
+			fprintf(fp, "\n");
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Compress a buffer with the block format of vtkZLibDataCompressor (UInt64 header).
+static bool zlib_encode(const vector<unsigned char>& src, vector<unsigned char>& dst)
+{
+	size_t N = src.size();
+	size_t blocks = N / VTU_BLOCK_SIZE + (N % VTU_BLOCK_SIZE ? 1 : 0);
+	vector<unsigned long long> hdr(3 + blocks);
+	hdr[0] = blocks;
+	hdr[1] = VTU_BLOCK_SIZE;
+	hdr[2] = N % VTU_BLOCK_SIZE;
+
+	dst.assign(8 * hdr.size(), 0);
+	vector<unsigned char> tmp(compressBound((uLong)VTU_BLOCK_SIZE));
+	for (size_t i = 0; i < blocks; ++i)
+	{
+		size_t n0 = i * VTU_BLOCK_SIZE;
+		size_t n = (N - n0 < VTU_BLOCK_SIZE ? N - n0 : VTU_BLOCK_SIZE);
+		uLongf nc = (uLongf)tmp.size();
+		if (compress2(&tmp[0], &nc, &src[n0], (uLong)n, Z_BEST_SPEED) != Z_OK) return false;
+		hdr[3 + i] = nc;
+		dst.insert(dst.end(), tmp.begin(), tmp.begin() + nc);
+	}
+	memcpy(&dst[0], &hdr[0], 8 * hdr.size());
+	return true;
+}
+
+//-----------------------------------------------------------------------------
 FEVTKExport::FEVTKExport(void)
 {
 	m_bwriteAllStates = false;
+	m_format = VTK_ASCII;
 }
 
 FEVTKExport::~FEVTKExport(void)
@@ -81,31 +256,51 @@ bool FEVTKExport::Save(FEPostModel& fem, const char* szfile)
     int ns = fem.GetStates();
     if (ns == 0) return false;
 
+	bool xml = ((m_format == VTU_RAW) || (m_format == VTU_ZLIB));
+
 	if (m_bwriteAllStates)
 	{
-		char szroot[256] = {0}, szname[256] = {0}, szext[16] = {0};
-		const char* sz;
-		sz = strrchr(szfile, '.');
-		if (sz == 0) {
-			strcpy(szroot, szfile);
-			strcat(szroot,".");
-			strcpy(szext,".vtk");
+		// split the file name in root and extension
+		std::string root(szfile), ext;
+		size_t n = root.find_last_of("./\\");
+		if ((n == std::string::npos) || (root[n] != '.'))
+		{
+			root += ".";
+			ext = ".vtk";
 		}
-		else {
-			int l = sz - szfile + 1;
-			strncpy(szroot, szfile, l);
-			szroot[l] = 0;
-			strcpy(szext, sz);
+		else
+		{
+			ext = root.substr(n);
+			root.erase(n + 1);
 		}
-    
-		// save each state in a separate file
+
+		// the states of the XML format always go in .vtu files
+		if (xml) ext = ".vtu";
+
 		int l0 = (int) log10((double)ns) + 1;
-		for (int is=0; is<ns; ++is) 
+		vector<std::string> files(ns);
+		for (int is = 0; is < ns; ++is)
 		{
-			if (sprintf(szname, "%st%0*d%s",szroot,l0,is,szext) < 0) return false;
+			char szstate[32];
+			sprintf(szstate, "t%0*d", l0, is);
+			files[is] = root + szstate + ext;
+		}
 
-			if (WriteState(szname, fem.GetState(is)) == false) return false;
+		// save each state in a separate file
+		int nfail = 0;
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int is=0; is<ns; ++is) 
+		{
+			if (WriteState(files[is].c_str(), fem.GetState(is)) == false)
+			{
+#pragma omp atomic
+				nfail++;
+			}
 		}
+		if (nfail > 0) return false;
+
+		// the .pvd file lets ParaView load the states as a time series
+		if (xml) return WritePVD((root + "pvd").c_str(), fem, files);
 
 		return true;
 	}
@@ -116,296 +311,384 @@ bool FEVTKExport::Save(FEPostModel& fem, const char* szfile)
 	}
 }        
 
+//-----------------------------------------------------------------------------
 bool FEVTKExport::WriteState(const char* szname, FEState* ps)
 {
 	FEPostMesh* pm = ps->GetFEMesh();
 	if (pm == 0) return false;
 
-	m_fp = fopen(szname, "wt");
-	if (m_fp == 0) return false;
-        
-	// --- H E A D E R ---
-	WriteHeader(ps);
-	
-	// --- N O D E S ---
-	WritePoints(ps);
-        
-    // --- E L E M E N T S ---
-	WriteCells(ps);
-        
-    // --- N O D E   D A T A ---
-	WritePointData(ps);
-        
-    // --- E L E M E N T   C E L L   D A T A ---
-	WriteCellData(ps);
-        
-    fclose(m_fp);
-	m_fp = nullptr;
+	FILE* fp = fopen(szname, (m_format == VTK_ASCII ? "wt" : "wb"));
+	if (fp == 0) return false;
+	setvbuf(fp, 0, _IOFBF, 1 << 20);
 
-	return true;
+	bool bret = false;
+	if ((m_format == VTU_RAW) || (m_format == VTU_ZLIB))
+		bret = WriteVTU(fp, ps);
+	else
+		bret = WriteLegacy(fp, ps);
+
+	if (ferror(fp)) bret = false;
+	fclose(fp);
+
+	return bret;
 }
 
 //-----------------------------------------------------------------------------
-void FEVTKExport::WriteHeader(FEState* ps)
+bool FEVTKExport::WritePVD(const char* szfile, FEPostModel& fem, const vector<std::string>& files)
 {
-	fprintf(m_fp, "%s\n"       ,"# vtk DataFile Version 3.0");
-	fprintf(m_fp, "%s %g\n"    ,"vtk output at time", ps->m_time);
-	fprintf(m_fp, "%s\n"       ,"ASCII");
-	fprintf(m_fp, "%s\n"       ,"DATASET UNSTRUCTURED_GRID");
+	FILE* fp = fopen(szfile, "wt");
+	if (fp == 0) return false;
+
+	fprintf(fp, "<?xml version=\"1.0\"?>\n");
+	fprintf(fp, "<VTKFile type=\"Collection\" version=\"0.1\">\n");
+	fprintf(fp, "  <Collection>\n");
+	for (int i = 0; i < (int)files.size(); ++i)
+	{
+		// the files are referenced relative to the .pvd file
+		const std::string& file = files[i];
+		size_t n = file.find_last_of("/\\");
+		std::string name = (n == std::string::npos ? file : file.substr(n + 1));
+
+		fprintf(fp, "    <DataSet timestep=\"%g\" group=\"\" part=\"0\" file=\"%s\"/>\n", fem.GetState(i)->m_time, name.c_str());
+	}
+	fprintf(fp, "  </Collection>\n");
+	fprintf(fp, "</VTKFile>\n");
+
+	bool bret = (ferror(fp) == 0);
+	fclose(fp);
+	return bret;
 }
 
 //-----------------------------------------------------------------------------
-void FEVTKExport::WritePoints(FEState* ps)
+bool FEVTKExport::WriteLegacy(FILE* fp, FEState* ps)
 {
-	FEPostMesh& m = *ps->GetFEMesh();
-	int nodes = m.Nodes();
-	fprintf(m_fp, "POINTS %d float\n", nodes);
-	for (int j=0; j<nodes; j += 3)
-	{
-	    for (int k =0; k<3 && j+k<nodes;k++)
-	    {
-	        vec3f& r = ps->m_NODE[j+k].m_rt;
-	        fprintf(m_fp, "%g %g %g ", r.x, r.y, r.z);
-	    }
-	    fprintf(m_fp, "\n");
-	}
-	fprintf(m_fp, "%s\n" ,"");
+	FEPostMesh& mesh = *ps->GetFEMesh();
+	int NN = mesh.Nodes();
+	int NE = mesh.Elements();
+	bool binary = (m_format == VTK_BINARY);
+
+	// --- H E A D E R ---
+	fprintf(fp, "# vtk DataFile Version 3.0\n");
+	fprintf(fp, "vtk output at time %g\n", ps->m_time);
+	fprintf(fp, "%s\n", (binary ? "BINARY" : "ASCII"));
+	fprintf(fp, "DATASET UNSTRUCTURED_GRID\n");
+
+	// --- N O D E S ---
+	vector<float> val(3 * NN);
+	for (int i = 0; i < NN; ++i)
+	{
+		vec3f& r = ps->m_NODE[i].m_rt;
+		val[3 * i] = r.x; val[3 * i + 1] = r.y; val[3 * i + 2] = r.z;
+	}
+	fprintf(fp, "POINTS %d float\n", NN);
+	write_array(fp, binary, val, 9);
+
+	// --- E L E M E N T S ---
+	vector<int> cells, types(NE);
+	for (int i = 0; i < NE; ++i)
+	{
+		FEElement_& el = mesh.ElementRef(i);
+		cells.push_back(el.Nodes());
+		for (int k = 0; k < el.Nodes(); ++k) cells.push_back(el.m_node[k]);
+		types[i] = vtk_cell_type(el.Type());
+	}
+
+	fprintf(fp, "\nCELLS %d %d\n", NE, (int)cells.size());
+	if (binary)
+	{
+		if (NE > 0) write_binary(fp, &cells[0], cells.size());
+		fprintf(fp, "\n");
+	}
+	else
+	{
+		for (size_t i = 0; i < cells.size(); i += cells[i] + 1)
+		{
+			for (int k = 0; k <= cells[i]; ++k) fprintf(fp, "%d ", cells[i + k]);
+			fprintf(fp, "\n");
+		}
+	}
+
+	fprintf(fp, "\nCELL_TYPES %d\n", NE);
+	if (binary)
+	{
+		if (NE > 0) write_binary(fp, &types[0], types.size());
+		fprintf(fp, "\n");
+	}
+	else for (int i = 0; i < NE; ++i) fprintf(fp, "%d\n", types[i]);
+
+	// --- D A T A ---
+	vector<FIELD> pointFields, cellFields;
+	FindFields(ps, pointFields, cellFields);
+
+	for (int n = 0; n < 2; ++n)
+	{
+		vector<FIELD>& fields = (n == 0 ? pointFields : cellFields);
+		if (fields.empty()) continue;
+
+		if (n == 0) fprintf(fp, "\nPOINT_DATA %d\n", NN);
+		else fprintf(fp, "\nCELL_DATA %d\n", NE);
+
+		for (int i = 0; i < (int)fields.size(); ++i)
+		{
+			FIELD& f = fields[i];
+			bool bok = (n == 0 ? FillPointField(ps, f, val) : FillCellField(ps, f, val));
+			if (bok == false) continue;
+
+			const char* szname = f.name.c_str();
+			if (f.ncomp == 1)
+			{
+				fprintf(fp, "SCALARS %s float\n", szname);
+				fprintf(fp, "LOOKUP_TABLE default\n");
+				write_array(fp, binary, val, 1);
+			}
+			else if (f.ncomp == 3)
+			{
+				fprintf(fp, "VECTORS %s float\n", szname);
+				write_array(fp, binary, val, 3);
+			}
+			else if (f.ncomp == 9)
+			{
+				fprintf(fp, "TENSORS %s float\n", szname);
+				write_array(fp, binary, val, 3);
+			}
+		}
+	}
+
+	return true;
 }
 
 //-----------------------------------------------------------------------------
-void FEVTKExport::WriteCells(FEState* ps)
+// Writes an unstructured grid in the XML format. All arrays are appended. The raw
+// arrays are generated while they are written, so that only one array is held
+// in memory. Compressed arrays are generated up front since their size must be known
+// before the XML header can be written.
+bool FEVTKExport::WriteVTU(FILE* fp, FEState* ps)
 {
-	FEPostMesh&m = *ps->GetFEMesh();
-	int NE = m.Elements();
-    int nsize = 0;
-	for (int j = 0; j<NE; ++j)
-        nsize += m.ElementRef(j).Nodes() + 1;
-
-	// Write CELLS
-    fprintf(m_fp, "CELLS %d %d\n", NE, nsize);
-    for (int j=0; j<m.Elements(); ++j)
-    {
-		FEElement_& el = m.ElementRef(j);
-        fprintf(m_fp, "%d ", el.Nodes());
-        for (int k=0; k<el.Nodes(); ++k) fprintf(m_fp, "%d ", el.m_node[k]);
-        fprintf(m_fp, "\n");
-    }
-        
-	// Write CELL_TYPES
-    fprintf(m_fp, "\nCELL_TYPES %d\n", NE);
-	for (int j = 0; j<m.Elements(); ++j)
-    {
-		FEElement_& el = m.ElementRef(j);
-        int vtk_type;
-        switch (el.Type()) {
-            case FE_HEX8   : vtk_type = VTK_HEXAHEDRON; break;
-            case FE_TET4   : vtk_type = VTK_TETRA; break;
-            case FE_PENTA6 : vtk_type = VTK_WEDGE; break;
-            case FE_QUAD4  : vtk_type = VTK_QUAD; break;
-            case FE_TRI3   : vtk_type = VTK_TRIANGLE; break;
-            case FE_BEAM2  : vtk_type = VTK_LINE; break;
-            case FE_HEX20  : vtk_type = VTK_QUADRATIC_HEXAHEDRON; break;
-            case FE_QUAD8  : vtk_type = VTK_QUADRATIC_QUAD; break;
-            case FE_BEAM3  : vtk_type = VTK_QUADRATIC_EDGE; break;
-            case FE_TET10  : vtk_type = VTK_QUADRATIC_TETRA; break;
-            case FE_TET15  : vtk_type = VTK_QUADRATIC_TETRA; break;
-            case FE_PENTA15: vtk_type = VTK_QUADRATIC_WEDGE; break;
-            case FE_HEX27  : vtk_type = VTK_QUADRATIC_HEXAHEDRON; break;
-            case FE_TRI6   : vtk_type = VTK_QUADRATIC_TRIANGLE; break;
-            case FE_QUAD9  : vtk_type = VTK_QUADRATIC_QUAD; break;
-            default: vtk_type = -1; break;
-        }
-            
-        fprintf(m_fp, "%d\n", vtk_type);
-    }
+	FEPostMesh& mesh = *ps->GetFEMesh();
+	int NN = mesh.Nodes();
+	int NE = mesh.Elements();
+	bool compress = (m_format == VTU_ZLIB);
+
+	size_t nconn = 0;
+	for (int i = 0; i < NE; ++i) nconn += mesh.ElementRef(i).Nodes();
+
+	vector<FIELD> pointFields, cellFields;
+	FindFields(ps, pointFields, cellFields);
+
+	// setup the arrays
+	vector<VTU_ARRAY> arrays;
+	VTU_ARRAY a;
+	a.offset = 0;
+	for (size_t i = 0; i < pointFields.size(); ++i)
+	{
+		a.nsrc = VTU_POINT_FIELD; a.f = &pointFields[i]; a.sztype = "Float32"; a.ncomp = a.f->ncomp; a.size = 4 * (size_t)NN * a.ncomp;
+		arrays.push_back(a);
+	}
+	for (size_t i = 0; i < cellFields.size(); ++i)
+	{
+		a.nsrc = VTU_CELL_FIELD; a.f = &cellFields[i]; a.sztype = "Float32"; a.ncomp = a.f->ncomp; a.size = 4 * (size_t)NE * a.ncomp;
+		arrays.push_back(a);
+	}
+	a.f = nullptr;
+	a.nsrc = VTU_POINTS; a.sztype = "Float32"; a.ncomp = 3; a.size = 12 * (size_t)NN; arrays.push_back(a);
+	a.nsrc = VTU_CONNECTIVITY; a.sztype = "Int32"; a.ncomp = 1; a.size = 4 * nconn; arrays.push_back(a);
+	a.nsrc = VTU_OFFSETS; a.sztype = "Int32"; a.ncomp = 1; a.size = 4 * (size_t)NE; arrays.push_back(a);
+	a.nsrc = VTU_TYPES; a.sztype = "UInt8"; a.ncomp = 1; a.size = (size_t)NE; arrays.push_back(a);
+
+	// compress the arrays and calculate the offsets
+	vector<unsigned char> buf;
+	unsigned long long offset = 0;
+	for (size_t i = 0; i < arrays.size(); ++i)
+	{
+		VTU_ARRAY& ai = arrays[i];
+		ai.offset = offset;
+		if (compress)
+		{
+			FillVTUArray(ps, ai.nsrc, ai.f, buf);
+			if (zlib_encode(buf, ai.data) == false) return false;
+			offset += ai.data.size();
+		}
+		else offset += 8 + ai.size;
+	}
+	size_t npf = pointFields.size();
+	size_t ncf = cellFields.size();
+
+	// --- X M L   H E A D E R ---
+	fprintf(fp, "<?xml version=\"1.0\"?>\n");
+	fprintf(fp, "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\"%s>\n",
+		(is_little_endian() ? "LittleEndian" : "BigEndian"),
+		(compress ? " compressor=\"vtkZLibDataCompressor\"" : ""));
+	fprintf(fp, "  <UnstructuredGrid>\n");
+	fprintf(fp, "    <FieldData>\n");
+	fprintf(fp, "      <DataArray type=\"Float64\" Name=\"TimeValue\" NumberOfTuples=\"1\" format=\"ascii\">%.9g</DataArray>\n", ps->m_time);
+	fprintf(fp, "    </FieldData>\n");
+	fprintf(fp, "    <Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n", NN, NE);
+
+	const char* szsection[] = { "PointData", "CellData", "Points", "Cells" };
+	size_t sectionEnd[] = { npf, npf + ncf, npf + ncf + 1, arrays.size() };
+	size_t n0 = 0;
+	for (int n = 0; n < 4; ++n)
+	{
+		fprintf(fp, "      <%s>\n", szsection[n]);
+		for (size_t i = n0; i < sectionEnd[n]; ++i)
+		{
+			VTU_ARRAY& ai = arrays[i];
+			fprintf(fp, "        <DataArray type=\"%s\"", ai.sztype);
+			if (ai.f) fprintf(fp, " Name=\"%s\"", ai.f->name.c_str());
+			else if (ai.nsrc == VTU_CONNECTIVITY) fprintf(fp, " Name=\"connectivity\"");
+			else if (ai.nsrc == VTU_OFFSETS) fprintf(fp, " Name=\"offsets\"");
+			else if (ai.nsrc == VTU_TYPES) fprintf(fp, " Name=\"types\"");
+			fprintf(fp, " NumberOfComponents=\"%d\" format=\"appended\" offset=\"%llu\"/>\n", ai.ncomp, ai.offset);
+		}
+		fprintf(fp, "      </%s>\n", szsection[n]);
+		n0 = sectionEnd[n];
+	}
+	fprintf(fp, "    </Piece>\n");
+	fprintf(fp, "  </UnstructuredGrid>\n");
+
+	// --- A P P E N D E D   D A T A ---
+	fprintf(fp, "  <AppendedData encoding=\"raw\">\n   _");
+	for (size_t i = 0; i < arrays.size(); ++i)
+	{
+		VTU_ARRAY& ai = arrays[i];
+		if (compress)
+		{
+			if (ai.data.empty() == false) fwrite(&ai.data[0], 1, ai.data.size(), fp);
+			vector<unsigned char>().swap(ai.data);
+		}
+		else
+		{
+			FillVTUArray(ps, ai.nsrc, ai.f, buf);
+			unsigned long long nbytes = buf.size();
+			assert(nbytes == ai.size);
+			fwrite(&nbytes, sizeof(nbytes), 1, fp);
+			if (buf.empty() == false) fwrite(&buf[0], 1, buf.size(), fp);
+		}
+	}
+	fprintf(fp, "\n  </AppendedData>\n");
+	fprintf(fp, "</VTKFile>\n");
+
+	return true;
 }
 
 //-----------------------------------------------------------------------------
-void FEVTKExport::WritePointData(FEState* ps)
+void FEVTKExport::FillVTUArray(FEState* ps, int nsrc, const FIELD* f, vector<unsigned char>& buf)
 {
-	// make sure the state has data
-	int NDATA = ps->m_Data.size();
-	if (NDATA == 0) return;
-
 	FEPostMesh& mesh = *ps->GetFEMesh();
-	int nodes = mesh.Nodes();
+	int NN = mesh.Nodes();
+	int NE = mesh.Elements();
 
-	fprintf(m_fp, "\nPOINT_DATA %d\n", nodes);
+	vector<float> val;
+	vector<int> ival;
+	switch (nsrc)
+	{
+	case VTU_POINT_FIELD:
+		if (FillPointField(ps, *f, val) == false) val.clear();
+		val.resize((size_t)NN * f->ncomp, 0.f);
+		break;
+	case VTU_CELL_FIELD:
+		if (FillCellField(ps, *f, val) == false) val.clear();
+		val.resize((size_t)NE * f->ncomp, 0.f);
+		break;
+	case VTU_POINTS:
+		val.resize(3 * (size_t)NN);
+		for (int i = 0; i < NN; ++i)
+		{
+			vec3f& r = ps->m_NODE[i].m_rt;
+			val[3 * i] = r.x; val[3 * i + 1] = r.y; val[3 * i + 2] = r.z;
+		}
+		break;
+	case VTU_CONNECTIVITY:
+		for (int i = 0; i < NE; ++i)
+		{
+			FEElement_& el = mesh.ElementRef(i);
+			for (int k = 0; k < el.Nodes(); ++k) ival.push_back(el.m_node[k]);
+		}
+		break;
+	case VTU_OFFSETS:
+		{
+			ival.resize(NE);
+			int n = 0;
+			for (int i = 0; i < NE; ++i)
+			{
+				n += mesh.ElementRef(i).Nodes();
+				ival[i] = n;
+			}
+		}
+		break;
+	case VTU_TYPES:
+		buf.resize(NE);
+		for (int i = 0; i < NE; ++i) buf[i] = (unsigned char)vtk_cell_type(mesh.ElementRef(i).Type());
+		return;
+	default:
+		assert(false);
+	}
+
+	if (val.empty() == false)
+	{
+		buf.resize(val.size() * sizeof(float));
+		memcpy(&buf[0], &val[0], buf.size());
+	}
+	else if (ival.empty() == false)
+	{
+		buf.resize(ival.size() * sizeof(int));
+		memcpy(&buf[0], &ival[0], buf.size());
+	}
+	else buf.clear();
+}
+
+//-----------------------------------------------------------------------------
+void FEVTKExport::FindFields(FEState* ps, vector<FIELD>& pointFields, vector<FIELD>& cellFields)
+{
 	FEPostModel& fem = *ps->GetFEModel();
 	FEDataManager& DM = *fem.GetDataManager();
 	FEDataFieldPtr pd = DM.FirstDataField();
+	int NDATA = ps->m_Data.size();
 	for (int n = 0; n<NDATA; ++n, ++pd)
 	{
 		FEDataField& data = *(*pd);
-		if ((data.DataClass() == CLASS_NODE) && (data.Flags() & EXPORT_DATA))
-		{
-			FEMeshData& meshData = ps->m_Data[n];
-			char szname[256];
-			strcpy(szname, data.GetName().c_str());
-			Space2_(szname);
-
-			// value array
-			vector<float> val;
-			if (FillNodeDataArray(val, meshData))
-			{
-				// write the value array
-				int ntype = meshData.GetType();
-				if (ntype == DATA_FLOAT) {
-					fprintf(m_fp, "%s %s %s\n", "SCALARS", szname, "float");
-					fprintf(m_fp, "%s %s\n", "LOOKUP_TABLE", "default");
-					for (int i = 0; i<val.size(); ++i) fprintf(m_fp, "%g\n", val[i]);
-				}
-				else if (ntype == DATA_VEC3F) {
-					fprintf(m_fp, "%s %s %s\n", "VECTORS", szname, "float");
-					for (int i = 0; i<val.size(); i += 3) fprintf(m_fp, "%g %g %g\n", val[i], val[i + 1], val[i + 2]);
-				}
-				else if (ntype == DATA_MAT3FS) {
-					fprintf(m_fp, "%s %s %s\n", "TENSORS", szname, "float");
-					for (int i = 0; i<val.size(); i += 6)
-						fprintf(m_fp, "%g %g %g\n%g %g %g\n%g %g %g\n\n",
-							val[i    ], val[i + 3], val[i + 5],
-							val[i + 3], val[i + 1], val[i + 4],
-							val[i + 5], val[i + 4], val[i + 2]);
-				}
-				else if (ntype == DATA_MAT3FD) {
-					fprintf(m_fp, "%s %s %s\n", "TENSORS", szname, "float");
-					for (int i = 0; i<val.size(); i += 3)
-						fprintf(m_fp, "%g %g %g\n%g %g %g\n%g %g %g\n\n",
-							val[i], 0.f, 0.f,
-							0.f, val[i + 1], 0.f,
-							0.f, 0.f, val[i + 2]);
-				}
-			}
-		}
+		if ((data.Flags() & EXPORT_DATA) == 0) continue;
 
-		// --- E L E M E N T   P O I N T   D A T A ---
-		if ((data.DataClass() == CLASS_ELEM) && (data.Flags() & EXPORT_DATA))
+		FEMeshData& meshData = ps->m_Data[n];
+
+		FIELD f;
+		f.ndata = n;
+		f.name = data.GetName();
+		for (size_t i = 0; i < f.name.size(); ++i) if (f.name[i] == ' ') f.name[i] = '_';
+		f.nclass = data.DataClass();
+		f.ntype = meshData.GetType();
+		f.ncomp = vtk_components(f.ntype);
+		if (f.ncomp == 0) continue;
+
+		if (f.nclass == CLASS_NODE) pointFields.push_back(f);
+		else if (f.nclass == CLASS_ELEM)
 		{
-			FEMeshData& meshData = ps->m_Data[n];
+			// element data that is defined on the nodes is exported as point data
 			Data_Format dfmt = meshData.GetFormat();
-			if (dfmt == DATA_NODE) {
-				FEDataField& data = *(*pd);
-				char szname[256];
-				strcpy(szname, data.GetName().c_str());
-				Space2_(szname);
-
-				// value array
-				vector<float> val;
-				if (FillElementNodeDataArray(val, meshData))
-				{
-					// write the value array
-					int ntype = meshData.GetType();
-					if (ntype == DATA_FLOAT) {
-						fprintf(m_fp, "SCALARS %s float\n", szname);
-						fprintf(m_fp, "LOOKUP_TABLE default\n");
-						for (int i = 0; i<val.size(); ++i) fprintf(m_fp, "%g\n", val[i]);
-					}
-					else if (ntype == DATA_VEC3F) {
-						fprintf(m_fp, "VECTORS %s float\n", szname);
-						for (int i = 0; i<val.size(); i += 3) fprintf(m_fp, "%g %g %g\n", val[i], val[i + 1], val[i + 2]);
-					}
-					else if (ntype == DATA_MAT3FS) {
-						fprintf(m_fp, "TENSORS %s float\n", szname);
-						for (int i = 0; i<val.size(); i += 6)
-							fprintf(m_fp, "%g %g %g\n%g %g %g\n%g %g %g\n\n",
-								val[i], val[i + 3], val[i + 5],
-								val[i + 3], val[i + 1], val[i + 4],
-								val[i + 5], val[i + 4], val[i + 2]);
-					}
-					else if (ntype == DATA_MAT3FD) {
-						fprintf(m_fp, "TENSORS %s float\n", szname);
-						for (int i = 0; i<val.size(); i += 3)
-							fprintf(m_fp, "%g %g %g\n%g %g %g\n%g %g %g\n\n",
-								val[i], 0.f, 0.f,
-								0.f, val[i + 1], 0.f,
-								0.f, 0.f, val[i + 2]);
-					}
-				}
-			}
+			if (dfmt == DATA_NODE) pointFields.push_back(f);
+			else if (dfmt == DATA_ITEM) cellFields.push_back(f);
 		}
 	}
 }
 
 //-----------------------------------------------------------------------------
-void FEVTKExport::WriteCellData(FEState* ps)
+bool FEVTKExport::FillPointField(FEState* ps, const FIELD& f, vector<float>& val)
 {
-	FEPostModel& fem = *ps->GetFEModel();
-    FEDataManager& DM = *fem.GetDataManager();
-    FEDataFieldPtr pd = DM.FirstDataField();
+	FEMeshData& meshData = ps->m_Data[f.ndata];
+	bool bret = false;
+	if (f.nclass == CLASS_NODE) bret = FillNodeDataArray(val, meshData);
+	else bret = FillElementNodeDataArray(val, meshData);
+	if (bret) expand_tensors(val, f.ntype);
+	return bret;
+}
 
-	FEPostMesh& mesh = *ps->GetFEMesh();
-            
-    int NDATA = ps->m_Data.size();
-    if (NDATA > 0) fprintf(m_fp, "\nCELL_DATA %d\n" , mesh.Elements());
-            
-    for (int n=0; n<NDATA; ++n, ++pd)
-    {
-        FEDataField& data = *(*pd);
-        if ((data.DataClass() == CLASS_ELEM) && (data.Flags() & EXPORT_DATA))
-        {
-            FEMeshData& meshData = ps->m_Data[n];
-            Data_Format dfmt = meshData.GetFormat();
-            if (dfmt == DATA_ITEM) {
-                FEDataField& data = *(*pd);
-                char szname[256];
-				strcpy(szname, data.GetName().c_str());
-                Space2_(szname);
-                        
-                // value array
-                vector<float> val;
-                        
-				bool first = true;
-                int ND = mesh.Parts();
-                for (int i=0; i<ND; ++i)
-                {
-                    FEPart& part = mesh.Part(i);
-                            
-                    if (FillElemDataArray(val, meshData, part))
-                    {
-						// write the value array
-						if (val.empty() == false) {
-							int ntype = meshData.GetType();
-							if (ntype == DATA_FLOAT) {
-								if (first) {
-									fprintf(m_fp, "%s %s %s\n" ,"SCALARS",szname,"float");
-									fprintf(m_fp, "%s %s\n","LOOKUP_TABLE","default");
-								}
-								for (int i=0; i<val.size(); ++i) fprintf(m_fp,"%g\n",val[i]);
-							}
-							else if (ntype == DATA_VEC3F) {
-								if (first) {
-									fprintf(m_fp, "%s %s %s\n" ,"VECTORS",szname,"float");
-								}
-								for (int i=0; i<val.size(); i+=3) fprintf(m_fp,"%g %g %g\n",val[i],val[i+1],val[i+2]);
-							}
-							else if (ntype == DATA_MAT3FS) {
-								if (first) {
-									fprintf(m_fp, "%s %s %s\n" ,"TENSORS",szname,"float");
-								}
-								for (int i=0; i<val.size(); i+=6)
-									fprintf(m_fp,"%g %g %g\n%g %g %g\n%g %g %g\n\n",
-											val[i  ],val[i+3],val[i+5],
-											val[i+3],val[i+1],val[i+4],
-											val[i+5],val[i+4],val[i+2]);
-							}
-							else if (ntype == DATA_MAT3FD) {
-								if (first) {
-									fprintf(m_fp, "%s %s %s\n" ,"TENSORS",szname,"float");
-								}
-								for (int i=0; i<val.size(); i+=3)
-									fprintf(m_fp,"%g %g %g\n%g %g %g\n%g %g %g\n\n",
-											val[i  ],0.f,0.f,
-											0.f,val[i+1],0.f,
-											0.f,0.f,val[i+2]);
-							}
-
-							first = false;
-						}
-					}
-                }
-            }
-        }
-    }
+//-----------------------------------------------------------------------------
+bool FEVTKExport::FillCellField(FEState* ps, const FIELD& f, vector<float>& val)
+{
+	FEMeshData& meshData = ps->m_Data[f.ndata];
+	if (FillCellDataArray(val, meshData) == false) return false;
+	expand_tensors(val, f.ntype);
+	return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -442,29 +725,33 @@ bool FEVTKExport::FillNodeDataArray(vector<float>& val, Post::FEMeshData& meshDa
 	int ntype = meshData.GetType();
 	int NN = mesh.Nodes();
 
+	// values are read with eval so that compressed arrays are not expanded
 	if (ntype == DATA_FLOAT)
 	{
 		FENodeData<float>& data = dynamic_cast<FENodeData<float>&>(meshData);
 		val.assign(NN, 0.f);
-		for (int i=0; i<NN; ++i) val[i] = data[i];
+		for (int i=0; i<NN; ++i) data.eval(i, &val[i]);
 	}
 	else if (ntype == DATA_VEC3F)
 	{
 		FENodeData<vec3f>& data = dynamic_cast<FENodeData<vec3f>&>(meshData);
 		val.assign(NN*3, 0.f);
-		for (int i=0; i<NN; ++i) write_data(val, i, data[i]);
+		vec3f v;
+		for (int i=0; i<NN; ++i) { data.eval(i, &v); write_data(val, i, v); }
 	}
 	else if (ntype == DATA_MAT3FS)
 	{
 		FENodeData<mat3fs>& data = dynamic_cast<FENodeData<mat3fs>&>(meshData);
 		val.assign(NN*6, 0.f);
-		for (int i=0; i<NN; ++i) write_data(val, i, data[i]);
+		mat3fs v;
+		for (int i=0; i<NN; ++i) { data.eval(i, &v); write_data(val, i, v); }
 	}
 	else if (ntype == DATA_MAT3FD)
 	{
 		FENodeData<mat3fd>& data = dynamic_cast<FENodeData<mat3fd>&>(meshData);
 		val.assign(NN*3, 0.f);
-		for (int i=0; i<NN; ++i) write_data(val, i, data[i]);
+		mat3fd v;
+		for (int i=0; i<NN; ++i) { data.eval(i, &v); write_data(val, i, v); }
 	}
 	else return false;
 
@@ -567,233 +854,64 @@ bool FEVTKExport::FillElementNodeDataArray(vector<float>& val, Post::FEMeshData&
 }
 
 //-----------------------------------------------------------------------------
-bool FEVTKExport::FillElemDataArray(vector<float>& val, Post::FEMeshData& meshData, Post::FEPart& part)
+bool FEVTKExport::FillCellDataArray(vector<float>& val, Post::FEMeshData& meshData)
 {
-	FEPostModel& fem = *meshData.GetFEModel();
-	FEPostMesh& mesh = *fem.GetFEMesh(0);
+	if (meshData.GetFormat() != DATA_ITEM) return false;
 
+	FEPostMesh& mesh = *meshData.GetFEMesh();
+	int NE = mesh.Elements();
 	int ntype = meshData.GetType();
-	int nfmt  = meshData.GetFormat();
-
-	int NE = part.Size();
-	if (NE == 0) return false;
-
-	// number of nodes per element
-	int ne = mesh.ElementRef(part.m_Elem[0]).Nodes();
-
-	// number of actually written values
-	int nval = 0;
 
-	if (nfmt == DATA_ITEM)
+	if (ntype == DATA_FLOAT)
 	{
-		if (ntype == DATA_FLOAT)
-		{
-			FEElementData<float, DATA_ITEM>& data = dynamic_cast<FEElementData<float, DATA_ITEM>&>(meshData);
-			val.assign(NE, 0.f);
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-				if (data.active(eid)) { data.eval(eid, &val[i]); nval++; }
-			}
-		}
-		else if (ntype == DATA_VEC3F)
-		{
-			FEElementData<vec3f, DATA_ITEM>& data = dynamic_cast<FEElementData<vec3f, DATA_ITEM>&>(meshData);
-			val.assign(3*NE, 0.f);
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-				if (data.active(eid))
-				{
-					vec3f v(0.f, 0.f, 0.f);
-					data.eval(eid, &v);
-					write_data(val, i, v);
-
-					nval++; 
-				}
-			}
-		}
-		else if (ntype == DATA_MAT3FS)
-		{
-			FEElementData<mat3fs, DATA_ITEM>& data = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>&>(meshData);
-			val.assign(6*NE, 0.f);
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-
-				if (data.active(eid))
-				{
-					mat3fs v;
-					data.eval(eid, &v);
-					write_data(val, i, v);
-
-					nval++;
-				}
-			}
-		}
-		else if (ntype == DATA_MAT3FD)
+		FEElementData<float, DATA_ITEM>& data = dynamic_cast<FEElementData<float, DATA_ITEM>&>(meshData);
+		val.assign(NE, 0.f);
+		for (int i = 0; i<NE; ++i)
 		{
-			FEElementData<mat3fd, DATA_ITEM>& data = dynamic_cast<FEElementData<mat3fd, DATA_ITEM>&>(meshData);
-			val.assign(3*NE, 0.f);
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-
-				if (data.active(eid))
-				{
-					mat3fd v;
-					data.eval(eid, &v);
-					write_data(val, i, v);
-
-					nval++;
-				}
-			}
+			if (data.active(i)) data.eval(i, &val[i]);
 		}
-		else return false;
 	}
-	else if (nfmt == DATA_COMP)
+	else if (ntype == DATA_VEC3F)
 	{
-		if (ntype == DATA_FLOAT)
-		{
-			FEElementData<float, DATA_COMP>& data = dynamic_cast<FEElementData<float, DATA_COMP>&>(meshData);
-			val.assign(NE*ne, 0.f);
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-				float v[FEElement::MAX_NODES] = {0.f};
-				if (data.active(eid))
-				{
-					data.eval(eid, v);
-					for (int j=0; j<ne; ++j) val[i*ne + j] = v[j];
-					nval++;
-				}
-			}
-		}
-		else if (ntype == DATA_VEC3F)
-		{
-			FEElementData<vec3f, DATA_COMP>& data = dynamic_cast<FEElementData<vec3f, DATA_COMP>&>(meshData);
-			val.assign(NE*ne*3, 0.f);
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-				vec3f v[FEElement::MAX_NODES] = {vec3f(0.f,0.f,0.f)};
-				if (data.active(eid))
-				{
-					data.eval(eid, v);
-					for (int j=0; j<ne; ++j) write_data(val, i*ne + j, v[j]);
-					nval++;
-				}
-			}
-		}
-		else if (ntype == DATA_MAT3FS)
-		{
-			FEElementData<mat3fs, DATA_COMP>& data = dynamic_cast<FEElementData<mat3fs, DATA_COMP>&>(meshData);
-			val.assign(NE*ne*6, 0.f);
-			mat3fs v[FEElement::MAX_NODES];
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-				if (data.active(eid))
-				{
-					data.eval(eid, v);
-					for (int j=0; j<ne; ++j) write_data(val, i*ne + j, v[j]);
-					nval++;
-				}
-			}
-		}
-		else if (ntype == DATA_MAT3FD)
+		FEElementData<vec3f, DATA_ITEM>& data = dynamic_cast<FEElementData<vec3f, DATA_ITEM>&>(meshData);
+		val.assign(3 * NE, 0.f);
+		for (int i = 0; i<NE; ++i)
 		{
-			FEElementData<mat3fd, DATA_COMP>& data = dynamic_cast<FEElementData<mat3fd, DATA_COMP>&>(meshData);
-			val.assign(NE*ne*3, 0.f);
-			mat3fd v[FEElement::MAX_NODES];
-			for (int i=0; i<NE; ++i)
+			if (data.active(i))
 			{
-				int eid = part.m_Elem[i];
-				if (data.active(eid))
-				{
-					data.eval(eid, v);
-					for (int j=0; j<ne; ++j) write_data(val, i*ne + j, v[j]);
-					nval++;
-				}
+				vec3f v;
+				data.eval(i, &v);
+				write_data(val, i, v);
 			}
 		}
-		else return false;
 	}
-	else if (nfmt == DATA_NODE)
+	else if (ntype == DATA_MAT3FS)
 	{
-		vector<int> node, lnode;
-		part.GetNodeList(node, lnode);
-		int NN = (int) node.size();
-
-		if (ntype == DATA_FLOAT)
-		{
-			FEElementData<float, DATA_NODE>& data = dynamic_cast<FEElementData<float, DATA_NODE>&>(meshData);
-			val.assign(NN, 0.f);
-
-			float v[FEElement::MAX_NODES];
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-				if (data.active(eid))
-				{
-					data.eval(eid, v);
-					for (int j=0; j<ne; ++j) val[lnode[i*ne+j]] = v[j];
-					nval++;
-				}
-			}
-		}
-		else if (ntype == DATA_VEC3F)
-		{
-			FEElementData<vec3f, DATA_NODE>& data = dynamic_cast<FEElementData<vec3f, DATA_NODE>&>(meshData);
-			val.assign(NN*3, 0.f);
-
-			vec3f v[FEElement::MAX_NODES];
-			for (int i=0; i<NE; ++i)
-			{
-				int eid = part.m_Elem[i];
-				if (data.active(eid))
-				{
-					data.eval(eid, v);
-					for (int j=0; j<ne; ++j) write_data(val, lnode[i*ne+j], v[j]);
-					nval++;
-				}
-			}
-		}
-		else if (ntype == DATA_MAT3FS)
+		FEElementData<mat3fs, DATA_ITEM>& data = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>&>(meshData);
+		val.assign(6 * NE, 0.f);
+		for (int i = 0; i<NE; ++i)
 		{
-			FEElementData<mat3fs, DATA_NODE>& data = dynamic_cast<FEElementData<mat3fs, DATA_NODE>&>(meshData);
-			val.assign(NN*6, 0.f);
-
-			mat3fs v[FEElement::MAX_NODES];
-			for (int i=0; i<NE; ++i)
+			if (data.active(i))
 			{
-				int eid = part.m_Elem[i];
-				if (data.active(eid))
-				{
-					data.eval(eid, v);
-					for (int j=0; j<ne; ++j) write_data(val, lnode[i*ne+j], v[j]);
-					nval++;
-				}
+				mat3fs v;
+				data.eval(i, &v);
+				write_data(val, i, v);
 			}
 		}
-		else if (ntype == DATA_MAT3FD)
+	}
+	else if (ntype == DATA_MAT3FD)
+	{
+		FEElementData<mat3fd, DATA_ITEM>& data = dynamic_cast<FEElementData<mat3fd, DATA_ITEM>&>(meshData);
+		val.assign(3 * NE, 0.f);
+		for (int i = 0; i<NE; ++i)
 		{
-			FEElementData<mat3fd, DATA_NODE>& data = dynamic_cast<FEElementData<mat3fd, DATA_NODE>&>(meshData);
-			val.assign(NN*3, 0.f);
-
-			mat3fd v[FEElement::MAX_NODES];
-			for (int i=0; i<NE; ++i)
+			if (data.active(i))
 			{
-				int eid = part.m_Elem[i];
-				if (data.active(eid))
-				{
-					data.eval(eid, v);
-					for (int j=0; j<ne; ++j) write_data(val, lnode[i*ne+j], v[j]);
-					nval++;
-				}
+				mat3fd v;
+				data.eval(i, &v);
+				write_data(val, i, v);
 			}
 		}
-		else return false;
 	}
 	else return false;
 
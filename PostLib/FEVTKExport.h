@@ -27,11 +27,34 @@ SOFTWARE.*/
 #pragma once
 #include "FEFileExport.h"
 #include "FEPostModel.h"
+#include <string>
 namespace Post {
 
 //-----------------------------------------------------------------------------
+// Exports the post model to VTK. The legacy format (.vtk) can be written
+// in ASCII or binary, the XML format (.vtu) with raw or zlib compressed 
+// appended data. When all states are exported, each state is written to its
+// own file (in parallel) and for the XML format a .pvd index is written as well.
 class FEVTKExport : public FEFileExport
 {
+public:
+	enum FileFormat {
+		VTK_ASCII,		// legacy, ASCII
+		VTK_BINARY,		// legacy, binary
+		VTU_RAW,		// XML, raw appended data
+		VTU_ZLIB		// XML, zlib compressed appended data
+	};
+
+	// a data field that is exported
+	struct FIELD
+	{
+		int				ndata;	// index into state data
+		std::string		name;	// name of field (without spaces)
+		int				nclass;	// data class
+		int				ntype;	// data type
+		int				ncomp;	// number of VTK components
+	};
+
 public:
     FEVTKExport(void);
     ~FEVTKExport(void);
@@ -40,23 +63,25 @@ public:
 
 	void ExportAllStates(bool b);
 
+	void SetFileFormat(int n) { m_format = n; }
+
 private:
 	bool WriteState(const char* szname, FEState* ps);
+	bool WriteLegacy(FILE* fp, FEState* ps);
+	bool WriteVTU(FILE* fp, FEState* ps);
+	bool WritePVD(const char* szfile, FEPostModel& fem, const std::vector<std::string>& files);
+
+private:
+	void FindFields(FEState* ps, std::vector<FIELD>& pointFields, std::vector<FIELD>& cellFields);
+	bool FillPointField(FEState* ps, const FIELD& f, vector<float>& val);
+	bool FillCellField(FEState* ps, const FIELD& f, vector<float>& val);
 	bool FillNodeDataArray(vector<float>& val, FEMeshData& data);
 	bool FillElementNodeDataArray(vector<float>& val, FEMeshData& meshData);
-	bool FillElemDataArray(vector<float>& val, FEMeshData& data, FEPart& part);
-    
-private:
-	void WriteHeader(FEState* ps);
-	void WritePoints(FEState* ps);
-	void WriteCells (FEState* ps);
-	void WritePointData(FEState* ps);
-	void WriteCellData(FEState* ps);
+	bool FillCellDataArray(vector<float>& val, FEMeshData& meshData);
+	void FillVTUArray(FEState* ps, int nsrc, const FIELD* f, std::vector<unsigned char>& buf);
 
 private:
 	bool	m_bwriteAllStates;	// write all states
-
-private:
-	FILE*	m_fp;
+	int		m_format;			// file format (see FileFormat)
 };
 }
@@ -28,11 +28,175 @@ SOFTWARE.*/
 #include "FEVTKImport.h"
 #include "FEMeshData_T.h"
 #include "FEPostModel.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <zlib.h>
+
+#ifdef WIN32
+#define fseek64(a,b,c) _fseeki64(a,b,c)
+#endif
+
+#ifdef LINUX // same for Linux and Mac OS X
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+#ifdef __APPLE__ // same for Linux and Mac OS X
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
 
 using namespace Post;
 
+// size of the read buffer for legacy files
+const size_t VTK_BUFFER_SIZE = (1 << 20);
+
+// data types of VTK arrays
+enum VTK_DATATYPE {
+	VTK_INT8, VTK_UINT8, VTK_INT16, VTK_UINT16, VTK_INT32, VTK_UINT32, VTK_INT64, VTK_UINT64, VTK_FLOAT32, VTK_FLOAT64,
+	VTK_INVALID_TYPE
+};
+
+static const int vtk_type_size[] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+
+//-----------------------------------------------------------------------------
+// This takes both the legacy and the XML type names
+static int vtk_data_type(const std::string& s)
+{
+	if ((s == "Int8"   ) || (s == "char") || (s == "signed_char")) return VTK_INT8;
+	if ((s == "UInt8"  ) || (s == "unsigned_char")) return VTK_UINT8;
+	if ((s == "Int16"  ) || (s == "short")) return VTK_INT16;
+	if ((s == "UInt16" ) || (s == "unsigned_short")) return VTK_UINT16;
+	if ((s == "Int32"  ) || (s == "int")) return VTK_INT32;
+	if ((s == "UInt32" ) || (s == "unsigned_int")) return VTK_UINT32;
+	if ((s == "Int64"  ) || (s == "long") || (s == "vtktypeint64") || (s == "vtkIdType")) return VTK_INT64;
+	if ((s == "UInt64" ) || (s == "unsigned_long") || (s == "vtktypeuint64")) return VTK_UINT64;
+	if ((s == "Float32") || (s == "float")) return VTK_FLOAT32;
+	if ((s == "Float64") || (s == "double")) return VTK_FLOAT64;
+	return VTK_INVALID_TYPE;
+}
+
+//-----------------------------------------------------------------------------
+// element type of a VTK cell type
+static int fe_element_type(int vtkType)
+{
+	switch (vtkType)
+	{
+	case  3: return FE_BEAM2;
+	case  5: return FE_TRI3;
+	case  9: return FE_QUAD4;
+	case 10: return FE_TET4;
+	case 12: return FE_HEX8;
+	case 13: return FE_PENTA6;
+	case 14: return FE_PYRA5;
+	case 21: return FE_BEAM3;
+	case 22: return FE_TRI6;
+	case 23: return FE_QUAD8;
+	case 24: return FE_TET10;
+	case 25: return FE_HEX20;
+	case 26: return FE_PENTA15;
+	case 28: return FE_QUAD9;
+	case 29: return FE_HEX27;
+	}
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+static bool is_little_endian()
+{
+	int n = 1;
+	return (*((char*)&n) == 1);
+}
+
+static void swap_bytes(unsigned char* p, size_t n, int size)
+{
+	if (size == 1) return;
+	for (size_t i = 0; i < n; ++i, p += size)
+	{
+		for (int j = 0; j < size / 2; ++j)
+		{
+			unsigned char c = p[j]; p[j] = p[size - j - 1]; p[size - j - 1] = c;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+template <typename In, typename T> static void cast_array(const unsigned char* p, size_t n, T* out)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		In v;
+		memcpy(&v, p + i*sizeof(In), sizeof(In));
+		out[i] = (T)v;
+	}
+}
+
+template <typename T> static void convert_array(const unsigned char* p, size_t n, int ntype, T* out)
+{
+	switch (ntype)
+	{
+	case VTK_INT8   : cast_array<signed char       >(p, n, out); break;
+	case VTK_UINT8  : cast_array<unsigned char     >(p, n, out); break;
+	case VTK_INT16  : cast_array<short             >(p, n, out); break;
+	case VTK_UINT16 : cast_array<unsigned short    >(p, n, out); break;
+	case VTK_INT32  : cast_array<int               >(p, n, out); break;
+	case VTK_UINT32 : cast_array<unsigned int      >(p, n, out); break;
+	case VTK_INT64  : cast_array<long long         >(p, n, out); break;
+	case VTK_UINT64 : cast_array<unsigned long long>(p, n, out); break;
+	case VTK_FLOAT32: cast_array<float             >(p, n, out); break;
+	case VTK_FLOAT64: cast_array<double            >(p, n, out); break;
+	default:
+		assert(false);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// get the value of an attribute of an XML tag
+static bool attribute(const std::string& tag, const char* szatt, std::string& val)
+{
+	std::string key = std::string(" ") + szatt + "=\"";
+	size_t n = tag.find(key);
+	if (n == std::string::npos) return false;
+	n += key.size();
+	size_t m = tag.find('"', n);
+	if (m == std::string::npos) return false;
+	val = tag.substr(n, m - n);
+	return true;
+}
+
+// get the XML tag that starts at position pos
+static std::string xml_tag(const std::string& xml, size_t pos)
+{
+	size_t n = xml.find('>', pos);
+	if (n == std::string::npos) return xml.substr(pos);
+	return xml.substr(pos, n - pos + 1);
+}
+
+// Find the range of a section (e.g. <PointData>...</PointData>) in [start, end).
+static bool xml_section(const std::string& xml, const char* szname, size_t start, size_t end, size_t& s0, size_t& s1)
+{
+	std::string open = std::string("<") + szname;
+	size_t n = xml.find(open, start);
+	if ((n == std::string::npos) || (n >= end)) return false;
+	std::string tag = xml_tag(xml, n);
+	s0 = n + tag.size();
+	if ((tag.size() > 1) && (tag[tag.size() - 2] == '/')) { s1 = s0; return true; }
+	s1 = xml.find(std::string("</") + szname, s0);
+	if (s1 == std::string::npos) s1 = end;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
 FEVTKimport::FEVTKimport(FEPostModel* fem) : FEFileReader(fem)
 {
+	m_version = 0.f;
+	m_binary = false;
+	m_polyData = false;
+	m_time = 0.f;
+	m_pos = m_end = 0;
+	m_appended = -1;
+	m_swap = false;
+	m_header64 = false;
+	m_compressed = false;
 }
 
 FEVTKimport::~FEVTKimport(void)
@@ -48,257 +212,669 @@ bool FEVTKimport::Load(const char* szfile)
 	FEMaterial mat;
 	fem.AddMaterial(mat);
 
-	if (!Open(szfile, "rt")) return errf("Failed opening file %s.", szfile);
+	m_time = 0.f;
+	m_points.clear();
+	m_conn.clear();
+	m_offset.clear();
+	m_types.clear();
+	m_data.clear();
 
-	char szline[256] = {0}, *ch;
-	int nread, i,j,k;
-	char type[256];
-	double temp[9];
-	bool isASCII=false, isPOLYDATA = false, isUnstructuredGrid = false, isCellData = false,isScalar=false,isShellThickness=false;
-	// read the header
-	do
+	if (!Open(szfile, "rb")) return errf("Failed opening file %s.", szfile);
+
+	// XML files start with a tag, legacy files with the "# vtk" header
+	int c = 0;
+	do { c = fgetc(m_fp); } while ((c != EOF) && isspace(c));
+	rewind(m_fp);
+
+	bool bret = (c == '<' ? LoadVTU() : LoadLegacy());
+	Close();
+
+	if (bret) bret = BuildModel();
+
+	// release the buffers
+	std::vector<char>().swap(m_buf);
+	std::vector<float>().swap(m_points);
+	std::vector<int>().swap(m_conn);
+	std::vector<int>().swap(m_offset);
+	std::vector<int>().swap(m_types);
+	m_data.clear();
+
+	return bret;
+}
+
+//=============================================================================
+// legacy format
+//=============================================================================
+
+bool FEVTKimport::LoadLegacy()
+{
+	m_buf.resize(VTK_BUFFER_SIZE + 1);
+	m_pos = m_end = 0;
+	m_buf[0] = 0;
+
+	// header and version
+	if (!nextLine() || (strncmp(m_line.c_str(), "# vtk DataFile", 14) != 0)) return errf("This is not a valid VTK file.");
+	const char* sz = strstr(m_line.c_str(), "Version");
+	m_version = (sz ? (float)atof(sz + 7) : 0.f);
+
+	// title, which may hold the time (files written by FEBio Studio do)
+	if (!nextLine(false)) return errf("Unexpected end of file.");
+	sz = strstr(m_line.c_str(), "at time");
+	if (sz) m_time = (float)atof(sz + 7);
+
+	// file format
+	if (!nextLine()) return errf("Unexpected end of file.");
+	if      (strncmp(m_line.c_str(), "ASCII" , 5) == 0) m_binary = false;
+	else if (strncmp(m_line.c_str(), "BINARY", 6) == 0) m_binary = true;
+	else return errf("Unknown file format %s.", m_line.c_str());
+
+	// dataset type
+	if (!nextLine() || (strncmp(m_line.c_str(), "DATASET", 7) != 0)) return errf("Error looking for DATASET keyword.");
+	if      (strstr(m_line.c_str(), "UNSTRUCTURED_GRID")) m_polyData = false;
+	else if (strstr(m_line.c_str(), "POLYDATA")) m_polyData = true;
+	else return errf("Only POLYDATA and UNSTRUCTURED_GRID datasets are supported.");
+
+	// read the sections
+	int items = 0;
+	bool cellData = false;
+	while (nextLine())
 	{
-		ch = fgets(szline, 255, m_fp);
-		if (ch == 0) return errf("An unexpected error occured while reading the file data.");
-		if (strstr(ch, "ASCII") != 0) isASCII = true;
-		if (strstr(ch, "POLYDATA") != 0) isPOLYDATA = true;
-		if (strstr(ch, "UNSTRUCTURED_GRID") != 0) isUnstructuredGrid = true;
-	}
-	while(strstr(ch, "POINTS") == 0);
-	if (!isASCII)
-		return errf("Only ASCII files are read");
-
-	//get number of nodes
-	int nodes = atoi(ch+6);
-	
-	int size = 0;
-	int nparts = 0;
-	int edges = 0;
-	int elems = 0;
-	if (nodes <= 0) return errf("Invalid number of nodes.");
-	
+		char szkey[64] = { 0 }, sztype[64] = { 0 };
+		int n1 = 0, n2 = 0;
+		sscanf(m_line.c_str(), "%63s", szkey);
 
-	// create a new mesh
-	FEPostMesh* pm = new FEPostMesh;
-	pm->Create(nodes, 0);
-	
-	// read the nodes
-	//Check how many nodes are there in each line
-	ch = fgets(szline, 255, m_fp);
-	if (ch == 0) return errf("An unexpected error occured while reading the file data.");
-
-	nread = sscanf(szline, "%lg%lg%lg%lg%lg%lg%lg%lg%lg", &temp[0],&temp[1],&temp[2], &temp[3],&temp[4],&temp[5], &temp[6],&temp[7],&temp[8]);
-	if (nread%3 != 0 && nread>9) 
-		return errf("An error occured while reading the nodal coordinates.");
-	int nodes_each_row = nread/3;
-	double temp2 = double(nodes)/nodes_each_row;
-	int rows = (int)ceil(temp2);
-	for (i=0; i<rows; ++i)
-	{	
-		for (j=0,k=0;j<nodes_each_row && i*nodes_each_row+j <nodes;j++)
+		if (strcmp(szkey, "POINTS") == 0)
+		{
+			if ((sscanf(m_line.c_str(), "%*s %d %63s", &n1, sztype) != 2) || (n1 <= 0)) return errf("Invalid number of nodes.");
+			if (!readArray(sztype, 3 * (size_t)n1, m_points)) return false;
+		}
+		else if ((strcmp(szkey, "CELLS") == 0) || (strcmp(szkey, "POLYGONS") == 0))
+		{
+			if (sscanf(m_line.c_str(), "%*s %d %d", &n1, &n2) != 2) return errf("Invalid %s section.", szkey);
+			if (!readCells(n1, n2)) return false;
+		}
+		else if (strcmp(szkey, "CELL_TYPES") == 0)
+		{
+			if (sscanf(m_line.c_str(), "%*s %d", &n1) != 1) return errf("Invalid CELL_TYPES section.");
+			if (!readArray("int", n1, m_types)) return false;
+		}
+		else if ((strcmp(szkey, "POINT_DATA") == 0) || (strcmp(szkey, "CELL_DATA") == 0))
 		{
-			FENode& n= pm->Node(i*nodes_each_row+j);
-			vec3f r;
-			r.x = (float)temp[k];
-			r.y = (float)temp[k + 1];
-			r.z = (float)temp[k + 2];
-			n.r = r;
-			k +=3;
+			if (sscanf(m_line.c_str(), "%*s %d", &items) != 1) return errf("Invalid %s section.", szkey);
+			cellData = (szkey[0] == 'C');
 		}
-		ch = fgets(szline, 255, m_fp);
-		if (ch == 0) return errf("An unexpected error occured while reading the file data.");
-
-		nread = sscanf(szline, "%lg%lg%lg%lg%lg%lg%lg%lg%lg", &temp[0],&temp[1],&temp[2], &temp[3],&temp[4],&temp[5], &temp[6],&temp[7],&temp[8]);
-		if (nread%3 != 0 && nread != -1)
-		{ 			
-			if (i+1 != nodes/nodes_each_row)
-				return errf("An error occured while reading the nodal coordinates.");
+		else if ((strcmp(szkey, "SCALARS") == 0) || (strcmp(szkey, "VECTORS") == 0) || (strcmp(szkey, "NORMALS") == 0) ||
+				 (strcmp(szkey, "TENSORS") == 0) || (strcmp(szkey, "TENSORS6") == 0))
+		{
+			if (items == 0) return errf("%s section found outside POINT_DATA or CELL_DATA.", szkey);
+			if (!readAttribute(items, cellData)) return false;
 		}
+		else if (strcmp(szkey, "FIELD") == 0)
+		{
+			// field data in POINT_DATA or CELL_DATA is kept, otherwise only the time is read
+			if (!readField(items, cellData, (items > 0))) return false;
+		}
+		else if (strcmp(szkey, "LOOKUP_TABLE") == 0)
+		{
+			if (sscanf(m_line.c_str(), "%*s %*s %d", &n1) != 1) return errf("Invalid LOOKUP_TABLE section.");
+			std::vector<float> tmp;
+			if (!readArray((m_binary ? "unsigned_char" : "float"), 4 * (size_t)n1, tmp)) return false;
+		}
+		else if (strcmp(szkey, "METADATA") == 0)
+		{
+			// meta data ends with an empty line
+			while (nextLine(false) && (m_line.empty() == false));
+		}
+		else return errf("Unsupported section %s.", szkey);
+
+		if (IsCancelled()) return false;
 	}
-	//Reading element data
-	while(1)
-	{		
-		if (ch == 0) return errf("An unexpected error occured while reading the file data.");
-		if (strstr(ch, "POLYGONS") != 0 || strstr(ch, "CELLS") != 0 ) 
+
+	if (m_points.empty()) return errf("No POINTS section found.");
+	if (m_polyData)
+	{
+		// polygons are classified by their number of nodes
+		int NE = (int)m_offset.size();
+		m_types.resize(NE);
+		for (int i = 0; i < NE; ++i)
 		{
-			sscanf(szline, "%s %d %d",type,&elems,&size);
-			break;
+			int n = m_offset[i] - (i > 0 ? m_offset[i - 1] : 0);
+			m_types[i] = (n == 3 ? 5 : (n == 4 ? 9 : 7));
 		}
-		ch = fgets(szline, 255, m_fp);
 	}
 
-	if(elems == 0||size == 0)
-		return errf("Only POLYGON/CELL dataset format is supported.");
+	return true;
+}
 
-	pm->Create(0, elems);
+//-----------------------------------------------------------------------------
+bool FEVTKimport::fillBuffer()
+{
+	size_t rem = m_end - m_pos;
+	if ((rem > 0) && (m_pos > 0)) memmove(&m_buf[0], &m_buf[m_pos], rem);
+	m_pos = 0;
+	m_end = rem;
+
+	size_t nread = fread(&m_buf[m_end], 1, m_buf.size() - 1 - m_end, m_fp);
+	m_end += nread;
+	m_buf[m_end] = 0;
+	return (nread > 0);
+}
 
-	// read the elements
-	int n[9];
-	for (i=0; i<elems; ++i)
-	{	
-		FEElement& el = static_cast<FEElement&>(pm->ElementRef(i));
-		ch = fgets(szline, 255, m_fp);
-		if (ch == 0) return errf("An unexpected error occured while reading the file data.");
-		nread = sscanf(szline, "%d%d%d%d%d%d%d%d%d", &n[0], &n[1], &n[2], &n[3], &n[4],&n[5],&n[6],&n[7],&n[8]);
-		int min = 0;
-		switch (n[0])
+//-----------------------------------------------------------------------------
+// read the next line, without leading and trailing white space
+bool FEVTKimport::nextLine(bool skipEmpty)
+{
+	do
+	{
+		m_line.clear();
+		bool eol = false;
+		while (!eol)
 		{
-		case 3: 
-			el.SetType(FE_TRI3);
-			el.m_node[0] = n[1]-min;
-			el.m_node[1] = n[2]-min;
-			el.m_node[2] = n[3]-min;
-			break;
-		case 4:			
-			if(isPOLYDATA)
-				el.SetType(FE_QUAD4);
-			if(isUnstructuredGrid)
-				el.SetType(FE_TET4);
-			el.m_node[0] = n[1]-min;
-			el.m_node[1] = n[2]-min;
-			el.m_node[2] = n[3]-min;
-			el.m_node[3] = n[4]-min;
-			break;
-		case 8:
-			el.SetType(FE_HEX8);
-			el.m_node[0] = n[1]-min;
-			el.m_node[1] = n[2]-min;
-			el.m_node[2] = n[3]-min;
-			el.m_node[3] = n[4]-min;
-			el.m_node[4] = n[5]-min;
-			el.m_node[5] = n[6]-min;
-			el.m_node[6] = n[7]-min;
-			el.m_node[7] = n[8]-min;
-			break;
-		default:
-			delete pm;
-			return errf("Only triangular, quadrilateral and hexahedron polygons are supported.");
+			if ((m_pos >= m_end) && (fillBuffer() == false))
+			{
+				if (m_line.empty()) return false;
+				break;
+			}
+
+			size_t n0 = m_pos;
+			while ((m_pos < m_end) && (m_buf[m_pos] != '\n')) m_pos++;
+			m_line.append(&m_buf[n0], m_pos - n0);
+			if (m_pos < m_end) { m_pos++; eol = true; }
 		}
+
+		size_t n0 = m_line.find_first_not_of(" \t\r");
+		if (n0 == std::string::npos) m_line.clear();
+		else m_line = m_line.substr(n0, m_line.find_last_not_of(" \t\r") - n0 + 1);
 	}
-	ch = fgets(szline, 255, m_fp);
+	while (skipEmpty && m_line.empty());
 
-	// update the mesh
-	fem.AddMesh(pm);
-	pm->BuildMesh();
-	fem.UpdateBoundingBox();
+	return true;
+}
 
-	// add a state
-	FEState* ps = new FEState(0.f, m_fem, m_fem->GetFEMesh(0));
-	m_ps = ps;
-	fem.AddState(ps);
+//-----------------------------------------------------------------------------
+bool FEVTKimport::readBytes(void* pd, size_t nbytes)
+{
+	unsigned char* d = (unsigned char*)pd;
+	size_t n = m_end - m_pos;
+	if (n > nbytes) n = nbytes;
+	if (n > 0) memcpy(d, &m_buf[m_pos], n);
+	m_pos += n;
+	d += n;
+	nbytes -= n;
+
+	// large blocks are read directly
+	if (nbytes > 0) return (fread(d, 1, nbytes, m_fp) == nbytes);
+	return true;
+}
 
-	while (ch != NULL) //making sure the file doesn't ends here
+//-----------------------------------------------------------------------------
+bool FEVTKimport::readNumber(double& v)
+{
+	// skip white space
+	while (true)
 	{
-		//reading the point data
-		do
-		{	
-			if (ch == NULL) break;
-			if (ch == 0) return errf("An unexpected error occured while reading the file data.");
-			if (strstr(ch, "POINT_DATA") != 0)
-			{
-//				if (!readPointData(szline)) return errf("Error while reading POINT_DATA");
-				size = atoi(ch + 10);
-			}
-			if(strstr(ch,"CELL_DATA")!=0)
+		if ((m_pos >= m_end) && (fillBuffer() == false)) return false;
+		if (isspace((unsigned char)m_buf[m_pos])) m_pos++; else break;
+	}
+
+	// make sure the number is not split at the end of the buffer
+	if (m_end - m_pos < 64) fillBuffer();
+
+	char* sz = &m_buf[m_pos];
+	char* end = nullptr;
+	v = strtod(sz, &end);
+	if (end == sz) return false;
+	m_pos += (end - sz);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T> bool FEVTKimport::readArray(const std::string& type, size_t n, std::vector<T>& val)
+{
+	int ntype = vtk_data_type(type);
+	if (ntype == VTK_INVALID_TYPE) return errf("Unsupported data type %s.", type.c_str());
+
+	val.resize(n);
+	if (n == 0) return true;
+
+	if (m_binary)
+	{
+		// binary data is stored big-endian
+		int size = vtk_type_size[ntype];
+		std::vector<unsigned char> raw(n*size);
+		if (readBytes(&raw[0], raw.size()) == false) return errf("Unexpected end of file.");
+		if (is_little_endian()) swap_bytes(&raw[0], n, size);
+		convert_array(&raw[0], n, ntype, &val[0]);
+	}
+	else
+	{
+		double v;
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (readNumber(v) == false) return errf("An error occured while reading the data.");
+			val[i] = (T)v;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FEVTKimport::readCells(int elems, int size)
+{
+	m_conn.clear();
+	m_offset.clear();
+	if (m_version >= 5.1f)
+	{
+		// offsets and connectivity are stored in separate arrays
+		char szkey[64] = { 0 }, sztype[64] = { 0 };
+		std::vector<int> off;
+		if (!nextLine() || (sscanf(m_line.c_str(), "%63s %63s", szkey, sztype) != 2) || (strcmp(szkey, "OFFSETS") != 0)) return errf("Error looking for OFFSETS keyword.");
+		if (!readArray(sztype, elems, off)) return false;
+		if (!nextLine() || (sscanf(m_line.c_str(), "%63s %63s", szkey, sztype) != 2) || (strcmp(szkey, "CONNECTIVITY") != 0)) return errf("Error looking for CONNECTIVITY keyword.");
+		if (!readArray(sztype, size, m_conn)) return false;
+		if (off.size() > 1) m_offset.assign(off.begin() + 1, off.end());
+	}
+	else
+	{
+		// each cell is stored as the number of nodes followed by the nodes
+		std::vector<int> cells;
+		if (!readArray("int", size, cells)) return false;
+		m_conn.reserve(size - elems);
+		m_offset.resize(elems);
+		size_t n = 0;
+		for (int i = 0; i < elems; ++i)
+		{
+			if (n >= cells.size()) return errf("Invalid cell data.");
+			size_t m = cells[n++];
+			if (n + m > cells.size()) return errf("Invalid cell data.");
+			m_conn.insert(m_conn.end(), cells.begin() + n, cells.begin() + n + m);
+			m_offset[i] = (int)m_conn.size();
+			n += m;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FEVTKimport::readAttribute(int items, bool cellData)
+{
+	char szkey[64] = { 0 }, szname[256] = { 0 }, sztype[64] = { 0 };
+	int ncomp = 1;
+	int nread = sscanf(m_line.c_str(), "%63s %255s %63s %d", szkey, szname, sztype, &ncomp);
+	if (nread < 3) return errf("Invalid %s section.", szkey);
+
+	if (strcmp(szkey, "SCALARS") == 0)
+	{
+		if (nread < 4) ncomp = 1;
+		if (!nextLine() || (strncmp(m_line.c_str(), "LOOKUP_TABLE", 12) != 0)) return errf("Error looking for LOOKUP_TABLE keyword.");
+	}
+	else if (strcmp(szkey, "TENSORS") == 0) ncomp = 9;
+	else if (strcmp(szkey, "TENSORS6") == 0) ncomp = 6;
+	else ncomp = 3;
+
+	m_data.push_back(ARRAY());
+	ARRAY& a = m_data.back();
+	a.name = szname;
+	a.ncomp = ncomp;
+	a.cellData = cellData;
+	return readArray(sztype, (size_t)items*ncomp, a.val);
+}
+
+//-----------------------------------------------------------------------------
+bool FEVTKimport::readField(int items, bool cellData, bool keep)
+{
+	char szname[256] = { 0 }, sztype[64] = { 0 };
+	int narrays = 0;
+	if (sscanf(m_line.c_str(), "%*s %255s %d", szname, &narrays) != 2) return errf("Invalid FIELD section.");
+
+	for (int i = 0; i < narrays; ++i)
+	{
+		int ncomp = 0, ntuples = 0;
+		if (!nextLine() || (sscanf(m_line.c_str(), "%255s %d %d %63s", szname, &ncomp, &ntuples, sztype) != 4)) return errf("Invalid FIELD array.");
+
+		std::vector<float> val;
+		if (!readArray(sztype, (size_t)ncomp*ntuples, val)) return false;
+
+		if (keep && (ntuples == items))
+		{
+			m_data.push_back(ARRAY());
+			ARRAY& a = m_data.back();
+			a.name = szname;
+			a.ncomp = ncomp;
+			a.cellData = cellData;
+			a.val.swap(val);
+		}
+		else if (!keep && val.size() && ((strcmp(szname, "TimeValue") == 0) || (strcmp(szname, "TIME") == 0))) m_time = val[0];
+	}
+	return true;
+}
+
+//=============================================================================
+// XML format
+//=============================================================================
+
+bool FEVTKimport::LoadVTU()
+{
+	// read the XML part, i.e. everything up to the appended data
+	std::string xml;
+	std::vector<char> buf(1 << 16);
+	m_appended = -1;
+	size_t nread = 0, ntag = std::string::npos;
+	while ((nread = fread(&buf[0], 1, buf.size(), m_fp)) > 0)
+	{
+		size_t n0 = xml.size();
+		xml.append(&buf[0], nread);
+		if (ntag == std::string::npos) ntag = xml.find("<AppendedData", (n0 > 16 ? n0 - 16 : 0));
+		if (ntag != std::string::npos)
+		{
+			// the data starts after the underscore that follows the tag
+			size_t n = xml.find('>', ntag);
+			if (n != std::string::npos) n = xml.find('_', n);
+			if (n != std::string::npos)
 			{
-				size = atoi(ch + 9);
-				isCellData = true;
+				m_appended = (long long)n + 1;
+				break;
 			}
-			if (strstr(ch, "SCALARS") != 0) isScalar = true;
-			if (strstr(ch, "ShellThickness") != 0) isShellThickness = true;
-			ch = fgets(szline, 255, m_fp);
 		}
-		while(ch == NULL || strstr(ch, "LOOKUP_TABLE") == 0);
-
-		if (ch == NULL) break;
-
-		if(!isScalar && ch !=NULL)
-			return errf("Only scalar data is supported.");	
-		vector<double> data; 
-		//reading shell thickness
-		if(isShellThickness || isScalar)
-		{			
-			data.reserve(size);
-			//Check how many nodes are there in each line
-			ch = fgets(szline, 255, m_fp);
-			if (ch == 0) return errf("An unexpected error occured while reading the file data.");
-
-			nodes_each_row = sscanf(szline, "%lg%lg%lg%lg%lg%lg%lg%lg%lg", &temp[0],&temp[1],&temp[2], &temp[3],&temp[4],&temp[5], &temp[6],&temp[7],&temp[8]);
-			if (nodes_each_row>9) 
-				return errf("An error occured while reading the nodal coordinates.");
-			double temp2 = double(size)/nodes_each_row;
-			rows = (int)ceil(temp2);
-			for (i=0; i<rows; ++i)
-			{	
-				for (j=0;j<nodes_each_row && i*nodes_each_row+j <size;j++)
-				{
-					data.push_back(temp[j]);
-				}
-				ch = fgets(szline, 255, m_fp);
-				if (ch == 0 && i+1 != rows) 
-					return errf("An unexpected error occured while reading the scalar data.");
-
-				nread = sscanf(szline, "%lg%lg%lg%lg%lg%lg%lg%lg%lg", &temp[0],&temp[1],&temp[2], &temp[3],&temp[4],&temp[5], &temp[6],&temp[7],&temp[8]);
-				if (nread > 9 && nread != -1)
-				{ 			
-					if (i+1 != rows)
-						return errf("An error occured while reading the scalar.");
-				}
-			}
+	}
 
-			fem.AddDataField(new FEDataField_T<FENodeData<float> >("data", EXPORT_DATA));
+	if (m_appended >= 0)
+	{
+		std::string val;
+		if (attribute(xml_tag(xml, ntag), "encoding", val) && (val != "raw")) return errf("Only raw encoded appended data is supported.");
+		xml.resize(ntag);
+	}
 
-			FENodeData<float>& df = dynamic_cast<FENodeData<float>&>(ps->m_Data[0]);
-			for (int j=0; j<pm->Nodes(); ++j) df[j] = (float) data[j];
+	// file info
+	size_t n = xml.find("<VTKFile");
+	if (n == std::string::npos) return errf("This is not a valid VTK XML file.");
+	std::string tag = xml_tag(xml, n), val;
+	if (!attribute(tag, "type", val) || (val != "UnstructuredGrid")) return errf("Only VTK unstructured grid (.vtu) files are supported.");
+	m_swap = (attribute(tag, "byte_order", val) && ((val == "BigEndian") == is_little_endian()));
+	m_header64 = (attribute(tag, "header_type", val) && (val == "UInt64"));
+	m_compressed = false;
+	if (attribute(tag, "compressor", val))
+	{
+		if (val != "vtkZLibDataCompressor") return errf("Unsupported compressor %s.", val.c_str());
+		m_compressed = true;
+	}
+
+	// the time is stored in the field data
+	size_t s0, s1;
+	if (xml_section(xml, "FieldData", 0, xml.size(), s0, s1))
+	{
+		size_t m = xml.find("Name=\"TimeValue\"", s0);
+		if ((m != std::string::npos) && (m < s1))
+		{
+			std::vector<float> t;
+			m = xml.rfind("<DataArray", m);
+			if (!readDataArray(xml, m, t)) return false;
+			if (t.empty() == false) m_time = t[0];
 		}
+	}
 
-		//reading cell data
-		if(isCellData)
+	// we only read the first piece
+	n = xml.find("<Piece");
+	if (n == std::string::npos) return errf("No Piece found.");
+	if (xml.find("<Piece", n + 1) != std::string::npos) return errf("Only files with a single piece are supported.");
+	tag = xml_tag(xml, n);
+	int nodes = (attribute(tag, "NumberOfPoints", val) ? atoi(val.c_str()) : 0);
+	int elems = (attribute(tag, "NumberOfCells" , val) ? atoi(val.c_str()) : 0);
+	if (nodes <= 0) return errf("Invalid number of nodes.");
+	if (elems <= 0) return errf("Invalid number of cells.");
+	size_t p0 = n, p1 = xml.size();
+
+	// points
+	if (!xml_section(xml, "Points", p0, p1, s0, s1)) return errf("Error looking for Points section.");
+	n = xml.find("<DataArray", s0);
+	if ((n >= s1) || !readDataArray(xml, n, m_points)) return errf("Error reading Points.");
+	if (m_points.size() != 3 * (size_t)nodes) return errf("Invalid number of points.");
+
+	// cells
+	if (!xml_section(xml, "Cells", p0, p1, s0, s1)) return errf("Error looking for Cells section.");
+	for (n = xml.find("<DataArray", s0); n < s1; n = xml.find("<DataArray", n + 1))
+	{
+		tag = xml_tag(xml, n);
+		if (!attribute(tag, "Name", val)) continue;
+		bool bret = true;
+		if      (val == "connectivity") bret = readDataArray(xml, n, m_conn);
+		else if (val == "offsets"     ) bret = readDataArray(xml, n, m_offset);
+		else if (val == "types"       ) bret = readDataArray(xml, n, m_types);
+		if (bret == false) return false;
+	}
+	if ((m_offset.size() != (size_t)elems) || (m_types.size() != (size_t)elems)) return errf("Invalid number of cells.");
+
+	// point and cell data
+	for (int k = 0; k < 2; ++k)
+	{
+		if (!xml_section(xml, (k == 0 ? "PointData" : "CellData"), p0, p1, s0, s1)) continue;
+		for (n = xml.find("<DataArray", s0); n < s1; n = xml.find("<DataArray", n + 1))
 		{
-			fem.AddDataField(new FEDataField_T<FEElementData<float, DATA_ITEM> >("data", EXPORT_DATA));
+			tag = xml_tag(xml, n);
 
-			FEElementData<float, DATA_ITEM>& ed = dynamic_cast<FEElementData<float, DATA_ITEM>&>(ps->m_Data[ ps->m_Data.size() - 1]);
+			m_data.push_back(ARRAY());
+			ARRAY& a = m_data.back();
+			a.name = (attribute(tag, "Name", val) ? val : "");
+			a.ncomp = (attribute(tag, "NumberOfComponents", val) ? atoi(val.c_str()) : 1);
+			a.cellData = (k == 1);
+			if (!readDataArray(xml, n, a.val)) return false;
 
-			for (i=0; i<size; ++i)
-			{
-				FEElement_& el = pm->ElementRef(i);
-				ch = fgets(szline, 255, m_fp);
-				if (ch == 0) return errf("An unexpected error occured while reading the file data.");
-				nread = sscanf(szline, "%lg", &temp[0]);
-				ed.add(i, (float) temp[0]);
-			}
-		}		
+			if (IsCancelled()) return false;
+		}
 	}
 
-	Close();
+	return true;
+}
 
+//-----------------------------------------------------------------------------
+static bool read_header(FILE* fp, bool header64, bool swap, unsigned long long& v)
+{
+	if (header64)
+	{
+		if (fread(&v, 8, 1, fp) != 1) return false;
+		if (swap) swap_bytes((unsigned char*)&v, 1, 8);
+	}
+	else
+	{
+		unsigned int n;
+		if (fread(&n, 4, 1, fp) != 1) return false;
+		if (swap) swap_bytes((unsigned char*)&n, 1, 4);
+		v = n;
+	}
 	return true;
 }
 
-bool FEVTKimport::readPointData(char* szline)
+//-----------------------------------------------------------------------------
+// read the DataArray whose tag starts at position pos
+template <typename T> bool FEVTKimport::readDataArray(const std::string& xml, size_t pos, std::vector<T>& val)
 {
-	int size = atoi(szline + 10);
-	char* ch = fgets(szline, 255, m_fp);
-	char buf[3][64] = {0};
-	int nread = sscanf(szline, "%s %s %s", buf[0], buf[1], buf[2]);
+	std::string tag = xml_tag(xml, pos), sztype, format;
+	if (!attribute(tag, "type", sztype) || !attribute(tag, "format", format)) return errf("Invalid DataArray.");
+	int ntype = vtk_data_type(sztype);
+	if (ntype == VTK_INVALID_TYPE) return errf("Unsupported data type %s.", sztype.c_str());
 
+	if (format == "ascii")
+	{
+		size_t n0 = pos + tag.size();
+		size_t n1 = xml.find("</DataArray>", n0);
+		if (n1 == std::string::npos) return errf("Invalid DataArray.");
+		val.clear();
+		const char* sz = xml.c_str() + n0;
+		const char* szend = xml.c_str() + n1;
+		while (sz < szend)
+		{
+			char* end = nullptr;
+			double v = strtod(sz, &end);
+			if ((end == sz) || (end > szend)) break;
+			val.push_back((T)v);
+			sz = end;
+		}
+		return true;
+	}
+	else if (format != "appended") return errf("Unsupported DataArray format %s.", format.c_str());
 
-	bool bVectors = false;
-	if (strcmp(buf[0], "VECTORS") == 0) bVectors = true;
+	std::string offset;
+	if ((m_appended < 0) || !attribute(tag, "offset", offset)) return errf("Invalid appended DataArray.");
+	if (fseek64(m_fp, m_appended + atoll(offset.c_str()), SEEK_SET) != 0) return errf("Invalid appended DataArray.");
 
-	if (bVectors)
+	std::vector<unsigned char> raw;
+	if (m_compressed)
+	{
+		// header: number of blocks, block size, size of last block, compressed block sizes
+		unsigned long long hdr[3];
+		for (int i = 0; i < 3; ++i) if (!read_header(m_fp, m_header64, m_swap, hdr[i])) return errf("Unexpected end of file.");
+		size_t nb = (size_t)hdr[0], bs = (size_t)hdr[1], last = (size_t)hdr[2];
+		std::vector<unsigned long long> csize(nb);
+		for (size_t i = 0; i < nb; ++i) if (!read_header(m_fp, m_header64, m_swap, csize[i])) return errf("Unexpected end of file.");
+
+		size_t total = (nb == 0 ? 0 : (nb - 1)*bs + (last ? last : bs));
+		raw.resize(total);
+		std::vector<unsigned char> cbuf;
+		size_t n0 = 0;
+		for (size_t i = 0; i < nb; ++i)
+		{
+			cbuf.resize((size_t)csize[i]);
+			if (cbuf.size() && (fread(&cbuf[0], 1, cbuf.size(), m_fp) != cbuf.size())) return errf("Unexpected end of file.");
+			uLongf nout = (uLongf)(i == nb - 1 ? total - n0 : bs);
+			if ((nout > 0) && (uncompress(&raw[n0], &nout, (cbuf.empty() ? nullptr : &cbuf[0]), (uLong)cbuf.size()) != Z_OK)) return errf("Failed decompressing data.");
+			n0 += nout;
+		}
+		if (n0 != total) return errf("Failed decompressing data.");
+	}
+	else
 	{
-		m_fem->AddDataField(new FEDataField_T<FENodeData<vec3f> >(buf[1], EXPORT_DATA));
+		unsigned long long nbytes = 0;
+		if (!read_header(m_fp, m_header64, m_swap, nbytes)) return errf("Unexpected end of file.");
+		raw.resize((size_t)nbytes);
+		if (raw.size() && (fread(&raw[0], 1, raw.size(), m_fp) != raw.size())) return errf("Unexpected end of file.");
+	}
+
+	int size = vtk_type_size[ntype];
+	size_t n = raw.size() / size;
+	if (m_swap && n) swap_bytes(&raw[0], n, size);
+	val.resize(n);
+	if (n) convert_array(&raw[0], n, ntype, &val[0]);
+	return true;
+}
+
+//=============================================================================
+// build the model from the data that was read
+//=============================================================================
+
+bool FEVTKimport::BuildModel()
+{
+	FEPostModel& fem = *m_fem;
+
+	int nodes = (int)(m_points.size() / 3);
+	int elems = (int)m_offset.size();
+	if (nodes <= 0) return errf("Invalid number of nodes.");
+	if (elems <= 0) return errf("No cells found.");
+	if (m_types.size() != (size_t)elems) return errf("Incorrect number of cell types.");
+
+	// create a new mesh
+	FEPostMesh* pm = new FEPostMesh;
+	pm->Create(nodes, elems);
+
+	for (int i = 0; i < nodes; ++i)
+	{
+		const float* r = &m_points[3 * i];
+		pm->Node(i).r = vec3d(r[0], r[1], r[2]);
+	}
+
+	int n0 = 0;
+	for (int i = 0; i < elems; ++i)
+	{
+		FEElement& el = static_cast<FEElement&>(pm->ElementRef(i));
+		int ntype = fe_element_type(m_types[i]);
+		if (ntype == -1) { delete pm; return errf("Unsupported cell type %d.", m_types[i]); }
+		el.SetType(ntype);
+
+		int nn = m_offset[i] - n0;
+		if ((nn != el.Nodes()) || (m_offset[i] > (int)m_conn.size())) { delete pm; return errf("Invalid number of nodes for cell %d.", i + 1); }
+		for (int j = 0; j < nn; ++j)
+		{
+			int nj = m_conn[n0 + j];
+			if ((nj < 0) || (nj >= nodes)) { delete pm; return errf("Invalid node index in cell %d.", i + 1); }
+			el.m_node[j] = nj;
+		}
+		n0 = m_offset[i];
+	}
 
-		FENodeData<vec3f>& df = dynamic_cast<FENodeData<vec3f>&>(m_ps->m_Data[  m_ps->m_Data.size() - 1 ]);
+	// update the mesh
+	fem.AddMesh(pm);
+	pm->BuildMesh();
+	fem.UpdateBoundingBox();
 
-		float v[3];
-		for (int i=0; i<size; ++i)
+	// add a state
+	FEState* ps = new FEState(m_time, m_fem, pm);
+	fem.AddState(ps);
+
+	// add the data fields
+	for (size_t n = 0; n < m_data.size(); ++n)
+	{
+		ARRAY& a = m_data[n];
+		int items = (a.cellData ? elems : nodes);
+		if (a.val.size() != (size_t)items*a.ncomp) continue;
+		std::string name = (a.name.empty() ? "data" : a.name);
+		const float* v = &a.val[0];
+
+		// symmetric tensors are stored as xx, yy, zz, xy, yz, xz
+		if (a.cellData == false)
 		{
-			fgets(szline, 255, m_fp);
-			nread = sscanf(szline, "%g%g%g", &v[0], &v[1], &v[2]);
-			df[i] = vec3f(v[0], v[1], v[2]);
+			if (a.ncomp == 1)
+			{
+				fem.AddDataField(new FEDataField_T<FENodeData<float> >(name, EXPORT_DATA));
+				FENodeData<float>& df = dynamic_cast<FENodeData<float>&>(ps->m_Data[ps->m_Data.size() - 1]);
+				for (int i = 0; i < items; ++i) df[i] = v[i];
+			}
+			else if (a.ncomp == 3)
+			{
+				fem.AddDataField(new FEDataField_T<FENodeData<vec3f> >(name, EXPORT_DATA));
+				FENodeData<vec3f>& df = dynamic_cast<FENodeData<vec3f>&>(ps->m_Data[ps->m_Data.size() - 1]);
+				for (int i = 0; i < items; ++i, v += 3) df[i] = vec3f(v[0], v[1], v[2]);
+			}
+			else if (a.ncomp == 6)
+			{
+				fem.AddDataField(new FEDataField_T<FENodeData<mat3fs> >(name, EXPORT_DATA));
+				FENodeData<mat3fs>& df = dynamic_cast<FENodeData<mat3fs>&>(ps->m_Data[ps->m_Data.size() - 1]);
+				for (int i = 0; i < items; ++i, v += 6) df[i] = mat3fs(v[0], v[1], v[2], v[3], v[4], v[5]);
+			}
+			else if (a.ncomp == 9)
+			{
+				fem.AddDataField(new FEDataField_T<FENodeData<mat3fs> >(name, EXPORT_DATA));
+				FENodeData<mat3fs>& df = dynamic_cast<FENodeData<mat3fs>&>(ps->m_Data[ps->m_Data.size() - 1]);
+				for (int i = 0; i < items; ++i, v += 9) df[i] = mat3fs(v[0], v[4], v[8], v[1], v[5], v[2]);
+			}
+		}
+		else
+		{
+			if (a.ncomp == 1)
+			{
+				fem.AddDataField(new FEDataField_T<FEElementData<float, DATA_ITEM> >(name, EXPORT_DATA));
+				FEElementData<float, DATA_ITEM>& ed = dynamic_cast<FEElementData<float, DATA_ITEM>&>(ps->m_Data[ps->m_Data.size() - 1]);
+				for (int i = 0; i < items; ++i) ed.add(i, v[i]);
+			}
+			else if (a.ncomp == 3)
+			{
+				fem.AddDataField(new FEDataField_T<FEElementData<vec3f, DATA_ITEM> >(name, EXPORT_DATA));
+				FEElementData<vec3f, DATA_ITEM>& ed = dynamic_cast<FEElementData<vec3f, DATA_ITEM>&>(ps->m_Data[ps->m_Data.size() - 1]);
+				for (int i = 0; i < items; ++i, v += 3) ed.add(i, vec3f(v[0], v[1], v[2]));
+			}
+			else if (a.ncomp == 6)
+			{
+				fem.AddDataField(new FEDataField_T<FEElementData<mat3fs, DATA_ITEM> >(name, EXPORT_DATA));
+				FEElementData<mat3fs, DATA_ITEM>& ed = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>&>(ps->m_Data[ps->m_Data.size() - 1]);
+				for (int i = 0; i < items; ++i, v += 6) ed.add(i, mat3fs(v[0], v[1], v[2], v[3], v[4], v[5]));
+			}
+			else if (a.ncomp == 9)
+			{
+				fem.AddDataField(new FEDataField_T<FEElementData<mat3fs, DATA_ITEM> >(name, EXPORT_DATA));
+				FEElementData<mat3fs, DATA_ITEM>& ed = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>&>(ps->m_Data[ps->m_Data.size() - 1]);
+				for (int i = 0; i < items; ++i, v += 9) ed.add(i, mat3fs(v[0], v[4], v[8], v[1], v[5], v[2]));
+			}
 		}
+
+		std::vector<float>().swap(a.val);
 	}
 
 	return true;
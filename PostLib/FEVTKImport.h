@@ -27,13 +27,27 @@ SOFTWARE.*/
 #pragma once
 #include "FEFileReader.h"
 #include <vector>
+#include <string>
 
 namespace Post {
 
 class FEState;
 
+//-----------------------------------------------------------------------------
+// Reads an unstructured grid or polydata from a legacy VTK file (ASCII or binary)
+// or from an XML unstructured grid (.vtu). The VTU reader supports inline ASCII
+// arrays and raw appended data, optionally zlib compressed.
 class FEVTKimport :	public FEFileReader
 {
+public:
+	// a point or cell data array
+	struct ARRAY
+	{
+		std::string			name;
+		int					ncomp;
+		bool				cellData;
+		std::vector<float>	val;
+	};
 
 public:
 	FEVTKimport(FEPostModel* fem);
@@ -42,10 +56,46 @@ public:
 	bool Load(const char* szfile) override;
 
 protected:
-	bool readPointData(char* ch);
-	
+	bool LoadLegacy();
+	bool LoadVTU();
+	bool BuildModel();
+
+protected:
+	// legacy format
+	bool fillBuffer();
+	bool readBytes(void* pd, size_t nbytes);
+	bool readNumber(double& v);
+	template <typename T> bool readArray(const std::string& type, size_t n, std::vector<T>& val);
+	bool nextLine(bool skipEmpty = true);
+	bool readCells(int elems, int size);
+	bool readAttribute(int items, bool cellData);
+	bool readField(int items, bool cellData, bool keep);
+
+	// XML format
+	template <typename T> bool readDataArray(const std::string& xml, size_t pos, std::vector<T>& val);
+
 protected:
-	bool BuildMesh();
-	FEState*		m_ps;
+	float		m_version;		// legacy file version
+	bool		m_binary;		// legacy file is binary
+	bool		m_polyData;		// legacy file contains POLYDATA
+	float		m_time;			// time value of the state
+
+	// read buffer (legacy format)
+	std::vector<char>	m_buf;
+	size_t				m_pos, m_end;
+	std::string			m_line;
+
+	// VTU format
+	long long	m_appended;		// file offset of appended data
+	bool		m_swap;			// swap byte order
+	bool		m_header64;		// use 64-bit headers
+	bool		m_compressed;	// data is zlib compressed
+
+	// data read from file
+	std::vector<float>	m_points;
+	std::vector<int>	m_conn;			// connectivity
+	std::vector<int>	m_offset;		// end of each cell in connectivity
+	std::vector<int>	m_types;		// VTK cell types
+	std::vector<ARRAY>	m_data;
 };
 }
@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include "ImageModel.h"
 #include <ImageLib/3DImage.h>
 #include "GLImageRenderer.h"
+#include "ImagePyramid.h"
 #include <FSCore/FSDir.h>
 #include <assert.h>
 using namespace Post;
@@ -38,8 +39,10 @@ CImageSource::CImageSource(CImageModel* imgModel)
 	AddIntParam(0, "NX")->SetState(Param_VISIBLE);
 	AddIntParam(1, "NY")->SetState(Param_VISIBLE);
 	AddIntParam(2, "NZ")->SetState(Param_VISIBLE);
+	AddIntParam(0, "voxel type")->SetEnumNames("8-bit\0""16-bit\0""32-bit float\0")->SetState(Param_VISIBLE);
 
 	m_img = nullptr;
+	m_pyramid = nullptr;
 	m_imgModel = imgModel;
 }
 
@@ -55,6 +58,7 @@ void CImageSource::SetImageModel(CImageModel* imgModel)
 
 CImageSource::~CImageSource()
 {
+	delete m_pyramid;
 	delete m_img;
 }
 
@@ -68,16 +72,11 @@ std::string CImageSource::GetFileName() const
 	return GetStringValue(0);
 }
 
-bool CImageSource::LoadImageData(const std::string& fileName, int nx, int ny, int nz)
+bool CImageSource::LoadImageData(const std::string& fileName, int nx, int ny, int nz, int voxelType)
 {
+	// The image data is not read here. It is loaded from the file in bricks when it is accessed.
 	C3DImage* im = new C3DImage;
-	if (im->Create(nx, ny, nz) == false)
-	{
-		delete im;
-		return false;
-	}
-
-	if (im->LoadFromFile(fileName.c_str(), 8) == false)
+	if (im->Open(fileName.c_str(), nx, ny, nz, voxelType) == false)
 	{
 		delete im;
 		return false;
@@ -87,10 +86,15 @@ bool CImageSource::LoadImageData(const std::string& fileName, int nx, int ny, in
 	SetIntValue(1, nx);
 	SetIntValue(2, ny);
 	SetIntValue(3, nz);
+	SetIntValue(4, voxelType);
 
+	delete m_pyramid;
 	delete m_img;
 	m_img = im;
 
+	// this creates a preview right away and builds the other levels in the background
+	m_pyramid = new CImagePyramid(m_img, fileName);
+
 	return true;
 }
 
@@ -102,12 +106,13 @@ void CImageSource::Save(OArchive& ar)
 int CImageSource::Width() const { return GetIntValue(1);  }
 int CImageSource::Height() const { return GetIntValue(2); }
 int CImageSource::Depth() const { return GetIntValue(3); }
+int CImageSource::VoxelType() const { return GetIntValue(4); }
 
 void CImageSource::Load(IArchive& ar)
 {
 	FSObject::Load(ar);
 	string file = GetFileName();
-	LoadImageData(file, Width(), Height(), Depth());
+	LoadImageData(file, Width(), Height(), Depth(), VoxelType());
 }
 
 //========================================================================
@@ -131,6 +136,8 @@ CImageModel::CImageModel(CGLModel* mdl) : CGLObject(mdl)
 
 CImageModel::~CImageModel()
 {
+	// the renderers may still be using the image data in the background
+	m_render.Clear();
 	delete m_img;
 }
 
@@ -161,11 +168,11 @@ bool CImageModel::UpdateData(bool bsave)
 	return false;
 }
 
-bool CImageModel::LoadImageData(const std::string& fileName, int nx, int ny, int nz, const BOX& box)
+bool CImageModel::LoadImageData(const std::string& fileName, int nx, int ny, int nz, const BOX& box, int voxelType)
 {
 	if (m_img == nullptr) m_img = new CImageSource(this);
 
-	if (m_img->LoadImageData(fileName, nx, ny, nz) == false)
+	if (m_img->LoadImageData(fileName, nx, ny, nz, voxelType) == false)
 	{
 		delete m_img;
 		m_img = nullptr;
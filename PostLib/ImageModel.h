@@ -38,6 +38,7 @@ namespace Post {
 
 class CImageModel;
 class CGLImageRenderer;
+class CImagePyramid;
 
 class CImageSource : public FSObject
 {
@@ -48,16 +49,21 @@ public:
 	void SetFileName(const std::string& fileName);
 	std::string GetFileName() const;
 
-	bool LoadImageData(const std::string& fileName, int nx, int ny, int nz);
+	// voxelType is one of the C3DImage::VoxelType values
+	bool LoadImageData(const std::string& fileName, int nx, int ny, int nz, int voxelType = 0);
 
 	C3DImage* Get3DImage() { return m_img; }
 
+	// multi-resolution version of the image data
+	CImagePyramid* GetPyramid() { return m_pyramid; }
+
 	void Save(OArchive& ar);
 	void Load(IArchive& ar);
 
 	int Width() const;
 	int Height() const;
 	int Depth() const;
+	int VoxelType() const;
 
 public:
 	CImageModel* GetImageModel();
@@ -65,6 +71,7 @@ public:
 
 private:
 	C3DImage*	m_img;
+	CImagePyramid*	m_pyramid;
 	CImageModel*	m_imgModel;
 };
 
@@ -74,7 +81,7 @@ public:
 	CImageModel(CGLModel* mdl);
 	~CImageModel();
 
-	bool LoadImageData(const std::string& fileName, int nx, int ny, int nz, const BOX& box);
+	bool LoadImageData(const std::string& fileName, int nx, int ny, int nz, const BOX& box, int voxelType = 0);
 
 	int ImageRenderers() const { return (int)m_render.Size(); }
 	CGLImageRenderer* GetImageRenderer(int i) { return m_render[i]; }
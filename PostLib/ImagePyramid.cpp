@@ -0,0 +1,377 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#include "stdafx.h"
+#include "ImagePyramid.h"
+#include <ImageLib/3DImage.h>
+#include <QThread>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+using namespace Post;
+
+//-----------------------------------------------------------------------------
+class CPyramidThread : public QThread
+{
+public:
+	CPyramidThread(CImagePyramid* pyr) : m_pyr(pyr) {}
+
+	void run() override { m_pyr->Build(); }
+
+private:
+	CImagePyramid*	m_pyr;
+};
+
+//-----------------------------------------------------------------------------
+// header of the cache files
+struct PYRAMID_CACHE
+{
+	char		magic[4];		// "FSIP"
+	int			version;
+	int			nx, ny, nz;		// source dimensions
+	int			voxelType;		// source voxel type
+	int			level;
+	int			reserved;
+	double		vmin, vmax;		// value range
+	long long	mtime;			// modification time of source file
+};
+
+static bool s_diskCache = true;
+static std::atomic<int> s_refining(0);
+
+void CImagePyramid::SetDiskCache(bool b) { s_diskCache = b; }
+bool CImagePyramid::DiskCache() { return s_diskCache; }
+
+void CImagePyramid::BeginRefine() { s_refining++; }
+void CImagePyramid::EndRefine() { s_refining--; }
+bool CImagePyramid::IsRefining() { return (s_refining > 0); }
+
+//-----------------------------------------------------------------------------
+CImagePyramid::CImagePyramid(C3DImage* src, const std::string& fileName) : m_src(src), m_file(fileName)
+{
+	m_preview = nullptr;
+	m_thread = nullptr;
+	m_rev = 0;
+	m_building = false;
+	m_cancel = false;
+
+	m_N = src->Width();
+	if (src->Height() > m_N) m_N = src->Height();
+	if (src->Depth () > m_N) m_N = src->Depth();
+
+	// find the range of levels
+	m_L0 = 1;
+	while (LevelSize(m_N, m_L0) > MAX_LEVEL_SIZE) m_L0++;
+	m_L1 = m_L0;
+	while (LevelSize(m_N, m_L1) > MIN_LEVEL_SIZE) m_L1++;
+
+	// small images are used as is
+	if (m_N <= PREVIEW_SIZE) return;
+
+	m_level.assign(m_L1 + 1, nullptr);
+
+	// create the preview
+	int Lp = 0;
+	while (LevelSize(m_N, Lp) > PREVIEW_SIZE) Lp++;
+	m_preview = new C3DImage;
+	src->Subsample(*m_preview, 1 << Lp);
+
+	// build the other levels in the background
+	m_building = true;
+	BeginRefine();
+	m_thread = new CPyramidThread(this);
+	m_thread->start(QThread::LowPriority);
+}
+
+CImagePyramid::~CImagePyramid()
+{
+	if (m_thread)
+	{
+		m_cancel = true;
+		m_thread->wait();
+		delete m_thread;
+	}
+
+	for (size_t i = 0; i < m_level.size(); ++i) delete m_level[i];
+	delete m_preview;
+}
+
+//-----------------------------------------------------------------------------
+C3DImage* CImagePyramid::GetImage(int maxSize)
+{
+	if ((m_N <= maxSize) || m_level.empty()) return m_src;
+
+	// find the level that fits
+	int L = 1;
+	while (LevelSize(m_N, L) > maxSize) L++;
+	if (L < m_L0) return m_src;
+
+	// return the finest level available that is not larger
+	QMutexLocker lock(&m_mutex);
+	for (int i = L; i <= m_L1; ++i)
+		if (m_level[i]) return m_level[i];
+
+	return m_preview;
+}
+
+//-----------------------------------------------------------------------------
+void CImagePyramid::Build()
+{
+	C3DImage* im = LoadCache(m_L0);
+	if (im == nullptr)
+	{
+		im = Reduce(m_L0);
+		if (im) SaveCache(m_L0, *im);
+	}
+
+	if (im)
+	{
+		Publish(m_L0, im);
+
+		// the coarser levels are cheap to calculate from the finest one
+		for (int L = m_L0 + 1; (L <= m_L1) && (m_cancel == false); ++L)
+		{
+			im = Halve(*im);
+			Publish(L, im);
+		}
+	}
+
+	m_building = false;
+	EndRefine();
+}
+
+void CImagePyramid::Publish(int L, C3DImage* im)
+{
+	QMutexLocker lock(&m_mutex);
+	m_level[L] = im;
+	m_rev++;
+}
+
+//-----------------------------------------------------------------------------
+// Calculate level L from the source image by averaging blocks of 2^L voxels. The
+// work is split in tiles that line up with the bricks of out-of-core images, so
+// that each brick is read only once. Returns null if the build was canceled.
+C3DImage* CImagePyramid::Reduce(int L)
+{
+	C3DImage& src = *m_src;
+	int cx = src.Width();
+	int cy = src.Height();
+	int cz = src.Depth();
+
+	const int s = 1 << L;
+	int nx = LevelSize(cx, L);
+	int ny = LevelSize(cy, L);
+	int nz = LevelSize(cz, L);
+
+	C3DImage* im = new C3DImage;
+	if (im->Create(nx, ny, nz) == false) { delete im; return nullptr; }
+	byte* pd = im->GetBytes();
+
+	// tile size (in source voxels)
+	const int T = (s > C3DImage::BRICK_SIZE ? s : (int)C3DImage::BRICK_SIZE);
+	const int tx = (cx + T - 1) / T;
+	const int ty = (cy + T - 1) / T;
+	const int tz = (cz + T - 1) / T;
+	const int tiles = tx*ty*tz;
+
+	#pragma omp parallel
+	{
+		const int m = T / s;
+		std::vector<unsigned long long> sum((size_t)m*m*m);
+
+		#pragma omp for schedule(dynamic)
+		for (int n = 0; n < tiles; ++n)
+		{
+			if (m_cancel) continue;
+
+			int i0 = (n % tx)*T;
+			int j0 = ((n / tx) % ty)*T;
+			int k0 = (n / (tx*ty))*T;
+			int i1 = (i0 + T < cx ? i0 + T : cx);
+			int j1 = (j0 + T < cy ? j0 + T : cy);
+			int k1 = (k0 + T < cz ? k0 + T : cz);
+
+			// accumulate the voxels in source order
+			sum.assign(sum.size(), 0);
+			for (int k = k0; k < k1; ++k)
+			{
+				unsigned long long* pk = &sum[((k - k0) >> L)*m*m];
+				for (int j = j0; j < j1; ++j)
+				{
+					unsigned long long* pj = pk + ((j - j0) >> L)*m;
+					for (int i = i0; i < i1; ++i) pj[(i - i0) >> L] += src.value(i, j, k);
+				}
+			}
+
+			// store the averages
+			int I0 = i0 / s, I1 = LevelSize(i1, L);
+			int J0 = j0 / s, J1 = LevelSize(j1, L);
+			int K0 = k0 / s, K1 = LevelSize(k1, L);
+			for (int K = K0; K < K1; ++K)
+			{
+				int ck = (cz - K*s < s ? cz - K*s : s);
+				for (int J = J0; J < J1; ++J)
+				{
+					int cj = (cy - J*s < s ? cy - J*s : s);
+					for (int I = I0; I < I1; ++I)
+					{
+						int ci = (cx - I*s < s ? cx - I*s : s);
+						unsigned long long c = (unsigned long long)ci*cj*ck;
+						unsigned long long v = sum[((K - K0)*m + (J - J0))*m + (I - I0)];
+						pd[((size_t)K*ny + J)*nx + I] = (byte)((v + c / 2) / c);
+					}
+				}
+			}
+		}
+	}
+
+	if (m_cancel) { delete im; return nullptr; }
+	return im;
+}
+
+//-----------------------------------------------------------------------------
+// Downsample an image by a factor two in each direction.
+C3DImage* CImagePyramid::Halve(C3DImage& im)
+{
+	int cx = im.Width();
+	int cy = im.Height();
+	int cz = im.Depth();
+	int nx = LevelSize(cx, 1);
+	int ny = LevelSize(cy, 1);
+	int nz = LevelSize(cz, 1);
+
+	C3DImage* pim = new C3DImage;
+	pim->Create(nx, ny, nz);
+	const byte* ps = im.GetBytes();
+	byte* pd = pim->GetBytes();
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int K = 0; K < nz; ++K)
+	{
+		int k0 = 2*K, k1 = (2*K + 1 < cz ? 2*K + 1 : 2*K);
+		for (int J = 0; J < ny; ++J)
+		{
+			int j0 = 2*J, j1 = (2*J + 1 < cy ? 2*J + 1 : 2*J);
+			for (int I = 0; I < nx; ++I)
+			{
+				int i0 = 2*I, i1 = (2*I + 1 < cx ? 2*I + 1 : 2*I);
+				int v = 0;
+				v += ps[((size_t)k0*cy + j0)*cx + i0] + ps[((size_t)k0*cy + j0)*cx + i1];
+				v += ps[((size_t)k0*cy + j1)*cx + i0] + ps[((size_t)k0*cy + j1)*cx + i1];
+				v += ps[((size_t)k1*cy + j0)*cx + i0] + ps[((size_t)k1*cy + j0)*cx + i1];
+				v += ps[((size_t)k1*cy + j1)*cx + i0] + ps[((size_t)k1*cy + j1)*cx + i1];
+				pd[((size_t)K*ny + J)*nx + I] = (byte)((v + 4) / 8);
+			}
+		}
+	}
+
+	return pim;
+}
+
+//-----------------------------------------------------------------------------
+std::string CImagePyramid::CacheFile(int L) const
+{
+	char sz[16] = { 0 };
+	sprintf(sz, ".L%d.mip", L);
+	return m_file + sz;
+}
+
+static long long fileTime(const std::string& file)
+{
+	struct stat st;
+	if (stat(file.c_str(), &st) != 0) return -1;
+	return (long long)st.st_mtime;
+}
+
+// Read a level from the disk cache. Returns null if there is no valid cache file.
+C3DImage* CImagePyramid::LoadCache(int L)
+{
+	if ((s_diskCache == false) || m_file.empty()) return nullptr;
+
+	FILE* fp = fopen(CacheFile(L).c_str(), "rb");
+	if (fp == nullptr) return nullptr;
+
+	double vmin, vmax;
+	m_src->GetValueRange(vmin, vmax);
+
+	PYRAMID_CACHE h;
+	bool bok = (fread(&h, sizeof(h), 1, fp) == 1) && (strncmp(h.magic, "FSIP", 4) == 0) && (h.version == 1) &&
+		(h.nx == m_src->Width()) && (h.ny == m_src->Height()) && (h.nz == m_src->Depth()) &&
+		(h.voxelType == m_src->GetVoxelType()) && (h.level == L) &&
+		(h.vmin == vmin) && (h.vmax == vmax) && (h.mtime == fileTime(m_file));
+
+	C3DImage* im = nullptr;
+	if (bok)
+	{
+		int nx = LevelSize(h.nx, L);
+		int ny = LevelSize(h.ny, L);
+		int nz = LevelSize(h.nz, L);
+		size_t nsize = (size_t)nx*ny*nz;
+		im = new C3DImage;
+		if ((im->Create(nx, ny, nz) == false) || (fread(im->GetBytes(), 1, nsize, fp) != nsize))
+		{
+			delete im;
+			im = nullptr;
+		}
+	}
+	fclose(fp);
+
+	return im;
+}
+
+// Write a level to the disk cache. Failures are ignored since the cache is optional.
+// The magic is written last so that an incomplete file is never used.
+void CImagePyramid::SaveCache(int L, C3DImage& im)
+{
+	if ((s_diskCache == false) || m_file.empty()) return;
+
+	std::string file = CacheFile(L);
+	FILE* fp = fopen(file.c_str(), "wb");
+	if (fp == nullptr) return;
+
+	PYRAMID_CACHE h;
+	memset(&h, 0, sizeof(h));
+	h.version = 1;
+	h.nx = m_src->Width();
+	h.ny = m_src->Height();
+	h.nz = m_src->Depth();
+	h.voxelType = m_src->GetVoxelType();
+	h.level = L;
+	m_src->GetValueRange(h.vmin, h.vmax);
+	h.mtime = fileTime(m_file);
+
+	size_t nsize = (size_t)im.Width()*im.Height()*im.Depth();
+	bool bok = (fwrite(&h, sizeof(h), 1, fp) == 1) && (fwrite(im.GetBytes(), 1, nsize, fp) == nsize);
+	if (bok)
+	{
+		memcpy(h.magic, "FSIP", 4);
+		bok = (fseek(fp, 0, SEEK_SET) == 0) && (fwrite(&h, sizeof(h), 1, fp) == 1);
+	}
+	fclose(fp);
+
+	if (bok == false) remove(file.c_str());
+}
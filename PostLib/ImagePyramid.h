@@ -0,0 +1,111 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <QMutex>
+
+class C3DImage;
+class QThread;
+
+namespace Post {
+
+//-----------------------------------------------------------------------------
+// Multi-resolution pyramid of a 3D image. Level L is the image downsampled by
+// a factor 2^L in each direction. A point-sampled preview is created right away
+// so that something can be shown quickly. The filtered (box-averaged) levels are
+// built on a background thread and become available through GetImage as they
+// are finished. The finest filtered level can be cached on disk next to the
+// image file so it does not need to be rebuilt when the image is loaded again.
+class CImagePyramid
+{
+public:
+	enum {
+		PREVIEW_SIZE   = 128,	// max dimension of the preview
+		MAX_LEVEL_SIZE = 512,	// max dimension of the finest level that is built
+		MIN_LEVEL_SIZE = 16		// max dimension of the coarsest level
+	};
+
+public:
+	CImagePyramid(C3DImage* src, const std::string& fileName);
+	~CImagePyramid();
+
+	// Returns the best image available now whose dimensions do not exceed maxSize.
+	// The source image is returned if it is small enough, or if maxSize is larger
+	// than the finest level.
+	C3DImage* GetImage(int maxSize);
+
+	// incremented each time a new level becomes available
+	int Revision() const { return m_rev; }
+
+	// are the levels still being built?
+	bool IsBuilding() const { return m_building; }
+
+	// builds the filtered levels (runs on the worker thread)
+	void Build();
+
+public:
+	// enable or disable the disk cache
+	static void SetDiskCache(bool b);
+	static bool DiskCache();
+
+	// Background tasks that refine image data report themselves with BeginRefine/EndRefine.
+	// IsRefining is used by the view to keep redrawing until the refinement is done.
+	static void BeginRefine();
+	static void EndRefine();
+	static bool IsRefining();
+
+private:
+	int LevelSize(int n, int L) const { return (n + (1 << L) - 1) >> L; }
+
+	C3DImage* Reduce(int L);
+	C3DImage* Halve(C3DImage& im);
+	void Publish(int L, C3DImage* im);
+
+	std::string CacheFile(int L) const;
+	C3DImage* LoadCache(int L);
+	void SaveCache(int L, C3DImage& im);
+
+private:
+	C3DImage*		m_src;		// the source image
+	std::string		m_file;		// the source file
+	int				m_N;		// largest source dimension
+	int				m_L0;		// finest level that is built
+	int				m_L1;		// coarsest level that is built
+
+	C3DImage*				m_preview;	// point-sampled preview
+	std::vector<C3DImage*>	m_level;	// filtered levels (null if not yet available)
+
+	QThread*			m_thread;
+	QMutex				m_mutex;
+	std::atomic<int>	m_rev;
+	std::atomic<bool>	m_building;
+	std::atomic<bool>	m_cancel;
+};
+}
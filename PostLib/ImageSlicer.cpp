@@ -37,6 +37,7 @@ SOFTWARE.*/
 #endif
 #include "ImageSlicer.h"
 #include "ImageModel.h"
+#include "ImagePyramid.h"
 #include <assert.h>
 #include <sstream>
 using namespace Post;
@@ -59,6 +60,7 @@ CImageSlicer::CImageSlicer(CImageModel* img) : CGLImageRenderer(img)
 	m_off = 0.5;
 	m_texID = 0;
 	m_reloadTexture = true;
+	m_srcImage = nullptr;
 
 	UpdateData(false);
 }
@@ -104,8 +106,10 @@ void CImageSlicer::Create()
 	int nz = closest_pow2(d);
 	m_im3d.Create(nx, ny, nz);
 
-	// resample image
-	im3d.StretchBlt(m_im3d);
+	// resample the best level of the image pyramid that is available now
+	CImagePyramid* pyr = src->GetPyramid();
+	m_srcImage = (pyr ? pyr->GetImage(max(nx, max(ny, nz))) : &im3d);
+	m_srcImage->StretchBlt(m_im3d);
 
 	// call update to initialize all other data
 	Update();
@@ -180,6 +184,14 @@ void CImageSlicer::BuildLUT()
 //! Render textures
 void CImageSlicer::Render(CGLContext& rc)
 {
+	// switch to a finer level of the image pyramid when it becomes available
+	CImageSource* src = GetImageModel()->GetImageSource();
+	if (src && src->GetPyramid() && m_srcImage)
+	{
+		int nmax = max(m_im3d.Width(), max(m_im3d.Height(), m_im3d.Depth()));
+		if (src->GetPyramid()->GetImage(nmax) != m_srcImage) Create();
+	}
+
 	if (m_texID == 0)
 	{
 		glDisable(GL_TEXTURE_2D);
@@ -67,6 +67,7 @@ private:
 
 private:
 	C3DImage		m_im3d;	// resampled 3D image data
+	C3DImage*		m_srcImage;	// image that m_im3d was resampled from
 	CRGBAImage		m_im;	// 2D image that will be displayed
 	int				m_LUTC[4][256];	// color lookup table
 	bool			m_reloadTexture;
@@ -38,9 +38,12 @@ SOFTWARE.*/
 #endif
 #include "MarchingCubes.h"
 #include "ImageModel.h"
+#include "ImagePyramid.h"
 #include <ImageLib/3DImage.h>
 #include <ImageLib/3DGradientMap.h>
 #include <sstream>
+#include <algorithm>
+#include <QThread>
 #include <assert.h>
 using namespace std;
 using namespace Post;
@@ -56,28 +59,90 @@ TriMesh::TriMesh()
 
 void TriMesh::Clear()
 {
+	m_Node.clear();
+	m_Norm.clear();
 	m_Face.clear();
 }
 
-void TriMesh::Reserve(size_t nsize)
+void TriMesh::Reserve(size_t nodes, size_t faces)
 {
-	m_Face.reserve(nsize);
+	m_Node.reserve(nodes);
+	m_Norm.reserve(nodes);
+	m_Face.reserve(faces);
 }
 
-void TriMesh::Resize(size_t nsize)
+void TriMesh::Merge(TriMesh& tri)
 {
-	m_Face.resize(nsize);
+	int N0 = Nodes();
+	m_Node.insert(m_Node.end(), tri.m_Node.begin(), tri.m_Node.end());
+	m_Norm.insert(m_Norm.end(), tri.m_Norm.begin(), tri.m_Norm.end());
+
+	size_t F0 = m_Face.size();
+	m_Face.insert(m_Face.end(), tri.m_Face.begin(), tri.m_Face.end());
+	for (size_t i = F0; i < m_Face.size(); ++i)
+	{
+		TRI& f = m_Face[i];
+		f.n[0] += N0; f.n[1] += N0; f.n[2] += N0;
+	}
 }
 
-void TriMesh::Merge(TriMesh& tri, int ncount)
+void TriMesh::Weld(std::vector<std::pair<long long, int> >& keys)
 {
-	if (ncount < 0) ncount = tri.Faces();
-	int N = (int)m_Face.size();
-	m_Face.resize(m_Face.size() + ncount);
-	for (size_t i = 0; i < ncount; ++i)
-		m_Face[N + i] = tri.m_Face[i];
+	if (keys.empty()) return;
+	std::sort(keys.begin(), keys.end());
+
+	// map each node to the first node with the same key
+	int N = Nodes();
+	std::vector<int> tag(N);
+	for (int i = 0; i < N; ++i) tag[i] = i;
+	for (size_t i = 1; i < keys.size(); ++i)
+	{
+		if (keys[i].first == keys[i - 1].first) tag[keys[i].second] = tag[keys[i - 1].second];
+	}
+
+	// remove the duplicates
+	int n = 0;
+	for (int i = 0; i < N; ++i)
+	{
+		if (tag[i] == i)
+		{
+			m_Node[n] = m_Node[i];
+			m_Norm[n] = m_Norm[i];
+			tag[i] = n++;
+		}
+		else tag[i] = tag[tag[i]];
+	}
+	m_Node.resize(n);
+	m_Norm.resize(n);
+
+	for (size_t i = 0; i < m_Face.size(); ++i)
+	{
+		TRI& f = m_Face[i];
+		f.n[0] = tag[f.n[0]];
+		f.n[1] = tag[f.n[1]];
+		f.n[2] = tag[f.n[2]];
+	}
+}
+
+void TriMesh::Swap(TriMesh& tri)
+{
+	m_Node.swap(tri.m_Node);
+	m_Norm.swap(tri.m_Norm);
+	m_Face.swap(tri.m_Face);
 }
 
+//-----------------------------------------------------------------------------
+class CRefineThread : public QThread
+{
+public:
+	CRefineThread(CMarchingCubes* mc) : m_mc(mc) {}
+
+	void run() override { m_mc->Refine(); }
+
+private:
+	CMarchingCubes*	m_mc;
+};
+
 CMarchingCubes::CMarchingCubes(CImageModel* img) : CGLImageRenderer(img)
 {
 	static int n = 1;
@@ -99,18 +164,28 @@ CMarchingCubes::CMarchingCubes(CImageModel* img) : CGLImageRenderer(img)
 	m_binvertSpace = false;
 	m_col = GLColor(200, 185, 185);
 
+	m_thread = nullptr;
+	m_refineImage = nullptr;
+	m_refineGrad = nullptr;
+	m_grad[0] = m_grad[1] = nullptr;
+	m_cancel = false;
+	m_refined = false;
+
 	UpdateData(false);
 }
 
 CMarchingCubes::~CMarchingCubes()
 {
-
+	StopRefine();
+	delete m_grad[0];
+	delete m_grad[1];
 }
 
 bool CMarchingCubes::UpdateData(bool bsave)
 {
 	if (bsave)
 	{
+		StopRefine();
 		m_val = GetFloatValue(ISO_VALUE);
 		m_bsmooth = GetBoolValue(SMOOTH);
 		m_col = GetColorValue(COLOR);
@@ -135,6 +210,7 @@ bool CMarchingCubes::UpdateData(bool bsave)
 
 void CMarchingCubes::SetSmooth(bool b)
 { 
+	StopRefine();
 	m_bsmooth = b; 
 	m_oldVal = -1.f;
 //	Create();
@@ -142,12 +218,14 @@ void CMarchingCubes::SetSmooth(bool b)
 
 void CMarchingCubes::SetInvertSpace(bool b)
 { 
+	StopRefine();
 	m_binvertSpace = b; 
 	m_oldVal = -1.f;
 }
 
 void CMarchingCubes::SetCloseSurface(bool b)
 {
+	StopRefine();
 	m_bcloseSurface = b;
 	m_oldVal = -1.f;
 }
@@ -165,8 +243,14 @@ void CMarchingCubes::Create()
 	CreateSurface();
 }
 
+//-----------------------------------------------------------------------------
+// The surface is first calculated on a coarse level of the image pyramid so that 
+// something can be shown right away. The full resolution surface is then
+// calculated in the background and replaces the preview when it is done.
 void CMarchingCubes::CreateSurface()
 {
+	StopRefine();
+
 	m_oldVal = m_val;
 
 	m_mesh.Clear();
@@ -178,6 +262,58 @@ void CMarchingCubes::CreateSurface()
 
 	BOX b = im.GetBoundingBox();
 
+	CImagePyramid* pyr = src->GetPyramid();
+	C3DImage* pim = (pyr ? pyr->GetImage(CImagePyramid::PREVIEW_SIZE) : &im3d);
+	BuildSurface(*pim, b, GradientMap(pim == &im3d ? 1 : 0, *pim, b), m_mesh);
+
+	if (pim != &im3d)
+	{
+		m_refineImage = &im3d;
+		m_refineBox = b;
+		m_refineGrad = &GradientMap(1, im3d, b);
+		m_refined = false;
+		CImagePyramid::BeginRefine();
+		m_thread = new CRefineThread(this);
+		m_thread->start(QThread::LowPriority);
+	}
+}
+
+void CMarchingCubes::Refine()
+{
+	m_next.Clear();
+	BuildSurface(*m_refineImage, m_refineBox, *m_refineGrad, m_next);
+	if (m_cancel == false) m_refined = true;
+	CImagePyramid::EndRefine();
+}
+
+void CMarchingCubes::StopRefine()
+{
+	if (m_thread)
+	{
+		m_cancel = true;
+		m_thread->wait();
+		delete m_thread;
+		m_thread = nullptr;
+		m_cancel = false;
+	}
+	m_refined = false;
+	m_next.Clear();
+}
+
+C3DGradientMap& CMarchingCubes::GradientMap(int n, C3DImage& im3d, const BOX& b)
+{
+	C3DGradientMap* grad = m_grad[n];
+	if ((grad == nullptr) || (&grad->GetImage() != &im3d))
+	{
+		delete grad;
+		grad = m_grad[n] = new C3DGradientMap(im3d, b);
+	}
+	else grad->SetBox(b);
+	return *grad;
+}
+
+void CMarchingCubes::BuildSurface(C3DImage& im3d, const BOX& b, C3DGradientMap& grad, TriMesh& mesh)
+{
 	int NX = im3d.Width();
 	int NY = im3d.Height();
 	int NZ = im3d.Depth();
@@ -189,152 +325,215 @@ void CMarchingCubes::CreateSurface()
 
 	byte ref = (byte)(m_val * 255.f);
 	float fref = (float)ref;
-	m_ref = ref;
 
-	C3DGradientMap grad(im3d, b);
+	// the normals are precomputed if they fit in memory
+	if (m_bsmooth) grad.Lock();
+
+	// the value ranges of the bricks are used to skip the blocks that cannot contain the surface
+	im3d.UpdateBrickRanges();
+
+	// The cells are processed in blocks that line up with the bricks. Each block 
+	// creates its own indexed mesh, in which the nodes on the cell edges are shared.
+	// The nodes on the block boundaries are welded when the blocks are merged.
+	const int BS = C3DImage::BRICK_SIZE;
+	const int nbx = (NX - 1 + BS - 1) / BS;
+	const int nby = (NY - 1 + BS - 1) / BS;
+	const int nbz = (NZ - 1 + BS - 1) / BS;
+	const int blocks = nbx*nby*nbz;
+	vector<TriMesh> part(blocks);
+	vector< vector< pair<long long, int> > > seam(blocks);
+
+	// corner offsets of the cell
+	const int CO[8][3] = { {0,0,0},{1,0,0},{1,1,0},{0,1,0},{0,0,1},{1,0,1},{1,1,1},{0,1,1} };
+
+	// start corner, end corner and direction of the cell edges
+	int EC[12][3];
+	for (int e = 0; e < 12; ++e)
+	{
+		int n1 = ET_HEX[e][0];
+		int n2 = ET_HEX[e][1];
+		int a = (CO[n1][0] != CO[n2][0] ? 0 : (CO[n1][1] != CO[n2][1] ? 1 : 2));
+		if (CO[n1][a] > CO[n2][a]) { int t = n1; n1 = n2; n2 = t; }
+		EC[e][0] = n1;
+		EC[e][1] = n2;
+		EC[e][2] = a;
+	}
 
 	#pragma omp parallel default(shared)
 	{
-		const int MAX_FACES = 1000000;
-		TriMesh temp;
-		temp.Resize(MAX_FACES);
-		int nfaces = 0;
+		vector<int> cache;
 		byte val[8];
-		vec3f r[8], g[8];
+		int nv[3];
 
-		#pragma omp for schedule(dynamic, 5)
-		for (int k = 0; k < NZ - 1; ++k)
+		#pragma omp for schedule(dynamic)
+		for (int n = 0; n < blocks; ++n)
 		{
-			for (int j = 0; j < NY - 1; ++j)
-			{
-				for (int i = 0; i < NX - 1; ++i)
-				{
-					// get the voxel's values
-					if (i == 0)
+			if (m_cancel) continue;
+
+			int bx = n % nbx;
+			int by = (n / nbx) % nby;
+			int bz = n / (nbx*nby);
+
+			// range of cells in this block
+			int i0 = bx*BS, i1 = (i0 + BS < NX - 1 ? i0 + BS : NX - 1);
+			int j0 = by*BS, j1 = (j0 + BS < NY - 1 ? j0 + BS : NY - 1);
+			int k0 = bz*BS, k1 = (k0 + BS < NZ - 1 ? k0 + BS : NZ - 1);
+
+			// The cells use the voxels [i0,i1]x[j0,j1]x[k0,k1], so the range
+			// includes the first layer of the next bricks.
+			byte vmin = 255, vmax = 0;
+			for (int z = k0 / BS; z <= k1 / BS; ++z)
+				for (int y = j0 / BS; y <= j1 / BS; ++y)
+					for (int x = i0 / BS; x <= i1 / BS; ++x)
 					{
-						val[0] = im3d.value(i, j, k);
-						val[3] = im3d.value(i, j + 1, k);
-						val[4] = im3d.value(i, j, k + 1);
-						val[7] = im3d.value(i, j + 1, k + 1);
+						byte bmin, bmax;
+						im3d.GetBrickRange(x, y, z, bmin, bmax);
+						if (bmin < vmin) vmin = bmin;
+						if (bmax > vmax) vmax = bmax;
 					}
+			bool empty = (m_binvertSpace ? ((vmin >= ref) || (vmax < ref)) : ((vmax <= ref) || (vmin > ref)));
+			if (empty) continue;
 
-					val[1] = im3d.value(i + 1, j, k);
-					val[2] = im3d.value(i + 1, j + 1, k);
-					val[5] = im3d.value(i + 1, j, k + 1);
-					val[6] = im3d.value(i + 1, j + 1, k + 1);
+			// nodes on the cell edges of this block
+			const int mx = i1 - i0 + 1;
+			const int my = j1 - j0 + 1;
+			const int mz = k1 - k0 + 1;
+			cache.assign((size_t)mx*my*mz * 3, -1);
 
-					// calculate the case of the voxel
-					int ncase = 0;
-					if (m_binvertSpace)
-					{
-						if (val[0] < ref) ncase |= 0x01;
-						if (val[1] < ref) ncase |= 0x02;
-						if (val[2] < ref) ncase |= 0x04;
-						if (val[3] < ref) ncase |= 0x08;
-						if (val[4] < ref) ncase |= 0x10;
-						if (val[5] < ref) ncase |= 0x20;
-						if (val[6] < ref) ncase |= 0x40;
-						if (val[7] < ref) ncase |= 0x80;
-					}
-					else
-					{
-						if (val[0] > ref) ncase |= 0x01;
-						if (val[1] > ref) ncase |= 0x02;
-						if (val[2] > ref) ncase |= 0x04;
-						if (val[3] > ref) ncase |= 0x08;
-						if (val[4] > ref) ncase |= 0x10;
-						if (val[5] > ref) ncase |= 0x20;
-						if (val[6] > ref) ncase |= 0x40;
-						if (val[7] > ref) ncase |= 0x80;
-					}
+			TriMesh& blockMesh = part[n];
+			vector< pair<long long, int> >& blockSeam = seam[n];
 
-					// cases 0 and 255 don't generate triangles, so don't waste time on these
-					if ((ncase != 0) && (ncase != 255))
+			for (int k = k0; k < k1; ++k)
+			{
+				for (int j = j0; j < j1; ++j)
+				{
+					for (int i = i0; i < i1; ++i)
 					{
-						// get the corners
-						r[0].x = b.x0 + i      *dxi; r[0].y = b.y0 + j      *dyi; r[0].z = b.z0 + k      *dzi;
-						r[1].x = b.x0 + (i + 1)*dxi; r[1].y = b.y0 + j      *dyi; r[1].z = b.z0 + k      *dzi;
-						r[2].x = b.x0 + (i + 1)*dxi; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = b.z0 + k      *dzi;
-						r[3].x = b.x0 + i      *dxi; r[3].y = b.y0 + (j + 1)*dyi; r[3].z = b.z0 + k      *dzi;
-						r[4].x = b.x0 + i      *dxi; r[4].y = b.y0 + j      *dyi; r[4].z = b.z0 + (k + 1)*dzi;
-						r[5].x = b.x0 + (i + 1)*dxi; r[5].y = b.y0 + j      *dyi; r[5].z = b.z0 + (k + 1)*dzi;
-						r[6].x = b.x0 + (i + 1)*dxi; r[6].y = b.y0 + (j + 1)*dyi; r[6].z = b.z0 + (k + 1)*dzi;
-						r[7].x = b.x0 + i      *dxi; r[7].y = b.y0 + (j + 1)*dyi; r[7].z = b.z0 + (k + 1)*dzi;
-
-						// calculate gradients
-						if (m_bsmooth)
+						// get the voxel's values
+						if (i == i0)
 						{
-							g[0] = grad.Value(i, j, k);
-							g[1] = grad.Value(i + 1, j, k);
-							g[2] = grad.Value(i + 1, j + 1, k);
-							g[3] = grad.Value(i, j + 1, k);
-							g[4] = grad.Value(i, j, k + 1);
-							g[5] = grad.Value(i + 1, j, k + 1);
-							g[6] = grad.Value(i + 1, j + 1, k + 1);
-							g[7] = grad.Value(i, j + 1, k + 1);
+							val[0] = im3d.value(i, j, k);
+							val[3] = im3d.value(i, j + 1, k);
+							val[4] = im3d.value(i, j, k + 1);
+							val[7] = im3d.value(i, j + 1, k + 1);
 						}
 
-						// loop over faces
-						int* pf = LUT[ncase];
-						for (int l = 0; l < 5; l++)
+						val[1] = im3d.value(i + 1, j, k);
+						val[2] = im3d.value(i + 1, j + 1, k);
+						val[5] = im3d.value(i + 1, j, k + 1);
+						val[6] = im3d.value(i + 1, j + 1, k + 1);
+
+						// calculate the case of the voxel
+						int ncase = 0;
+						if (m_binvertSpace)
 						{
-							if (*pf == -1) break;
+							for (int l = 0; l < 8; ++l) if (val[l] < ref) ncase |= (1 << l);
+						}
+						else
+						{
+							for (int l = 0; l < 8; ++l) if (val[l] > ref) ncase |= (1 << l);
+						}
 
-							// calculate nodal positions
-							TriMesh::TRI& tri = temp.Face(nfaces++);
-							for (int m = 0; m < 3; m++)
+						// cases 0 and 255 don't generate triangles, so don't waste time on these
+						if ((ncase != 0) && (ncase != 255))
+						{
+							// loop over faces
+							int* pf = LUT[ncase];
+							for (int l = 0; l < 5; l++)
 							{
-								int n1 = ET_HEX[pf[m]][0];
-								int n2 = ET_HEX[pf[m]][1];
-
-								float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
-								assert((w >= 0.f) && (w <= 1.f));
-
-								tri.m_node[m] = r[n1] * (1.f - w) + r[n2] * w;
+								if (*pf == -1) break;
 
-								if (m_bsmooth)
+								for (int m = 0; m < 3; m++)
 								{
-									vec3f normal = g[n1] * (1.f - w) + g[n2] * w;
-									normal.Normalize();
-									tri.m_norm[m] = (m_binvertSpace ? -normal : normal);
+									const int* ec = EC[pf[m]];
+									int na = ec[0];
+									int nb = ec[1];
+									int a = ec[2];
+
+									// find the node on this edge, or create it
+									int ia = i + CO[na][0];
+									int ja = j + CO[na][1];
+									int ka = k + CO[na][2];
+									int li = ia - i0, lj = ja - j0, lk = ka - k0;
+									int& node = cache[(((size_t)lk*my + lj)*mx + li) * 3 + a];
+									if (node < 0)
+									{
+										float w = (fref - (float)val[na]) / ((float)val[nb] - (float)val[na]);
+										assert((w >= 0.f) && (w <= 1.f));
+
+										vec3f r(b.x0 + ia*dxi, b.y0 + ja*dyi, b.z0 + ka*dzi);
+										if (a == 0) r.x += w*dxi;
+										else if (a == 1) r.y += w*dyi;
+										else r.z += w*dzi;
+
+										vec3f normal(0.f, 0.f, 0.f);
+										if (m_bsmooth)
+										{
+											vec3f g0 = grad.Normal(ia, ja, ka);
+											vec3f g1 = grad.Normal(i + CO[nb][0], j + CO[nb][1], k + CO[nb][2]);
+											normal = g0 * (1.f - w) + g1 * w;
+											normal.Normalize();
+											if (m_binvertSpace) normal = -normal;
+										}
+
+										node = blockMesh.AddNode(r, normal);
+
+										// nodes on the block boundary can be shared with other blocks
+										if ((li == 0) || (li == mx - 1) || (lj == 0) || (lj == my - 1) || (lk == 0) || (lk == mz - 1))
+										{
+											long long key = (((long long)ka*NY + ja)*NX + ia) * 3 + a;
+											blockSeam.push_back(pair<long long, int>(key, node));
+										}
+									}
+									nv[m] = node;
 								}
-							}
 
-							if (m_bsmooth == false)
-							{
-								vec3f normal = (tri.m_node[1] - tri.m_node[0]) ^ (tri.m_node[2] - tri.m_node[0]);
-								normal.Normalize();
-								tri.m_norm[0] = normal;
-								tri.m_norm[1] = normal;
-								tri.m_norm[2] = normal;
-							}
+								blockMesh.AddFace(nv[0], nv[1], nv[2]);
 
-							pf += 3;
-
-							if (nfaces == MAX_FACES)
-							{
-								#pragma omp critical
-								m_mesh.Merge(temp, nfaces);
-								nfaces = 0;
+								pf += 3;
 							}
 						}
-					}
 
-					// keep this for next i
-					val[0] = val[1];
-					val[4] = val[5];
-					val[3] = val[2];
-					val[7] = val[6];
+						// keep this for next i
+						val[0] = val[1];
+						val[4] = val[5];
+						val[3] = val[2];
+						val[7] = val[6];
+					}
 				}
 			}
 		}
+	}
 
-		#pragma omp critical
-		m_mesh.Merge(temp, nfaces);
+	// merge the blocks
+	size_t nodes = 0, faces = 0, seams = 0;
+	for (int n = 0; n < blocks; ++n)
+	{
+		nodes += part[n].Nodes();
+		faces += part[n].Faces();
+		seams += seam[n].size();
 	}
+	mesh.Reserve(nodes, faces);
+
+	vector< pair<long long, int> > keys;
+	keys.reserve(seams);
+	for (int n = 0; n < blocks; ++n)
+	{
+		int N0 = mesh.Nodes();
+		for (size_t i = 0; i < seam[n].size(); ++i) keys.push_back(pair<long long, int>(seam[n][i].first, seam[n][i].second + N0));
+		mesh.Merge(part[n]);
+
+		// release the block's memory
+		TriMesh tmp;
+		part[n].Swap(tmp);
+		vector< pair<long long, int> >().swap(seam[n]);
+	}
+	mesh.Weld(keys);
+
+	if (m_bsmooth) grad.Unlock();
 
 	// create surface meshes
-	if (m_bcloseSurface)
+	if (m_bcloseSurface && (m_cancel == false))
 	{
 		byte val[4];
 		vec3f r[4];
@@ -363,7 +562,7 @@ void CMarchingCubes::CreateSurface()
 					r[3].x = x; r[3].y = b.y0 + j      *dyi; r[3].z = b.z0 + (k + 1)*dzi;
 
 					// add the triangles
-					AddSurfaceTris(val, r, faceNormal);
+					AddSurfaceTris(mesh, val, r, faceNormal, ref);
 				}
 			}
 		}
@@ -392,7 +591,7 @@ void CMarchingCubes::CreateSurface()
 					r[3].x = b.x0 + i    *dxi; r[3].y = y; r[3].z = b.z0 + (k + 1)*dzi;
 
 					// add the triangles
-					AddSurfaceTris(val, r, faceNormal);
+					AddSurfaceTris(mesh, val, r, faceNormal, ref);
 				}
 			}
 		}
@@ -421,33 +620,33 @@ void CMarchingCubes::CreateSurface()
 					r[3].x = b.x0 + i      *dxi; r[3].y = b.y0 + (j + 1)*dyi; r[3].z = z;
 
 					// add the triangles
-					AddSurfaceTris(val, r, faceNormal);
+					AddSurfaceTris(mesh, val, r, faceNormal, ref);
 				}
 			}
 		}
 	}
 }
 
-void CMarchingCubes::AddSurfaceTris(byte val[4], vec3f r[4], const vec3f& faceNormal)
+void CMarchingCubes::AddSurfaceTris(TriMesh& mesh, byte val[4], vec3f r[4], const vec3f& faceNormal, byte ref)
 {
 	// calculate the case of the voxel
 	int ncase = 0;
 	if (m_binvertSpace)
 	{
-		if (val[0] < m_ref) ncase |= 0x01;
-		if (val[1] < m_ref) ncase |= 0x02;
-		if (val[2] < m_ref) ncase |= 0x04;
-		if (val[3] < m_ref) ncase |= 0x08;
+		if (val[0] < ref) ncase |= 0x01;
+		if (val[1] < ref) ncase |= 0x02;
+		if (val[2] < ref) ncase |= 0x04;
+		if (val[3] < ref) ncase |= 0x08;
 	}
 	else
 	{
-		if (val[0] > m_ref) ncase |= 0x01;
-		if (val[1] > m_ref) ncase |= 0x02;
-		if (val[2] > m_ref) ncase |= 0x04;
-		if (val[3] > m_ref) ncase |= 0x08;
+		if (val[0] > ref) ncase |= 0x01;
+		if (val[1] > ref) ncase |= 0x02;
+		if (val[2] > ref) ncase |= 0x04;
+		if (val[3] > ref) ncase |= 0x08;
 	}
 
-	float fref = (float)m_ref;
+	float fref = (float)ref;
 
 	// loop over faces
 	int* pf = LUT2D_tri[ncase];
@@ -456,13 +655,13 @@ void CMarchingCubes::AddSurfaceTris(byte val[4], vec3f r[4], const vec3f& faceNo
 		if (*pf == -1) break;
 
 		// calculate nodal positions
-		TriMesh::TRI tri;
+		vec3f rt[3];
 		for (int m = 0; m < 3; m++)
 		{
 			int node = pf[m];
 			if (node < 4)
 			{
-				tri.m_node[m] = r[node];
+				rt[m] = r[node];
 			}
 			else
 			{
@@ -470,18 +669,28 @@ void CMarchingCubes::AddSurfaceTris(byte val[4], vec3f r[4], const vec3f& faceNo
 				int n2 = ET2D[node - 4][1];
 
 				float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
-				tri.m_node[m] = r[n1] * (1.f - w) + r[n2] * w;
+				rt[m] = r[n1] * (1.f - w) + r[n2] * w;
 			}
-
-			tri.m_norm[m] = faceNormal;
 		}
 
-		m_mesh.AddFace(tri);
+		AddSurfaceTri(mesh, rt, faceNormal);
 
 		pf += 3;
 	}
 }
 
+// The nodes of the boundary triangles are not shared since they have their own 
+// normal. The triangle is oriented so that its winding agrees with the normal.
+void CMarchingCubes::AddSurfaceTri(TriMesh& mesh, vec3f r[3], const vec3f& faceNormal)
+{
+	vec3f fn = (r[1] - r[0]) ^ (r[2] - r[0]);
+	int n0 = mesh.AddNode(r[0], faceNormal);
+	int n1 = mesh.AddNode(r[1], faceNormal);
+	int n2 = mesh.AddNode(r[2], faceNormal);
+	if (fn*faceNormal < 0.f) mesh.AddFace(n0, n2, n1);
+	else mesh.AddFace(n0, n1, n2);
+}
+
 void CMarchingCubes::SetIsoValue(float v)
 {
 	m_val = v;
@@ -489,17 +698,47 @@ void CMarchingCubes::SetIsoValue(float v)
 
 void CMarchingCubes::Render(CGLContext& rc)
 {
+	// replace the preview with the full resolution surface
+	if (m_refined)
+	{
+		m_thread->wait();
+		delete m_thread;
+		m_thread = nullptr;
+		m_mesh.Swap(m_next);
+		m_next.Clear();
+		m_refined = false;
+	}
+
 	glColor3ub(m_col.r, m_col.g, m_col.b);
-	glBegin(GL_TRIANGLES);
-	for (int i = 0; i < m_mesh.Faces(); ++i)
+	if ((m_mesh.Faces() == 0) || (m_mesh.Nodes() == 0)) return;
+
+	if (m_bsmooth)
 	{
-		TriMesh::TRI& face = m_mesh.Face(i);
-		glNormal3f(face.m_norm[0].x, face.m_norm[0].y, face.m_norm[0].z);
-		glVertex3f(face.m_node[0].x, face.m_node[0].y, face.m_node[0].z);
-		glNormal3f(face.m_norm[1].x, face.m_norm[1].y, face.m_norm[1].z);
-		glVertex3f(face.m_node[1].x, face.m_node[1].y, face.m_node[1].z);
-		glNormal3f(face.m_norm[2].x, face.m_norm[2].y, face.m_norm[2].z);
-		glVertex3f(face.m_node[2].x, face.m_node[2].y, face.m_node[2].z);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glVertexPointer(3, GL_FLOAT, sizeof(vec3f), &m_mesh.Node(0));
+		glNormalPointer(GL_FLOAT, sizeof(vec3f), &m_mesh.Normal(0));
+		glDrawElements(GL_TRIANGLES, 3 * m_mesh.Faces(), GL_UNSIGNED_INT, &m_mesh.Face(0));
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+	else
+	{
+		// flat shading uses the face normals
+		glBegin(GL_TRIANGLES);
+		for (int i = 0; i < m_mesh.Faces(); ++i)
+		{
+			TriMesh::TRI& face = m_mesh.Face(i);
+			vec3f& r0 = m_mesh.Node(face.n[0]);
+			vec3f& r1 = m_mesh.Node(face.n[1]);
+			vec3f& r2 = m_mesh.Node(face.n[2]);
+			vec3f fn = (r1 - r0) ^ (r2 - r0);
+			fn.Normalize();
+			glNormal3f(fn.x, fn.y, fn.z);
+			glVertex3f(r0.x, r0.y, r0.z);
+			glVertex3f(r1.x, r1.y, r1.z);
+			glVertex3f(r2.x, r2.y, r2.z);
+		}
+		glEnd();
 	}
-	glEnd();
 }
@@ -27,20 +27,27 @@ SOFTWARE.*/
 #pragma once
 #include "GLImageRenderer.h"
 #include <vector>
+#include <atomic>
 #include <MathLib/math3d.h>
 #include <FSCore/color.h>
+#include <FSCore/box.h>
+
+class C3DImage;
+class C3DGradientMap;
+class QThread;
 
 namespace Post {
 
 class CImageModel;
 
+//-----------------------------------------------------------------------------
+// Indexed triangle mesh. Each node stores a position and a normal.
 class TriMesh
 {
 public:
 	struct TRI
 	{
-		vec3f	m_node[3];
-		vec3f	m_norm[3];
+		int	n[3];
 	};
 
 public:
@@ -48,18 +55,29 @@ public:
 
 	void Clear();
 
-	void Merge(TriMesh& tri, int ncount = -1);
+	// append a mesh
+	void Merge(TriMesh& tri);
 
-	void Reserve(size_t nsize);
+	void Reserve(size_t nodes, size_t faces);
 
-	void Resize(size_t nsize);
+	int Nodes() const { return (int)m_Node.size(); }
+	vec3f& Node(int i) { return m_Node[i]; }
+	vec3f& Normal(int i) { return m_Norm[i]; }
 
-	TRI& Face(int i) { return m_Face[i]; }
 	int Faces() const { return (int)m_Face.size(); }
+	TRI& Face(int i) { return m_Face[i]; }
+
+	int AddNode(const vec3f& r, const vec3f& n) { m_Node.push_back(r); m_Norm.push_back(n); return (int)m_Node.size() - 1; }
+	void AddFace(int n0, int n1, int n2) { TRI t = { { n0, n1, n2 } }; m_Face.push_back(t); }
+
+	// merge the nodes that have the same key. keys holds (key, node) pairs.
+	void Weld(std::vector<std::pair<long long, int> >& keys);
 
-	void AddFace(TRI& tri) { m_Face.push_back(tri); }
+	void Swap(TriMesh& tri);
 
 protected:
+	std::vector<vec3f>	m_Node;
+	std::vector<vec3f>	m_Norm;
 	std::vector<TRI>	m_Face;
 };
 
@@ -94,11 +112,22 @@ public:
 
 	bool UpdateData(bool bsave = true) override;
 
+	// calculates the full resolution surface (runs on the worker thread)
+	void Refine();
+
 private:
-	void AddSurfaceTris(byte val[4], vec3f r[4], const vec3f& faceNormal);
+	void AddSurfaceTris(TriMesh& mesh, byte val[4], vec3f r[4], const vec3f& faceNormal, byte ref);
+
+	void AddSurfaceTri(TriMesh& mesh, vec3f r[3], const vec3f& faceNormal);
 
 	void CreateSurface();
 
+	void BuildSurface(C3DImage& im3d, const BOX& b, C3DGradientMap& grad, TriMesh& mesh);
+
+	C3DGradientMap& GradientMap(int n, C3DImage& im3d, const BOX& b);
+
+	void StopRefine();
+
 private:
 	float	m_val, m_oldVal;		// iso-surface value
 	bool	m_bsmooth;
@@ -107,6 +136,17 @@ private:
 	GLColor	m_col;
 	TriMesh	m_mesh;
 
-	byte m_ref;
+	// gradients of the preview and full resolution images. These are kept
+	// so that they are not recalculated when the iso-value changes.
+	C3DGradientMap*	m_grad[2];
+
+	// background refinement of the surface
+	QThread*			m_thread;
+	C3DImage*			m_refineImage;	// full resolution image
+	BOX					m_refineBox;
+	C3DGradientMap*		m_refineGrad;
+	TriMesh				m_next;			// full resolution surface
+	std::atomic<bool>	m_cancel;
+	std::atomic<bool>	m_refined;		// m_next is ready
 };
 }
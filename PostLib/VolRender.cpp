@@ -27,22 +27,61 @@ SOFTWARE.*/
 #include "stdafx.h"
 #ifdef WIN32
 #include <Windows.h>
-#include <gl/GL.h>
+#include <glew.h>
 #endif
 #ifdef __APPLE__
 #include <OpenGL/gl.h>
 #endif
 #ifdef LINUX
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
 #endif
 #include "VolRender.h"
 #include <GLLib/GLContext.h>
 #include "ImageModel.h"
+#include "ImagePyramid.h"
 #include "ColorMap.h"
 #include <ImageLib/3DGradientMap.h>
 #include <sstream>
+#include <stdlib.h>
 using namespace Post;
 
+//-----------------------------------------------------------------------------
+// The shaders for 3D texture rendering. The fragment shader looks up the color
+// in the transfer function and applies the same shading as DepthCueX/Y/Z.
+static const char* szvertexShader =
+"varying vec3 tc;\n"
+"void main()\n"
+"{\n"
+"	tc = gl_MultiTexCoord0.xyz;\n"
+"	gl_Position = ftransform();\n"
+"	gl_ClipVertex = gl_ModelViewMatrix*gl_Vertex;\n"
+"}\n";
+
+static const char* szfragmentShader =
+"uniform sampler3D vol;\n"
+"uniform sampler1D tf;\n"
+"uniform sampler3D att;\n"
+"uniform float alpha;\n"
+"uniform int lighting;\n"
+"uniform float shade;\n"
+"uniform vec3 amb;\n"
+"uniform vec3 spc;\n"
+"varying vec3 tc;\n"
+"void main()\n"
+"{\n"
+"	float v = texture3D(vol, tc).r;\n"
+"	vec4 c = texture1D(tf, (255.0*v + 0.5)/256.0);\n"
+"	if (lighting != 0)\n"
+"	{\n"
+"		float a = texture3D(att, tc).r;\n"
+"		float w = shade*a + (1.0 - shade);\n"
+"		float s = shade*a*a;\n"
+"		c.rgb = (c.rgb*(1.0 - s) + s*spc)*w + amb*(1.0 - w);\n"
+"	}\n"
+"	gl_FragColor = vec4(c.rgb, c.a*alpha);\n"
+"}\n";
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -68,9 +107,9 @@ CVolRender::CVolRender(CImageModel* img) : CGLImageRenderer(img)
 	AddColorParam(GLColor::White(), "Specular color");
 	AddVecParam(vec3d(1, 1, 1), "Light direction");
 
-	m_pImx = m_pImy = m_pImz = 0;
-	m_sliceX = m_sliceY = m_sliceZ = 0;
 	m_nx = m_ny = m_nz = 0;
+	m_srcImage = nullptr;
+	m_grad = nullptr;
 
 	m_blight = false;
 	m_bcalc_lighting = true;
@@ -80,6 +119,13 @@ CVolRender::CVolRender(CImageModel* img) : CGLImageRenderer(img)
 
 	m_texID = 0;
 
+	m_mode = 0;
+	m_volTex = m_tfTex = m_attTex = 0;
+	m_prog = 0;
+	m_reloadVolume = true;
+	m_reloadTF = true;
+	m_reloadAtt = true;
+
 	m_alpha = 0.2;
 	m_I0 = 0;
 	m_I1 = 255;
@@ -100,6 +146,16 @@ CVolRender::CVolRender(CImageModel* img) : CGLImageRenderer(img)
 CVolRender::~CVolRender()
 {
 	Clear();
+	delete m_grad;
+
+	if (m_mode == 1)
+	{
+		glDeleteTextures(1, &m_volTex);
+		glDeleteTextures(1, &m_tfTex);
+		glDeleteTextures(1, &m_attTex);
+		glDeleteProgram(m_prog);
+	}
+	if (m_texID) glDeleteTextures(1, &m_texID);
 }
 
 bool CVolRender::UpdateData(bool bsave)
@@ -175,13 +231,7 @@ void CVolRender::Reset()
 
 void CVolRender::Clear()
 {
-	delete [] m_sliceX; m_sliceX = 0;
-	delete [] m_sliceY; m_sliceY = 0;
-	delete [] m_sliceZ; m_sliceZ = 0;
-
-	delete [] m_pImx; m_pImx = 0; m_nx = 0;
-	delete [] m_pImy; m_pImy = 0; m_ny = 0;
-	delete [] m_pImz; m_pImz = 0; m_nz = 0;
+	m_nx = m_ny = m_nz = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -208,45 +258,16 @@ void CVolRender::Create()
 	m_nz = closest_pow2(d);
 	m_im3d.Create(m_nx, m_ny, m_nz);
 
-	// resample image
-	im3d.StretchBlt(m_im3d);
+	// resample the best level of the image pyramid that is available now
+	CImagePyramid* pyr = src->GetPyramid();
+	m_srcImage = (pyr ? pyr->GetImage(max(m_nx, max(m_ny, m_nz))) : &im3d);
+	m_srcImage->StretchBlt(m_im3d);
 
-	// allocate slices
-	m_sliceX = new CImage[m_nx];
-	m_pImx = new CRGBAImage[m_nx];
-	for (int i = 0; i < m_nx; ++i)
-	{
-		m_sliceX[i].Create(m_ny, m_nz);
-		m_pImx[i].Create(m_ny, m_nz);
-	}
-
-	m_sliceY = new CImage[m_ny]; 
-	m_pImy = new CRGBAImage[m_ny];
-	for (int i = 0; i < m_ny; ++i)
-	{
-		m_sliceY[i].Create(m_nx, m_nz);
-		m_pImy[i].Create(m_nx, m_nz);
-	}
-	
-	m_sliceZ = new CImage[m_nz]; 
-	m_pImz = new CRGBAImage[m_nz];
-	for (int i = 0; i < m_nz; ++i)
-	{
-		m_sliceZ[i].Create(m_nx, m_ny);
-		m_pImz[i].Create(m_nx, m_ny);
-	}
-
-#pragma omp parallel default(shared)
-	{
-#pragma omp for
-		for (int i = 0; i < m_nx; ++i) m_im3d.GetSliceX(m_sliceX[i], i);
-
-#pragma omp for
-		for (int i = 0; i < m_ny; ++i) m_im3d.GetSliceY(m_sliceY[i], i);
-
-#pragma omp for
-		for (int i = 0; i < m_nz; ++i) m_im3d.GetSliceZ(m_sliceZ[i], i);
-	}
+	// This is the only copy of the voxels. The slices are either rendered from
+	// a 3D texture, or they are generated while rendering.
+	m_reloadVolume = true;
+	m_bcalc_lighting = true;
+	if (m_grad) m_grad->Release();
 
 	// calculate alpha scale factors
 /*	BOX b = img.GetBoundingBox();
@@ -275,7 +296,11 @@ void CVolRender::CalcAttenuation()
 
 	const BOX& b = GetImageModel()->GetBoundingBox();
 
-	C3DGradientMap map(m_im3d, b);
+	// The gradients are kept, so they are not calculated again when only the light changes.
+	if (m_grad == nullptr) m_grad = new C3DGradientMap(m_im3d, b);
+	else m_grad->SetBox(b);
+	C3DGradientMap& map = *m_grad;
+	map.Lock();
 
 #pragma omp parallel for default(shared)
 	for (int k = 0; k < m_nz; ++k)
@@ -283,12 +308,14 @@ void CVolRender::CalcAttenuation()
 		for (int j = 0; j < m_ny; ++j)
 			for (int i = 0; i < m_nx; ++i)
 			{
-				vec3d f = map.Value(i, j, k); f.Normalize();
+				vec3d f = map.Normal(i, j, k);
 				double a = f*l;
 				if (a < 0.0) a = 0.0;
-				m_att.value(i, j, k) = (byte)(255.0*a);
+				m_att.setValue(i, j, k, (byte)(255.0*a));
 			}
 	}
+
+	map.Unlock();
 }
 
 //-----------------------------------------------------------------------------
@@ -302,10 +329,11 @@ void CVolRender::Update()
 void CVolRender::UpdateVolRender()
 {
 	// calculate attenuation factors
-	if (m_bcalc_lighting)
+	if (m_blight && m_bcalc_lighting && (m_nx > 0))
 	{
 		CalcAttenuation();
 		m_bcalc_lighting = false;
+		m_reloadAtt = true;
 	}
 
 	CColorMap& map = m_Col.ColorMap();
@@ -326,39 +354,8 @@ void CVolRender::UpdateVolRender()
 		m_LUTC[3][i] = (i == 0 ? m_Amin : (i == 255 ? m_Amax : (m_A0 + i*(m_A1 - m_A0) / 255)));
 	}
 
-	UpdateRGBImages();
-}
-
-void CVolRender::UpdateRGBImages()
-{
-	#pragma omp parallel default(shared)
-	{
-		#pragma omp for 
-		for (int i = 0; i < m_nx; i++)
-		{
-			CImage& im = m_sliceX[i];
-			Colorize(m_pImx[i], im);
-			if (m_blight) DepthCueX(m_pImx[i], i);
-		}
-
-		// create the y-images
-		#pragma omp for 
-		for (int i = 0; i < m_ny; i++)
-		{
-			CImage& im = m_sliceY[i];
-			Colorize(m_pImy[i], im);
-			if (m_blight) DepthCueY(m_pImy[i], i);
-		}
-
-		// create the z-images
-		#pragma omp for 
-		for (int i = 0; i < m_nz; i++)
-		{
-			CImage& im = m_sliceZ[i];
-			Colorize(m_pImz[i], im);
-			if (m_blight) DepthCueZ(m_pImz[i], i);
-		}
-	}
+	// for 3D textures, only the transfer function needs to be uploaded again
+	m_reloadTF = true;
 }
 
 //-----------------------------------------------------------------------------
@@ -447,6 +444,31 @@ void CVolRender::DepthCueZ(CRGBAImage& im, int n)
 //! Render textures
 void CVolRender::Render(CGLContext& rc)
 {
+	// switch to a finer level of the image pyramid when it becomes available
+	CImageSource* src = GetImageModel()->GetImageSource();
+	if (src && src->GetPyramid() && m_srcImage)
+	{
+		if (src->GetPyramid()->GetImage(max(m_nx, max(m_ny, m_nz))) != m_srcImage) Create();
+	}
+	if (m_nx == 0) return;
+
+	// direction towards the viewer
+	vec3d r(0,0,1);
+	quatd q = rc.m_q;
+	q.Inverse().RotateVector(r);
+
+	// use a 3D texture if possible
+	if (m_mode == 0) m_mode = (Init3DTexture() ? 1 : 2);
+	if (m_mode == 1)
+	{
+		Upload3DTexture();
+		if (m_mode == 1)
+		{
+			Render3DTexture(r);
+			return;
+		}
+	}
+
 	if (m_texID == 0)
 	{
 		glGenTextures(1, &m_texID);
@@ -469,11 +491,6 @@ void CVolRender::Render(CGLContext& rc)
 
 //	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
-	
-	vec3d r(0,0,1);
-	quatd q = rc.m_q;
-	q.Inverse().RotateVector(r);
-
 	double x = fabs(r.x);
 	double y = fabs(r.y);
 	double z = fabs(r.z);
@@ -505,9 +522,17 @@ void CVolRender::RenderX(int inc)
 
 	const BOX& box = GetImageModel()->GetBoundingBox();
 
+	if ((m_slice.Width() != m_ny) || (m_slice.Height() != m_nz)) m_slice.Create(m_ny, m_nz);
+	if ((m_rgba.Width() != m_ny) || (m_rgba.Height() != m_nz)) m_rgba.Create(m_ny, m_nz);
+
 	for (int i=n0; i != n1; i += inc)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_ny, m_nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pImx[i].GetBytes());
+		// generate the slice
+		m_im3d.GetSliceX(m_slice, i);
+		Colorize(m_rgba, m_slice);
+		if (m_blight) DepthCueX(m_rgba, i);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_ny, m_nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_rgba.GetBytes());
 
 		x = box.x0 + i*(box.x1 - box.x0)*fx;
 
@@ -542,9 +567,17 @@ void CVolRender::RenderY(int inc)
 
 	const BOX& box = GetImageModel()->GetBoundingBox();
 
+	if ((m_slice.Width() != m_nx) || (m_slice.Height() != m_nz)) m_slice.Create(m_nx, m_nz);
+	if ((m_rgba.Width() != m_nx) || (m_rgba.Height() != m_nz)) m_rgba.Create(m_nx, m_nz);
+
 	for (int i=n0; i != n1; i += inc)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_nx, m_nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pImy[i].GetBytes());
+		// generate the slice
+		m_im3d.GetSliceY(m_slice, i);
+		Colorize(m_rgba, m_slice);
+		if (m_blight) DepthCueY(m_rgba, i);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_nx, m_nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_rgba.GetBytes());
 
 		y = box.y0 + i*(box.y1 - box.y0)*fy;
 
@@ -579,9 +612,17 @@ void CVolRender::RenderZ(int inc)
 
 	const BOX& box = GetImageModel()->GetBoundingBox();
 
+	if ((m_slice.Width() != m_nx) || (m_slice.Height() != m_ny)) m_slice.Create(m_nx, m_ny);
+	if ((m_rgba.Width() != m_nx) || (m_rgba.Height() != m_ny)) m_rgba.Create(m_nx, m_ny);
+
 	for (int i=n0; i != n1; i += inc)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_nx, m_ny, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pImz[i].GetBytes());
+		// generate the slice
+		m_im3d.GetSliceZ(m_slice, i);
+		Colorize(m_rgba, m_slice);
+		if (m_blight) DepthCueZ(m_rgba, i);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_nx, m_ny, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_rgba.GetBytes());
 
 		z = box.z0 + i*(box.z1 - box.z0)*fz;
 
@@ -595,3 +636,265 @@ void CVolRender::RenderZ(int inc)
 		glEnd();
 	}
 }
+
+//-----------------------------------------------------------------------------
+static GLuint compileShader(GLenum type, const char* szsrc)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &szsrc, 0);
+	glCompileShader(shader);
+
+	GLint status = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status == 0)
+	{
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+//-----------------------------------------------------------------------------
+// Creates the textures and the shader program for 3D texture rendering.
+// Returns false if this is not supported, in which case the slices are rendered
+// as 2D textures.
+bool CVolRender::Init3DTexture()
+{
+	// we need OpenGL 2.0 for the shaders
+	const char* szver = (const char*)glGetString(GL_VERSION);
+	if ((szver == nullptr) || (atof(szver) < 2.0)) return false;
+
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+	if ((m_nx > maxSize) || (m_ny > maxSize) || (m_nz > maxSize)) return false;
+
+	GLuint vs = compileShader(GL_VERTEX_SHADER, szvertexShader);
+	GLuint fs = compileShader(GL_FRAGMENT_SHADER, szfragmentShader);
+	if ((vs == 0) || (fs == 0))
+	{
+		if (vs) glDeleteShader(vs);
+		if (fs) glDeleteShader(fs);
+		return false;
+	}
+
+	m_prog = glCreateProgram();
+	glAttachShader(m_prog, vs);
+	glAttachShader(m_prog, fs);
+	glLinkProgram(m_prog);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	GLint status = 0;
+	glGetProgramiv(m_prog, GL_LINK_STATUS, &status);
+	if (status == 0)
+	{
+		glDeleteProgram(m_prog);
+		m_prog = 0;
+		return false;
+	}
+
+	GLuint tex[3];
+	glGenTextures(3, tex);
+	m_volTex = tex[0];
+	m_tfTex  = tex[1];
+	m_attTex = tex[2];
+
+	GLuint tex3d[2] = { m_volTex, m_attTex };
+	for (int i = 0; i < 2; ++i)
+	{
+		glBindTexture(GL_TEXTURE_3D, tex3d[i]);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	glBindTexture(GL_TEXTURE_1D, m_tfTex);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_1D, 0);
+
+	m_reloadVolume = m_reloadTF = m_reloadAtt = true;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Uploads the data that has changed. Switches to 2D slices if the volume does
+// not fit in texture memory.
+void CVolRender::Upload3DTexture()
+{
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (m_reloadVolume)
+	{
+		while (glGetError() != GL_NO_ERROR);
+
+		glBindTexture(GL_TEXTURE_3D, m_volTex);
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_LUMINANCE8, m_nx, m_ny, m_nz, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, m_im3d.GetBytes());
+		glBindTexture(GL_TEXTURE_3D, 0);
+		m_reloadVolume = false;
+
+		if (glGetError() != GL_NO_ERROR)
+		{
+			m_mode = 2;
+			return;
+		}
+	}
+
+	if (m_reloadAtt && m_blight && (m_att.Width() == m_nx))
+	{
+		glBindTexture(GL_TEXTURE_3D, m_attTex);
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_LUMINANCE8, m_nx, m_ny, m_nz, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, m_att.GetBytes());
+		glBindTexture(GL_TEXTURE_3D, 0);
+		m_reloadAtt = false;
+	}
+
+	if (m_reloadTF)
+	{
+		byte tf[256][4];
+		for (int i = 0; i < 256; ++i)
+		{
+			int val = m_LUT[i];
+			tf[i][0] = m_LUTC[0][val];
+			tf[i][1] = m_LUTC[1][val];
+			tf[i][2] = m_LUTC[2][val];
+			tf[i][3] = m_LUTC[3][val];
+		}
+
+		glBindTexture(GL_TEXTURE_1D, m_tfTex);
+		glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, tf);
+		glBindTexture(GL_TEXTURE_1D, 0);
+		m_reloadTF = false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Renders the 3D texture with slices that are perpendicular to the view direction.
+// The slices are drawn back to front with about one slice per voxel.
+void CVolRender::Render3DTexture(const vec3d& view)
+{
+	const BOX& box = GetImageModel()->GetBoundingBox();
+	vec3d r = view; r.Normalize();
+
+	// box corners and edges
+	vec3d c[8] = {
+		vec3d(box.x0, box.y0, box.z0), vec3d(box.x1, box.y0, box.z0), vec3d(box.x1, box.y1, box.z0), vec3d(box.x0, box.y1, box.z0),
+		vec3d(box.x0, box.y0, box.z1), vec3d(box.x1, box.y0, box.z1), vec3d(box.x1, box.y1, box.z1), vec3d(box.x0, box.y1, box.z1)
+	};
+	const int edge[12][2] = { {0,1},{1,2},{2,3},{3,0},{4,5},{5,6},{6,7},{7,4},{0,4},{1,5},{2,6},{3,7} };
+
+	double dmin = c[0]*r, dmax = dmin;
+	for (int i = 1; i < 8; ++i)
+	{
+		double d = c[i]*r;
+		if (d < dmin) dmin = d;
+		if (d > dmax) dmax = d;
+	}
+	if (dmax <= dmin) return;
+
+	// voxel size
+	double W = box.x1 - box.x0; if (W == 0.0) W = 1.0;
+	double H = box.y1 - box.y0; if (H == 0.0) H = 1.0;
+	double D = box.z1 - box.z0; if (D == 0.0) D = 1.0;
+	double dx = W / (m_nx > 1 ? m_nx - 1 : 1);
+	double dy = H / (m_ny > 1 ? m_ny - 1 : 1);
+	double dz = D / (m_nz > 1 ? m_nz - 1 : 1);
+
+	// number of slices
+	double h = fabs(r.x)*dx + fabs(r.y)*dy + fabs(r.z)*dz;
+	int nmax = 2*(m_nx + m_ny + m_nz);
+	int nslices = (h > 0.0 ? (int)((dmax - dmin) / h) + 1 : nmax);
+	if (nslices > nmax) nslices = nmax;
+
+	// alpha per slice, with the same scale factors that RenderX/Y/Z use,
+	// weighted by how much each axis contributes to the slice spacing
+	double alpha = m_alpha;
+	if (h > 0.0) alpha = m_alpha*(fabs(r.x)*dx*m_ax + fabs(r.y)*dy*m_ay + fabs(r.z)*dz*m_az) / h;
+
+	// basis in the slice plane for sorting the polygon vertices
+	vec3d u = (fabs(r.x) < 0.9 ? vec3d(1, 0, 0) : vec3d(0, 1, 0)) ^ r; u.Normalize();
+	vec3d v = r ^ u;
+
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, m_volTex);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_1D, m_tfTex);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_3D, m_attTex);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUseProgram(m_prog);
+	glUniform1i(glGetUniformLocation(m_prog, "vol"), 0);
+	glUniform1i(glGetUniformLocation(m_prog, "tf"), 1);
+	glUniform1i(glGetUniformLocation(m_prog, "att"), 2);
+	glUniform1f(glGetUniformLocation(m_prog, "alpha"), (float)alpha);
+	glUniform1i(glGetUniformLocation(m_prog, "lighting"), (m_blight ? 1 : 0));
+	glUniform1f(glGetUniformLocation(m_prog, "shade"), (float)m_shadeStrength);
+	glUniform3f(glGetUniformLocation(m_prog, "amb"), m_amb.r / 255.f, m_amb.g / 255.f, m_amb.b / 255.f);
+	glUniform3f(glGetUniformLocation(m_prog, "spc"), m_spc.r / 255.f, m_spc.g / 255.f, m_spc.b / 255.f);
+
+	// texture coordinates put the voxels at the texel centers
+	double sx = (m_nx - 1.0) / m_nx, tx = 0.5 / m_nx;
+	double sy = (m_ny - 1.0) / m_ny, ty = 0.5 / m_ny;
+	double sz = (m_nz - 1.0) / m_nz, tz = 0.5 / m_nz;
+
+	for (int n = 0; n < nslices; ++n)
+	{
+		double d = dmin + (n + 0.5)*(dmax - dmin) / nslices;
+
+		// intersect the plane with the box edges
+		vec3d p[12];
+		double a[12];
+		int np = 0;
+		for (int i = 0; i < 12; ++i)
+		{
+			const vec3d& ca = c[edge[i][0]];
+			const vec3d& cb = c[edge[i][1]];
+			double da = ca*r - d;
+			double db = cb*r - d;
+			if ((da < 0.0) != (db < 0.0))
+			{
+				p[np++] = ca + (cb - ca)*(da / (da - db));
+			}
+		}
+		if (np < 3) continue;
+
+		// sort the vertices by angle
+		vec3d pc(0, 0, 0);
+		for (int i = 0; i < np; ++i) pc += p[i];
+		pc /= (double)np;
+		for (int i = 0; i < np; ++i) a[i] = atan2((p[i] - pc)*v, (p[i] - pc)*u);
+		for (int i = 1; i < np; ++i)
+			for (int j = i; (j > 0) && (a[j] < a[j - 1]); --j)
+			{
+				double t = a[j]; a[j] = a[j - 1]; a[j - 1] = t;
+				vec3d q = p[j]; p[j] = p[j - 1]; p[j - 1] = q;
+			}
+
+		glBegin(GL_POLYGON);
+		for (int i = 0; i < np; ++i)
+		{
+			glTexCoord3d(tx + sx*(p[i].x - box.x0) / W, ty + sy*(p[i].y - box.y0) / H, tz + sz*(p[i].z - box.z0) / D);
+			glVertex3d(p[i].x, p[i].y, p[i].z);
+		}
+		glEnd();
+	}
+
+	glUseProgram(0);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_1D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	glPopAttrib();
+}
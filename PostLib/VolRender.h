@@ -31,10 +31,17 @@ SOFTWARE.*/
 #include "GLImageRenderer.h"
 #include "ColorMap.h"
 
+class C3DGradientMap;
+
 namespace Post {
 
 class CImageModel;
 
+//-----------------------------------------------------------------------------
+// Volume renderer for 3D image data. When the hardware supports it, the image is
+// uploaded once as a 3D texture and the transfer function is applied through a
+// 1D lookup texture while rendering view-aligned slices. Otherwise, the slices
+// along the axis that faces the viewer are colorized on the fly.
 class CVolRender : public CGLImageRenderer
 {
 	enum { ALPHA_SCALE, MIN_INTENSITY, MAX_INTENSITY, MIN_ALPHA, MAX_ALPHA, AMIN, AMAX, COLOR_MAP, LIGHTING, LIGHTING_STRENGTH, AMBIENT, SPECULAR, LIGHT_POS };
@@ -74,7 +81,10 @@ protected:
 	void DepthCueZ(CRGBAImage& im, int n);
 
 	void UpdateVolRender();
-	void UpdateRGBImages();
+
+	bool Init3DTexture();
+	void Upload3DTexture();
+	void Render3DTexture(const vec3d& view);
 
 public:
 	Post::CColorTexture	m_Col;		//!< color texture
@@ -89,17 +99,24 @@ public:
 
 protected:
 	C3DImage		m_im3d;	// resampled 3D image data
+	C3DImage*		m_srcImage;	// image that m_im3d was resampled from
 	C3DImage		m_att;	// attenuation map (for lighting)
+	C3DGradientMap*	m_grad;	// gradients of m_im3d (for lighting)
 
-	CImage*	m_sliceX;
-	CImage*	m_sliceY;
-	CImage*	m_sliceZ;
-
-	CRGBAImage*	m_pImx;	// Image array in x-direction
-	CRGBAImage*	m_pImy;	// Image array in y-direction
-	CRGBAImage*	m_pImz;	// Image array in x-direction
+	CImage		m_slice;	// current slice (when slices are colorized on the fly)
+	CRGBAImage	m_rgba;		// colorized slice
 	unsigned int m_texID;
 
+	// 3D texture rendering
+	int				m_mode;		// 0 = not initialized, 1 = 3D texture, 2 = 2D slices
+	unsigned int	m_volTex;	// image data
+	unsigned int	m_tfTex;	// transfer function
+	unsigned int	m_attTex;	// attenuation map
+	unsigned int	m_prog;		// shader program
+	bool			m_reloadVolume;
+	bool			m_reloadTF;
+	bool			m_reloadAtt;
+
 	int m_nx;	// nr of images in x-direction
 	int m_ny;	// nr of images in y-direction
 	int	m_nz;	// nr of images in z-direction
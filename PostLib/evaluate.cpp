@@ -823,6 +823,218 @@ void FEPostModel::EvaluateNode(const vec3f& p, int ntime, int nfield, NODEDATA&
 	d.m_val = el.eval(v, r[0], r[1], r[2]);
 }
 
+//-----------------------------------------------------------------------------
+// clamp the state range of a time history request
+static int historyRange(int states, int& nmin, int& nmax)
+{
+	if (nmin < 0) nmin = 0;
+	if ((nmax == -1) || (nmax >= states)) nmax = states - 1;
+	if (nmax < nmin) nmax = nmin;
+	return nmax - nmin + 1;
+}
+
+//-----------------------------------------------------------------------------
+// copy the histories of a list of items from the history cache
+static void copyCachedHistory(const float* cache, int states, const vector<int>& items, int nmin, int nn, vector<float>& val)
+{
+	int N = (int)items.size();
+	val.resize(N*nn);
+	for (int i = 0; i < N; ++i)
+	{
+		const float* src = cache + (size_t)items[i] * states + nmin;
+		std::copy(src, src + nn, val.begin() + i*nn);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate the time history of a list of nodes. The states are processed in parallel,
+// and each state evaluates all items in one pass.
+int FEPostModel::EvaluateNodeHistory(const vector<int>& items, int nfield, int nmin, int nmax, vector<float>& val)
+{
+	int nn = historyRange(GetStates(), nmin, nmax);
+	int N = (int)items.size();
+
+	if (HasHistoryCache(CLASS_NODE, nfield))
+	{
+		copyCachedHistory(&m_histVal[0], m_histStates, items, nmin, nn, val);
+		return nn;
+	}
+
+	val.assign(N*nn, 0.f);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int n = 0; n < nn; ++n)
+	{
+		NODEDATA nd;
+		for (int i = 0; i < N; ++i)
+		{
+			EvaluateNode(items[i], nmin + n, nfield, nd);
+			val[i*nn + n] = nd.m_val;
+		}
+	}
+
+	return nn;
+}
+
+//-----------------------------------------------------------------------------
+int FEPostModel::EvaluateEdgeHistory(const vector<int>& items, int nfield, int nmin, int nmax, vector<float>& val)
+{
+	int nn = historyRange(GetStates(), nmin, nmax);
+	int N = (int)items.size();
+	val.assign(N*nn, 0.f);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int n = 0; n < nn; ++n)
+	{
+		EDGEDATA ed;
+		for (int i = 0; i < N; ++i)
+		{
+			EvaluateEdge(items[i], nmin + n, nfield, ed);
+			val[i*nn + n] = ed.m_val;
+		}
+	}
+
+	return nn;
+}
+
+//-----------------------------------------------------------------------------
+int FEPostModel::EvaluateFaceHistory(const vector<int>& items, int nfield, int nmin, int nmax, vector<float>& val)
+{
+	int nn = historyRange(GetStates(), nmin, nmax);
+	int N = (int)items.size();
+
+	if (HasHistoryCache(CLASS_FACE, nfield))
+	{
+		copyCachedHistory(&m_histVal[0], m_histStates, items, nmin, nn, val);
+		return nn;
+	}
+
+	val.assign(N*nn, 0.f);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int n = 0; n < nn; ++n)
+	{
+		float data[FEFace::MAX_NODES], v;
+		for (int i = 0; i < N; ++i)
+		{
+			EvaluateFace(items[i], nmin + n, nfield, data, v);
+			val[i*nn + n] = v;
+		}
+	}
+
+	return nn;
+}
+
+//-----------------------------------------------------------------------------
+int FEPostModel::EvaluateElementHistory(const vector<int>& items, int nfield, int nmin, int nmax, vector<float>& val)
+{
+	int nn = historyRange(GetStates(), nmin, nmax);
+	int N = (int)items.size();
+
+	if (HasHistoryCache(CLASS_ELEM, nfield))
+	{
+		copyCachedHistory(&m_histVal[0], m_histStates, items, nmin, nn, val);
+		return nn;
+	}
+
+	val.assign(N*nn, 0.f);
+
+	// eroded elements are not evaluated
+	vector<char> eroded(N*nn, 0);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int n = 0; n < nn; ++n)
+	{
+		float data[FEElement::MAX_NODES] = { 0.f }, v = 0.f;
+		for (int i = 0; i < N; ++i)
+		{
+			FEElement_& el = GetState(nmin + n)->GetFEMesh()->ElementRef(items[i]);
+			if (el.IsEroded()) eroded[i*nn + n] = 1;
+			else
+			{
+				EvaluateElement(items[i], nmin + n, nfield, data, v);
+				val[i*nn + n] = v;
+			}
+		}
+	}
+
+	// eroded elements keep their last value
+	for (int i = 0; i < N; ++i)
+	{
+		for (int n = 1; n < nn; ++n)
+			if (eroded[i*nn + n]) val[i*nn + n] = val[i*nn + n - 1];
+	}
+
+	return nn;
+}
+
+//-----------------------------------------------------------------------------
+// Build the history cache for all items of the given class. Returns false if the
+// class is not supported or the cache would be too large.
+bool FEPostModel::BuildHistoryCache(Data_Class itemClass, int nfield)
+{
+	if (HasHistoryCache(itemClass, nfield)) return true;
+	ClearHistoryCache();
+
+	int states = GetStates();
+	if ((states == 0) || (m_mesh.empty())) return false;
+
+	FEPostMesh& mesh = *GetFEMesh(0);
+	int items = 0;
+	switch (itemClass)
+	{
+	case CLASS_NODE: items = mesh.Nodes(); break;
+	case CLASS_FACE: items = mesh.Faces(); break;
+	case CLASS_ELEM: items = mesh.Elements(); break;
+	default:
+		return false;
+	}
+
+	// don't let the cache grow beyond 1 GB
+	const size_t maxSize = ((size_t)1 << 28);
+	if ((items == 0) || ((size_t)items*states > maxSize)) return false;
+
+	vector<int> itemList(items);
+	for (int i = 0; i < items; ++i) itemList[i] = i;
+
+	switch (itemClass)
+	{
+	case CLASS_NODE: EvaluateNodeHistory   (itemList, nfield, 0, states - 1, m_histVal); break;
+	case CLASS_FACE: EvaluateFaceHistory   (itemList, nfield, 0, states - 1, m_histVal); break;
+	case CLASS_ELEM: EvaluateElementHistory(itemList, nfield, 0, states - 1, m_histVal); break;
+	default:
+		assert(false);
+	}
+
+	m_histClass = itemClass;
+	m_histField = nfield;
+	m_histStates = states;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::ClearHistoryCache()
+{
+	m_histClass = 0;
+	m_histField = -1;
+	m_histStates = 0;
+	vector<float>().swap(m_histVal);
+}
+
+//-----------------------------------------------------------------------------
+bool FEPostModel::HasHistoryCache(Data_Class itemClass, int nfield)
+{
+	return ((m_histClass == itemClass) && (m_histField == nfield) && (m_histStates == GetStates()));
+}
+
+//-----------------------------------------------------------------------------
+const float* FEPostModel::CachedHistory(Data_Class itemClass, int nfield, int item)
+{
+	if (HasHistoryCache(itemClass, nfield) == false) return 0;
+	return &m_histVal[0] + (size_t)item * m_histStates;
+}
+
 //-----------------------------------------------------------------------------
 // Calculate field value of edge n at time ntime
 void FEPostModel::EvaluateEdge(int n, int ntime, int nfield, EDGEDATA& d)
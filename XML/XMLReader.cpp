@@ -30,6 +30,21 @@ SOFTWARE.*/
 
 #include "XMLReader.h"
 
+#ifdef WIN32
+#define ftell64(a)     _ftelli64(a)
+#define fseek64(a,b,c) _fseeki64(a,b,c)
+#endif
+
+#ifdef LINUX // same for Linux and Mac OS X
+#define ftell64(a)     ftello(a)
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+#ifdef __APPLE__ // same for Linux and Mac OS X
+#define ftell64(a)     ftello(a)
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
 #ifdef _DEBUG
 #undef THIS_FILE
 static char THIS_FILE[]=__FILE__;
@@ -53,6 +68,52 @@ int XMLAtt::value(double* pf, int n)
 	return nr;
 }
 
+//-----------------------------------------------------------------------------
+// Replacement for atoi that works on a range that is not null-terminated.
+// Like atoi, parsing stops at the first character that is not a digit.
+static inline int parse_int(const char* sz, const char* end, const char** szend = 0)
+{
+	while ((sz < end) && isspace((unsigned char)*sz)) ++sz;
+	bool neg = false;
+	if ((sz < end) && ((*sz == '-') || (*sz == '+'))) { neg = (*sz == '-'); ++sz; }
+	int n = 0;
+	while ((sz < end) && (*sz >= '0') && (*sz <= '9')) n = 10*n + (*sz++ - '0');
+	if (szend) *szend = sz;
+	return (neg ? -n : n);
+}
+
+//-----------------------------------------------------------------------------
+// Parses an item of an integer list, i.e. "n0", "n0:n1", or "n0:n1:nn".
+// Returns the number of values read (same as sscanf(sz, "%d:%d:%d", ...)).
+// Missing values default to n1 = n0 and nn = 1.
+static int parse_range(const char* sz, const char* end, int& n0, int& n1, int& nn)
+{
+	int* pn[3] = { &n0, &n1, &nn };
+	int nread = 0;
+	const char* ch;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (i > 0)
+		{
+			if ((sz >= end) || (*sz != ':')) break;
+			++sz;
+		}
+
+		// make sure we actually read a digit
+		int n = parse_int(sz, end, &ch);
+		if ((ch == sz) || !isdigit((unsigned char)ch[-1])) break;
+
+		*pn[i] = n;
+		nread++;
+		sz = ch;
+	}
+
+	if      (nread == 1) { n1 = n0; nn = 1; }
+	else if (nread == 2) nn = 1;
+
+	return nread;
+}
+
 //////////////////////////////////////////////////////////////////////
 // XMLTag
 //////////////////////////////////////////////////////////////////////
@@ -65,6 +126,8 @@ XMLTag::XMLTag()
 	m_sztag[0] = 0;
 	m_szval[0] = 0;
 	m_nlevel = 0;
+	m_fpos = 0;
+	m_valPos = m_valLen = 0;
 
 	m_natt = 0;
 	int i;
@@ -81,15 +144,16 @@ XMLTag::XMLTag()
 
 int XMLTag::value(double* pf, int n)
 {
-	char* sz = m_szval;
+	int64_t len;
+	const char* sz = valueView(len);
+	const char* end = sz + len;
 	int nr = 0;
 	for (int i=0; i<n; ++i)
 	{
-		char* sze = strchr(sz, ',');
-
-		pf[i] = atof(sz);
+		pf[i] = strtod(sz, 0);
 		nr++;
 
+		const char* sze = (const char*) memchr(sz, ',', end - sz);
 		if (sze) sz = sze + 1;
 		else break;
 	}
@@ -100,15 +164,16 @@ int XMLTag::value(double* pf, int n)
 
 int XMLTag::value(float* pf, int n)
 {
-	char* sz = m_szval;
+	int64_t len;
+	const char* sz = valueView(len);
+	const char* end = sz + len;
 	int nr = 0;
 	for (int i=0; i<n; ++i)
 	{
-		char* sze = strchr(sz, ',');
-
-		pf[i] = (float) atof(sz);
+		pf[i] = (float) strtod(sz, 0);
 		nr++;
 
+		const char* sze = (const char*) memchr(sz, ',', end - sz);
 		if (sze) sz = sze + 1;
 		else break;
 	}
@@ -119,15 +184,16 @@ int XMLTag::value(float* pf, int n)
 
 int XMLTag::value(int* pi, int n)
 {
-	char* sz = m_szval;
+	int64_t len;
+	const char* sz = valueView(len);
+	const char* end = sz + len;
 	int nr = 0;
 	for (int i=0; i<n; ++i)
 	{
-		char* sze = strchr(sz, ',');
-
-		pi[i] = atoi(sz);
+		pi[i] = parse_int(sz, end);
 		nr++;
 
+		const char* sze = (const char*) memchr(sz, ',', end - sz);
 		if (sze) sz = sze + 1;
 		else break;
 	}
@@ -138,7 +204,9 @@ int XMLTag::value(int* pi, int n)
 
 void XMLTag::value(vec3d& v)
 {
-	sscanf(m_szval, "%lg,%lg,%lg", &v.x, &v.y, &v.z);
+	double a[3] = { v.x, v.y, v.z };
+	value(a, 3);
+	v = vec3d(a[0], a[1], a[2]);
 }
 
 void XMLTag::value(vec2i& v)
@@ -148,7 +216,9 @@ void XMLTag::value(vec2i& v)
 
 void XMLTag::value(vec3f& v)
 {
-	sscanf(m_szval, "%g,%g,%g", &v.x, &v.y, &v.z);
+	float a[3] = { v.x, v.y, v.z };
+	value(a, 3);
+	v = vec3f(a[0], a[1], a[2]);
 }
 
 void XMLTag::value(mat3d& m)
@@ -165,42 +235,35 @@ void XMLTag::value(GLColor& c)
 
 void XMLTag::value(string& s)
 {
-	s = m_szval;
+	// (line breaks are not part of the value)
+	int64_t len;
+	const char* sz = valueView(len);
+	s.clear();
+	s.reserve(len);
+	for (int64_t i = 0; i < len; ++i)
+	{
+		if (sz[i] != '\n') s.push_back(sz[i]);
+	}
 }
 
 //-----------------------------------------------------------------------------
 void XMLTag::value(vector<int>& l)
 {
+	int64_t len;
+	const char* szval = valueView(len);
+	const char* end = szval + len;
+
+	// count the items first
 	int i, n = 0, n0, n1, nn;
-	char* szval = strdup(m_szval);
-	char* ch;
-	char* sz = szval;
-	int nread;
+	const char* sz = szval;
+	const char* ch;
 	do
 	{
-		ch = strchr(sz, ',');
-		if (ch) *ch = 0;
-		nread = sscanf(sz, "%d:%d:%d", &n0, &n1, &nn);
-		switch (nread)
+		ch = (const char*) memchr(sz, ',', end - sz);
+		if (parse_range(sz, (ch ? ch : end), n0, n1, nn) > 0)
 		{
-		case 1:
-			n1 = n0;
-			nn = 1;
-			break;
-		case 2:
-			nn = 1;
-			break;
-		case 3:
-			break;
-		default:
-			n0 = 0;
-			n1 = -1;
-			nn = 1;
+			for (i=n0; i<=n1; i += nn) ++n;
 		}
-
-		for (i=n0; i<=n1; i += nn) ++n;
-
-		if (ch) *ch = ',';
 		sz = ch+1;
 	}
 	while (ch != 0);
@@ -213,29 +276,16 @@ void XMLTag::value(vector<int>& l)
 		n = 0;
 		do
 		{
-			ch = strchr(sz, ',');
-			if (ch) *ch = 0;
-			nread = sscanf(sz, "%d:%d:%d", &n0, &n1, &nn);
-			switch (nread)
+			ch = (const char*) memchr(sz, ',', end - sz);
+			if (parse_range(sz, (ch ? ch : end), n0, n1, nn) > 0)
 			{
-			case 1:
-				n1 = n0;
-				nn = 1;
-				break;
-			case 2:
-				nn = 1;
+				for (i=n0; i<=n1; i += nn) l[n++] = i;
+				assert(n <= (int) l.size());
 			}
-
-			for (i=n0; i<=n1; i += nn) l[n++] = i;
-			assert(n <= (int) l.size());
-
-			if (ch) *ch = ',';
 			sz = ch+1;
 		}
 		while (ch != 0);
 	}
-
-	free(szval);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -296,10 +346,11 @@ XMLReader::XMLReader()
 	m_fp = 0;
 	m_ownFile = false;
 	m_nline = 0;
+	m_buf.resize(BUF_SIZE);
+	m_bufStart = 0;
 	m_bufIndex = 0;
 	m_bufSize = 0;
 	m_eof = false;
-	m_currentPos = 0;
 }
 
 XMLReader::~XMLReader()
@@ -315,10 +366,61 @@ void XMLReader::Close()
 	}
 	m_fp = 0;
 
+	m_bufStart = 0;
 	m_bufIndex = 0;
 	m_bufSize = 0;
 	m_eof = false;
-	m_currentPos = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Read the next block of the file. The last few characters of the current
+// block are kept at the front so that rewind does not have to go back to the file.
+void XMLReader::fillBuffer()
+{
+	if (m_eof) throw EndOfFile();
+
+	int64_t keep = (m_bufSize < 16 ? m_bufSize : 16);
+	if (keep > 0) memmove(&m_buf[0], &m_buf[m_bufSize - keep], keep);
+	m_bufStart += m_bufSize - keep;
+
+	int64_t nread = fread(&m_buf[keep], 1, BUF_SIZE - keep, m_fp);
+	m_bufIndex = keep;
+	m_bufSize = keep + nread;
+	m_eof = (nread != BUF_SIZE - keep);
+	if (nread == 0) throw EndOfFile();
+}
+
+// Set the current file position. This only goes back to the file if 
+// the position is not in the current buffer.
+void XMLReader::seekTo(int64_t pos)
+{
+	if ((pos >= m_bufStart) && (pos <= m_bufStart + m_bufSize))
+	{
+		m_bufIndex = pos - m_bufStart;
+	}
+	else
+	{
+		fseek64(m_fp, pos, SEEK_SET);
+		m_bufStart = pos;
+		m_bufIndex = m_bufSize = 0;
+		m_eof = false;
+	}
+}
+
+// Returns a pointer to the value at the given file position. 
+const char* XMLReader::valueView(int64_t pos, int64_t len)
+{
+	// the value is terminated by a '<', which has to be in the buffer as well
+	if ((pos >= m_bufStart) && (pos + len < m_bufStart + m_bufSize)) return &m_buf[pos - m_bufStart];
+
+	// the value is no longer in the buffer, so we read it from the file
+	m_valBuf.assign(len, 0);
+	fseek64(m_fp, pos, SEEK_SET);
+	size_t nread = fread(&m_valBuf[0], 1, len, m_fp);
+	m_valBuf.resize(nread);
+	fseek64(m_fp, m_bufStart + m_bufSize, SEEK_SET);
+	return m_valBuf.c_str();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -345,6 +447,11 @@ bool XMLReader::Open(const char* szfile)
 		return false;
 	}
 
+	// start buffering from here
+	m_bufStart = ftell64(m_fp);
+	m_bufIndex = m_bufSize = 0;
+	m_eof = false;
+
 	// This file is ready to be processed
 	return true;
 }
@@ -366,6 +473,11 @@ bool XMLReader::Attach(FILE* fp)
 		return false;
 	}
 
+	// start buffering from here
+	m_bufStart = ftell64(m_fp);
+	m_bufIndex = m_bufSize = 0;
+	m_eof = false;
+
 	// This file is ready to be processed
 	return true;
 }
@@ -375,9 +487,7 @@ bool XMLReader::Attach(FILE* fp)
 bool XMLReader::FindTag(const char* sztag, XMLTag& tag)
 {
 	// go to the beginning of the file
-	fseek(m_fp, 0, SEEK_SET);
-	m_bufIndex = m_bufSize = 0;
-	m_currentPos = 0;
+	seekTo(0);
 
 	// set the first tag
 	tag.m_preader = this;
@@ -404,13 +514,7 @@ void XMLReader::NextTag(XMLTag& tag)
 	m_nline = tag.m_ncurrent_line;
 
 	// set the current file position
-	if (m_currentPos != tag.m_fpos)
-	{
-		fseek(m_fp, tag.m_fpos, SEEK_SET);
-		m_currentPos = tag.m_fpos;
-		m_bufSize = m_bufIndex = 0;
-		m_eof = false;
-	}
+	if (currentPos() != tag.m_fpos) seekTo(tag.m_fpos);
 
 	// clear tag's content
 	tag.clear();
@@ -525,14 +629,16 @@ void XMLReader::ReadTag(XMLTag& tag)
 	// read the tag name
 	if (!isvalid(ch)) throw XMLSyntaxError();
 	sz = tag.m_sztag;
+	char* szend = sz + XMLTag::MAX_TAG - 1;
 	*sz++ = ch;
-	while (isvalid(ch=GetChar())) *sz++ = ch;
+	while (isvalid(ch=GetChar())) if (sz < szend) *sz++ = ch;
 	*sz = 0;
 
 	// read attributes
 	tag.m_natt = 0;
 	int n = 0;
 	sz = 0;
+	XMLAtt dummy;
 	while (true)
 	{
 		// skip whitespace
@@ -547,10 +653,13 @@ void XMLReader::ReadTag(XMLTag& tag)
 		else if (ch == '>') break;
 
 		// read the attribute's name
-		sz = tag.m_att[n].m_sztag;
+		// (attributes beyond MAX_ATT are parsed, but not stored)
+		XMLAtt& att = (n < XMLTag::MAX_ATT ? tag.m_att[n] : dummy);
+		sz = att.m_sztag;
+		szend = sz + XMLAtt::MAX_TAG - 1;
 		if (!isvalid(ch)) throw XMLSyntaxError();
 		*sz++ = ch;
-		while (isvalid(ch=GetChar())) *sz++ = ch;
+		while (isvalid(ch=GetChar())) if (sz < szend) *sz++ = ch;
 		*sz=0; sz=0;
 
 		// skip whitespace
@@ -562,13 +671,17 @@ void XMLReader::ReadTag(XMLTag& tag)
 		if ((ch != '"')&&(ch!='\'')) throw XMLSyntaxError();
 		char quot = ch;
 
-		sz = tag.m_att[n].m_szval;
-		while ((ch=GetChar())!=quot) *sz++ = ch;
+		sz = att.m_szval;
+		szend = sz + XMLAtt::MAX_TAG - 1;
+		while ((ch=GetChar())!=quot) if (sz < szend) *sz++ = ch;
 		*sz=0; sz=0;
 		ch=GetChar();
 
-		++n;
-		++tag.m_natt;
+		if (n < XMLTag::MAX_ATT)
+		{
+			++n;
+			++tag.m_natt;
+		}
 	}
 
 	if (!tag.isend() && !tag.isempty())
@@ -581,14 +694,36 @@ void XMLReader::ReadTag(XMLTag& tag)
 
 void XMLReader::ReadValue(XMLTag& tag)
 {
-	char ch;
-	if (!tag.isend())
+	// Scan the buffer for the start of the next tag. Only the first MAX_TAG-1 characters
+	// are copied to m_szval. The full value can be accessed via XMLTag::valueView.
+	bool bcopy = !tag.isend();
+	char* sz = tag.m_szval;
+	char* szend = sz + XMLTag::MAX_TAG - 1;
+	int64_t pos0 = currentPos();
+	while (true)
+	{
+		if (m_bufIndex >= m_bufSize) fillBuffer();
+
+		const char* ch = &m_buf[m_bufIndex];
+		const char* che = ch + (m_bufSize - m_bufIndex);
+		for (; (ch < che) && (*ch != '<'); ++ch)
+		{
+			if (*ch == '\n') ++m_nline;
+			else if (bcopy && (sz < szend)) *sz++ = *ch;
+		}
+		m_bufIndex = m_bufSize - (che - ch);
+		if (ch < che) break;
+	}
+
+	// skip the '<'
+	m_bufIndex++;
+
+	if (bcopy)
 	{
-		char *sz = tag.m_szval;
-		while ((ch=GetChar())!='<') *sz++ = ch;
-		*sz=0;
+		*sz = 0;
+		tag.m_valPos = pos0;
+		tag.m_valLen = currentPos() - 1 - pos0;
 	}
-	else while ((ch=GetChar())!='<');
 }
 
 void XMLReader::ReadEndTag(XMLTag& tag)
@@ -84,11 +84,9 @@ public:
 	int		m_natt;	// nr of attributes
 
 	XMLReader*	m_preader;		// pointer to reader
-#ifdef WIN32
-	fpos_t	m_fpos;				// file position of next tag
-#else
-	long int	m_fpos;				// file position of next tag
-#endif
+	int64_t	m_fpos;				// file position of next tag
+	int64_t	m_valPos;			// file position of the tag's value
+	int64_t	m_valLen;			// length of the tag's value (not limited to MAX_TAG)
 	int		m_nstart_line;		// line number at beginning of tag
 	int		m_ncurrent_line;	// current line number
 
@@ -103,6 +101,7 @@ public:
 	{
 		m_sztag[0] = 0;
 		m_szval[0] = 0;
+		m_valPos = m_valLen = 0;
 		m_natt = 0;
 		m_bend = false;
 		m_bleaf = true;
@@ -150,6 +149,10 @@ public:
 
 	const char* szvalue() { return m_szval; }
 
+	// Returns a (not null-terminated) view of the full value. Unlike m_szval this 
+	// is not truncated, but it is only valid until the reader advances.
+	const char* valueView(int64_t& len);
+
 	const std::string& comment();
 };
 
@@ -170,7 +173,7 @@ template <> inline double XMLTag::AttributeValue<double >(const char* szatt, dou
 class XMLReader  
 {
 public:
-	enum { BUF_SIZE = 4096 };
+	enum { BUF_SIZE = 1048576 };
 
 public:
 	// exceptions -----------
@@ -276,7 +279,7 @@ public:
 
 	int64_t currentPos()
 	{
-		return m_currentPos;
+		return m_bufStart + m_bufIndex;
 	}
 
 protected:
@@ -289,29 +292,14 @@ protected:
 
 	char readNextChar()
 	{
-		if (m_bufIndex >= m_bufSize)
-		{
-			if (m_eof) throw EndOfFile();
-
-			m_bufSize = fread(m_buf, 1, BUF_SIZE, m_fp);
-			m_bufIndex = 0;
-			m_eof = (m_bufSize != BUF_SIZE);
-		}
-		m_currentPos++;
+		if (m_bufIndex >= m_bufSize) fillBuffer();
 		return m_buf[m_bufIndex++];
 	}
 
 	void rewind(int64_t nstep)
 	{
 		m_bufIndex -= nstep;
-		m_currentPos -= nstep;
-
-		if (m_bufIndex < 0)
-		{
-			fseek(m_fp, m_bufIndex - m_bufSize, SEEK_CUR);
-			m_bufIndex = m_bufSize = 0;
-			m_eof = false;
-		}
+		if (m_bufIndex < 0) seekTo(m_bufStart + m_bufIndex);
 	}
 
 	// only used for processing comments
@@ -327,6 +315,10 @@ protected:
 		return ch;
 	}
 
+	void fillBuffer();
+	void seekTo(int64_t pos);
+	const char* valueView(int64_t pos, int64_t len);
+
 	void ReadTag(XMLTag& tag);
 	void ReadValue(XMLTag& tag);
 	void ReadEndTag(XMLTag& tag);
@@ -336,17 +328,26 @@ protected:
 	bool	m_ownFile;	// flag that inidicates whether the reader owns the file pointer or not
 
 	int		m_nline;	// current line (used only as temp storage)
-	int64_t	m_currentPos;	//!< current file position
 
 	string	m_comment;	// last comment that was read
 
-	char		m_buf[BUF_SIZE];
+	vector<char>	m_buf;		// read buffer
+	int64_t		m_bufStart;		// file position of m_buf[0]
 	int64_t		m_bufIndex, m_bufSize;
 	bool		m_eof;
 
+	string		m_valBuf;	// holds values that are no longer in the read buffer
+
 	friend class XMLTag;
 };
 
 inline void XMLTag::operator ++ () { m_preader->NextTag(*this); }
 
 inline const std::string& XMLTag::comment() { return m_preader->GetLastComment(); }
+
+inline const char* XMLTag::valueView(int64_t& len)
+{
+	len = m_valLen;
+	if ((m_valLen == 0) || (m_preader == 0)) return m_szval;
+	return m_preader->valueView(m_valPos, m_valLen);
+}
@@ -29,6 +29,7 @@ SOFTWARE.*/
 //////////////////////////////////////////////////////////////////////
 
 #include "XMLWriter.h"
+#include <algorithm>
 
 const char* XMLElement::intFormat = "%6d";
 
@@ -37,41 +38,81 @@ void XMLElement::setDefautlFormats()
 	intFormat = "%6d";
 }
 
-void XMLElement::value(int* pi, int n)
+// Returns the field width if fmt is of the form %d or %<width>d, or -1 otherwise.
+static int int_format_width(const char* fmt)
+{
+	if (fmt[0] != '%') return -1;
+	int w = 0;
+	const char* c = fmt + 1;
+	while ((*c >= '0') && (*c <= '9')) { w = 10*w + (*c - '0'); ++c; }
+	if ((c[0] != 'd') || (c[1] != 0)) return -1;
+	return w;
+}
+
+// Writes an integer right-aligned in a field of width w. This gives the same
+// result as sprintf with the format %<w>d, but is a lot faster.
+static char* write_int(char* sz, int n, int w)
 {
-	m_szval[0] = 0;
-	if (n==0) return;
+	char tmp[16];
+	int l = 0;
+	unsigned int u = (n < 0 ? 0u - (unsigned int) n : (unsigned int) n);
+	do { tmp[l++] = (char)('0' + u % 10); u /= 10; } while (u);
+	if (n < 0) tmp[l++] = '-';
+	for (int i = l; i < w; ++i) *sz++ = ' ';
+	while (l > 0) *sz++ = tmp[--l];
+	*sz = 0;
+	return sz;
+}
 
-	sprintf(m_szval, intFormat, pi[0]);
-	int l = (int)strlen(m_szval);
-	for (int i=1; i<n; ++i)
+char* XMLElement::format_value(char* sz, const int* pi, int n)
+{
+	sz[0] = 0;
+	int w = int_format_width(intFormat);
+	for (int i=0; i<n; ++i)
 	{
-		sprintf(m_szval+l, ",");
-		sprintf(m_szval + l + 1, intFormat, pi[i]);
-		l = (int)strlen(m_szval);
+		if (i > 0) *sz++ = ',';
+		if (w >= 0) sz = write_int(sz, pi[i], w);
+		else sz += sprintf(sz, intFormat, pi[i]);
 	}
+	return sz;
 }
 
-void XMLElement::value(double* pg, int n)
+char* XMLElement::format_value(char* sz, double g)
 {
-	m_szval[0] = 0;
-	if (n==0) return;
+	return sz + sprintf(sz, "%.9lg", g);
+}
 
-	sprintf(m_szval, "%lg", pg[0]);
-	int l = (int)strlen(m_szval);
-	for (int i=1; i<n; ++i)
-	{
-		sprintf(m_szval+l, ",%lg", pg[i]);
-		l = (int)strlen(m_szval);
-	}
+char* XMLElement::format_value(char* sz, const double* pg, int n)
+{
+	sz[0] = 0;
+	if (n==0) return sz;
+
+	sz += sprintf(sz, "%lg", pg[0]);
+	for (int i=1; i<n; ++i) sz += sprintf(sz, ",%lg", pg[i]);
+	return sz;
 }
 
-void XMLElement::value(const vec3d& r)
-{ 
+char* XMLElement::format_value(char* sz, const vec3d& r)
+{
 	if (XMLWriter::GetFloatFormat() == XMLWriter::ScientificFormat)
-		sprintf(m_szval, "%15.7e,%15.7e,%15.7e", r.x, r.y, r.z); 
+		return sz + sprintf(sz, "%15.7e,%15.7e,%15.7e", r.x, r.y, r.z); 
 	else
-		sprintf(m_szval, "%.9lg,%.9lg,%.9lg", r.x, r.y, r.z);
+		return sz + sprintf(sz, "%.9lg,%.9lg,%.9lg", r.x, r.y, r.z);
+}
+
+void XMLElement::value(int* pi, int n)
+{
+	format_value(m_szval, pi, n);
+}
+
+void XMLElement::value(double* pg, int n)
+{
+	format_value(m_szval, pg, n);
+}
+
+void XMLElement::value(const vec3d& r)
+{ 
+	format_value(m_szval, r);
 }
 
 void XMLElement::value(const vec2i& r)
@@ -177,6 +218,7 @@ XMLWriter::XMLWriter()
 {
 	m_fp = 0;
 	m_level = 0;
+	m_progress = 0;
 
 	m_sztab[0] = 0;
 
@@ -194,6 +236,9 @@ bool XMLWriter::open(const char* szfile)
 
 	m_fp = fopen(szfile, "wt");
 
+	// use a large output buffer
+	if (m_fp) setvbuf(m_fp, 0, _IOFBF, 1 << 20);
+
 	// write the first line
 	if (m_fp) fprintf(m_fp, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n");
 	
@@ -395,6 +440,53 @@ void XMLWriter::add_leaf(XMLElement& el, const std::vector<int>& A)
 }
 
 
+// Writes a (large) list of leaves. The leaves are formatted in blocks, which are
+// processed in parallel and then written in order. Only a limited number of blocks
+// is kept in memory, so the memory use does not depend on the size of the list.
+void XMLWriter::add_leaves(XMLLeafList& list)
+{
+	const int BLOCK_SIZE = 4096;	// leaves per block
+	const int MAX_BLOCKS = 64;		// max nr of blocks in memory
+
+	std::string head = std::string(m_sztab) + "<" + list.m_sztag + " " + list.m_szatt + "=\"";
+	std::string tail = std::string("</") + list.m_sztag + ">\n";
+
+	int N = list.Leaves();
+	int NB = (N + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<std::string> buf(std::min(NB, MAX_BLOCKS));
+	for (int b0 = 0; b0 < NB; b0 += MAX_BLOCKS)
+	{
+		int b1 = std::min(b0 + MAX_BLOCKS, NB);
+
+#pragma omp parallel for schedule(dynamic)
+		for (int b = b0; b < b1; ++b)
+		{
+			std::string& s = buf[b - b0];
+			s.clear();
+
+			char szid[16];
+			char szval[sizeof(XMLElement::m_szval)];
+			int n1 = std::min((b + 1)*BLOCK_SIZE, N);
+			for (int i = b*BLOCK_SIZE; i < n1; ++i)
+			{
+				s += head;
+				s.append(szid, write_int(szid, list.LeafID(i), 0));
+				s += "\">";
+				s.append(szval, list.LeafValue(i, szval));
+				s += tail;
+			}
+		}
+
+		for (int b = b0; b < b1; ++b)
+		{
+			const std::string& s = buf[b - b0];
+			fwrite(s.data(), 1, s.size(), m_fp);
+		}
+
+		if (m_progress) m_progress->Progress(list.m_sztag, std::min(b1*BLOCK_SIZE, N), N);
+	}
+}
+
 void XMLWriter::close_branch()
 {
 	if (m_level > 0)
@@ -60,12 +60,19 @@ public:
 	void value(int    n) { sprintf(m_szval, "%d" , n); }
 	void value(int* pi, int n);
 	void value(bool   b) { sprintf(m_szval, "%d" , (int) b); }
-	void value(double g) { sprintf(m_szval, "%.9lg", g); }
+	void value(double g) { format_value(m_szval, g); }
 	void value(double* pg, int n);
 	void value(const vec3d& r);
 	void value(const mat3d& a);
 	void value(const vec2i& r);
 
+	// These format a value the same way as the corresponding value() functions.
+	// The value is written to sz and a pointer to the terminating null character is returned.
+	static char* format_value(char* sz, const int* pi, int n);
+	static char* format_value(char* sz, double g);
+	static char* format_value(char* sz, const double* pg, int n);
+	static char* format_value(char* sz, const vec3d& r);
+
 	int add_attribute(const char* szn, const char* szv);
 	int add_attribute(const char* szn, int n);
 	int add_attribute(const char* szn, bool b);
@@ -92,6 +99,43 @@ public:
 	friend class XMLWriter;
 };
 
+//-----------------------------------------------------------------------------
+// A list of leaves of the form <tag att="id">value</tag> that can be written in one
+// go with XMLWriter::add_leaves. This is used for large sections (e.g. nodes and elements).
+// The leaves are formatted in parallel, so LeafID and LeafValue must not modify any data.
+class XMLLeafList
+{
+public:
+	XMLLeafList(const char* sztag, const char* szatt) : m_sztag(sztag), m_szatt(szatt) {}
+	virtual ~XMLLeafList() {}
+
+	// number of leaves
+	virtual int Leaves() const = 0;
+
+	// the id attribute of leaf i
+	virtual int LeafID(int i) const = 0;
+
+	// Write the value of leaf i to sz (which can hold the same number of characters as
+	// an XMLElement value) and return a pointer to the terminating null character.
+	virtual char* LeafValue(int i, char* sz) const = 0;
+
+public:
+	const char*	m_sztag;	// leaf name
+	const char*	m_szatt;	// name of id attribute
+};
+
+//-----------------------------------------------------------------------------
+// Callback interface for reporting the progress of XMLWriter::add_leaves.
+class XMLProgressCallback
+{
+public:
+	virtual ~XMLProgressCallback() {}
+
+	// called each time a part of the leaves was written
+	virtual void Progress(const char* sztag, int written, int total) = 0;
+};
+
+//-----------------------------------------------------------------------------
 class XMLWriter  
 {
 public:
@@ -129,6 +173,8 @@ public:
 	void add_leaf(const char* szn, const GLColor& c) { char szv[256]; sprintf(szv, "%d,%d,%d", c.r, c.g, c.b); }
 	void add_leaf(XMLElement& el, const std::vector<int>& A);
 
+	void add_leaves(XMLLeafList& list);
+
 	void close_branch();
 
 	void add_comment(const std::string& s, bool singleLine = false);
@@ -137,6 +183,8 @@ public:
 	static void SetFloatFormat(XMLFloatFormat fmt);
 	static XMLFloatFormat GetFloatFormat();
 
+	void SetProgressCallback(XMLProgressCallback* pcb) { m_progress = pcb; }
+
 protected:
 	void inc_level();
 	void dec_level();
@@ -148,5 +196,7 @@ protected:
 	char	m_tag[MAX_TAGS][256];
 	char	m_sztab[256];
 
+	XMLProgressCallback*	m_progress;
+
 	static XMLFloatFormat	m_floatFormat;
 };
@@ -60,6 +60,8 @@ xpltArchive::xpltArchive()
 	m_pRoot = 0;
 	m_pChunk = 0;
 	m_bSaving = true;
+	m_bowner = false;
+	m_pout = 0;
 }
 
 xpltArchive::~xpltArchive()
@@ -84,7 +86,10 @@ void xpltArchive::Close()
 	}
 
 	// close the file pointer
+	if (m_bowner) delete m_fp;
 	m_fp = 0;
+	m_bowner = false;
+	SetBuffer(0);
 
 	// delete the buffer
 	if (m_buf) delete[] m_buf;
@@ -117,6 +122,7 @@ bool xpltArchive::Create(const char* szfile)
 	// attempt to create the file
 	assert(m_fp == 0);
 	m_fp = new IOFileStream();
+	m_bowner = true;
 	if (m_fp->Create(szfile) == false) return false;
 
 	// write the master tag 
@@ -128,8 +134,39 @@ bool xpltArchive::Create(const char* szfile)
 	return true;
 }
 
+void xpltArchive::SetBuffer(vector<unsigned char>* pbuf)
+{
+	m_pout = pbuf;
+	if (m_pout) m_pout->clear();
+	while (m_outChunk.empty() == false) m_outChunk.pop();
+}
+
+void xpltArchive::AppendBuffer(const void* pd, size_t nsize)
+{
+	if (nsize == 0) return;
+	size_t n0 = m_pout->size();
+	m_pout->resize(n0 + nsize);
+	memcpy(&(*m_pout)[n0], pd, nsize);
+}
+
+void xpltArchive::WriteBuffer(unsigned int nid, const void* pd, size_t nsize)
+{
+	unsigned int hdr[2] = { nid, (unsigned int)nsize };
+	AppendBuffer(hdr, sizeof(hdr));
+	AppendBuffer(pd, nsize);
+}
+
 void xpltArchive::BeginChunk(unsigned int id)
 {
+	if (m_pout)
+	{
+		// the chunk size is filled in when the chunk ends
+		m_outChunk.push(m_pout->size());
+		unsigned int hdr[2] = { id, 0 };
+		AppendBuffer(hdr, sizeof(hdr));
+		return;
+	}
+
 	if (m_pRoot == 0)
 	{
 		m_pRoot = new OBranch(id);
@@ -150,6 +187,15 @@ void xpltArchive::BeginChunk(unsigned int id)
 
 void xpltArchive::EndChunk()
 {
+	if (m_pout)
+	{
+		assert(m_outChunk.empty() == false);
+		size_t pos = m_outChunk.top(); m_outChunk.pop();
+		unsigned int nsize = (unsigned int)(m_pout->size() - pos - 2*sizeof(unsigned int));
+		memcpy(&(*m_pout)[pos + sizeof(unsigned int)], &nsize, sizeof(unsigned int));
+		return;
+	}
+
 	if (m_pChunk != m_pRoot)
 		m_pChunk = m_pChunk->GetParent();
 	else
@@ -275,6 +321,7 @@ bool xpltArchive::Append(const char* szfile)
 	// reopen the plot file for appending
 	assert(m_fp == 0);
 	m_fp = new IOFileStream();
+	m_bowner = true;
 	if (m_fp->Append(szfile) == false) return false;
 	m_bSaving = true;
 	return true;
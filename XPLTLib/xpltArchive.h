@@ -84,24 +84,42 @@ public:
 
 	template <typename T> void WriteChunk(unsigned int nid, T& o)
 	{
-		m_pChunk->AddChild(new OLeaf<T>(nid, o));
+		if (m_pout) WriteBuffer(nid, &o, sizeof(T));
+		else m_pChunk->AddChild(new OLeaf<T>(nid, o));
 	}
 
 	void WriteChunk(unsigned int nid, const char* sz)
 	{
-		m_pChunk->AddChild(new OLeaf<const char*>(nid, sz));
+		if (m_pout)
+		{
+			int l = (int)strlen(sz);
+			BeginChunk(nid);
+			AppendBuffer(&l, sizeof(int));
+			AppendBuffer(sz, l);
+			EndChunk();
+		}
+		else m_pChunk->AddChild(new OLeaf<const char*>(nid, sz));
 	}
 
 	template <typename T> void WriteChunk(unsigned int nid, T* po, int n)
 	{
-		m_pChunk->AddChild(new OLeaf<T*>(nid, po, n));
+		if (m_pout) WriteBuffer(nid, po, sizeof(T)*n);
+		else m_pChunk->AddChild(new OLeaf<T*>(nid, po, n));
 	}
 
 	template <typename T> void WriteChunk(unsigned int nid, vector<T>& a)
 	{
-		m_pChunk->AddChild(new OLeaf<vector<T> >(nid, a));
+		if (m_pout) WriteBuffer(nid, &a[0], sizeof(T)*a.size());
+		else m_pChunk->AddChild(new OLeaf<vector<T> >(nid, a));
 	}
 
+	// Serialize chunks directly into a memory buffer, instead of collecting them
+	// in the chunk tree and writing them to file. Pass null to end buffering.
+	void SetBuffer(vector<unsigned char>* pbuf);
+
+	// get the file pointer (e.g. for writing buffers to file)
+	FILE* FilePtr() { return (m_fp ? m_fp->FilePtr() : nullptr); }
+
 	// (overridden from Archive)
 	virtual void WriteData(int nid, std::vector<float>& data)
 	{
@@ -183,6 +201,10 @@ public: // reading
 
 	int DecompressChunk(unsigned int& nid, unsigned int& nsize);
 
+protected:
+	void AppendBuffer(const void* pd, size_t nsize);
+	void WriteBuffer(unsigned int nid, const void* pd, size_t nsize);
+
 protected:
 	IOFileStream*	m_fp;		// the file pointer
 	bool	m_bswap;		// swap data when reading
@@ -203,4 +225,9 @@ protected:
 	// write data
 	OBranch*	m_pRoot;	// chunk tree root
 	OBranch*	m_pChunk;	// current chunk
+	bool		m_bowner;	// the file stream was created by this archive
+
+	// buffered write data
+	vector<unsigned char>*	m_pout;		// output buffer
+	stack<size_t>			m_outChunk;	// buffer offsets of open chunks
 };
@@ -26,6 +26,7 @@ SOFTWARE.*/
 
 #include "stdafx.h"
 #include "xpltFileExport.h"
+#include "xpltStreamWriter.h"
 #include <PostLib/FEPostModel.h>
 #include <PostLib/FEMeshData_T.h>
 using namespace Post;
@@ -59,6 +60,7 @@ xpltFileExport::xpltFileExport()
 {
 	m_szerr[0] = 0;
 	m_ncompress = 0;
+	m_nthreads = 0;
 }
 
 bool xpltFileExport::error(const char* sz)
@@ -81,23 +83,38 @@ bool xpltFileExport::Save(FEPostModel& fem, const char* szfile)
 		return false;
 	}
 
-	// set compression option
-	m_ar.SetCompression(m_ncompress);
+	// Write the state data. Each state is serialized into a buffer on this thread,
+	// while the stream writer compresses and writes the previous states.
+	xpltStreamWriter out;
+	out.Start(m_ar.FilePtr(), (m_ncompress != 0), m_nthreads);
 
-	// write the state data
+	vector<unsigned char> buf;
 	int NS = fem.GetStates();
 	for (int i=0; i<NS; ++i)
 	{
-		if (WriteState(fem, *fem.GetState(i)) == false)
+		m_ar.SetBuffer(&buf);
+		bool bret = WriteState(fem, *fem.GetState(i));
+		m_ar.SetBuffer(0);
+		if (bret == false)
 		{
+			out.Finish();
 			m_ar.Close();
 			return false;
 		}
+
+		// the buffer is handed over to the writer
+		size_t nsize = buf.size();
+		if (out.Submit(buf) == false) break;
+		buf.reserve(nsize);
 	}
 
+	bool bok = out.Finish();
+
 	// don't forget to close
 	m_ar.Close();
 
+	if (bok == false) return error("Failed writing state data");
+
 	return true;
 }
 
@@ -155,6 +155,9 @@ public:
 	// set the compression flag
 	void SetCompression(bool b) { m_ncompress = (b ? 1 : 0); }
 
+	// set the number of compression threads (0 = pick based on hardware)
+	void SetThreads(int n) { m_nthreads = n; }
+
 protected:
 	bool WriteRoot(FEPostModel& fem);
 	bool WriteHeader    (FEPostModel& fem);
@@ -186,6 +189,7 @@ private:
 	int			m_elemData;
 	int			m_faceData;
 	int			m_ncompress;
+	int			m_nthreads;
 
 	char		m_szerr[256];
 };
@@ -30,6 +30,8 @@ SOFTWARE.*/
 #include "xpltReader2.h"
 #include "xpltReader3.h"
 #include <PostLib/FEPostModel.h>
+#include <PostLib/FEDataManager.h>
+#include <PostLib/FEDataArray.h>
 
 xpltParser::xpltParser(xpltFileReader* xplt) : m_xplt(xplt), m_ar(xplt->GetArchive())
 {
@@ -55,12 +57,26 @@ xpltFileReader::xpltFileReader(Post::FEPostModel* fem) : FEFileReader(fem)
 {
 	m_xplt = 0;
 	m_read_state_flag = XPLT_READ_ALL_STATES;
+	m_storage = Post::STORAGE_FLOAT;
 }
 
 xpltFileReader::~xpltFileReader()
 {
 }
 
+void xpltFileReader::ApplyDataStorage(Post::FEPostModel& fem)
+{
+	Post::FEDataManager& dm = *fem.GetDataManager();
+	Post::FEDataFieldPtr pd = dm.FirstDataField();
+	for (int i = 0; i < dm.DataFields(); ++i, ++pd)
+	{
+		int storage = m_storage;
+		std::map<std::string, int>::iterator it = m_fieldStorage.find((*pd)->GetName());
+		if (it != m_fieldStorage.end()) storage = it->second;
+		(*pd)->SetStorage(storage);
+	}
+}
+
 bool xpltFileReader::Load(const char* szfile)
 {
 	// open the file
@@ -107,6 +123,22 @@ bool xpltFileReader::Load(const char* szfile)
 	m_ar.Close();
 	Close();
 
+	// log the max error due to compact storage
+	if (bret)
+	{
+		Post::FEDataManager& dm = *m_fem->GetDataManager();
+		Post::FEDataFieldPtr pd = dm.FirstDataField();
+		for (int i = 0; i < dm.DataFields(); ++i, ++pd)
+		{
+			if ((*pd)->GetStorage() != Post::STORAGE_FLOAT)
+			{
+				char szmsg[256] = { 0 };
+				snprintf(szmsg, 255, "Compact storage of \"%s\": max error = %g", (*pd)->GetName().c_str(), (*pd)->StorageError());
+				logMessage(szmsg);
+			}
+		}
+	}
+
 	if (m_xplt->warnings() > 0)
 	{
 		for (int i=0; i<m_xplt->warnings(); ++i)
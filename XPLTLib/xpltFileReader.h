@@ -27,6 +27,8 @@ SOFTWARE.*/
 #pragma once
 #include "PostLib/FEFileReader.h"
 #include "xpltArchive.h"
+#include <map>
+#include <string>
 
 enum XPLT_READ_STATE_FLAG { 
 	XPLT_READ_ALL_STATES, 
@@ -105,6 +107,14 @@ public:
 	int GetReadStateFlag() const { return m_read_state_flag; }
 	vector<int> GetReadStates() const { return m_state_list; }
 
+	// set the storage mode for state data (see Post::Data_Storage). The
+	// default mode applies to all fields without a field specific mode.
+	void SetDataStorage(int n) { m_storage = n; }
+	void SetFieldStorage(const std::string& fieldName, int n) { m_fieldStorage[fieldName] = n; }
+
+	// assign the storage modes to the model's data fields
+	void ApplyDataStorage(Post::FEPostModel& fem);
+
 public:
 	xpltArchive& GetArchive() { return m_ar; }
 
@@ -121,6 +131,8 @@ private:
 	// Options
 	int			m_read_state_flag;	//!< flag setting option for reading states
 	vector<int>	m_state_list;		//!< list of states to read (only when m_read_state_flag == XPLT_READ_STATES_FROM_LIST)
+	int			m_storage;			//!< default storage mode of state data
+	std::map<std::string, int>	m_fieldStorage;	//!< field specific storage modes
 
 	friend class xpltParser;
 };
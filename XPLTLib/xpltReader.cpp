@@ -202,7 +202,7 @@ bool XpltReader::ReadRootSection(FEPostModel& fem)
 		int nid = m_ar.GetChunkID();
 		switch (nid)
 		{
-		case PLT_DICTIONARY: if (ReadDictionary(fem) == false) return false; break;
+		case PLT_DICTIONARY: if (ReadDictionary(fem) == false) return false; m_xplt->ApplyDataStorage(fem); break;
 		case PLT_MATERIALS : if (ReadMaterials (fem) == false) return false; break;
 		case PLT_GEOMETRY  : if (ReadMesh      (fem) == false) return false; break;
 		default:
@@ -238,7 +238,7 @@ bool XpltReader2::ReadRootSection(FEPostModel& fem)
 		int nid = m_ar.GetChunkID();
 		switch (nid)
 		{
-		case PLT_DICTIONARY: if (ReadDictionary(fem) == false) return false; break;
+		case PLT_DICTIONARY: if (ReadDictionary(fem) == false) return false; m_xplt->ApplyDataStorage(fem); break;
 		default:
 			return errf("Failed reading Root section");
 		}
@@ -240,7 +240,7 @@ bool XpltReader3::ReadRootSection(FEPostModel& fem)
 		int nid = m_ar.GetChunkID();
 		switch (nid)
 		{
-		case PLT_DICTIONARY: if (ReadDictionary(fem) == false) return false; break;
+		case PLT_DICTIONARY: if (ReadDictionary(fem) == false) return false; m_xplt->ApplyDataStorage(fem); break;
 		default:
 			return errf("Failed reading Root section");
 		}
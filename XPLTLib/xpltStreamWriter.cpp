@@ -0,0 +1,174 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#include "stdafx.h"
+#include "xpltStreamWriter.h"
+#include <zlib.h>
+
+xpltStreamWriter::xpltStreamWriter()
+{
+	m_fp = nullptr;
+	m_compress = false;
+	m_maxBlocks = 0;
+	m_stop = false;
+	m_error = false;
+}
+
+xpltStreamWriter::~xpltStreamWriter()
+{
+	Finish();
+}
+
+void xpltStreamWriter::Start(FILE* fp, bool compress, int threads, int maxBlocks)
+{
+	Finish();
+
+	m_fp = fp;
+	m_compress = compress;
+	m_stop = false;
+	m_error = (fp == nullptr);
+
+	// the calling thread is busy preparing blocks, so leave one core for it
+	if (threads <= 0)
+	{
+		threads = (int)std::thread::hardware_concurrency() - 1;
+		if (threads < 1) threads = 1;
+	}
+	if (m_compress == false) threads = 0;
+
+	m_maxBlocks = (maxBlocks > 0 ? maxBlocks : 2 * (threads + 1));
+
+	for (int i = 0; i < threads; ++i) m_threads.push_back(std::thread(&xpltStreamWriter::compressThread, this));
+	m_threads.push_back(std::thread(&xpltStreamWriter::writeThread, this));
+}
+
+bool xpltStreamWriter::Submit(std::vector<unsigned char>& data)
+{
+	BLOCK* pb = new BLOCK;
+	pb->data.swap(data);
+	pb->status = (m_compress ? 0 : 2);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (((int)m_queue.size() >= m_maxBlocks) && (m_error == false)) m_cv.wait(lock);
+	if (m_error || m_threads.empty())
+	{
+		delete pb;
+		return false;
+	}
+	m_queue.push_back(pb);
+	m_cv.notify_all();
+	return true;
+}
+
+bool xpltStreamWriter::Finish()
+{
+	if (m_threads.empty()) return (m_error == false);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_cv.notify_all();
+	for (size_t i = 0; i < m_threads.size(); ++i) m_threads[i].join();
+	m_threads.clear();
+
+	// anything left over was never written because of an error
+	for (size_t i = 0; i < m_queue.size(); ++i) delete m_queue[i];
+	m_queue.clear();
+
+	if (m_fp && (fflush(m_fp) != 0)) m_error = true;
+	m_fp = nullptr;
+
+	return (m_error == false);
+}
+
+void xpltStreamWriter::compressThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		// find the next block that needs to be compressed
+		BLOCK* pb = nullptr;
+		for (size_t i = 0; i < m_queue.size(); ++i)
+		{
+			if (m_queue[i]->status == 0) { pb = m_queue[i]; break; }
+		}
+
+		if (pb == nullptr)
+		{
+			if (m_stop || m_error) return;
+			m_cv.wait(lock);
+			continue;
+		}
+		pb->status = 1;
+		lock.unlock();
+
+		// each block is compressed into a separate zlib stream
+		std::vector<unsigned char>& in = pb->data;
+		uLongf nsize = compressBound((uLong)in.size());
+		std::vector<unsigned char> out(nsize);
+		bool bok = (compress2(&out[0], &nsize, (in.empty() ? nullptr : &in[0]), (uLong)in.size(), Z_DEFAULT_COMPRESSION) == Z_OK);
+		out.resize(nsize);
+		in.swap(out);
+
+		lock.lock();
+		if (bok == false) m_error = true;
+		pb->status = 2;
+		m_cv.notify_all();
+	}
+}
+
+void xpltStreamWriter::writeThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		// wait for the next block in line
+		if (m_queue.empty() || (m_queue.front()->status != 2))
+		{
+			if (m_error || (m_stop && m_queue.empty())) return;
+			m_cv.wait(lock);
+			continue;
+		}
+
+		BLOCK* pb = m_queue.front();
+		m_queue.pop_front();
+		m_cv.notify_all();
+		lock.unlock();
+
+		const std::vector<unsigned char>& d = pb->data;
+		bool bok = (d.empty() || (fwrite(&d[0], 1, d.size(), m_fp) == d.size()));
+		delete pb;
+
+		lock.lock();
+		if (bok == false)
+		{
+			m_error = true;
+			m_cv.notify_all();
+		}
+	}
+}
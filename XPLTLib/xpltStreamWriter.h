@@ -0,0 +1,81 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2020 University of Utah, The Trustees of Columbia University in 
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+#pragma once
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//-----------------------------------------------------------------------------
+// Writes a sequence of data blocks to a file, in the order in which they are
+// submitted. When compression is on, each block is compressed into its own zlib
+// stream on a worker thread while the caller prepares the next block. The number
+// of blocks in flight is bounded, so memory use does not grow with the number of blocks.
+class xpltStreamWriter
+{
+	struct BLOCK
+	{
+		std::vector<unsigned char>	data;
+		int		status;		// 0 = waiting for compression, 1 = compressing, 2 = ready to write
+	};
+
+public:
+	xpltStreamWriter();
+	~xpltStreamWriter();
+
+	// Start the pipeline. The file must remain open until Finish is called.
+	// threads   = number of compression threads (0 = pick based on hardware)
+	// maxBlocks = max number of blocks in flight (0 = twice the number of threads)
+	void Start(FILE* fp, bool compress, int threads = 0, int maxBlocks = 0);
+
+	// Submit a block. The data is moved into the pipeline, so data is empty on return.
+	// This waits if the pipeline is full. Returns false if an error occurred.
+	bool Submit(std::vector<unsigned char>& data);
+
+	// Wait until all blocks are written and stop the threads.
+	// Returns false if an error occurred.
+	bool Finish();
+
+private:
+	void compressThread();
+	void writeThread();
+
+private:
+	FILE*	m_fp;
+	bool	m_compress;
+	int		m_maxBlocks;
+	bool	m_stop;
+	bool	m_error;
+
+	std::deque<BLOCK*>			m_queue;	// blocks in submission order
+	std::vector<std::thread>	m_threads;
+	std::mutex					m_mutex;	// protects all of the above
+	std::condition_variable		m_cv;
+};